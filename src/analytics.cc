@@ -70,7 +70,7 @@ void Analytics::TrackSettingsUsage(
 
     start(new TogglAnalyticsEvent(
         user_api_token,
-        Json::StyledWriter().write(json)));
+        Json::FastWriter().write(json)));
 }
 
 void TogglAnalyticsEvent::runTask() {
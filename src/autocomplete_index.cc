@@ -0,0 +1,438 @@
+// Copyright 2015 Toggl Desktop developers.
+
+#include "../src/autocomplete_index.h"
+
+#include <algorithm>
+#include <cctype>
+#include <utility>
+
+#include "./const.h"
+#include "./related_data.h"
+#include "./time_entry.h"
+
+#include "Poco/UTF8String.h"
+
+namespace toggl {
+
+// Longest n-gram in the index, in characters
+#define kAutocompleteIndexGramLength 3
+
+// Match quality, lower is better
+#define kAutocompleteRankPrefix 0
+#define kAutocompleteRankWord 1
+#define kAutocompleteRankSubstring 2
+
+static bool isContinuationByte(const char c) {
+    return (static_cast<unsigned char>(c) & 0xC0) == 0x80;
+}
+
+static bool isWordBoundary(const char c) {
+    unsigned char uc = static_cast<unsigned char>(c);
+    return uc < 0x80 && (isspace(uc) || ispunct(uc));
+}
+
+std::string AutocompleteIndex::fold(const std::string &value) {
+    return Poco::UTF8::toLower(value);
+}
+
+// All substrings of up to kAutocompleteIndexGramLength
+// UTF-8 characters of the value
+void AutocompleteIndex::grams(
+    const std::string &value,
+    std::set<std::string> *result) {
+
+    poco_check_ptr(result);
+
+    for (size_t start = 0; start < value.size(); start++) {
+        if (isContinuationByte(value[start])) {
+            continue;
+        }
+        size_t end = start;
+        for (int n = 0; n < kAutocompleteIndexGramLength; n++) {
+            if (end >= value.size()) {
+                break;
+            }
+            end++;
+            while (end < value.size() && isContinuationByte(value[end])) {
+                end++;
+            }
+            result->insert(value.substr(start, end - start));
+        }
+    }
+}
+
+size_t AutocompleteIndex::rank(
+    const std::string &haystack,
+    const std::string &needle) {
+    size_t result(std::string::npos);
+    size_t pos = haystack.find(needle);
+    while (pos != std::string::npos) {
+        if (0 == pos) {
+            return kAutocompleteRankPrefix;
+        }
+        if (isWordBoundary(haystack[pos - 1])) {
+            result = kAutocompleteRankWord;
+        } else if (std::string::npos == result) {
+            result = kAutocompleteRankSubstring;
+        }
+        pos = haystack.find(needle, pos + 1);
+    }
+    return result;
+}
+
+bool AutocompleteIndex::same(
+    const AutocompleteItem &a,
+    const AutocompleteItem &b) {
+    // Labels are interned, so these are pointer compares
+    return a.Text == b.Text
+           && a.Description == b.Description
+           && a.ProjectAndTaskLabel == b.ProjectAndTaskLabel
+           && a.TaskLabel == b.TaskLabel
+           && a.ProjectLabel == b.ProjectLabel
+           && a.ClientLabel == b.ClientLabel
+           && a.ProjectColor == b.ProjectColor
+           && a.TaskID == b.TaskID
+           && a.ProjectID == b.ProjectID
+           && a.WorkspaceID == b.WorkspaceID
+           && a.Type == b.Type
+           && a.WorkspaceName == b.WorkspaceName;
+}
+
+void AutocompleteIndex::Update(
+    const std::vector<AutocompleteItem> &items,
+    const RelatedData &related) {
+
+    Poco::Mutex::ScopedLock lock(mutex_);
+
+    std::map<const std::string *, Poco::UInt64> ids;
+    std::vector<Poco::UInt64> order;
+
+    for (std::vector<AutocompleteItem>::const_iterator it = items.begin();
+            it != items.end(); it++) {
+        const std::string *text = &it->Text.str();
+        if (ids.find(text) != ids.end()) {
+            continue;
+        }
+
+        Poco::UInt64 id(0);
+        std::map<const std::string *, Poco::UInt64>::iterator existing =
+            ids_.find(text);
+        if (existing != ids_.end()
+                && same(entries_[existing->second].Item, *it)) {
+            id = existing->second;
+            ids_.erase(existing);
+        } else {
+            id = insert(*it);
+        }
+
+        Entry &entry = entries_[id];
+        entry.Position = order.size();
+        entry.TimeEntries = 0;
+        ids[text] = id;
+        order.push_back(id);
+    }
+
+    // Whatever is left was not in the new list
+    for (std::map<const std::string *, Poco::UInt64>::const_iterator it =
+        ids_.begin(); it != ids_.end(); it++) {
+        erase(it->second);
+    }
+
+    if (!built_ || order != order_) {
+        version_++;
+    }
+
+    ids_.swap(ids);
+    order_.swap(order);
+
+    // Link time entry items to the time entries giving them
+    time_entries_.clear();
+    for (std::vector<TimeEntry *>::const_iterator it =
+        related.TimeEntries.begin();
+            it != related.TimeEntries.end(); it++) {
+        TimeEntry *te = *it;
+        if (te->GUID().empty()) {
+            continue;
+        }
+        AutocompleteItem item;
+        if (!related.TimeEntryAutocompleteItem(te, &item)) {
+            continue;
+        }
+        std::map<const std::string *, Poco::UInt64>::const_iterator
+        found = ids_.find(&item.Text.str());
+        if (found == ids_.end()) {
+            continue;
+        }
+        Entry &entry = entries_[found->second];
+        if (!entry.Item.IsTimeEntry()) {
+            continue;
+        }
+        entry.TimeEntries++;
+        time_entries_[te->GUID()] = &item.Text.str();
+    }
+
+    built_ = true;
+}
+
+bool AutocompleteIndex::Apply(
+    const std::vector<ModelChange> &changes,
+    const RelatedData &related) {
+
+    Poco::Mutex::ScopedLock lock(mutex_);
+
+    if (!built_) {
+        return false;
+    }
+
+    // Other models are part of the labels of many items
+    for (std::vector<ModelChange>::const_iterator it = changes.begin();
+            it != changes.end(); it++) {
+        if (it->ModelType() == kModelTimeEntry) {
+            if (it->GUID().empty()) {
+                return false;
+            }
+        } else if (it->ModelType() != kModelTag
+                   && it->ModelType() != kModelUser
+                   && it->ModelType() != kModelAutotrackerRule) {
+            return false;
+        }
+    }
+
+    bool reordered(false);
+    for (std::vector<ModelChange>::const_iterator it = changes.begin();
+            it != changes.end(); it++) {
+        if (it->ModelType() != kModelTimeEntry) {
+            continue;
+        }
+
+        TimeEntry *te = related.TimeEntryByGUID(it->GUID());
+        AutocompleteItem item;
+        bool listed = te && related.TimeEntryAutocompleteItem(te, &item);
+
+        // Most edits do not change the item of the time entry
+        std::map<guid, const std::string *>::const_iterator linked =
+            time_entries_.find(it->GUID());
+        if (listed && linked != time_entries_.end()
+                && linked->second == &item.Text.str()) {
+            continue;
+        }
+
+        if (removeTimeEntry(it->GUID())) {
+            reordered = true;
+        }
+        if (listed && addTimeEntry(it->GUID(), item)) {
+            reordered = true;
+        }
+    }
+
+    if (reordered) {
+        renumber();
+        version_++;
+    }
+
+    return true;
+}
+
+bool AutocompleteIndex::addTimeEntry(
+    const guid GUID,
+    const AutocompleteItem &item) {
+
+    const std::string *text = &item.Text.str();
+    std::map<const std::string *, Poco::UInt64>::const_iterator existing =
+        ids_.find(text);
+    if (existing != ids_.end()) {
+        // Another time entry, or a task or project,
+        // already gives an item with the same text
+        Entry &entry = entries_[existing->second];
+        if (entry.Item.IsTimeEntry()) {
+            entry.TimeEntries++;
+            time_entries_[GUID] = text;
+        }
+        return false;
+    }
+
+    Poco::UInt64 id = insert(item);
+    entries_[id].TimeEntries = 1;
+    ids_[text] = id;
+    time_entries_[GUID] = text;
+
+    // Binary search for the list position of the new item
+    size_t first(0), last(order_.size());
+    while (first < last) {
+        size_t middle = first + (last - first) / 2;
+        if (compare_(entries_[order_[middle]].Item, item)) {
+            first = middle + 1;
+        } else {
+            last = middle;
+        }
+    }
+    order_.insert(order_.begin() + first, id);
+    return true;
+}
+
+bool AutocompleteIndex::removeTimeEntry(const guid GUID) {
+    std::map<guid, const std::string *>::iterator linked =
+        time_entries_.find(GUID);
+    if (linked == time_entries_.end()) {
+        return false;
+    }
+
+    std::map<const std::string *, Poco::UInt64>::iterator existing =
+        ids_.find(linked->second);
+    time_entries_.erase(linked);
+    if (existing == ids_.end()) {
+        return false;
+    }
+
+    Poco::UInt64 id = existing->second;
+    Entry &entry = entries_[id];
+    if (entry.TimeEntries > 1) {
+        entry.TimeEntries--;
+        return false;
+    }
+
+    ids_.erase(existing);
+    order_.erase(std::find(order_.begin(), order_.end(), id));
+    erase(id);
+    return true;
+}
+
+void AutocompleteIndex::renumber() {
+    for (size_t i = 0; i < order_.size(); i++) {
+        entries_[order_[i]].Position = i;
+    }
+}
+
+Poco::UInt64 AutocompleteIndex::insert(const AutocompleteItem &item) {
+    Poco::UInt64 id = ++next_id_;
+    Entry &entry = entries_[id];
+    entry.Item = item;
+    entry.Haystack = fold(item.Text + "\n"
+                          + item.Description + "\n"
+                          + item.ProjectAndTaskLabel + "\n"
+                          + item.ClientLabel + "\n"
+                          + item.WorkspaceName);
+    add(id);
+    return id;
+}
+
+void AutocompleteIndex::erase(const Poco::UInt64 id) {
+    remove(id);
+    entries_.erase(id);
+}
+
+void AutocompleteIndex::Clear() {
+    Poco::Mutex::ScopedLock lock(mutex_);
+    entries_.clear();
+    ids_.clear();
+    time_entries_.clear();
+    order_.clear();
+    postings_.clear();
+    built_ = false;
+    version_++;
+}
+
+size_t AutocompleteIndex::Size() const {
+    Poco::Mutex::ScopedLock lock(mutex_);
+    return order_.size();
+}
+
+Poco::UInt64 AutocompleteIndex::Version() const {
+    Poco::Mutex::ScopedLock lock(mutex_);
+    return version_;
+}
+
+void AutocompleteIndex::add(const Poco::UInt64 id) {
+    std::set<std::string> item_grams;
+    grams(entries_[id].Haystack, &item_grams);
+    for (std::set<std::string>::const_iterator it = item_grams.begin();
+            it != item_grams.end(); it++) {
+        postings_[*it].insert(id);
+    }
+}
+
+void AutocompleteIndex::remove(const Poco::UInt64 id) {
+    std::set<std::string> item_grams;
+    grams(entries_[id].Haystack, &item_grams);
+    for (std::set<std::string>::const_iterator it = item_grams.begin();
+            it != item_grams.end(); it++) {
+        std::map<std::string, std::set<Poco::UInt64> >::iterator posting =
+            postings_.find(*it);
+        if (posting == postings_.end()) {
+            continue;
+        }
+        posting->second.erase(id);
+        if (posting->second.empty()) {
+            postings_.erase(posting);
+        }
+    }
+}
+
+void AutocompleteIndex::Query(
+    const std::string &text,
+    const size_t limit,
+    std::vector<AutocompleteItem> *result) const {
+
+    poco_check_ptr(result);
+
+    Poco::Mutex::ScopedLock lock(mutex_);
+
+    std::string needle = fold(text);
+
+    if (needle.empty()) {
+        for (size_t i = 0; i < order_.size(); i++) {
+            if (limit && result->size() >= limit) {
+                break;
+            }
+            result->push_back(entries_.find(order_[i])->second.Item);
+        }
+        return;
+    }
+
+    // Candidates must contain every n-gram of the needle;
+    // start from the rarest one.
+    std::set<std::string> needle_grams;
+    grams(needle, &needle_grams);
+    std::vector<const std::set<Poco::UInt64> *> lists;
+    for (std::set<std::string>::const_iterator it = needle_grams.begin();
+            it != needle_grams.end(); it++) {
+        std::map<std::string, std::set<Poco::UInt64> >::const_iterator
+        posting = postings_.find(*it);
+        if (posting == postings_.end()) {
+            return;
+        }
+        lists.push_back(&posting->second);
+    }
+    const std::set<Poco::UInt64> *rarest = lists.front();
+    for (size_t i = 1; i < lists.size(); i++) {
+        if (lists[i]->size() < rarest->size()) {
+            rarest = lists[i];
+        }
+    }
+
+    // Rank and list position of each match
+    std::vector<std::pair<size_t, size_t> > matches;
+    for (std::set<Poco::UInt64>::const_iterator it = rarest->begin();
+            it != rarest->end(); it++) {
+        const Entry &entry = entries_.find(*it)->second;
+        size_t match_rank = rank(entry.Haystack, needle);
+        if (std::string::npos == match_rank) {
+            continue;
+        }
+        matches.push_back(std::make_pair(match_rank, entry.Position));
+    }
+
+    size_t count = matches.size();
+    if (limit && limit < count) {
+        count = limit;
+    }
+    std::partial_sort(matches.begin(), matches.begin() + count,
+                      matches.end());
+
+    for (size_t i = 0; i < count; i++) {
+        result->push_back(
+            entries_.find(order_[matches[i].second])->second.Item);
+    }
+}
+
+}   // namespace toggl
@@ -0,0 +1,136 @@
+// Copyright 2015 Toggl Desktop developers.
+
+#ifndef SRC_AUTOCOMPLETE_INDEX_H_
+#define SRC_AUTOCOMPLETE_INDEX_H_
+
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+
+#include "./autocomplete_item.h"
+#include "./model_change.h"
+#include "./types.h"
+
+#include "Poco/Mutex.h"
+#include "Poco/Types.h"
+
+namespace toggl {
+
+class RelatedData;
+
+#define kAutocompleteQueryTimeEntry 0
+#define kAutocompleteQueryMinitimer 1
+#define kAutocompleteQueryProject 2
+
+// Order of items in an autocomplete list
+typedef bool (*AutocompleteItemCompare)(AutocompleteItem, AutocompleteItem);
+
+// Search index over an autocomplete list. Items are matched
+// case-insensitively by any substring of their text and labels,
+// using the n-grams (up to 3 characters) of the folded text.
+// Updating the index only re-indexes the items that changed.
+class AutocompleteIndex {
+ public:
+    explicit AutocompleteIndex(AutocompleteItemCompare compare)
+        : compare_(compare)
+    , next_id_(0)
+    , version_(0)
+    , built_(false) {}
+
+    // Replace the indexed list, sorted in list order. Items keep
+    // that order as their rank among matches of equal quality.
+    // Time entry items are linked to the time entries in related
+    // data that give them, so that Apply can update them later.
+    void Update(
+        const std::vector<AutocompleteItem> &items,
+        const RelatedData &related);
+
+    // Update time entry items from the time entries in the given
+    // changes, leaving the rest of the index as it is. Returns false
+    // if the changes affect other items too, or the index was not
+    // built yet; the index must then be updated from the full list.
+    bool Apply(
+        const std::vector<ModelChange> &changes,
+        const RelatedData &related);
+
+    void Clear();
+
+    size_t Size() const;
+
+    // Changes whenever items are added to or removed from the
+    // list, so UI needs to be shown the list only then
+    Poco::UInt64 Version() const;
+
+    // Matching items, best first: matches at the start of the text,
+    // then at the start of a word, then anywhere. Empty text
+    // matches all items. Zero limit returns all matches.
+    void Query(
+        const std::string &text,
+        const size_t limit,
+        std::vector<AutocompleteItem> *result) const;
+
+ private:
+    class Entry {
+     public:
+        Entry()
+            : Haystack("")
+        , Position(0)
+        , TimeEntries(0) {}
+
+        AutocompleteItem Item;
+        std::string Haystack;
+        size_t Position;
+
+        // Number of time entries that give this item
+        size_t TimeEntries;
+    };
+
+    static std::string fold(const std::string &value);
+    static void grams(
+        const std::string &value,
+        std::set<std::string> *result);
+    static size_t rank(
+        const std::string &haystack,
+        const std::string &needle);
+
+    static bool same(const AutocompleteItem &a, const AutocompleteItem &b);
+
+    Poco::UInt64 insert(const AutocompleteItem &item);
+    void erase(const Poco::UInt64 id);
+    // Return true if an item was added or removed
+    bool addTimeEntry(const guid GUID, const AutocompleteItem &item);
+    bool removeTimeEntry(const guid GUID);
+    void renumber();
+
+    void add(const Poco::UInt64 id);
+    void remove(const Poco::UInt64 id);
+
+    mutable Poco::Mutex mutex_;
+
+    AutocompleteItemCompare compare_;
+
+    Poco::UInt64 next_id_;
+
+    Poco::UInt64 version_;
+
+    bool built_;
+
+    std::map<Poco::UInt64, Entry> entries_;
+
+    // Item ID by interned item text; texts are unique within a list
+    std::map<const std::string *, Poco::UInt64> ids_;
+
+    // Interned item text by GUID of the time entry that gives it
+    std::map<guid, const std::string *> time_entries_;
+
+    // Item IDs in list order
+    std::vector<Poco::UInt64> order_;
+
+    // Item IDs by n-gram of folded item text
+    std::map<std::string, std::set<Poco::UInt64> > postings_;
+};
+
+}  // namespace toggl
+
+#endif  // SRC_AUTOCOMPLETE_INDEX_H_
@@ -6,6 +6,8 @@
 #include <string>
 #include <sstream>
 
+#include "./string_pool.h"
+
 #include "Poco/Types.h"
 
 namespace toggl {
@@ -15,6 +17,8 @@ namespace toggl {
 #define kAutocompleteItemProject 2
 #define kAutocompleteItemWorkspace 3
 
+// Labels are interned, as the same names and descriptions
+// repeat across many items and autocomplete lists.
 class AutocompleteItem {
  public:
     AutocompleteItem()
@@ -63,18 +67,18 @@ class AutocompleteItem {
         return ss.str();
     }
 
-    std::string Text;
-    std::string Description;
-    std::string ProjectAndTaskLabel;
-    std::string TaskLabel;
-    std::string ProjectLabel;
-    std::string ClientLabel;
-    std::string ProjectColor;
+    InternedString Text;
+    InternedString Description;
+    InternedString ProjectAndTaskLabel;
+    InternedString TaskLabel;
+    InternedString ProjectLabel;
+    InternedString ClientLabel;
+    InternedString ProjectColor;
     Poco::UInt64 TaskID;
     Poco::UInt64 ProjectID;
     Poco::UInt64 WorkspaceID;
     Poco::UInt64 Type;
-    std::string WorkspaceName;
+    InternedString WorkspaceName;
 };
 
 }  // namespace toggl
@@ -8,7 +8,9 @@
 #include "./const.h"
 #include "./database.h"
 #include "./formatter.h"
+#include "./json_writer.h"
 #include "./model_change.h"
+#include "./model_index.h"
 
 #include "Poco/Timestamp.h"
 #include "Poco/DateTime.h"
@@ -17,6 +19,12 @@
 
 namespace toggl {
 
+BaseModel::~BaseModel() {
+    if (index_) {
+        index_->Remove(this);
+    }
+}
+
 bool BaseModel::NeedsPush() const {
     // Note that if a model has a validation error previously
     // received and attached from the backend, the model won't be
@@ -78,9 +86,23 @@ void BaseModel::SetUpdatedAt(const Poco::UInt64 value) {
     }
 }
 
+void BaseModel::SetLocalID(const Poco::Int64 value) {
+    if (local_id_ != value) {
+        Poco::Int64 old_value = local_id_;
+        local_id_ = value;
+        if (index_) {
+            index_->LocalIDChanged(this, old_value);
+        }
+    }
+}
+
 void BaseModel::SetGUID(const std::string value) {
     if (guid_ != value) {
+        guid old_value = guid_;
         guid_ = value;
+        if (index_) {
+            index_->GUIDChanged(this, old_value);
+        }
         SetDirty();
     }
 }
@@ -101,7 +123,11 @@ void BaseModel::SetUID(const Poco::UInt64 value) {
 
 void BaseModel::SetID(const Poco::UInt64 value) {
     if (id_ != value) {
+        Poco::UInt64 old_value = id_;
         id_ = value;
+        if (index_) {
+            index_->IDChanged(this, old_value);
+        }
         SetDirty();
     }
 }
@@ -198,12 +224,51 @@ error BaseModel::BatchUpdateJSON(Json::Value *result) const {
     return noError;
 }
 
+void BaseModel::WriteJSON(JSONWriter *writer) const {
+    poco_check_ptr(writer);
+    writer->Value(SaveToJSON());
+}
+
+error BaseModel::WriteBatchUpdateJSON(JSONWriter *writer) const {
+    poco_check_ptr(writer);
+
+    if (GUID().empty()) {
+        return error("Cannot export model to batch update without a GUID");
+    }
+
+    writer->BeginObject();
+    writer->Key("method");
+    writer->String(batchUpdateMethod());
+    writer->Key("relative_url");
+    writer->String(batchUpdateRelativeURL());
+    writer->Key("guid");
+    writer->String(GUID());
+    writer->Key("body");
+    writer->BeginObject();
+    writer->Key(ModelName().c_str());
+    WriteJSON(writer);
+    writer->EndObject();
+    writer->EndObject();
+
+    return noError;
+}
+
 Poco::Logger &BaseModel::logger() const {
     return Poco::Logger::get(ModelName());
 }
 
 void BaseModel::SetDirty() {
     dirty_ = true;
+    if (index_) {
+        index_->MarkDirty(this);
+    }
+}
+
+void BaseModel::ClearDirty() {
+    dirty_ = false;
+    if (index_) {
+        index_->ClearDirty(this);
+    }
 }
 
 }   // namespace toggl
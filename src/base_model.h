@@ -21,6 +21,8 @@ class Logger;
 namespace toggl {
 
 class BatchUpdateResult;
+class JSONWriter;
+class ModelIndex;
 
 class BaseModel {
  public:
@@ -31,18 +33,17 @@ class BaseModel {
     , ui_modified_at_(0)
     , uid_(0)
     , dirty_(false)
-    , deleted_at_(0)
     , is_marked_as_deleted_on_server_(false)
+    , deleted_at_(0)
     , updated_at_(0)
-    , validation_error_("") {}
-    virtual ~BaseModel() {}
+    , validation_error_("")
+    , index_() {}
+    virtual ~BaseModel();
 
     const Poco::Int64 &LocalID() const {
         return local_id_;
     }
-    void SetLocalID(const Poco::Int64 value) {
-        local_id_ = value;
-    }
+    void SetLocalID(const Poco::Int64 value);
 
     const Poco::UInt64 &ID() const {
         return id_;
@@ -71,9 +72,7 @@ class BaseModel {
     const bool &Dirty() const {
         return dirty_;
     }
-    void ClearDirty() {
-        dirty_ = false;
-    }
+    void ClearDirty();
 
     // Deleting a time entry hides it from
     // UI and flags it for removal from server:
@@ -120,11 +119,15 @@ class BaseModel {
     virtual std::string ModelName() const = 0;
     virtual std::string ModelURL() const = 0;
 
-    virtual void LoadFromJSON(Json::Value value) {}
+    virtual void LoadFromJSON(const Json::Value &value) {}
     virtual Json::Value SaveToJSON() const {
         return 0;
     }
 
+    // Same as SaveToJSON, written straight into a writer.
+    // Models pushed in bulk override it to skip the tree.
+    virtual void WriteJSON(JSONWriter *writer) const;
+
     virtual bool DuplicateResource(const toggl::error) const {
         return false;
     }
@@ -143,6 +146,7 @@ class BaseModel {
 
     // Convert model JSON into batch update format.
     error BatchUpdateJSON(Json::Value *result) const;
+    error WriteBatchUpdateJSON(JSONWriter *writer) const;
 
  protected:
     Poco::Logger &logger() const;
@@ -159,13 +163,40 @@ class BaseModel {
     Poco::UInt64 ui_modified_at_;
     Poco::UInt64 uid_;
     bool dirty_;
-    Poco::UInt64 deleted_at_;
     bool is_marked_as_deleted_on_server_;
+    Poco::UInt64 deleted_at_;
     Poco::UInt64 updated_at_;
 
     // If model push to backend results in an error,
     // the error is attached to the model for later inspection.
     std::string validation_error_;
+
+    // Lookup index the model is registered in, see RelatedData.
+    // Copies of a model are not part of any index.
+    class IndexRef {
+     public:
+        IndexRef() : index_(nullptr) {}
+        IndexRef(const IndexRef &) : index_(nullptr) {}
+        IndexRef &operator=(const IndexRef &) {
+            return *this;
+        }
+        IndexRef &operator=(ModelIndex *value) {
+            index_ = value;
+            return *this;
+        }
+        operator ModelIndex *() const {
+            return index_;
+        }
+        ModelIndex *operator->() const {
+            return index_;
+        }
+
+     private:
+        ModelIndex *index_;
+    };
+    IndexRef index_;
+
+    friend class ModelIndex;
 };
 
 }  // namespace toggl
@@ -45,6 +45,15 @@ class BatchUpdateResult {
         std::vector<error> *errors);
 };
 
+// Notified after each pushed batch has been applied to the models,
+// so the progress can be saved before the next batch goes out.
+class BatchUpdateMonitor {
+ public:
+    virtual ~BatchUpdateMonitor() {}
+
+    virtual error BatchUpdateApplied() = 0;
+};
+
 }  // namespace toggl
 
 #endif  // SRC_BATCH_UPDATE_RESULT_H_
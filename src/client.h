@@ -13,6 +13,7 @@
 
 #include "./base_model.h"
 #include "./const.h"
+#include "./string_pool.h"
 
 namespace toggl {
 
@@ -42,7 +43,7 @@ class Client : public BaseModel {
         return "/api/v8/clients";
     }
 
-    void LoadFromJSON(Json::Value value);
+    void LoadFromJSON(const Json::Value &value);
     Json::Value SaveToJSON() const;
 
     bool ResolveError(const toggl::error);
@@ -51,7 +52,7 @@ class Client : public BaseModel {
 
  private:
     Poco::UInt64 wid_;
-    std::string name_;
+    InternedString name_;
 
     static bool nameHasAlreadyBeenTaken(const error err);
 };
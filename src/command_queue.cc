@@ -0,0 +1,200 @@
+// Copyright 2015 Toggl Desktop developers.
+
+#include "../src/command_queue.h"
+
+#include <sstream>
+
+#include "Poco/Exception.h"
+#include "Poco/Logger.h"
+
+namespace toggl {
+
+// Longest sleep while no commands are queued
+#define kCommandQueueIdleMillis 60000
+
+CommandQueue::CommandQueue(const size_t max_depth)
+    : max_depth_(max_depth)
+, last_id_(0)
+, shutdown_(false)
+, reserved_(0)
+, busy_(false)
+, monitor_(nullptr)
+, pool_(1, 1)
+, running_(this, &CommandQueue::run) {
+    running_.start(pool_);
+}
+
+CommandQueue::~CommandQueue() {
+    Shutdown();
+}
+
+Poco::Logger &CommandQueue::logger() const {
+    return Poco::Logger::get("CommandQueue");
+}
+
+void CommandQueue::SetMonitor(CommandStateMonitor *monitor) {
+    Poco::Mutex::ScopedLock lock(mutex_);
+    monitor_ = monitor;
+}
+
+Poco::UInt64 CommandQueue::Enqueue(Command *command) {
+    poco_check_ptr(command);
+
+    Entry entry;
+    entry.Cmd = command;
+    bool accepted(false);
+    {
+        Poco::Mutex::ScopedLock lock(mutex_);
+        entry.ID = ++last_id_;
+        if (shutdown_ || queue_.size() + reserved_ >= max_depth_) {
+            stats_.Rejected++;
+        } else {
+            // Keep a place in the queue until UI has been told
+            // the command is queued, so that it hears of it
+            // before hearing that it is done
+            reserved_++;
+            accepted = true;
+        }
+    }
+
+    if (!accepted) {
+        std::stringstream ss;
+        ss << "Command queue is full, refused " << command->Name();
+        logger().warning(ss.str());
+        displayState(entry, kCommandStateRejected, error(ss.str()));
+        delete command;
+        return 0;
+    }
+
+    displayState(entry, kCommandStateQueued, noError);
+
+    {
+        Poco::Mutex::ScopedLock lock(mutex_);
+        reserved_--;
+        entry.QueuedAt.update();
+        queue_.push_back(entry);
+        stats_.Queued++;
+        if (queue_.size() > stats_.MaxDepth) {
+            stats_.MaxDepth = queue_.size();
+        }
+    }
+    wakeup_.Signal();
+
+    return entry.ID;
+}
+
+void CommandQueue::Drain() {
+    Poco::Mutex::ScopedLock lock(mutex_);
+    while (busy_ || reserved_ || !queue_.empty()) {
+        drained_.wait(mutex_);
+    }
+}
+
+void CommandQueue::Shutdown() {
+    {
+        Poco::Mutex::ScopedLock lock(mutex_);
+        shutdown_ = true;
+    }
+    if (running_.isRunning()) {
+        running_.stop();
+        wakeup_.Signal();
+        running_.wait();
+    }
+}
+
+size_t CommandQueue::Depth() const {
+    Poco::Mutex::ScopedLock lock(mutex_);
+    return queue_.size();
+}
+
+CommandQueueStats CommandQueue::Stats() const {
+    Poco::Mutex::ScopedLock lock(mutex_);
+    return stats_;
+}
+
+void CommandQueue::displayState(
+    const Entry &entry,
+    const Poco::Int64 state,
+    const error err) {
+    CommandStateMonitor *monitor(nullptr);
+    {
+        Poco::Mutex::ScopedLock lock(mutex_);
+        monitor = monitor_;
+    }
+    if (monitor) {
+        monitor->DisplayCommandState(
+            entry.ID, entry.Cmd->Name(), state, err);
+    }
+}
+
+void CommandQueue::run() {
+    while (true) {
+        Entry entry;
+        {
+            Poco::Mutex::ScopedLock lock(mutex_);
+            if (!queue_.empty()) {
+                entry = queue_.front();
+                queue_.pop_front();
+                busy_ = true;
+
+                Poco::UInt64 wait = entry.QueuedAt.elapsed();
+                stats_.TotalWaitMicros += wait;
+                if (wait > stats_.MaxWaitMicros) {
+                    stats_.MaxWaitMicros = wait;
+                }
+            } else if (running_.isStopped() && !reserved_) {
+                break;
+            }
+        }
+
+        if (!entry.Cmd) {
+            wakeup_.Wait(kCommandQueueIdleMillis);
+            continue;
+        }
+
+        error err = noError;
+        try {
+            err = entry.Cmd->Run();
+        } catch(const Poco::Exception& exc) {
+            err = exc.displayText();
+        } catch(const std::exception& ex) {
+            err = ex.what();
+        } catch(const std::string& ex) {
+            err = ex;
+        }
+
+        {
+            Poco::Mutex::ScopedLock lock(mutex_);
+            if (noError == err) {
+                stats_.Done++;
+            } else {
+                stats_.Failed++;
+            }
+        }
+
+        if (noError != err) {
+            logger().error(entry.Cmd->Name() + ": " + err);
+            displayState(entry, kCommandStateFailed, err);
+        } else {
+            displayState(entry, kCommandStateDone, noError);
+        }
+
+        delete entry.Cmd;
+
+        {
+            Poco::Mutex::ScopedLock lock(mutex_);
+            busy_ = false;
+        }
+        drained_.broadcast();
+    }
+
+    CommandQueueStats stats = Stats();
+    std::stringstream ss;
+    ss << "Command queue stopped, " << stats.Done << " done, "
+       << stats.Failed << " failed, " << stats.Rejected << " refused, "
+       << "most queued at once " << stats.MaxDepth << ", "
+       << "longest wait " << stats.MaxWaitMicros / 1000 << " ms";
+    logger().debug(ss.str());
+}
+
+}   // namespace toggl
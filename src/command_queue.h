@@ -0,0 +1,163 @@
+// Copyright 2015 Toggl Desktop developers.
+
+#ifndef SRC_COMMAND_QUEUE_H_
+#define SRC_COMMAND_QUEUE_H_
+
+#include <deque>
+#include <string>
+
+#include "./const.h"
+#include "./types.h"
+#include "./wakeup.h"
+
+#include "Poco/Activity.h"
+#include "Poco/Condition.h"
+#include "Poco/Mutex.h"
+#include "Poco/ThreadPool.h"
+#include "Poco/Timestamp.h"
+#include "Poco/Types.h"
+
+namespace Poco {
+class Logger;
+}
+
+namespace toggl {
+
+// A change requested by UI, run later on the command queue thread
+class Command {
+ public:
+    explicit Command(const std::string name)
+        : name_(name) {}
+    virtual ~Command() {}
+
+    const std::string &Name() const {
+        return name_;
+    }
+
+    virtual error Run() = 0;
+
+ private:
+    std::string name_;
+};
+
+// Is told when a command has been queued, rejected, run or has failed
+class CommandStateMonitor {
+ public:
+    virtual ~CommandStateMonitor() {}
+
+    virtual void DisplayCommandState(
+        const Poco::UInt64 command_id,
+        const std::string &name,
+        const Poco::Int64 state,
+        const error err) = 0;
+};
+
+class CommandQueueStats {
+ public:
+    CommandQueueStats()
+        : Queued(0)
+    , Done(0)
+    , Failed(0)
+    , Rejected(0)
+    , MaxDepth(0)
+    , TotalWaitMicros(0)
+    , MaxWaitMicros(0) {}
+
+    Poco::UInt64 Queued;
+    Poco::UInt64 Done;
+    Poco::UInt64 Failed;
+
+    // Commands refused because the queue was full
+    Poco::UInt64 Rejected;
+
+    // Most commands that have been waiting at once
+    size_t MaxDepth;
+
+    // How long commands waited in the queue before they ran
+    Poco::UInt64 TotalWaitMicros;
+    Poco::UInt64 MaxWaitMicros;
+};
+
+// Runs commands one at a time, in the order they were queued,
+// on a thread of its own, so that the thread queueing them does
+// not wait for database writes and UI updates. The queue is
+// bounded, and commands are refused when it is full.
+class CommandQueue {
+ public:
+    explicit CommandQueue(const size_t max_depth = kCommandQueueMaxDepth);
+    ~CommandQueue();
+
+    void SetMonitor(CommandStateMonitor *monitor);
+
+    // Takes ownership of the command. Returns the command ID,
+    // or 0 if the command was refused.
+    Poco::UInt64 Enqueue(Command *command);
+
+    // Wait until the commands still in the queue have run.
+    // Commands queued after this run as usual.
+    void Drain();
+
+    // Run the commands still in the queue, and stop.
+    // Commands queued after this are refused.
+    void Shutdown();
+
+    // Number of commands waiting to run
+    size_t Depth() const;
+
+    CommandQueueStats Stats() const;
+
+ protected:
+    // Activity callback
+    void run();
+
+ private:
+    class Entry {
+     public:
+        Entry()
+            : ID(0)
+        , Cmd(nullptr)
+        , QueuedAt() {}
+
+        Poco::UInt64 ID;
+        Command *Cmd;
+        Poco::Timestamp QueuedAt;
+    };
+
+    void displayState(
+        const Entry &entry,
+        const Poco::Int64 state,
+        const error err);
+
+    Poco::Logger &logger() const;
+
+    mutable Poco::Mutex mutex_;
+
+    std::deque<Entry> queue_;
+    size_t max_depth_;
+    Poco::UInt64 last_id_;
+    bool shutdown_;
+
+    // Accepted commands not yet in the queue
+    size_t reserved_;
+
+    // Set while a command runs. Signalled when the last
+    // command in the queue is done.
+    bool busy_;
+    Poco::Condition drained_;
+
+    CommandQueueStats stats_;
+
+    CommandStateMonitor *monitor_;
+
+    // Set when commands are queued, and on shutdown
+    Wakeup wakeup_;
+
+    // The activity runs on a pool of its own, so that stopping
+    // the default pool does not stop the queue
+    Poco::ThreadPool pool_;
+    Poco::Activity<CommandQueue> running_;
+};
+
+}  // namespace toggl
+
+#endif  // SRC_COMMAND_QUEUE_H_
@@ -7,6 +7,9 @@
 
 #define kMaxTimeEntryDurationSeconds 3600000
 #define kHTTPClientTimeoutSeconds 30
+#define kHTTPClientKeepAliveSeconds 15
+#define kHTTPClientIdleConnectionsPerHost 4
+#define kHTTPClientCompressMinBytes 1024
 #define kSyncIntervalRangeSeconds 900
 #define kWebsocketRestartRangeSeconds 45
 #define kCheckUpdateIntervalSeconds 86400
@@ -15,11 +18,29 @@
 #define kTimelineSecondsToKeep 604800
 #define kWindowFocusThresholdSeconds 10
 #define kAutotrackerThresholdSeconds 10
+
+// Shortest and longest wait for a focused
+// window change before checking anyway
+#define kWindowChangeMinWaitMillis 500
+#define kWindowChangeMaxWaitMillis 10000
+
+// How often durations of running days are updated in UI
+#define kUIUpdateIntervalMillis 10000
+
 #define kBetaChannelPercentage 25
 #define kTimelineChunkSeconds 900
 #define kEnterpriseInstall false
 #define kDebianPackage false
 #define kTimelineUploadIntervalSeconds 60
+#define kTimeEntryResidentDays 9
+#define kTimeEntryPageDays 30
+
+// Copy-on-write buckets of view snapshots, by time entry GUID
+#define kViewSnapshotGUIDBuckets 64
+
+// Models pushed per batch_updates request
+#define kBatchUpdateMaxSize 100
+#define kTimeEntryPoolSlabSize 1024
 #define kTimelineUploadMaxBackoffSeconds (kTimelineUploadIntervalSeconds * 10)  // NOLINT
 
 #define kLostPasswordURL "https://toggl.com/forgot-password?desktop=true"
@@ -63,6 +84,14 @@
 #define kOnlineStateNoNetwork 1
 #define kOnlineStateBackendDown 2
 
+#define kCommandStateQueued 0
+#define kCommandStateDone 1
+#define kCommandStateFailed 2
+#define kCommandStateRejected 3
+
+// Most UI commands waiting to run at once, in async mode
+#define kCommandQueueMaxDepth 100
+
 #define kSyncStateIdle 0
 #define kSyncStateWork 1
 
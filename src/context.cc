@@ -50,23 +50,41 @@ namespace toggl {
 
 std::string Context::log_path_ = "";
 
+// Keys of scheduled tasks
+const std::string kTaskSync = "sync";
+const std::string kTaskPushChanges = "push_changes";
+const std::string kTaskWebSocketOff = "websocket_off";
+const std::string kTaskWebSocketOn = "websocket_on";
+const std::string kTaskTimelineOff = "timeline_off";
+const std::string kTaskTimelineOn = "timeline_on";
+const std::string kTaskFetchUpdates = "fetch_updates";
+const std::string kTaskPeriodicSync = "periodic_sync";
+const std::string kTaskPeriodicUpdateCheck = "periodic_update_check";
+const std::string kTaskTimelineSettings = "timeline_settings";
+const std::string kTaskFeedback = "feedback";
+const std::string kTaskTrackSettingsUsage = "track_settings_usage";
+const std::string kTaskRemind = "remind";
+const std::string kTaskRender = "render";
+
 Context::Context(const std::string app_name, const std::string app_version)
     : db_(nullptr)
 , user_(nullptr)
 , timeline_uploader_(nullptr)
 , window_change_recorder_(nullptr)
 , next_sync_at_(0)
-, next_push_changes_at_(0)
-, next_fetch_updates_at_(0)
-, next_update_timeline_settings_at_(0)
-, next_reminder_at_(0)
-, next_analytics_at_(0)
+, async_commands_(false)
+, deferred_rendering_(true)
+, render_delay_millis_(0)
+, snapshot_(new ViewSnapshot())
 , time_entry_editor_guid_("")
 , environment_("production")
 , idle_(&ui_)
 , last_sync_started_(0)
 , sync_interval_seconds_(0)
 , update_check_disabled_(false)
+, time_entry_autocomplete_(CompareAutocompleteItems)
+, minitimer_autocomplete_(CompareAutocompleteItems)
+, project_autocomplete_(CompareStructuredAutocompleteItems)
 , quit_(false)
 , ui_updater_(this, &Context::uiUpdaterActivity)
 , update_path_("")
@@ -82,6 +100,8 @@ Context::Context(const std::string app_name, const std::string app_version)
 
     Poco::Crypto::OpenSSLInitializer::initialize();
 
+    commands_.SetMonitor(&ui_);
+
     startPeriodicUpdateCheck();
 
     startPeriodicSync();
@@ -94,6 +114,11 @@ Context::Context(const std::string app_name, const std::string app_version)
 Context::~Context() {
     SetQuit();
 
+    commands_.Shutdown();
+
+    scheduler_.Shutdown();
+    renderer_.Shutdown();
+
     stopActivities();
 
     {
@@ -121,7 +146,7 @@ Context::~Context() {
     }
 
     {
-        Poco::Mutex::ScopedLock lock(user_m_);
+        ModelLock::ScopedWrite lock(&model_lock_);
         if (user_) {
             delete user_;
             user_ = nullptr;
@@ -136,6 +161,7 @@ void Context::stopActivities() {
         Poco::Mutex::ScopedLock lock(ui_updater_m_);
         if (ui_updater_.isRunning()) {
             ui_updater_.stop();
+            ui_updater_wakeup_.Signal();
             ui_updater_.wait();
         }
     }
@@ -163,13 +189,14 @@ void Context::stopActivities() {
 }
 
 void Context::Shutdown() {
+    // Commands UI was told are queued still run
+    commands_.Drain();
+
     stopActivities();
 
     // cancel tasks but allow them finish
-    {
-        Poco::Mutex::ScopedLock lock(timer_m_);
-        timer_.cancel(true);
-    }
+    scheduler_.CancelAll();
+    renderer_.CancelAll();
 
     // Stops all running threads and waits for their completion.
     Poco::ThreadPool::defaultPool().stopAll();
@@ -239,6 +266,8 @@ void Context::displayUI() {
 }
 
 error Context::save(const bool push_changes) {
+    ModelLock::ScopedWrite lock(&model_lock_);
+
     logger().debug("save");
     try {
         std::vector<ModelChange> changes;
@@ -247,7 +276,8 @@ error Context::save(const bool push_changes) {
             return err;
         }
 
-        updateUI(&changes);
+        publishSnapshot(changes);
+        render(&changes);
 
         if (push_changes) {
             pushChanges();
@@ -276,7 +306,53 @@ error Context::save(const bool push_changes) {
     return noError;
 }
 
+void Context::render(std::vector<ModelChange> *changes) {
+    if (!deferred_rendering_) {
+        updateUI(changes);
+        return;
+    }
+
+    {
+        Poco::Mutex::ScopedLock lock(render_m_);
+        render_changes_.insert(render_changes_.end(),
+                               changes->begin(), changes->end());
+    }
+
+    Poco::Util::TimerTask::Ptr ptask =
+        new Poco::Util::TimerTaskAdapter<Context>(*this, &Context::onRender);
+
+    Poco::Timestamp render_at;
+    render_at += render_delay_millis_ * 1000;
+    renderer_.Schedule(kTaskRender, ptask, render_at, kTaskPriorityUI);
+}
+
+void Context::onRender(Poco::Util::TimerTask& task) {  // NOLINT
+    ModelLock::ScopedRead lock(&model_lock_);
+
+    std::vector<ModelChange> changes;
+    {
+        Poco::Mutex::ScopedLock render_lock(render_m_);
+        changes.swap(render_changes_);
+    }
+
+    if (changes.empty() || quit_) {
+        return;
+    }
+
+    updateUI(&changes);
+}
+
+TaskStats Context::RenderStats() const {
+    return renderer_.Stats(kTaskRender);
+}
+
+TaskStats Context::SyncStats() const {
+    return scheduler_.Stats(kTaskSync);
+}
+
 void Context::updateUI(std::vector<ModelChange> *changes) {
+    Poco::Mutex::ScopedLock view_lock(view_m_);
+
     // Assume nothing needs to be updated
     bool display_time_entries(false);
     bool display_time_entry_autocomplete(false);
@@ -290,6 +366,10 @@ void Context::updateUI(std::vector<ModelChange> *changes) {
     bool open_time_entry_list(false);
     bool display_autotracker_rules(false);
 
+    // Time entry changes can be sent to UI as list deltas,
+    // as long as no labels or other list items are affected
+    bool time_entry_list_changes_only(true);
+
     // Check what needs to be updated in UI
     for (std::vector<ModelChange>::const_iterator it =
         changes->begin();
@@ -312,6 +392,7 @@ void Context::updateUI(std::vector<ModelChange> *changes) {
         if (ch.ModelType() != kModelTag && ch.ModelType() != kModelUser
                 && ch.ModelType() != kModelTimeEntry) {
             display_project_autocomplete = true;
+            time_entry_list_changes_only = false;
         }
 
         if (ch.ModelType() == kModelClient
@@ -350,13 +431,19 @@ void Context::updateUI(std::vector<ModelChange> *changes) {
         }
     }
     if (display_time_entries) {
-        DisplayTimeEntryList(open_time_entry_list);
+        if (time_entry_list_changes_only && !open_time_entry_list
+                && UI()->CanDisplayTimeEntryListChanges()
+                && time_entry_list_.Initialized()) {
+            displayTimeEntryListChanges(changes);
+        } else {
+            DisplayTimeEntryList(open_time_entry_list);
+        }
     }
     if (display_time_entry_autocomplete) {
-        displayTimeEntryAutocomplete();
+        displayTimeEntryAutocomplete(changes);
     }
     if (display_mini_timer_autocomplete) {
-        displayMinitimerAutocomplete();
+        displayMinitimerAutocomplete(changes);
     }
     if (display_project_autocomplete) {
         displayProjectAutocomplete();
@@ -378,33 +465,86 @@ void Context::updateUI(std::vector<ModelChange> *changes) {
     }
 }
 
-void Context::displayTimeEntryAutocomplete() {
-    if (user_) {
-        std::vector<AutocompleteItem> list =
-            user_->related.TimeEntryAutocompleteItems();
+bool Context::updateAutocompleteIndex(
+    AutocompleteIndex *index,
+    const std::vector<AutocompleteItem> &list,
+    std::vector<ModelChange> const *changes) {
+
+    poco_check_ptr(index);
+
+    Poco::UInt64 version = index->Version();
+    if (!user_) {
+        index->Clear();
+    } else if (!changes || !index->Apply(*changes, user_->related)) {
+        index->Update(list, user_->related);
+    }
+    return index->Version() != version;
+}
+
+void Context::displayTimeEntryAutocomplete(
+    std::vector<ModelChange> const *changes) {
+    ViewSnapshotPtr snapshot = Snapshot();
+    if (snapshot->LoggedIn()) {
+        // Most changes leave the list as it is, and
+        // UI is shown the list only when it changes
+        if (!updateAutocompleteIndex(&time_entry_autocomplete_,
+                                     snapshot->TimeEntryAutocomplete(),
+                                     changes) && changes) {
+            return;
+        }
+        std::vector<AutocompleteItem> list = snapshot->TimeEntryAutocomplete();
         UI()->DisplayTimeEntryAutocomplete(&list);
     }
 }
 
-void Context::displayMinitimerAutocomplete() {
-    if (user_) {
-        std::vector<AutocompleteItem> list =
-            user_->related.MinitimerAutocompleteItems();
+void Context::displayMinitimerAutocomplete(
+    std::vector<ModelChange> const *changes) {
+    ViewSnapshotPtr snapshot = Snapshot();
+    if (snapshot->LoggedIn()) {
+        if (!updateAutocompleteIndex(&minitimer_autocomplete_,
+                                     snapshot->MinitimerAutocomplete(),
+                                     changes) && changes) {
+            return;
+        }
+        std::vector<AutocompleteItem> list = snapshot->MinitimerAutocomplete();
         UI()->DisplayMinitimerAutocomplete(&list);
     }
 }
 
 void Context::displayProjectAutocomplete() {
-    if (user_) {
-        std::vector<AutocompleteItem> list =
-            user_->related.ProjectAutocompleteItems();
+    ViewSnapshotPtr snapshot = Snapshot();
+    if (snapshot->LoggedIn()) {
+        std::vector<AutocompleteItem> list = snapshot->ProjectAutocomplete();
+        // Project list has no time entry items to apply changes to
+        updateAutocompleteIndex(&project_autocomplete_, list, nullptr);
         UI()->DisplayProjectAutocomplete(&list);
     } else {
         std::vector<AutocompleteItem> list;
+        project_autocomplete_.Clear();
         UI()->DisplayProjectAutocomplete(&list);
     }
 }
 
+error Context::AutocompleteQuery(
+    const Poco::UInt64 kind,
+    const std::string text,
+    const Poco::UInt64 limit,
+    std::vector<AutocompleteItem> *result) const {
+
+    poco_check_ptr(result);
+
+    if (kAutocompleteQueryTimeEntry == kind) {
+        time_entry_autocomplete_.Query(text, limit, result);
+    } else if (kAutocompleteQueryMinitimer == kind) {
+        minitimer_autocomplete_.Query(text, limit, result);
+    } else if (kAutocompleteQueryProject == kind) {
+        project_autocomplete_.Query(text, limit, result);
+    } else {
+        return error("Unknown autocomplete kind");
+    }
+    return noError;
+}
+
 void Context::displayClientSelect() {
     if (user_) {
         std::vector<Client *> list =
@@ -469,22 +609,6 @@ Poco::Timestamp Context::postpone(
     return Poco::Timestamp() + throttleMicros;
 }
 
-bool Context::isPostponed(
-    const Poco::Timestamp value,
-    const Poco::Timestamp::TimeDiff throttleMicros) const {
-    Poco::Timestamp now;
-    if (now > value) {
-        return false;
-    }
-    Poco::Timestamp::TimeDiff diff = value - now;
-    if (diff > 2*throttleMicros) {
-        logger().warning(
-            "Cannot postpone task, its foo far in the future");
-        return false;
-    }
-    return true;
-}
-
 error Context::displayError(const error err) {
     if ((err.find(kForbiddenError) != std::string::npos)
             || (err.find(kUnauthorizedError) != std::string::npos)) {
@@ -555,8 +679,7 @@ void Context::Sync() {
     Poco::Util::TimerTask::Ptr ptask =
         new Poco::Util::TimerTaskAdapter<Context>(*this, &Context::onSync);
 
-    Poco::Mutex::ScopedLock lock(timer_m_);
-    timer_.schedule(ptask, next_sync_at_);
+    scheduler_.Schedule(kTaskSync, ptask, next_sync_at_);
 
     std::stringstream ss;
     ss << "Next sync at "
@@ -565,11 +688,6 @@ void Context::Sync() {
 }
 
 void Context::onSync(Poco::Util::TimerTask& task) {  // NOLINT
-    if (isPostponed(next_sync_at_,
-                    kRequestThrottleSeconds * kOneSecondInMicros)) {
-        logger().debug("onSync postponed");
-        return;
-    }
     logger().debug("onFullSync executing");
 
     last_sync_started_ = time(0);
@@ -585,7 +703,7 @@ void Context::onSync(Poco::Util::TimerTask& task) {  // NOLINT
     }
 
     TogglClient client(UI());
-    error err = user_->PullAllUserData(&client);
+    error err = user_->PullChanges(&client);
     if (err != noError) {
         displayError(err);
         return;
@@ -594,7 +712,7 @@ void Context::onSync(Poco::Util::TimerTask& task) {  // NOLINT
     setOnline("Data pulled");
 
     bool had_something_to_push(true);
-    err = user_->PushChanges(&client, &had_something_to_push);
+    err = user_->PushChanges(&client, &had_something_to_push, this);
     if (err != noError) {
         displayError(err);
         return;
@@ -634,27 +752,22 @@ void Context::pushChanges() {
         return;
     }
 
-    next_push_changes_at_ =
+    Poco::Timestamp next_push_changes_at =
         postpone(kRequestThrottleSeconds * kOneSecondInMicros);
     Poco::Util::TimerTask::Ptr ptask =
         new Poco::Util::TimerTaskAdapter<Context>(
             *this, &Context::onPushChanges);
 
-    Poco::Mutex::ScopedLock lock(timer_m_);
-    timer_.schedule(ptask, next_push_changes_at_);
+    scheduler_.Schedule(kTaskPushChanges, ptask, next_push_changes_at,
+                        kTaskPriorityHigh);
 
     std::stringstream ss;
     ss << "Next push at "
-       << Formatter::Format8601(next_push_changes_at_);
+       << Formatter::Format8601(next_push_changes_at);
     logger().debug(ss.str());
 }
 
 void Context::onPushChanges(Poco::Util::TimerTask& task) {  // NOLINT
-    if (isPostponed(next_push_changes_at_,
-                    kRequestThrottleSeconds * kOneSecondInMicros)) {
-        logger().debug("onPushChanges postponed");
-        return;
-    }
     logger().debug("onPushChanges executing");
 
     if (im_a_teapot_) {
@@ -664,7 +777,7 @@ void Context::onPushChanges(Poco::Util::TimerTask& task) {  // NOLINT
 
     TogglClient client(UI());
     bool had_something_to_push(true);
-    error err = user_->PushChanges(&client, &had_something_to_push);
+    error err = user_->PushChanges(&client, &had_something_to_push, this);
     if (err != noError) {
         displayError(err);
     } else if (had_something_to_push) {
@@ -678,6 +791,12 @@ void Context::onPushChanges(Poco::Util::TimerTask& task) {  // NOLINT
     }
 }
 
+error Context::BatchUpdateApplied() {
+    // Save what has been pushed so far, so that a failing
+    // batch later on does not push it again
+    return save(false);
+}
+
 void Context::switchWebSocketOff() {
     logger().debug("switchWebSocketOff");
 
@@ -685,8 +804,7 @@ void Context::switchWebSocketOff() {
         new Poco::Util::TimerTaskAdapter<Context>(
             *this, &Context::onSwitchWebSocketOff);
 
-    Poco::Mutex::ScopedLock lock(timer_m_);
-    timer_.schedule(ptask, Poco::Timestamp());
+    scheduler_.Schedule(kTaskWebSocketOff, ptask, Poco::Timestamp());
 }
 
 void Context::onSwitchWebSocketOff(Poco::Util::TimerTask& task) {  // NOLINT
@@ -697,6 +815,8 @@ void Context::onSwitchWebSocketOff(Poco::Util::TimerTask& task) {  // NOLINT
 }
 
 error Context::LoadUpdateFromJSONString(const std::string json) {
+    ModelLock::ScopedWrite lock(&model_lock_);
+
     std::stringstream ss;
     ss << "LoadUpdateFromJSONString json=" << json;
     logger().debug(ss.str());
@@ -721,8 +841,7 @@ void Context::switchWebSocketOn() {
         new Poco::Util::TimerTaskAdapter<Context>(
             *this, &Context::onSwitchWebSocketOn);
 
-    Poco::Mutex::ScopedLock lock(timer_m_);
-    timer_.schedule(ptask, Poco::Timestamp());
+    scheduler_.Schedule(kTaskWebSocketOn, ptask, Poco::Timestamp());
 }
 
 void Context::onSwitchWebSocketOn(Poco::Util::TimerTask& task) {  // NOLINT
@@ -750,8 +869,7 @@ void Context::switchTimelineOff() {
         new Poco::Util::TimerTaskAdapter<Context>(
             *this, &Context::onSwitchTimelineOff);
 
-    Poco::Mutex::ScopedLock lock(timer_m_);
-    timer_.schedule(ptask, Poco::Timestamp());
+    scheduler_.Schedule(kTaskTimelineOff, ptask, Poco::Timestamp());
 }
 
 void Context::onSwitchTimelineOff(Poco::Util::TimerTask& task) {  // NOLINT
@@ -777,8 +895,7 @@ void Context::switchTimelineOn() {
         return;
     }
 
-    Poco::Mutex::ScopedLock lock(timer_m_);
-    timer_.schedule(ptask, Poco::Timestamp());
+    scheduler_.Schedule(kTaskTimelineOn, ptask, Poco::Timestamp());
 }
 
 void Context::onSwitchTimelineOn(Poco::Util::TimerTask& task) {  // NOLINT
@@ -813,28 +930,22 @@ void Context::onSwitchTimelineOn(Poco::Util::TimerTask& task) {  // NOLINT
 void Context::fetchUpdates() {
     logger().debug("fetchUpdates");
 
-    next_fetch_updates_at_ =
+    Poco::Timestamp next_fetch_updates_at =
         postpone(kRequestThrottleSeconds * kOneSecondInMicros);
     Poco::Util::TimerTask::Ptr ptask =
         new Poco::Util::TimerTaskAdapter<Context>(
             *this, &Context::onFetchUpdates);
 
-    Poco::Mutex::ScopedLock lock(timer_m_);
-    timer_.schedule(ptask, next_fetch_updates_at_);
+    scheduler_.Schedule(kTaskFetchUpdates, ptask, next_fetch_updates_at,
+                        kTaskPriorityLow);
 
     std::stringstream ss;
     ss << "Next update fetch at "
-       << Formatter::Format8601(next_fetch_updates_at_);
+       << Formatter::Format8601(next_fetch_updates_at);
     logger().debug(ss.str());
 }
 
 void Context::onFetchUpdates(Poco::Util::TimerTask& task) {  // NOLINT
-    if (isPostponed(next_fetch_updates_at_,
-                    kRequestThrottleSeconds * kOneSecondInMicros)) {
-        logger().debug("onFetchUpdates postponed");
-        return;
-    }
-
     executeUpdateCheck();
 }
 
@@ -849,8 +960,7 @@ void Context::startPeriodicSync() {
 
     Poco::Timestamp next_periodic_sync_at_ =
         Poco::Timestamp() + (sync_interval_seconds_ * kOneSecondInMicros);
-    Poco::Mutex::ScopedLock lock(timer_m_);
-    timer_.schedule(ptask, next_periodic_sync_at_);
+    scheduler_.Schedule(kTaskPeriodicSync, ptask, next_periodic_sync_at_);
 
     std::stringstream ss;
     ss << "Next periodic sync at "
@@ -880,8 +990,8 @@ void Context::startPeriodicUpdateCheck() {
     Poco::UInt64 micros = kCheckUpdateIntervalSeconds *
                           Poco::UInt64(kOneSecondInMicros);
     Poco::Timestamp next_periodic_check_at = Poco::Timestamp() + micros;
-    Poco::Mutex::ScopedLock lock(timer_m_);
-    timer_.schedule(ptask, next_periodic_check_at);
+    scheduler_.Schedule(kTaskPeriodicUpdateCheck, ptask,
+                        next_periodic_check_at, kTaskPriorityLow);
 
     std::stringstream ss;
     ss << "Next periodic update check at "
@@ -906,6 +1016,8 @@ error Context::UpdateChannel(
 }
 
 std::string Context::UserFullName() const {
+    ModelLock::ScopedRead lock(&model_lock_);
+
     if (!user_) {
         return "";
     }
@@ -913,6 +1025,8 @@ std::string Context::UserFullName() const {
 }
 
 std::string Context::UserEmail() const {
+    ModelLock::ScopedRead lock(&model_lock_);
+
     if (!user_) {
         return "";
     }
@@ -1111,18 +1225,18 @@ const std::string Context::installerPlatform() {
 void Context::TimelineUpdateServerSettings() {
     logger().debug("TimelineUpdateServerSettings");
 
-    next_update_timeline_settings_at_ =
+    Poco::Timestamp next_update_timeline_settings_at =
         postpone(kRequestThrottleSeconds * kOneSecondInMicros);
     Poco::Util::TimerTask::Ptr ptask =
         new Poco::Util::TimerTaskAdapter<Context>(*this,
                 &Context::onTimelineUpdateServerSettings);
 
-    Poco::Mutex::ScopedLock lock(timer_m_);
-    timer_.schedule(ptask, next_update_timeline_settings_at_);
+    scheduler_.Schedule(kTaskTimelineSettings, ptask,
+                        next_update_timeline_settings_at);
 
     std::stringstream ss;
     ss << "Next timeline settings update at "
-       << Formatter::Format8601(next_update_timeline_settings_at_);
+       << Formatter::Format8601(next_update_timeline_settings_at);
     logger().debug(ss.str());
 }
 
@@ -1135,12 +1249,6 @@ void Context::onTimelineUpdateServerSettings(Poco::Util::TimerTask& task) {  //
         return;
     }
 
-    if (isPostponed(next_update_timeline_settings_at_,
-                    kRequestThrottleSeconds * kOneSecondInMicros)) {
-        logger().debug("onTimelineUpdateServerSettings postponed");
-        return;
-    }
-
     logger().debug("onTimelineUpdateServerSettings executing");
 
     std::string json(kRecordTimelineDisabledJSON);
@@ -1179,8 +1287,8 @@ error Context::SendFeedback(Feedback fb) {
         new Poco::Util::TimerTaskAdapter<Context>(
             *this, &Context::onSendFeedback);
 
-    Poco::Mutex::ScopedLock lock(timer_m_);
-    timer_.schedule(ptask, Poco::Timestamp());
+    scheduler_.Schedule(kTaskFeedback, ptask, Poco::Timestamp(),
+                        kTaskPriorityLow);
 
     return noError;
 }
@@ -1512,49 +1620,25 @@ error Context::SetProxySettings(
 }
 
 void Context::displayTimerState() {
-    if (!user_) {
-        UI()->DisplayTimerState(0);
-        return;
-    }
-
-    TimeEntry *te = user_->RunningTimeEntry();
-    TogglTimeEntryView *view = timeEntryViewItem(te);
+    ViewSnapshotPtr snapshot = Snapshot();
+    TogglTimeEntryView *view =
+        timeEntryViewItem(*snapshot, snapshot->RunningTimeEntry());
     UI()->DisplayTimerState(view);
     time_entry_view_item_clear(view);
 }
 
-TogglTimeEntryView *Context::timeEntryViewItem(TimeEntry *te) {
+TogglTimeEntryView *Context::timeEntryViewItem(
+    const ViewSnapshot &snapshot,
+    const TimeEntryViewData *te) {
     if (!te) {
         return nullptr;
     }
 
-    std::string workspace_name("");
-    std::string project_and_task_label("");
-    std::string task_label("");
-    std::string project_label("");
-    std::string client_label("");
-    std::string color("");
-    user_->related.ProjectLabelAndColorCode(te,
-                                            &workspace_name,
-                                            &project_and_task_label,
-                                            &task_label,
-                                            &project_label,
-                                            &client_label,
-                                            &color);
-
-    Poco::Int64 duration = totalDurationForDate(te);
+    Poco::Int64 duration = snapshot.DateTotal(*te);
     std::string date_duration =
         Formatter::FormatDurationForDateHeader(duration);
 
-    return time_entry_view_item_init(te,
-                                     workspace_name,
-                                     project_and_task_label,
-                                     task_label,
-                                     project_label,
-                                     client_label,
-                                     color,
-                                     date_duration,
-                                     true);
+    return time_entry_view_item_init(*te, date_duration, true);
 }
 
 error Context::DisplaySettings(const bool open) {
@@ -1701,9 +1785,17 @@ error Context::Login(
         return displayError(kUnsupportedAppError);
     }
 
+    // If user data is here from an earlier login,
+    // ask only for what has changed since
+    Poco::UInt64 since(0);
+    error err = db()->LoadUserSince(email, &since);
+    if (err != noError) {
+        return displayError(err);
+    }
+
     TogglClient client(UI());
     std::string user_data_json("");
-    error err = User::Me(&client, email, password, &user_data_json, 0);
+    err = User::Me(&client, email, password, &user_data_json, since);
     if (err != noError) {
         if (!IsNetworkingError(err)) {
             return displayError(err);
@@ -1719,7 +1811,7 @@ error Context::Login(
         return displayError(attemptOfflineLogin(email, password));
     }
 
-    err = SetLoggedInUserFromJSON(user_data_json);
+    err = setLoggedInUserFromJSON(user_data_json, since);
     if (err != noError) {
         return displayError(err);
     }
@@ -1749,24 +1841,18 @@ void Context::trackSettingsUsage() {
         return;
     }
 
-    next_analytics_at_ =
+    Poco::Timestamp next_analytics_at =
         postpone(kRequestThrottleSeconds * kOneSecondInMicros);
 
     Poco::Util::TimerTask::Ptr ptask =
         new Poco::Util::TimerTaskAdapter<Context>(
             *this, &Context::onTrackSettingsUsage);
 
-    Poco::Mutex::ScopedLock lock(timer_m_);
-
-    timer_.schedule(ptask, next_analytics_at_);
+    scheduler_.Schedule(kTaskTrackSettingsUsage, ptask, next_analytics_at,
+                        kTaskPriorityLow);
 }
 
 void Context::onTrackSettingsUsage(Poco::Util::TimerTask& task) {  // NOLINT
-    if (isPostponed(next_analytics_at_,
-                    (kRequestThrottleSeconds * kOneSecondInMicros))) {
-        return;
-    }
-
     if (!user_) {
         return;
     }
@@ -1801,11 +1887,40 @@ void Context::setUser(User *value, const bool user_logged_in) {
         logger().debug(ss.str());
     }
 
-    Poco::Mutex::ScopedLock lock(user_m_);
+    // Timeline kept in memory belongs to the previous user. The
+    // recorder reads the models, so stop it before locking them.
+    {
+        Poco::Mutex::ScopedLock l(window_change_recorder_m_);
+        if (window_change_recorder_) {
+            window_change_recorder_->Shutdown();
+        }
+    }
+
+    ModelLock::ScopedWrite lock(&model_lock_);
+
     if (user_) {
         delete user_;
     }
     user_ = value;
+    if (user_) {
+        user_->SetModelLock(&model_lock_);
+    }
+
+    {
+        Poco::Mutex::ScopedLock view_lock(view_m_);
+        time_entry_list_.Clear();
+    }
+    {
+        Poco::Mutex::ScopedLock render_lock(render_m_);
+        render_changes_.clear();
+    }
+    time_entry_autocomplete_.Clear();
+    minitimer_autocomplete_.Clear();
+    project_autocomplete_.Clear();
+
+    ViewSnapshotChanges snapshot_changes;
+    snapshot_changes.SetAll();
+    publishSnapshot(snapshot_changes);
 
     if (quit_) {
         return;
@@ -1868,6 +1983,12 @@ void Context::setUser(User *value, const bool user_logged_in) {
 
 error Context::SetLoggedInUserFromJSON(
     const std::string user_data_json) {
+    return setLoggedInUserFromJSON(user_data_json, 0);
+}
+
+error Context::setLoggedInUserFromJSON(
+    const std::string user_data_json,
+    const Poco::UInt64 since) {
 
     if (user_data_json.empty()) {
         return displayError("empty JSON");
@@ -1891,12 +2012,23 @@ error Context::SetLoggedInUserFromJSON(
         return displayError(err);
     }
 
-    err = user->LoadUserAndRelatedDataFromJSONString(user_data_json, true);
+    Poco::UInt64 local_since = user->Since();
+
+    // If changes were asked for, JSON has only changes
+    err = user->LoadUserAndRelatedDataFromJSONString(user_data_json, !since);
     if (err != noError) {
         delete user;
         return displayError(err);
     }
 
+    if (since && (local_since != since || user->Since() < since)) {
+        // Changes do not apply on top of the data we have,
+        // let next sync pull all user data
+        logger().warning("Changes do not match local data, "
+                         "will pull all user data");
+        user->SetSince(0);
+    }
+
     err = db()->SetCurrentAPIToken(user->APIToken(), user->ID());
     if (err != noError) {
         delete user;
@@ -1941,13 +2073,16 @@ error Context::Logout() {
 
 error Context::ClearCache() {
     try {
-        if (!user_) {
-            logger().warning("User is logged out, cannot clear cache");
-            return noError;
-        }
-        error err = db()->DeleteUser(user_, true);
-        if (err != noError) {
-            return displayError(err);
+        {
+            ModelLock::ScopedWrite lock(&model_lock_);
+            if (!user_) {
+                logger().warning("User is logged out, cannot clear cache");
+                return noError;
+            }
+            error err = db()->DeleteUser(user_, true);
+            if (err != noError) {
+                return displayError(err);
+            }
         }
 
         return Logout();
@@ -1977,7 +2112,10 @@ TimeEntry *Context::Start(
     const std::string duration,
     const Poco::UInt64 task_id,
     const Poco::UInt64 project_id,
-    const std::string project_guid) {
+    const std::string project_guid,
+    const std::string guid) {
+
+    ModelLock::ScopedWrite lock(&model_lock_);
 
     if (im_a_teapot_) {
         displayError(kUnsupportedAppError);
@@ -1991,7 +2129,7 @@ TimeEntry *Context::Start(
 
     TimeEntry *te = user_->Start(description, duration,
                                  task_id,
-                                 project_id, project_guid);
+                                 project_id, project_guid, guid);
 
     error err = save();
     if (err != noError) {
@@ -2015,77 +2153,109 @@ TimeEntry *Context::Start(
     return te;
 }
 
-Poco::Int64 Context::totalDurationForDate(TimeEntry *match) const {
-    Poco::Int64 duration(0);
-    std::string date_header = match->DateHeaderString();
-    std::vector<TimeEntry *> list = timeEntries(true);
-    for (unsigned int i = 0; i < list.size(); i++) {
-        TimeEntry *te = list.at(i);
-        if (te->DateHeaderString() == date_header) {
-            duration += TimeEntry::AbsDuration(te->DurationInSeconds());
+void Context::displayTimeEntryListChanges(
+    std::vector<ModelChange> const *changes) {
+    Poco::Mutex::ScopedLock view_lock(view_m_);
+
+    ViewSnapshotPtr snapshot = Snapshot();
+    if (!snapshot->LoggedIn()) {
+        return;
+    }
+
+    std::vector<TimeEntryListChange> list_changes;
+    for (std::vector<ModelChange>::const_iterator it = changes->begin();
+            it != changes->end(); it++) {
+        if (it->ModelType() != kModelTimeEntry) {
+            continue;
         }
+        time_entry_list_.Update(it->GUID(), *snapshot, &list_changes);
     }
-    return duration;
+
+    displayTimeEntryListChanges(list_changes);
 }
 
-void Context::DisplayTimeEntryList(const bool open) {
-    if (!user_) {
-        logger().warning("Cannot view time entries, user logged out");
+void Context::displayTimeEntryListChanges(
+    const std::vector<TimeEntryListChange> &list_changes) {
+    Poco::Mutex::ScopedLock view_lock(view_m_);
+
+    ViewSnapshotPtr snapshot = Snapshot();
+    if (!snapshot->LoggedIn() || list_changes.empty()) {
         return;
     }
 
     Poco::Stopwatch stopwatch;
     stopwatch.start();
 
-    std::vector<TimeEntry *> list = timeEntries(true);
+    TogglTimeEntryListChangeView *first = nullptr;
+    for (std::vector<TimeEntryListChange>::const_reverse_iterator it =
+        list_changes.rbegin();
+            it != list_changes.rend(); it++) {
+        TimeEntryListChange change = *it;
 
-    std::map<std::string, Poco::Int64> date_durations;
-    for (unsigned int i = 0; i < list.size(); i++) {
-        TimeEntry *te = list.at(i);
+        TogglTimeEntryView *item = nullptr;
+        if (!change.IsDeletion()) {
+            const TimeEntryViewData *te =
+                snapshot->TimeEntryByGUID(change.GUID());
+            poco_check_ptr(te);
 
-        std::string date_header = te->DateHeaderString();
-        Poco::Int64 duration = date_durations[date_header];
-        duration += TimeEntry::AbsDuration(te->DurationInSeconds());
-        date_durations[date_header] = duration;
+            item = time_entry_view_item_init(*te,
+                                             change.DateDuration(),
+                                             false);
+            item->IsHeader = change.IsHeader();
+        }
+
+        TogglTimeEntryListChangeView *view =
+            time_entry_list_change_view_item_init(change, item);
+        view->Next = first;
+        first = view;
     }
 
+    UI()->DisplayTimeEntryListChanges(first);
+    time_entry_list_change_view_item_clear(first);
+
+    stopwatch.stop();
+    std::stringstream ss;
+    ss << "Time entry list changes (" << list_changes.size()
+       << ") rendered in " << stopwatch.elapsed() / 1000 << " ms";
+    logger().debug(ss.str());
+}
+
+bool Context::timeEntryListRenderedToday() const {
+    Poco::LocalDateTime now;
+    return now.year() == last_time_entry_list_render_at_.year()
+           && now.month() == last_time_entry_list_render_at_.month()
+           && now.day() == last_time_entry_list_render_at_.day();
+}
+
+void Context::DisplayTimeEntryList(const bool open) {
+    Poco::Mutex::ScopedLock view_lock(view_m_);
+
+    ViewSnapshotPtr snapshot = Snapshot();
+    if (!snapshot->LoggedIn()) {
+        logger().warning("Cannot view time entries, user logged out");
+        return;
+    }
+
+    Poco::Stopwatch stopwatch;
+    stopwatch.start();
+
+    std::vector<TimeEntryViewDataPtr> list = snapshot->TimeEntries();
+
     TogglTimeEntryView *first = nullptr;
     for (unsigned int i = 0; i < list.size(); i++) {
-        TimeEntry *te = list.at(i);
+        const TimeEntryViewData *te = list.at(i).get();
 
-        if (te->DurationInSeconds() < 0) {
+        if (te->DurationInSeconds < 0) {
             // Don't display running entries
             continue;
         }
 
-        std::string workspace_name("");
-        std::string project_and_task_label("");
-        std::string task_label("");
-        std::string project_label("");
-        std::string client_label("");
-        std::string color("");
-        user_->related.ProjectLabelAndColorCode(te,
-                                                &workspace_name,
-                                                &project_and_task_label,
-                                                &task_label,
-                                                &project_label,
-                                                &client_label,
-                                                &color);
-
-        Poco::Int64 duration = date_durations[te->DateHeaderString()];
+        Poco::Int64 duration = snapshot->DateTotal(*te);
         std::string date_duration =
             Formatter::FormatDurationForDateHeader(duration);
 
         TogglTimeEntryView *item =
-            time_entry_view_item_init(te,
-                                      workspace_name,
-                                      project_and_task_label,
-                                      task_label,
-                                      project_label,
-                                      client_label,
-                                      color,
-                                      date_duration,
-                                      false);
+            time_entry_view_item_init(*te, date_duration, false);
         item->Next = first;
         if (first && compare_string(item->DateHeader, first->DateHeader) != 0) {
             first->IsHeader = true;
@@ -2104,6 +2274,8 @@ void Context::DisplayTimeEntryList(const bool open) {
     UI()->DisplayTimeEntryList(open, first);
     time_entry_view_item_clear(first);
 
+    time_entry_list_.Reset(list);
+
     last_time_entry_list_render_at_ = Poco::LocalDateTime();
 
     stopwatch.stop();
@@ -2116,6 +2288,8 @@ void Context::DisplayTimeEntryList(const bool open) {
 void Context::Edit(const std::string GUID,
                    const bool edit_running_entry,
                    const std::string focused_field_name) {
+    ModelLock::ScopedRead lock(&model_lock_);
+
     if (!edit_running_entry && GUID.empty()) {
         logger().error("Cannot edit time entry without a GUID");
         return;
@@ -2150,6 +2324,8 @@ void Context::displayTimeEntryEditor(const bool open,
         UI()->DisplayApp();
     }
 
+    Poco::Mutex::ScopedLock view_lock(view_m_);
+
     // If user is already editing the time entry, toggle the editor
     // instead of doing nothing
     if (open && (time_entry_editor_guid_ == te->GUID())) {
@@ -2158,7 +2334,16 @@ void Context::displayTimeEntryEditor(const bool open,
     }
 
     time_entry_editor_guid_ = te->GUID();
-    TogglTimeEntryView *view = timeEntryViewItem(te);
+
+    // Time entries not yet saved are not in the snapshot
+    ViewSnapshotPtr snapshot = Snapshot();
+    const TimeEntryViewData *data = snapshot->TimeEntryByGUID(te->GUID());
+    TimeEntryViewData unsaved;
+    if (!data) {
+        unsaved = TimeEntryViewData(te, user_->related);
+        data = &unsaved;
+    }
+    TogglTimeEntryView *view = timeEntryViewItem(*snapshot, data);
 
     Workspace *ws = nullptr;
     if (te->WID()) {
@@ -2179,6 +2364,8 @@ void Context::displayTimeEntryEditor(const bool open,
 }
 
 error Context::ContinueLatest() {
+    ModelLock::ScopedWrite lock(&model_lock_);
+
     if (im_a_teapot_) {
         return displayError(kUnsupportedAppError);
     }
@@ -2230,6 +2417,8 @@ error Context::ContinueLatest() {
 error Context::Continue(
     const std::string GUID) {
 
+    ModelLock::ScopedWrite lock(&model_lock_);
+
     if (im_a_teapot_) {
         return displayError(kUnsupportedAppError);
     }
@@ -2263,6 +2452,8 @@ error Context::Continue(
 }
 
 error Context::DeleteTimeEntryByGUID(const std::string GUID) {
+    ModelLock::ScopedWrite lock(&model_lock_);
+
     if (im_a_teapot_) {
         return displayError(kUnsupportedAppError);
     }
@@ -2295,6 +2486,8 @@ error Context::DeleteTimeEntryByGUID(const std::string GUID) {
 error Context::SetTimeEntryDuration(
     const std::string GUID,
     const std::string duration) {
+    ModelLock::ScopedWrite lock(&model_lock_);
+
     if (GUID.empty()) {
         return displayError("Missing GUID");
     }
@@ -2317,6 +2510,8 @@ error Context::SetTimeEntryProject(
     const Poco::UInt64 task_id,
     const Poco::UInt64 project_id,
     const std::string project_guid) {
+    ModelLock::ScopedWrite lock(&model_lock_);
+
     try {
         if (GUID.empty()) {
             return displayError("Missing GUID");
@@ -2371,6 +2566,8 @@ error Context::SetTimeEntryDate(
     const std::string GUID,
     const Poco::Int64 unix_timestamp) {
 
+    ModelLock::ScopedWrite lock(&model_lock_);
+
     if (GUID.empty()) {
         return displayError("Missing GUID");
     }
@@ -2409,6 +2606,8 @@ error Context::SetTimeEntryDate(
 error Context::SetTimeEntryStart(
     const std::string GUID,
     const std::string value) {
+    ModelLock::ScopedWrite lock(&model_lock_);
+
     if (GUID.empty()) {
         return displayError("Missing GUID");
     }
@@ -2444,6 +2643,8 @@ error Context::SetTimeEntryStart(
 error Context::SetTimeEntryStop(
     const std::string GUID,
     const std::string value) {
+    ModelLock::ScopedWrite lock(&model_lock_);
+
     if (GUID.empty()) {
         return displayError("Missing GUID");
     }
@@ -2496,6 +2697,8 @@ error Context::SetTimeEntryStop(
 error Context::SetTimeEntryTags(
     const std::string GUID,
     const std::string value) {
+    ModelLock::ScopedWrite lock(&model_lock_);
+
     if (GUID.empty()) {
         return displayError("Missing GUID");
     }
@@ -2521,6 +2724,8 @@ error Context::SetTimeEntryTags(
 error Context::SetTimeEntryBillable(
     const std::string GUID,
     const bool value) {
+    ModelLock::ScopedWrite lock(&model_lock_);
+
     if (GUID.empty()) {
         return displayError("Missing GUID");
     }
@@ -2546,6 +2751,8 @@ error Context::SetTimeEntryBillable(
 error Context::SetTimeEntryDescription(
     const std::string GUID,
     const std::string value) {
+    ModelLock::ScopedWrite lock(&model_lock_);
+
     if (GUID.empty()) {
         return displayError("Missing GUID");
     }
@@ -2569,6 +2776,8 @@ error Context::SetTimeEntryDescription(
 }
 
 error Context::Stop() {
+    ModelLock::ScopedWrite lock(&model_lock_);
+
     if (!user_) {
         logger().warning("Cannot stop tracking, user logged out");
         return noError;
@@ -2592,6 +2801,8 @@ error Context::DiscardTimeAt(
     const Poco::Int64 at,
     const bool split_into_new_entry) {
 
+    ModelLock::ScopedWrite lock(&model_lock_);
+
     if (!user_) {
         logger().warning("Cannot stop time entry, user logged out");
         return noError;
@@ -2614,6 +2825,8 @@ error Context::DiscardTimeAndContinue(
     const std::string guid,
     const Poco::Int64 at) {
 
+    ModelLock::ScopedWrite lock(&model_lock_);
+
     if (!user_) {
         logger().warning("Cannot stop time entry, user logged out");
         return noError;
@@ -2629,6 +2842,8 @@ error Context::DiscardTimeAndContinue(
 }
 
 TimeEntry *Context::RunningTimeEntry() const {
+    ModelLock::ScopedRead lock(&model_lock_);
+
     if (!user_) {
         logger().warning("Cannot fetch time entry, user logged out");
         return nullptr;
@@ -2637,6 +2852,8 @@ TimeEntry *Context::RunningTimeEntry() const {
 }
 
 error Context::ToggleTimelineRecording(const bool record_timeline) {
+    ModelLock::ScopedWrite lock(&model_lock_);
+
     if (!user_) {
         logger().warning("Cannot toggle timeline, user logged out");
         return noError;
@@ -2670,35 +2887,66 @@ error Context::ToggleTimelineRecording(const bool record_timeline) {
     return noError;
 }
 
-std::vector<TimeEntry *> Context::timeEntries(
-    const bool including_running) const {
-    std::vector<TimeEntry *> result;
+error Context::LoadMoreTimeEntries() {
+    ModelLock::ScopedWrite lock(&model_lock_);
+
     if (!user_) {
-        return result;
+        logger().warning("Cannot load time entries, user logged out");
+        return noError;
     }
 
-    // Collect visible time entries
-    for (std::vector<TimeEntry *>::const_iterator it =
-        user_->related.TimeEntries.begin();
-            it != user_->related.TimeEntries.end(); it++) {
-        TimeEntry *te = *it;
+    error err = db()->LoadMoreTimeEntries(user_, kTimeEntryPageDays);
+    if (err != noError) {
+        return displayError(err);
+    }
 
-        if (te->GUID().empty()) {
-            logger().error("Ignoring a time entry without a GUID!");
-            continue;
-        }
-        if (te->DurationInSeconds() < 0 && !including_running) {
+    ViewSnapshotChanges snapshot_changes;
+    snapshot_changes.AllTimeEntries = true;
+    snapshot_changes.TimeEntryAutocomplete = true;
+    snapshot_changes.MinitimerAutocomplete = true;
+    publishSnapshot(snapshot_changes);
+
+    DisplayTimeEntryList(false);
+    displayTimeEntryAutocomplete();
+    displayMinitimerAutocomplete();
+
+    return noError;
+}
+
+ViewSnapshotPtr Context::Snapshot() const {
+    Poco::Mutex::ScopedLock lock(snapshot_m_);
+    return snapshot_;
+}
+
+void Context::publishSnapshot(const std::vector<ModelChange> &changes) {
+    ViewSnapshotChanges snapshot_changes;
+    for (std::vector<ModelChange>::const_iterator it = changes.begin();
+            it != changes.end(); it++) {
+        // Same as in updateUI
+        if (it->ModelType() == kModelTag || it->ModelType() == kModelUser) {
             continue;
         }
-        if (te->DeletedAt() > 0) {
-            continue;
+        snapshot_changes.TimeEntryAutocomplete = true;
+        snapshot_changes.MinitimerAutocomplete = true;
+        if (it->ModelType() == kModelTimeEntry) {
+            snapshot_changes.TimeEntries.insert(it->GUID());
+        } else {
+            // Labels of any time entry may have changed
+            snapshot_changes.AllTimeEntries = true;
+            snapshot_changes.ProjectAutocomplete = true;
         }
-        result.push_back(te);
     }
+    publishSnapshot(snapshot_changes);
+}
 
-    std::sort(result.begin(), result.end(), CompareTimeEntriesByStart);
+void Context::publishSnapshot(const ViewSnapshotChanges &changes) {
+    // Models must not change while they are copied
+    ModelLock::ScopedWrite lock(&model_lock_);
 
-    return result;
+    ViewSnapshotPtr next(ViewSnapshot::Next(*Snapshot(), user_, changes));
+
+    Poco::Mutex::ScopedLock snapshot_lock(snapshot_m_);
+    snapshot_ = next;
 }
 
 error Context::SetUpdateChannel(const std::string channel) {
@@ -2714,6 +2962,8 @@ error Context::AddAutotrackerRule(
     const std::string term,
     const Poco::UInt64 pid) {
 
+    ModelLock::ScopedWrite lock(&model_lock_);
+
     if (!user_) {
         logger().warning("cannot add autotracker rule, user logged out");
         return noError;
@@ -2741,7 +2991,7 @@ error Context::AddAutotrackerRule(
     rule->SetTerm(lowercase);
     rule->SetPID(pid);
     rule->SetUID(user_->ID());
-    user_->related.AutotrackerRules.push_back(rule);
+    user_->related.Add(rule);
 
     return displayError(save());
 }
@@ -2749,6 +2999,8 @@ error Context::AddAutotrackerRule(
 error Context::DeleteAutotrackerRule(
     const Poco::Int64 id) {
 
+    ModelLock::ScopedWrite lock(&model_lock_);
+
     if (!user_) {
         logger().warning("cannot delete rule, user is logged out");
         return noError;
@@ -2757,17 +3009,12 @@ error Context::DeleteAutotrackerRule(
         return displayError("cannot delete rule without an ID");
     }
 
-    for (std::vector<AutotrackerRule *>::iterator it =
-        user_->related.AutotrackerRules.begin();
-            it != user_->related.AutotrackerRules.end(); it++) {
-        AutotrackerRule *rule = *it;
-        // Autotracker settings are not saved to DB,
-        // so the ID will be 0 always. But will have local ID
-        if (rule->LocalID() == id) {
-            rule->MarkAsDeletedOnServer();
-            rule->Delete();
-            break;
-        }
+    // Autotracker settings are not saved to DB,
+    // so the ID will be 0 always. But will have local ID
+    AutotrackerRule *rule = user_->related.AutotrackerRuleByLocalID(id);
+    if (rule) {
+        rule->MarkAsDeletedOnServer();
+        rule->Delete();
     }
 
     return displayError(save());
@@ -2797,6 +3044,8 @@ Project *Context::CreateProject(
     const std::string project_name,
     const bool is_private) {
 
+    ModelLock::ScopedWrite lock(&model_lock_);
+
     if (!user_) {
         logger().warning("Cannot add project, user logged out");
         return nullptr;
@@ -2832,6 +3081,8 @@ Client *Context::CreateClient(
     const Poco::UInt64 workspace_id,
     const std::string client_name) {
 
+    ModelLock::ScopedWrite lock(&model_lock_);
+
     if (!user_) {
         logger().warning("Cannot create a client, user logged out");
         return nullptr;
@@ -2947,16 +3198,16 @@ error Context::offerBetaChannel() {
 }
 
 void Context::SetWake() {
+    ModelLock::ScopedRead lock(&model_lock_);
+
     logger().debug("SetWake");
 
     try {
         scheduleSync();
 
         if (user_) {
-            Poco::LocalDateTime now;
-            if (now.year() != last_time_entry_list_render_at_.year()
-                    || now.month() != last_time_entry_list_render_at_.month()
-                    || now.day() != last_time_entry_list_render_at_.day()) {
+            Poco::Mutex::ScopedLock view_lock(view_m_);
+            if (!timeEntryListRenderedToday()) {
                 DisplayTimeEntryList(false);
             }
         }
@@ -2981,8 +3232,7 @@ void Context::SetOnline() {
     Poco::Util::TimerTask::Ptr ptask =
         new Poco::Util::TimerTaskAdapter<Context>(*this, &Context::onSync);
 
-    Poco::Mutex::ScopedLock lock(timer_m_);
-    timer_.schedule(ptask, next_sync_at_);
+    scheduler_.Schedule(kTaskSync, ptask, next_sync_at_);
 
     std::stringstream ss;
     ss << "Next sync at "
@@ -2996,36 +3246,28 @@ void Context::remindToTrackTime() {
         return;
     }
 
-    next_reminder_at_ =
+    Poco::Timestamp next_reminder_at =
         postpone((settings_.reminder_minutes * 60) * kOneSecondInMicros);
     Poco::Util::TimerTask::Ptr ptask =
         new Poco::Util::TimerTaskAdapter<Context>(*this, &Context::onRemind);
 
-    Poco::Mutex::ScopedLock lock(timer_m_);
-    timer_.schedule(ptask, next_reminder_at_);
+    scheduler_.Schedule(kTaskRemind, ptask, next_reminder_at);
 
     std::stringstream ss;
     ss << "Next reminder to track time at "
-       << Formatter::Format8601(next_reminder_at_);
+       << Formatter::Format8601(next_reminder_at);
     logger().debug(ss.str());
 }
 
 void Context::onRemind(Poco::Util::TimerTask& task) {  // NOLINT
-    // if some code scheduled a reminder for a later time,
-    // meanwhile, then let the later reminder be executed
-    // not this one.
-    if (isPostponed(next_reminder_at_,
-                    (settings_.reminder_minutes * 60) * kOneSecondInMicros)) {
-        logger().debug("onRemind postponed");
-        return;
-    }
-
     displayReminder();
 
     remindToTrackTime();
 }
 
 void Context::displayReminder() {
+    ModelLock::ScopedRead lock(&model_lock_);
+
     if (!settings_.reminder) {
         logger().debug("Reminder is not enabled by user");
         return;
@@ -3084,6 +3326,8 @@ void Context::displayReminder() {
 }
 
 error Context::StartAutotrackerEvent(const TimelineEvent event) {
+    ModelLock::ScopedWrite lock(&model_lock_);
+
     logger().debug("StartAutotrackerEvent " + event.String());
 
     if (!user_) {
@@ -3123,7 +3367,7 @@ error Context::CreateCompressedTimelineBatchForUpload(TimelineBatch *batch) {
         return noError;
     }
 
-    Poco::Mutex::ScopedLock lock(user_m_);
+    ModelLock::ScopedRead lock(&model_lock_);
     if (!user_) {
         return noError;
     }
@@ -3143,6 +3387,8 @@ error Context::CreateCompressedTimelineBatchForUpload(TimelineBatch *batch) {
 }
 
 error Context::StartTimelineEvent(TimelineEvent *event) {
+    ModelLock::ScopedRead lock(&model_lock_);
+
     logger().debug("StartTimelineEvent " + event->String());
 
     poco_check_ptr(event);
@@ -3185,33 +3431,39 @@ error Context::SetPromotionResponse(
 }
 
 void Context::uiUpdaterActivity() {
-    std::string running_time("");
     while (!ui_updater_.isStopped()) {
-        // Sleep in increments for faster shutdown.
-        for (unsigned int i = 0; i < 4*10; i++) {
-            if (ui_updater_.isStopped()) {
-                return;
-            }
-            Poco::Thread::sleep(250);
+        ui_updater_wakeup_.Wait(kUIUpdateIntervalMillis);
+        if (ui_updater_.isStopped()) {
+            return;
         }
 
         {
-            Poco::Mutex::ScopedLock lock(user_m_);
-            if (!user_) {
+            Poco::Mutex::ScopedLock view_lock(view_m_);
+            if (!Snapshot()->LoggedIn()) {
                 continue;
             }
-            TimeEntry *te = user_->RunningTimeEntry();
-            if (!te) {
+            if (!time_entry_list_.Initialized()) {
+                continue;
+            }
+
+            // Date headers change when the day is over
+            if (!timeEntryListRenderedToday()) {
+                DisplayTimeEntryList(false);
+                continue;
+            }
+
+            // Only the date durations of running days can change
+            std::vector<TimeEntryListChange> changes;
+            time_entry_list_.Tick(&changes);
+            if (changes.empty()) {
                 continue;
             }
-            Poco::Int64 duration = totalDurationForDate(te);
-            std::string date_duration =
-                Formatter::FormatDurationForDateHeader(duration);
 
-            if (running_time != date_duration) {
+            if (UI()->CanDisplayTimeEntryListChanges()) {
+                displayTimeEntryListChanges(changes);
+            } else {
                 DisplayTimeEntryList(false);
             }
-            running_time = date_duration;
         }
     }
 }
@@ -10,21 +10,28 @@
 #include <iostream> // NOLINT
 
 #include "./analytics.h"
+#include "./autocomplete_index.h"
+#include "./batch_update_result.h"
+#include "./command_queue.h"
 #include "./custom_error_handler.h"
 #include "./feedback.h"
 #include "./gui.h"
 #include "./idle.h"
 #include "./model_change.h"
+#include "./model_lock.h"
+#include "./task_scheduler.h"
+#include "./time_entry_list.h"
 #include "./timeline_event.h"
 #include "./timeline_notifications.h"
 #include "./toggl_api.h"
 #include "./types.h"
+#include "./view_snapshot.h"
+#include "./wakeup.h"
 #include "./websocket_client.h"
 
 #include "Poco/Activity.h"
 #include "Poco/LocalDateTime.h"
 #include "Poco/Timestamp.h"
-#include "Poco/Util/Timer.h"
 
 namespace toggl {
 
@@ -33,7 +40,7 @@ class Database;
 class TimelineUploader;
 class WindowChangeRecorder;
 
-class Context : public TimelineDatasource {
+class Context : public TimelineDatasource, public BatchUpdateMonitor {
  public:
     Context(
         const std::string app_name,
@@ -44,6 +51,46 @@ class Context : public TimelineDatasource {
         return &ui_;
     }
 
+    // In async mode the C API queues commands that change time
+    // entries, and they run in order on a thread of their own
+    void SetAsyncCommands(const bool value) {
+        async_commands_ = value;
+    }
+    bool AsyncCommands() const {
+        return async_commands_;
+    }
+    CommandQueue *Commands() {
+        return &commands_;
+    }
+
+    // Runs syncs, pushes and other background tasks
+    TaskScheduler *Scheduler() {
+        return &scheduler_;
+    }
+
+    // How often, and how long, threads waited for the user data
+    ModelLockStats LockStats() const {
+        return model_lock_.Stats();
+    }
+
+    // With deferred rendering, UI is updated after saves by a task
+    // on a render thread of its own, so that renders do not wait
+    // for syncs. Saves made while it is pending are rendered
+    // together, in one go. Otherwise each save renders before it
+    // returns.
+    void SetDeferredRendering(const bool value) {
+        deferred_rendering_ = value;
+    }
+    void SetRenderDelayMillis(const Poco::UInt64 value) {
+        render_delay_millis_ = value;
+    }
+    TaskStats RenderStats() const;
+    TaskStats SyncStats() const;
+
+    // User data as last displayed in UI. The snapshot never
+    // changes, so it can be rendered from without any locks.
+    ViewSnapshotPtr Snapshot() const;
+
     // Check for logged in user etc, start up the app
     error StartEvents();
 
@@ -155,7 +202,8 @@ class Context : public TimelineDatasource {
         const std::string duration,
         const Poco::UInt64 task_id,
         const Poco::UInt64 project_id,
-        const std::string project_guid);
+        const std::string project_guid,
+        const std::string guid = "");
 
     error ContinueLatest();
 
@@ -164,6 +212,17 @@ class Context : public TimelineDatasource {
 
     void DisplayTimeEntryList(const bool open);
 
+    // Page older time entries into memory and list
+    error LoadMoreTimeEntries();
+
+    // Search the autocomplete list of the given kind,
+    // as last displayed in UI
+    error AutocompleteQuery(
+        const Poco::UInt64 kind,
+        const std::string text,
+        const Poco::UInt64 limit,
+        std::vector<AutocompleteItem> *result) const;
+
     error DisplaySettings(const bool open = false);
 
     void Edit(const std::string GUID,
@@ -279,6 +338,9 @@ class Context : public TimelineDatasource {
     error MarkTimelineBatchAsUploaded(
         const std::vector<TimelineEvent> &events);
 
+    // Batch update monitor
+    error BatchUpdateApplied();
+
     error SetPromotionResponse(
         const int64_t promotion_type,
         const int64_t promotion_response);
@@ -304,7 +366,7 @@ class Context : public TimelineDatasource {
 
     void fetchUpdates();
 
-    // timer_ callbacks
+    // scheduler_ callbacks
     void onSync(Poco::Util::TimerTask& task);  // NOLINT
     void onPushChanges(Poco::Util::TimerTask& task);  // NOLINT
     void onSwitchWebSocketOff(Poco::Util::TimerTask& task);  // NOLINT
@@ -318,6 +380,7 @@ class Context : public TimelineDatasource {
     void onRemind(Poco::Util::TimerTask&);  // NOLINT
     void onPeriodicSync(Poco::Util::TimerTask& task);  // NOLINT
     void onTrackSettingsUsage(Poco::Util::TimerTask& task);  // NOLINT
+    void onRender(Poco::Util::TimerTask& task);  // NOLINT
 
     void startPeriodicUpdateCheck();
     void executeUpdateCheck();
@@ -335,16 +398,39 @@ class Context : public TimelineDatasource {
 
     Database *db() const;
 
-    std::vector<TimeEntry *> timeEntries(const bool including_running) const;
+    // Build the next snapshot from user data and make it current
+    void publishSnapshot(const ViewSnapshotChanges &changes);
+    void publishSnapshot(const std::vector<ModelChange> &changes);
 
-    TogglTimeEntryView *timeEntryViewItem(TimeEntry *te);
+    // Update UI with saved changes, now or in a render task
+    void render(std::vector<ModelChange> *changes);
+
+    TogglTimeEntryView *timeEntryViewItem(
+        const ViewSnapshot &snapshot,
+        const TimeEntryViewData *te);
 
     void displayTimerState();
     void displayTimeEntryEditor(const bool open,
                                 TimeEntry *te,
                                 const std::string focused_field_name);
-    void displayTimeEntryAutocomplete();
-    void displayMinitimerAutocomplete();
+    // Without changes, the autocomplete index is updated
+    // from the full list
+    void displayTimeEntryAutocomplete(
+        std::vector<ModelChange> const *changes = nullptr);
+    void displayTimeEntryListChanges(
+        std::vector<ModelChange> const *changes);
+    void displayTimeEntryListChanges(
+        const std::vector<TimeEntryListChange> &list_changes);
+    // False once the day the time entry list was fully rendered
+    // on is over, and its date headers are out of date
+    bool timeEntryListRenderedToday() const;
+    void displayMinitimerAutocomplete(
+        std::vector<ModelChange> const *changes = nullptr);
+    // Returns true if items were added to or removed from the list
+    bool updateAutocompleteIndex(
+        AutocompleteIndex *index,
+        const std::vector<AutocompleteItem> &list,
+        std::vector<ModelChange> const *changes);
     void displayProjectAutocomplete();
     void displayWorkspaceSelect();
     void displayClientSelect();
@@ -353,8 +439,6 @@ class Context : public TimelineDatasource {
 
     void displayReminder();
 
-    Poco::Int64 totalDurationForDate(TimeEntry *te) const;
-
     void updateUI(std::vector<ModelChange> *changes);
 
     error displayError(const error err);
@@ -369,13 +453,15 @@ class Context : public TimelineDatasource {
 
     int nextSyncIntervalSeconds() const;
 
-    bool isPostponed(
-        const Poco::Timestamp value,
-        const Poco::Timestamp::TimeDiff throttleMicros) const;
-
     Poco::Timestamp postpone(
         const Poco::Timestamp::TimeDiff throttleMicros) const;
 
+    // Since is the time of the last pull the JSON has
+    // changes for, zero if it has all user data
+    error setLoggedInUserFromJSON(
+        const std::string user_data_json,
+        const Poco::UInt64 since);
+
     error attemptOfflineLogin(const std::string email,
                               const std::string password);
 
@@ -390,7 +476,9 @@ class Context : public TimelineDatasource {
     Poco::Mutex db_m_;
     Database *db_;
 
-    Poco::Mutex user_m_;
+    // Renders and lookups read the user and its related data
+    // under a read lock, changes and saves take a write lock
+    mutable ModelLock model_lock_;
     User *user_;
 
     Poco::Mutex ws_client_m_;
@@ -406,20 +494,34 @@ class Context : public TimelineDatasource {
 
     Feedback feedback_;
 
-    // Tasks are scheduled at:
+    // Sync has been scheduled at:
     Poco::Timestamp next_sync_at_;
-    Poco::Timestamp next_push_changes_at_;
-    Poco::Timestamp next_fetch_updates_at_;
-    Poco::Timestamp next_update_timeline_settings_at_;
-    Poco::Timestamp next_reminder_at_;
-    Poco::Timestamp next_analytics_at_;
 
-    // Schedule tasks using a timer:
-    Poco::Mutex timer_m_;
-    Poco::Util::Timer timer_;
+    // Runs the tasks below, at most one pending task per key
+    TaskScheduler scheduler_;
 
     class GUI ui_;
 
+    // Runs the UI commands in async mode
+    CommandQueue commands_;
+    bool async_commands_;
+
+    // Changes saved since the last render, in deferred rendering
+    Poco::Mutex render_m_;
+    std::vector<ModelChange> render_changes_;
+    bool deferred_rendering_;
+    Poco::UInt64 render_delay_millis_;
+    TaskScheduler renderer_;
+
+    // Views are rendered from the current snapshot, possibly from
+    // several threads at once. View state below is guarded by view_m_.
+    Poco::Mutex view_m_;
+
+    // Current snapshot, replaced after each change. The mutex
+    // guards only the pointer, not the snapshot it points to.
+    mutable Poco::Mutex snapshot_m_;
+    ViewSnapshotPtr snapshot_;
+
     std::string time_entry_editor_guid_;
 
     std::string environment_;
@@ -433,10 +535,19 @@ class Context : public TimelineDatasource {
 
     Poco::LocalDateTime last_time_entry_list_render_at_;
 
+    // Time entry list as last rendered in UI
+    TimeEntryList time_entry_list_;
+
+    // Search indexes of the autocomplete lists displayed in UI
+    AutocompleteIndex time_entry_autocomplete_;
+    AutocompleteIndex minitimer_autocomplete_;
+    AutocompleteIndex project_autocomplete_;
+
     bool quit_;
 
     Poco::Mutex ui_updater_m_;
     Poco::Activity<Context> ui_updater_;
+    Wakeup ui_updater_wakeup_;
 
     Analytics analytics_;
 
@@ -0,0 +1,144 @@
+// Copyright 2015 Toggl Desktop developers.
+
+#include "../src/context_commands.h"
+
+#include "./context.h"
+
+namespace toggl {
+
+StartCommand::StartCommand(
+    Context *ctx,
+    const std::string description,
+    const std::string duration,
+    const Poco::UInt64 task_id,
+    const Poco::UInt64 project_id,
+    const std::string project_guid,
+    const std::string guid)
+    : Command("start")
+, ctx_(ctx)
+, description_(description)
+, duration_(duration)
+, task_id_(task_id)
+, project_id_(project_id)
+, project_guid_(project_guid)
+, guid_(guid) {
+    poco_check_ptr(ctx_);
+}
+
+error StartCommand::Run() {
+    if (!ctx_->Start(description_, duration_,
+                     task_id_, project_id_, project_guid_, guid_)) {
+        return error("Could not start time entry");
+    }
+    return noError;
+}
+
+StopCommand::StopCommand(Context *ctx)
+    : Command("stop")
+, ctx_(ctx) {
+    poco_check_ptr(ctx_);
+}
+
+error StopCommand::Run() {
+    return ctx_->Stop();
+}
+
+ContinueCommand::ContinueCommand(
+    Context *ctx,
+    const std::string guid)
+    : Command("continue")
+, ctx_(ctx)
+, guid_(guid) {
+    poco_check_ptr(ctx_);
+}
+
+error ContinueCommand::Run() {
+    if (guid_.empty()) {
+        return ctx_->ContinueLatest();
+    }
+    return ctx_->Continue(guid_);
+}
+
+DeleteTimeEntryCommand::DeleteTimeEntryCommand(
+    Context *ctx,
+    const std::string guid)
+    : Command("delete_time_entry")
+, ctx_(ctx)
+, guid_(guid) {
+    poco_check_ptr(ctx_);
+}
+
+error DeleteTimeEntryCommand::Run() {
+    return ctx_->DeleteTimeEntryByGUID(guid_);
+}
+
+SetTimeEntryValueCommand::SetTimeEntryValueCommand(
+    const std::string name,
+    Context *ctx,
+    Setter setter,
+    const std::string guid,
+    const std::string value)
+    : Command(name)
+, ctx_(ctx)
+, setter_(setter)
+, guid_(guid)
+, value_(value) {
+    poco_check_ptr(ctx_);
+    poco_check_ptr(setter_);
+}
+
+error SetTimeEntryValueCommand::Run() {
+    return (ctx_->*setter_)(guid_, value_);
+}
+
+SetTimeEntryProjectCommand::SetTimeEntryProjectCommand(
+    Context *ctx,
+    const std::string guid,
+    const Poco::UInt64 task_id,
+    const Poco::UInt64 project_id,
+    const std::string project_guid)
+    : Command("set_time_entry_project")
+, ctx_(ctx)
+, guid_(guid)
+, task_id_(task_id)
+, project_id_(project_id)
+, project_guid_(project_guid) {
+    poco_check_ptr(ctx_);
+}
+
+error SetTimeEntryProjectCommand::Run() {
+    return ctx_->SetTimeEntryProject(
+        guid_, task_id_, project_id_, project_guid_);
+}
+
+SetTimeEntryDateCommand::SetTimeEntryDateCommand(
+    Context *ctx,
+    const std::string guid,
+    const Poco::Int64 unix_timestamp)
+    : Command("set_time_entry_date")
+, ctx_(ctx)
+, guid_(guid)
+, unix_timestamp_(unix_timestamp) {
+    poco_check_ptr(ctx_);
+}
+
+error SetTimeEntryDateCommand::Run() {
+    return ctx_->SetTimeEntryDate(guid_, unix_timestamp_);
+}
+
+SetTimeEntryBillableCommand::SetTimeEntryBillableCommand(
+    Context *ctx,
+    const std::string guid,
+    const bool value)
+    : Command("set_time_entry_billable")
+, ctx_(ctx)
+, guid_(guid)
+, value_(value) {
+    poco_check_ptr(ctx_);
+}
+
+error SetTimeEntryBillableCommand::Run() {
+    return ctx_->SetTimeEntryBillable(guid_, value_);
+}
+
+}   // namespace toggl
@@ -0,0 +1,155 @@
+// Copyright 2015 Toggl Desktop developers.
+
+#ifndef SRC_CONTEXT_COMMANDS_H_
+#define SRC_CONTEXT_COMMANDS_H_
+
+#include <string>
+
+#include "./command_queue.h"
+#include "./types.h"
+
+#include "Poco/Types.h"
+
+namespace toggl {
+
+class Context;
+
+// Commands of the C API, for running them in async mode
+
+class StartCommand : public Command {
+ public:
+    // The time entry is created with the given GUID, so that
+    // UI can refer to it before the command has run
+    StartCommand(
+        Context *ctx,
+        const std::string description,
+        const std::string duration,
+        const Poco::UInt64 task_id,
+        const Poco::UInt64 project_id,
+        const std::string project_guid,
+        const std::string guid);
+
+    error Run();
+
+ private:
+    Context *ctx_;
+    std::string description_;
+    std::string duration_;
+    Poco::UInt64 task_id_;
+    Poco::UInt64 project_id_;
+    std::string project_guid_;
+    std::string guid_;
+};
+
+class StopCommand : public Command {
+ public:
+    explicit StopCommand(Context *ctx);
+
+    error Run();
+
+ private:
+    Context *ctx_;
+};
+
+// Continue given time entry, or the latest one if GUID is empty
+class ContinueCommand : public Command {
+ public:
+    ContinueCommand(
+        Context *ctx,
+        const std::string guid);
+
+    error Run();
+
+ private:
+    Context *ctx_;
+    std::string guid_;
+};
+
+class DeleteTimeEntryCommand : public Command {
+ public:
+    DeleteTimeEntryCommand(
+        Context *ctx,
+        const std::string guid);
+
+    error Run();
+
+ private:
+    Context *ctx_;
+    std::string guid_;
+};
+
+// Sets a field of a time entry from a string, with the given setter
+class SetTimeEntryValueCommand : public Command {
+ public:
+    typedef error (Context::*Setter)(
+        const std::string GUID,
+        const std::string value);
+
+    SetTimeEntryValueCommand(
+        const std::string name,
+        Context *ctx,
+        Setter setter,
+        const std::string guid,
+        const std::string value);
+
+    error Run();
+
+ private:
+    Context *ctx_;
+    Setter setter_;
+    std::string guid_;
+    std::string value_;
+};
+
+class SetTimeEntryProjectCommand : public Command {
+ public:
+    SetTimeEntryProjectCommand(
+        Context *ctx,
+        const std::string guid,
+        const Poco::UInt64 task_id,
+        const Poco::UInt64 project_id,
+        const std::string project_guid);
+
+    error Run();
+
+ private:
+    Context *ctx_;
+    std::string guid_;
+    Poco::UInt64 task_id_;
+    Poco::UInt64 project_id_;
+    std::string project_guid_;
+};
+
+class SetTimeEntryDateCommand : public Command {
+ public:
+    SetTimeEntryDateCommand(
+        Context *ctx,
+        const std::string guid,
+        const Poco::Int64 unix_timestamp);
+
+    error Run();
+
+ private:
+    Context *ctx_;
+    std::string guid_;
+    Poco::Int64 unix_timestamp_;
+};
+
+class SetTimeEntryBillableCommand : public Command {
+ public:
+    SetTimeEntryBillableCommand(
+        Context *ctx,
+        const std::string guid,
+        const bool value);
+
+    error Run();
+
+ private:
+    Context *ctx_;
+    std::string guid_;
+    bool value_;
+};
+
+}  // namespace toggl
+
+#endif  // SRC_CONTEXT_COMMANDS_H_
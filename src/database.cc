@@ -4,7 +4,9 @@
 
 #include "../src/database.h"
 
+#include <algorithm>
 #include <limits>
+#include <set>
 #include <string>
 #include <vector>
 
@@ -13,6 +15,7 @@
 #include "./const.h"
 #include "./project.h"
 #include "./proxy.h"
+#include "./related_data.h"
 #include "./settings.h"
 #include "./tag.h"
 #include "./task.h"
@@ -27,6 +30,7 @@
 #include "Poco/Data/SQLite/Utility.h"
 #include "Poco/Data/Statement.h"
 #include "Poco/FileStream.h"
+#include "Poco/LocalDateTime.h"
 #include "Poco/Logger.h"
 #include "Poco/Stopwatch.h"
 #include "Poco/StreamCopier.h"
@@ -40,6 +44,10 @@ using Poco::Data::Keywords::limit;
 using Poco::Data::Keywords::into;
 using Poco::Data::Keywords::now;
 
+// Rows per multi-row insert. 19 time entry columns per row
+// stay below the default limit of 999 parameters per statement.
+#define kBulkInsertRows 50
+
 Database::Database(const std::string db_path)
     : session_(nullptr)
 , desktop_id_("")
@@ -111,6 +119,7 @@ Database::Database(const std::string db_path)
 }
 
 Database::~Database() {
+    clearPreparedStatements();
     if (session_) {
         delete session_;
         session_ = nullptr;
@@ -281,10 +290,11 @@ error Database::deleteFromTable(
     logger().debug(ss.str());
 
     try {
-        *session_ << "delete from " + table_name +
-                  " where local_id = :local_id",
-                  useRef(local_id),
-                  now;
+        PreparedStatement *statement = prepare(
+            "delete from " + table_name +
+            " where local_id = :local_id");
+        statement->Use(local_id);
+        statement->Execute();
     } catch(const Poco::Exception& exc) {
         return exc.displayText();
     } catch(const std::exception& ex) {
@@ -307,6 +317,110 @@ error Database::last_error(const std::string was_doing) {
     return noError;
 }
 
+PreparedStatement *Database::prepare(const std::string sql) {
+    Poco::Mutex::ScopedLock lock(session_m_);
+
+    poco_check_ptr(session_);
+
+    PreparedStatement *statement = nullptr;
+    std::map<std::string, PreparedStatement *>::const_iterator it =
+        prepared_statements_.find(sql);
+    if (it != prepared_statements_.end()) {
+        statement = it->second;
+    } else {
+        statement = new PreparedStatement(
+            Poco::Data::SQLite::Utility::dbHandle(*session_), sql);
+        prepared_statements_[sql] = statement;
+    }
+    statement->Reset();
+    return statement;
+}
+
+void Database::clearPreparedStatements() {
+    Poco::Mutex::ScopedLock lock(session_m_);
+
+    for (std::map<std::string, PreparedStatement *>::const_iterator it =
+        prepared_statements_.begin();
+            it != prepared_statements_.end(); it++) {
+        delete it->second;
+    }
+    prepared_statements_.clear();
+}
+
+Poco::Int64 Database::lastInsertRowID() {
+    Poco::Mutex::ScopedLock lock(session_m_);
+
+    poco_check_ptr(session_);
+
+    return sqlite3_last_insert_rowid(
+        Poco::Data::SQLite::Utility::dbHandle(*session_));
+}
+
+PreparedStatement::PreparedStatement(sqlite3 *db, const std::string sql)
+    : db_(db)
+, stmt_(nullptr)
+, position_(0) {
+    poco_check_ptr(db_);
+
+    int rc = sqlite3_prepare_v2(db_, sql.c_str(), -1, &stmt_, nullptr);
+    if (SQLITE_OK != rc) {
+        std::string err(sqlite3_errmsg(db_));
+        sqlite3_finalize(stmt_);
+        stmt_ = nullptr;
+        throw Poco::Exception("prepare: " + err);
+    }
+}
+
+PreparedStatement::~PreparedStatement() {
+    sqlite3_finalize(stmt_);
+}
+
+void PreparedStatement::Reset() {
+    sqlite3_reset(stmt_);
+    sqlite3_clear_bindings(stmt_);
+    position_ = 0;
+}
+
+void PreparedStatement::Use(const Poco::Int64 &value) {
+    check(sqlite3_bind_int64(stmt_, ++position_, value), "bind");
+}
+
+void PreparedStatement::Use(const Poco::UInt64 &value) {
+    check(sqlite3_bind_int64(stmt_, ++position_,
+                             static_cast<sqlite3_int64>(value)), "bind");
+}
+
+void PreparedStatement::Use(const bool &value) {
+    check(sqlite3_bind_int(stmt_, ++position_, value ? 1 : 0), "bind");
+}
+
+void PreparedStatement::Use(const std::string &value) {
+    check(sqlite3_bind_text(stmt_, ++position_,
+                            value.c_str(), static_cast<int>(value.size()),
+                            SQLITE_TRANSIENT), "bind");
+}
+
+void PreparedStatement::Execute() {
+    int rc = sqlite3_step(stmt_);
+    if (SQLITE_DONE == rc || SQLITE_ROW == rc) {
+        rc = SQLITE_OK;
+    }
+    check(rc, "execute");
+    // Release the statement, so it does not hold up the transaction
+    sqlite3_reset(stmt_);
+}
+
+void PreparedStatement::check(
+    const int rc,
+    const std::string was_doing) const {
+    if (SQLITE_OK == rc) {
+        return;
+    }
+    std::string err(sqlite3_errmsg(db_));
+    sqlite3_reset(stmt_);
+    throw Poco::Exception(was_doing + ": " + err);
+}
+
 std::string Database::GenerateGUID() {
     Poco::UUIDGenerator& generator = Poco::UUIDGenerator::defaultGenerator();
     Poco::UUID uuid(generator.createRandom());
@@ -753,6 +867,48 @@ error Database::LoadUserByEmail(
     return LoadUserByID(uid, model);
 }
 
+error Database::LoadUserSince(
+    const std::string &email,
+    Poco::UInt64 *since) {
+
+    if (email.empty()) {
+        return error("Cannot load user since without an email");
+    }
+
+    poco_check_ptr(since);
+
+    Poco::Mutex::ScopedLock lock(session_m_);
+
+    poco_check_ptr(session_);
+
+    *since = 0;
+
+    try {
+        Poco::Int64 value(0);
+        *session_ << "select since from users"
+                  " where email = :email"
+                  " limit 1",
+                  into(value),
+                  useRef(email),
+                  limit(1),
+                  now;
+        error err = last_error("LoadUserSince");
+        if (err != noError) {
+            return err;
+        }
+        if (value > 0) {
+            *since = value;
+        }
+    } catch(const Poco::Exception& exc) {
+        return exc.displayText();
+    } catch(const std::exception& ex) {
+        return ex.what();
+    } catch(const std::string& ex) {
+        return ex;
+    }
+    return noError;
+}
+
 error Database::loadUsersRelatedData(User *user) {
     error err = loadWorkspaces(user->ID(), &user->related.Workspaces);
     if (err != noError) {
@@ -779,7 +935,7 @@ error Database::loadUsersRelatedData(User *user) {
         return err;
     }
 
-    err = loadTimeEntries(user->ID(), &user->related.TimeEntries);
+    err = loadTimeEntries(user->ID(), &user->related);
     if (err != noError) {
         return err;
     }
@@ -885,7 +1041,7 @@ error Database::LoadUserByID(
 
 error Database::loadWorkspaces(
     const Poco::UInt64 &UID,
-    std::vector<Workspace *> *list) {
+    ModelList<Workspace> *list) {
 
     if (!UID) {
         return error("Cannot load user workspaces without an user ID");
@@ -940,7 +1096,7 @@ error Database::loadWorkspaces(
 
 error Database::loadClients(
     const Poco::UInt64 &UID,
-    std::vector<Client *> *list) {
+    ModelList<Client> *list) {
 
     if (!UID) {
         return error("Cannot load user clients without an user ID");
@@ -1001,7 +1157,7 @@ error Database::loadClients(
 
 error Database::loadProjects(
     const Poco::UInt64 &UID,
-    std::vector<Project *> *list) {
+    ModelList<Project> *list) {
 
     if (!UID) {
         return error("Cannot load user projects without an user ID");
@@ -1079,7 +1235,7 @@ error Database::loadProjects(
 
 error Database::loadTasks(
     const Poco::UInt64 &UID,
-    std::vector<Task *> *list) {
+    ModelList<Task> *list) {
 
     if (!UID) {
         return error("Cannot load user tasks without an user ID");
@@ -1140,7 +1296,7 @@ error Database::loadTasks(
 
 error Database::loadTags(
     const Poco::UInt64 &UID,
-    std::vector<Tag *> *list) {
+    ModelList<Tag> *list) {
 
     if (!UID) {
         return error("Cannot load user tags without an user ID");
@@ -1200,7 +1356,7 @@ error Database::loadTags(
 
 error Database::loadAutotrackerRules(
     const Poco::UInt64 &UID,
-    std::vector<AutotrackerRule *> *list) {
+    ModelList<AutotrackerRule> *list) {
 
     if (!UID) {
         return error("Cannot load autotracker rules without an user ID");
@@ -1248,9 +1404,18 @@ error Database::loadAutotrackerRules(
     return last_error("loadAutotrackerRules");
 }
 
+// Start of the local day, given number of days ago
+static Poco::Int64 startOfDay(const int days_ago) {
+    Poco::LocalDateTime now;
+    Poco::LocalDateTime today(now.year(), now.month(), now.day());
+    Poco::Timestamp ts = today.utc().timestamp();
+    ts -= days_ago * Poco::Timespan::DAYS;
+    return ts.epochTime();
+}
+
 error Database::loadTimeEntries(
     const Poco::UInt64 &UID,
-    std::vector<TimeEntry *> *list) {
+    RelatedData *related) {
 
     if (!UID) {
         return error("Cannot load user time entries without an user ID");
@@ -1258,10 +1423,13 @@ error Database::loadTimeEntries(
 
     Poco::Mutex::ScopedLock lock(session_m_);
 
-    poco_check_ptr(list);
+    poco_check_ptr(related);
 
+    ModelList<TimeEntry> *list = &related->TimeEntries;
     list->clear();
 
+    Poco::Int64 since = startOfDay(kTimeEntryResidentDays);
+
     try {
         Poco::Data::Statement select(*session_);
         select << "SELECT local_id, id, uid, description, wid, guid, pid, "
@@ -1270,8 +1438,10 @@ error Database::loadTimeEntries(
                "project_guid, validation_error "
                "FROM time_entries "
                "WHERE uid = :uid "
+               "AND start >= :since "
                "ORDER BY start DESC",
-               useRef(UID);
+               useRef(UID),
+               useRef(since);
         error err = last_error("loadTimeEntries");
         if (err != noError) {
             return err;
@@ -1281,14 +1451,190 @@ error Database::loadTimeEntries(
             return err;
         }
 
-        // Ensure all time entries have a GUID.
-        for (std::vector<TimeEntry *>::iterator it = list->begin();
-                it != list->end();
-                ++it) {
-            TimeEntry *te = *it;
-            te->EnsureGUID();
-            if (te->Dirty()) {
-                te->SetUIModified();
+        // Older time entries that are running
+        // or have changes not pushed yet
+        Poco::Data::Statement select_unsynced(*session_);
+        select_unsynced <<
+                        "SELECT local_id, id, uid, description, wid, guid, "
+                        "pid, tid, billable, duronly, ui_modified_at, "
+                        "start, stop, duration, tags, created_with, "
+                        "deleted_at, updated_at, project_guid, "
+                        "validation_error "
+                        "FROM time_entries "
+                        "WHERE uid = :uid "
+                        "AND start < :since "
+                        "AND (id IS NULL OR ui_modified_at > 0 "
+                        "OR deleted_at > 0 OR duration < 0)",
+                        useRef(UID),
+                        useRef(since);
+        err = loadTimeEntriesFromSQLStatement(&select_unsynced, list);
+        if (err != noError) {
+            return err;
+        }
+    } catch(const Poco::Exception& exc) {
+        return exc.displayText();
+    } catch(const std::exception& ex) {
+        return ex.what();
+    } catch(const std::string& ex) {
+        return ex;
+    }
+
+    return residentTimeEntriesSince(
+        UID, since, &related->ResidentTimeEntriesSince);
+}
+
+error Database::LoadMoreTimeEntries(User *user, const int days) {
+    poco_check_ptr(user);
+
+    if (!user->ID()) {
+        return error("Cannot load user time entries without an user ID");
+    }
+
+    Poco::Int64 before = user->related.ResidentTimeEntriesSince;
+    if (!before) {
+        // All time entries are loaded already
+        return noError;
+    }
+
+    Poco::Int64 since = before - days * Poco::Timespan::DAYS
+                        / Poco::Timespan::SECONDS;
+
+    Poco::Mutex::ScopedLock lock(session_m_);
+
+    poco_check_ptr(session_);
+
+    ModelList<TimeEntry> list;
+    try {
+        Poco::UInt64 UID = user->ID();
+        Poco::Data::Statement select(*session_);
+        select << "SELECT local_id, id, uid, description, wid, guid, pid, "
+               "tid, billable, duronly, ui_modified_at, start, stop, "
+               "duration, tags, created_with, deleted_at, updated_at, "
+               "project_guid, validation_error "
+               "FROM time_entries "
+               "WHERE uid = :uid "
+               "AND start >= :since "
+               "AND start < :before "
+               "ORDER BY start DESC",
+               useRef(UID),
+               useRef(since),
+               useRef(before);
+        error err = last_error("LoadMoreTimeEntries");
+        if (err != noError) {
+            return err;
+        }
+        err = loadTimeEntriesFromSQLStatement(&select, &list);
+        if (err != noError) {
+            return err;
+        }
+    } catch(const Poco::Exception& exc) {
+        return exc.displayText();
+    } catch(const std::exception& ex) {
+        return ex.what();
+    } catch(const std::string& ex) {
+        return ex;
+    }
+
+    std::stringstream ss;
+    ss << "Loaded " << list.size() << " more time entries";
+    logger().debug(ss.str());
+
+    // Unsynced ones are in memory already. Time entries stored
+    // without a GUID were given a new one on each load, so
+    // match them by local ID.
+    std::set<Poco::Int64> resident;
+    for (std::vector<TimeEntry *>::const_iterator it =
+        user->related.TimeEntries.begin();
+            it != user->related.TimeEntries.end(); it++) {
+        resident.insert((*it)->LocalID());
+    }
+    for (ModelList<TimeEntry>::const_iterator it = list.begin();
+            it != list.end(); it++) {
+        TimeEntry *te = *it;
+        if (resident.find(te->LocalID()) != resident.end()
+                || user->related.TimeEntryByGUID(te->GUID())) {
+            delete te;
+            continue;
+        }
+        user->related.Add(te);
+    }
+
+    return residentTimeEntriesSince(
+        user->ID(), since, &user->related.ResidentTimeEntriesSince);
+}
+
+error Database::residentTimeEntriesSince(
+    const Poco::UInt64 &UID,
+    const Poco::Int64 &since,
+    Poco::Int64 *result) {
+
+    Poco::Mutex::ScopedLock lock(session_m_);
+
+    poco_check_ptr(session_);
+    poco_check_ptr(result);
+
+    try {
+        Poco::Int64 older(0);
+        *session_ << "SELECT EXISTS(SELECT 1 FROM time_entries "
+                  "WHERE uid = :uid AND start < :since)",
+                  into(older),
+                  useRef(UID),
+                  useRef(since),
+                  now;
+        error err = last_error("residentTimeEntriesSince");
+        if (err != noError) {
+            return err;
+        }
+        *result = older ? since : 0;
+    } catch(const Poco::Exception& exc) {
+        return exc.displayText();
+    } catch(const std::exception& ex) {
+        return ex.what();
+    } catch(const std::string& ex) {
+        return ex;
+    }
+    return noError;
+}
+
+error Database::findTimeEntryLocalIDs(
+    const Poco::UInt64 &UID,
+    RelatedData *related) {
+
+    poco_check_ptr(related);
+
+    if (!related->ResidentTimeEntriesSince) {
+        // All time entries are in memory
+        return noError;
+    }
+
+    Poco::Mutex::ScopedLock lock(session_m_);
+
+    poco_check_ptr(session_);
+
+    std::vector<TimeEntry *> dirty;
+    related->DirtyModels(&dirty);
+
+    try {
+        for (std::vector<TimeEntry *>::const_iterator it = dirty.begin();
+                it != dirty.end(); it++) {
+            TimeEntry *model = *it;
+            if (model->LocalID() || !model->ID()) {
+                continue;
+            }
+            Poco::Int64 local_id(0);
+            Poco::UInt64 id(model->ID());
+            *session_ << "SELECT local_id FROM time_entries "
+                      "WHERE uid = :uid AND id = :id",
+                      into(local_id),
+                      useRef(UID),
+                      useRef(id),
+                      now;
+            error err = last_error("findTimeEntryLocalIDs");
+            if (err != noError) {
+                return err;
+            }
+            if (local_id) {
+                model->SetLocalID(local_id);
             }
         }
     } catch(const Poco::Exception& exc) {
@@ -1303,7 +1649,7 @@ error Database::loadTimeEntries(
 
 error Database::loadTimeEntriesFromSQLStatement(
     Poco::Data::Statement *select,
-    std::vector<TimeEntry *> *list) {
+    ModelList<TimeEntry> *list) {
 
     poco_check_ptr(select);
     poco_check_ptr(list);
@@ -1328,7 +1674,11 @@ error Database::loadTimeEntriesFromSQLStatement(
                     model->SetDescription(rs[3].convert<std::string>());
                 }
                 model->SetWID(rs[4].convert<Poco::UInt64>());
-                model->SetGUID(rs[5].convert<std::string>());
+                if (rs[5].isEmpty()) {
+                    model->SetGUID("");
+                } else {
+                    model->SetGUID(rs[5].convert<std::string>());
+                }
                 if (rs[6].isEmpty()) {
                     model->SetPID(0);
                 } else {
@@ -1384,6 +1734,13 @@ error Database::loadTimeEntriesFromSQLStatement(
                     model->SetValidationError(rs[19].convert<std::string>());
                 }
                 model->ClearDirty();
+
+                // Ensure all time entries have a GUID.
+                model->EnsureGUID();
+                if (model->Dirty()) {
+                    model->SetUIModified();
+                }
+
                 list->push_back(model);
                 more = rs.moveNext();
             }
@@ -1398,24 +1755,29 @@ error Database::loadTimeEntriesFromSQLStatement(
     return noError;
 }
 
+// Save the models of type T that were changed since last save
 template <typename T>
 error Database::saveRelatedModels(
     const Poco::UInt64 UID,
     const std::string table_name,
-    std::vector<T *> *list,
-    std::vector<ModelChange> *changes) {
+    RelatedData *related,
+    std::vector<ModelChange> *changes,
+    Poco::UInt64 *visited) {
 
     if (!UID) {
         return error("Cannot save user related data without an user ID");
     }
 
-    poco_check_ptr(list);
+    poco_check_ptr(related);
     poco_check_ptr(changes);
+    poco_check_ptr(visited);
 
-    typedef typename std::vector<T *>::iterator iterator;
+    std::vector<T *> list;
+    related->DirtyModels(&list);
+    *visited += list.size();
 
-    for (size_t i = 0; i < list->size(); i++) {
-        T *model = list->at(i);
+    for (size_t i = 0; i < list.size(); i++) {
+        T *model = list.at(i);
         if (model->IsMarkedAsDeletedOnServer()) {
             error err = deleteFromTable(table_name, model->LocalID());
             if (err != noError) {
@@ -1433,19 +1795,117 @@ error Database::saveRelatedModels(
         if (err != noError) {
             return err;
         }
+        // Model is in sync with database now,
+        // even if there was nothing to write
+        model->ClearDirty();
+    }
+
+    return noError;
+}
+
+// Insert new time entries that came from the server with
+// multi-row inserts, kBulkInsertRows rows per statement.
+// Whatever does not fill a whole statement is left for saveModel.
+error Database::insertTimeEntries(
+    const Poco::UInt64 UID,
+    RelatedData *related,
+    std::vector<ModelChange> *changes,
+    Poco::UInt64 *visited) {
+
+    if (!UID) {
+        return error("Cannot save user related data without an user ID");
+    }
+
+    poco_check_ptr(session_);
+    poco_check_ptr(related);
+    poco_check_ptr(changes);
+    poco_check_ptr(visited);
+
+    std::vector<TimeEntry *> dirty;
+    related->DirtyModels(&dirty);
+
+    std::vector<TimeEntry *> list;
+    for (std::vector<TimeEntry *>::const_iterator it = dirty.begin();
+            it != dirty.end(); it++) {
+        TimeEntry *model = *it;
+        if (model->LocalID() || !model->ID()
+                || model->IsMarkedAsDeletedOnServer()) {
+            continue;
+        }
+        model->EnsureGUID();
+        list.push_back(model);
     }
 
-    // Purge deleted models from memory
-    iterator it = list->begin();
-    while (it != list->end()) {
-        T *model = *it;
-        if (model->IsMarkedAsDeletedOnServer()) {
-            it = list->erase(it);
-        } else {
-            ++it;
+    size_t batches = list.size() / kBulkInsertRows;
+    if (!batches) {
+        return noError;
+    }
+
+    std::stringstream sql;
+    sql << "insert into time_entries(id, uid, description, "
+        "wid, guid, pid, tid, billable, "
+        "duronly, ui_modified_at, "
+        "start, stop, duration, "
+        "tags, created_with, deleted_at, updated_at, "
+        "project_guid, validation_error) values ";
+    for (size_t i = 0; i < kBulkInsertRows; i++) {
+        if (i) {
+            sql << ", ";
+        }
+        sql << "(?, ?, ?, ?, ?, ?, ?, ?, ?, ?, "
+            "?, ?, ?, ?, ?, ?, ?, ?, ?)";
+    }
+
+    try {
+        for (size_t batch = 0; batch < batches; batch++) {
+            PreparedStatement *statement = prepare(sql.str());
+            size_t first = batch * kBulkInsertRows;
+            for (size_t i = first; i < first + kBulkInsertRows; i++) {
+                TimeEntry *model = list[i];
+                model->SetUID(UID);
+                statement->Use(model->ID());
+                statement->Use(model->UID());
+                statement->Use(model->Description());
+                statement->Use(model->WID());
+                statement->Use(model->GUID());
+                statement->Use(model->PID());
+                statement->Use(model->TID());
+                statement->Use(model->Billable());
+                statement->Use(model->DurOnly());
+                statement->Use(model->UIModifiedAt());
+                statement->Use(model->Start());
+                statement->Use(model->Stop());
+                statement->Use(model->DurationInSeconds());
+                statement->Use(model->Tags());
+                statement->Use(model->CreatedWith());
+                statement->Use(model->DeletedAt());
+                statement->Use(model->UpdatedAt());
+                statement->Use(model->ProjectGUID());
+                statement->Use(model->ValidationError());
+            }
+            statement->Execute();
+
+            // Rows of a single insert statement get
+            // consecutive row IDs, in the order of values.
+            Poco::Int64 local_id = lastInsertRowID() - kBulkInsertRows + 1;
+            for (size_t i = first; i < first + kBulkInsertRows; i++) {
+                TimeEntry *model = list[i];
+                model->SetLocalID(local_id++);
+                model->ClearDirty();
+                changes->push_back(ModelChange(
+                    model->ModelName(), "insert", model->ID(), model->GUID()));
+            }
         }
+    } catch(const Poco::Exception& exc) {
+        return exc.displayText();
+    } catch(const std::exception& ex) {
+        return ex.what();
+    } catch(const std::string& ex) {
+        return ex;
     }
 
+    *visited += batches * kBulkInsertRows;
+
     return noError;
 }
 
@@ -1456,8 +1916,6 @@ error Database::saveModel(
     TimeEntry *model,
     std::vector<ModelChange> *changes) {
 
-    Poco::Mutex::ScopedLock lock(session_m_);
-
     poco_check_ptr(model);
     poco_check_ptr(session_);
     poco_check_ptr(changes);
@@ -1481,74 +1939,76 @@ error Database::saveModel(
             logger().debug(ss.str());
 
             if (model->ID()) {
-                *session_ << "update time_entries set "
-                          "id = :id, uid = :uid, description = :description, "
-                          "wid = :wid, guid = :guid, pid = :pid, tid = :tid, "
-                          "billable = :billable, "
-                          "duronly = :duronly, "
-                          "ui_modified_at = :ui_modified_at, "
-                          "start = :start, stop = :stop, duration = :duration, "
-                          "tags = :tags, created_with = :created_with, "
-                          "deleted_at = :deleted_at, "
-                          "updated_at = :updated_at, "
-                          "project_guid = :project_guid, "
-                          "validation_error = :validation_error "
-                          "where local_id = :local_id",
-                          useRef(model->ID()),
-                          useRef(model->UID()),
-                          useRef(model->Description()),
-                          useRef(model->WID()),
-                          useRef(model->GUID()),
-                          useRef(model->PID()),
-                          useRef(model->TID()),
-                          useRef(model->Billable()),
-                          useRef(model->DurOnly()),
-                          useRef(model->UIModifiedAt()),
-                          useRef(model->Start()),
-                          useRef(model->Stop()),
-                          useRef(model->DurationInSeconds()),
-                          useRef(model->Tags()),
-                          useRef(model->CreatedWith()),
-                          useRef(model->DeletedAt()),
-                          useRef(model->UpdatedAt()),
-                          useRef(model->ProjectGUID()),
-                          useRef(model->ValidationError()),
-                          useRef(model->LocalID()),
-                          now;
+                PreparedStatement *statement = prepare(
+                    "update time_entries set "
+                    "id = :id, uid = :uid, description = :description, "
+                    "wid = :wid, guid = :guid, pid = :pid, tid = :tid, "
+                    "billable = :billable, "
+                    "duronly = :duronly, "
+                    "ui_modified_at = :ui_modified_at, "
+                    "start = :start, stop = :stop, duration = :duration, "
+                    "tags = :tags, created_with = :created_with, "
+                    "deleted_at = :deleted_at, "
+                    "updated_at = :updated_at, "
+                    "project_guid = :project_guid, "
+                    "validation_error = :validation_error "
+                    "where local_id = :local_id");
+                statement->Use(model->ID());
+                statement->Use(model->UID());
+                statement->Use(model->Description());
+                statement->Use(model->WID());
+                statement->Use(model->GUID());
+                statement->Use(model->PID());
+                statement->Use(model->TID());
+                statement->Use(model->Billable());
+                statement->Use(model->DurOnly());
+                statement->Use(model->UIModifiedAt());
+                statement->Use(model->Start());
+                statement->Use(model->Stop());
+                statement->Use(model->DurationInSeconds());
+                statement->Use(model->Tags());
+                statement->Use(model->CreatedWith());
+                statement->Use(model->DeletedAt());
+                statement->Use(model->UpdatedAt());
+                statement->Use(model->ProjectGUID());
+                statement->Use(model->ValidationError());
+                statement->Use(model->LocalID());
+                statement->Execute();
             } else {
-                *session_ << "update time_entries set "
-                          "uid = :uid, description = :description, wid = :wid, "
-                          "guid = :guid, pid = :pid, tid = :tid, "
-                          "billable = :billable, "
-                          "duronly = :duronly, "
-                          "ui_modified_at = :ui_modified_at, "
-                          "start = :start, stop = :stop, duration = :duration, "
-                          "tags = :tags, created_with = :created_with, "
-                          "deleted_at = :deleted_at, "
-                          "updated_at = :updated_at, "
-                          "project_guid = :project_guid, "
-                          "validation_error = :validation_error "
-                          "where local_id = :local_id",
-                          useRef(model->UID()),
-                          useRef(model->Description()),
-                          useRef(model->WID()),
-                          useRef(model->GUID()),
-                          useRef(model->PID()),
-                          useRef(model->TID()),
-                          useRef(model->Billable()),
-                          useRef(model->DurOnly()),
-                          useRef(model->UIModifiedAt()),
-                          useRef(model->Start()),
-                          useRef(model->Stop()),
-                          useRef(model->DurationInSeconds()),
-                          useRef(model->Tags()),
-                          useRef(model->CreatedWith()),
-                          useRef(model->DeletedAt()),
-                          useRef(model->UpdatedAt()),
-                          useRef(model->ProjectGUID()),
-                          useRef(model->ValidationError()),
-                          useRef(model->LocalID()),
-                          now;
+                PreparedStatement *statement = prepare(
+                    "update time_entries set "
+                    "uid = :uid, description = :description, wid = :wid, "
+                    "guid = :guid, pid = :pid, tid = :tid, "
+                    "billable = :billable, "
+                    "duronly = :duronly, "
+                    "ui_modified_at = :ui_modified_at, "
+                    "start = :start, stop = :stop, duration = :duration, "
+                    "tags = :tags, created_with = :created_with, "
+                    "deleted_at = :deleted_at, "
+                    "updated_at = :updated_at, "
+                    "project_guid = :project_guid, "
+                    "validation_error = :validation_error "
+                    "where local_id = :local_id");
+                statement->Use(model->UID());
+                statement->Use(model->Description());
+                statement->Use(model->WID());
+                statement->Use(model->GUID());
+                statement->Use(model->PID());
+                statement->Use(model->TID());
+                statement->Use(model->Billable());
+                statement->Use(model->DurOnly());
+                statement->Use(model->UIModifiedAt());
+                statement->Use(model->Start());
+                statement->Use(model->Stop());
+                statement->Use(model->DurationInSeconds());
+                statement->Use(model->Tags());
+                statement->Use(model->CreatedWith());
+                statement->Use(model->DeletedAt());
+                statement->Use(model->UpdatedAt());
+                statement->Use(model->ProjectGUID());
+                statement->Use(model->ValidationError());
+                statement->Use(model->LocalID());
+                statement->Execute();
             }
             error err = last_error("saveTimeEntry");
             if (err != noError) {
@@ -1567,84 +2027,79 @@ error Database::saveModel(
                << " in thread " << Poco::Thread::currentTid();
             logger().debug(ss.str());
             if (model->ID()) {
-                *session_ << "insert into time_entries(id, uid, description, "
-                          "wid, guid, pid, tid, billable, "
-                          "duronly, ui_modified_at, "
-                          "start, stop, duration, "
-                          "tags, created_with, deleted_at, updated_at, "
-                          "project_guid, validation_error) "
-                          "values(:id, :uid, :description, :wid, "
-                          ":guid, :pid, :tid, :billable, "
-                          ":duronly, :ui_modified_at, "
-                          ":start, :stop, :duration, "
-                          ":tags, :created_with, :deleted_at, :updated_at, "
-                          ":project_guid, :validation_error)",
-                          useRef(model->ID()),
-                          useRef(model->UID()),
-                          useRef(model->Description()),
-                          useRef(model->WID()),
-                          useRef(model->GUID()),
-                          useRef(model->PID()),
-                          useRef(model->TID()),
-                          useRef(model->Billable()),
-                          useRef(model->DurOnly()),
-                          useRef(model->UIModifiedAt()),
-                          useRef(model->Start()),
-                          useRef(model->Stop()),
-                          useRef(model->DurationInSeconds()),
-                          useRef(model->Tags()),
-                          useRef(model->CreatedWith()),
-                          useRef(model->DeletedAt()),
-                          useRef(model->UpdatedAt()),
-                          useRef(model->ProjectGUID()),
-                          useRef(model->ValidationError()),
-                          now;
+                PreparedStatement *statement = prepare(
+                    "insert into time_entries(id, uid, description, "
+                    "wid, guid, pid, tid, billable, "
+                    "duronly, ui_modified_at, "
+                    "start, stop, duration, "
+                    "tags, created_with, deleted_at, updated_at, "
+                    "project_guid, validation_error) "
+                    "values(:id, :uid, :description, :wid, "
+                    ":guid, :pid, :tid, :billable, "
+                    ":duronly, :ui_modified_at, "
+                    ":start, :stop, :duration, "
+                    ":tags, :created_with, :deleted_at, :updated_at, "
+                    ":project_guid, :validation_error)");
+                statement->Use(model->ID());
+                statement->Use(model->UID());
+                statement->Use(model->Description());
+                statement->Use(model->WID());
+                statement->Use(model->GUID());
+                statement->Use(model->PID());
+                statement->Use(model->TID());
+                statement->Use(model->Billable());
+                statement->Use(model->DurOnly());
+                statement->Use(model->UIModifiedAt());
+                statement->Use(model->Start());
+                statement->Use(model->Stop());
+                statement->Use(model->DurationInSeconds());
+                statement->Use(model->Tags());
+                statement->Use(model->CreatedWith());
+                statement->Use(model->DeletedAt());
+                statement->Use(model->UpdatedAt());
+                statement->Use(model->ProjectGUID());
+                statement->Use(model->ValidationError());
+                statement->Execute();
             } else {
-                *session_ << "insert into time_entries(uid, description, wid, "
-                          "guid, pid, tid, billable, "
-                          "duronly, ui_modified_at, "
-                          "start, stop, duration, "
-                          "tags, created_with, deleted_at, updated_at, "
-                          "project_guid, validation_error "
-                          ") values ("
-                          ":uid, :description, :wid, "
-                          ":guid, :pid, :tid, :billable, "
-                          ":duronly, :ui_modified_at, "
-                          ":start, :stop, :duration, "
-                          ":tags, :created_with, :deleted_at, :updated_at, "
-                          ":project_guid, :validation_error)",
-                          useRef(model->UID()),
-                          useRef(model->Description()),
-                          useRef(model->WID()),
-                          useRef(model->GUID()),
-                          useRef(model->PID()),
-                          useRef(model->TID()),
-                          useRef(model->Billable()),
-                          useRef(model->DurOnly()),
-                          useRef(model->UIModifiedAt()),
-                          useRef(model->Start()),
-                          useRef(model->Stop()),
-                          useRef(model->DurationInSeconds()),
-                          useRef(model->Tags()),
-                          useRef(model->CreatedWith()),
-                          useRef(model->DeletedAt()),
-                          useRef(model->UpdatedAt()),
-                          useRef(model->ProjectGUID()),
-                          useRef(model->ValidationError()),
-                          now;
+                PreparedStatement *statement = prepare(
+                    "insert into time_entries(uid, description, wid, "
+                    "guid, pid, tid, billable, "
+                    "duronly, ui_modified_at, "
+                    "start, stop, duration, "
+                    "tags, created_with, deleted_at, updated_at, "
+                    "project_guid, validation_error "
+                    ") values ("
+                    ":uid, :description, :wid, "
+                    ":guid, :pid, :tid, :billable, "
+                    ":duronly, :ui_modified_at, "
+                    ":start, :stop, :duration, "
+                    ":tags, :created_with, :deleted_at, :updated_at, "
+                    ":project_guid, :validation_error)");
+                statement->Use(model->UID());
+                statement->Use(model->Description());
+                statement->Use(model->WID());
+                statement->Use(model->GUID());
+                statement->Use(model->PID());
+                statement->Use(model->TID());
+                statement->Use(model->Billable());
+                statement->Use(model->DurOnly());
+                statement->Use(model->UIModifiedAt());
+                statement->Use(model->Start());
+                statement->Use(model->Stop());
+                statement->Use(model->DurationInSeconds());
+                statement->Use(model->Tags());
+                statement->Use(model->CreatedWith());
+                statement->Use(model->DeletedAt());
+                statement->Use(model->UpdatedAt());
+                statement->Use(model->ProjectGUID());
+                statement->Use(model->ValidationError());
+                statement->Execute();
             }
             error err = last_error("saveTimeEntry");
             if (err != noError) {
                 return err;
             }
-            Poco::Int64 local_id(0);
-            *session_ << "select last_insert_rowid()",
-                      into(local_id),
-                      now;
-            err = last_error("saveTimeEntry");
-            if (err != noError) {
-                return err;
-            }
+            Poco::Int64 local_id = lastInsertRowID();
             model->SetLocalID(local_id);
             changes->push_back(ModelChange(
                 model->ModelName(), "insert", model->ID(), model->GUID()));
@@ -1664,8 +2119,6 @@ error Database::saveModel(
     AutotrackerRule *model,
     std::vector<ModelChange> *changes) {
 
-    Poco::Mutex::ScopedLock lock(session_m_);
-
     poco_check_ptr(model);
     poco_check_ptr(session_);
 
@@ -1680,14 +2133,15 @@ error Database::saveModel(
                << " in thread " << Poco::Thread::currentTid();
             logger().trace(ss.str());
 
-            *session_ << "update autotracker_settings set "
-                      "uid = :uid, term = :term, pid = :pid "
-                      "where local_id = :local_id",
-                      useRef(model->UID()),
-                      useRef(model->Term()),
-                      useRef(model->PID()),
-                      useRef(model->LocalID()),
-                      now;
+            PreparedStatement *statement = prepare(
+                "update autotracker_settings set "
+                "uid = :uid, term = :term, pid = :pid "
+                "where local_id = :local_id");
+            statement->Use(model->UID());
+            statement->Use(model->Term());
+            statement->Use(model->PID());
+            statement->Use(model->LocalID());
+            statement->Execute();
             error err = last_error("saveAutotrackerRule");
             if (err != noError) {
                 return err;
@@ -1705,25 +2159,18 @@ error Database::saveModel(
             ss << "Inserting autotracker rule " + model->String()
                << " in thread " << Poco::Thread::currentTid();
             logger().trace(ss.str());
-            *session_ <<
-                      "insert into autotracker_settings(uid, term, pid) "
-                      "values(:uid, :term, :pid)",
-                      useRef(model->UID()),
-                      useRef(model->Term()),
-                      useRef(model->PID()),
-                      now;
+            PreparedStatement *statement = prepare(
+                "insert into autotracker_settings(uid, term, pid) "
+                "values(:uid, :term, :pid)");
+            statement->Use(model->UID());
+            statement->Use(model->Term());
+            statement->Use(model->PID());
+            statement->Execute();
             error err = last_error("saveAutotrackerRule");
             if (err != noError) {
                 return err;
             }
-            Poco::Int64 local_id(0);
-            *session_ << "select last_insert_rowid()",
-                      into(local_id),
-                      now;
-            err = last_error("saveAutotrackerRule");
-            if (err != noError) {
-                return err;
-            }
+            Poco::Int64 local_id = lastInsertRowID();
             model->SetLocalID(local_id);
             changes->push_back(ModelChange(
                 model->ModelName(), "insert", model->ID(), model->GUID()));
@@ -1744,8 +2191,6 @@ error Database::saveModel(
     Workspace *model,
     std::vector<ModelChange> *changes) {
 
-    Poco::Mutex::ScopedLock lock(session_m_);
-
     poco_check_ptr(model);
     poco_check_ptr(session_);
 
@@ -1760,19 +2205,20 @@ error Database::saveModel(
                << " in thread " << Poco::Thread::currentTid();
             logger().trace(ss.str());
 
-            *session_ << "update workspaces set "
-                      "id = :id, uid = :uid, name = :name, premium = :premium, "
-                      "only_admins_may_create_projects = "
-                      ":only_admins_may_create_projects, admin = :admin "
-                      "where local_id = :local_id",
-                      useRef(model->ID()),
-                      useRef(model->UID()),
-                      useRef(model->Name()),
-                      useRef(model->Premium()),
-                      useRef(model->OnlyAdminsMayCreateProjects()),
-                      useRef(model->Admin()),
-                      useRef(model->LocalID()),
-                      now;
+            PreparedStatement *statement = prepare(
+                "update workspaces set "
+                "id = :id, uid = :uid, name = :name, premium = :premium, "
+                "only_admins_may_create_projects = "
+                ":only_admins_may_create_projects, admin = :admin "
+                "where local_id = :local_id");
+            statement->Use(model->ID());
+            statement->Use(model->UID());
+            statement->Use(model->Name());
+            statement->Use(model->Premium());
+            statement->Use(model->OnlyAdminsMayCreateProjects());
+            statement->Use(model->Admin());
+            statement->Use(model->LocalID());
+            statement->Execute();
             error err = last_error("saveWorkspace");
             if (err != noError) {
                 return err;
@@ -1785,30 +2231,23 @@ error Database::saveModel(
             ss << "Inserting workspace " + model->String()
                << " in thread " << Poco::Thread::currentTid();
             logger().trace(ss.str());
-            *session_ <<
-                      "insert into workspaces(id, uid, name, premium, "
-                      "only_admins_may_create_projects, admin) "
-                      "values(:id, :uid, :name, :premium, "
-                      ":only_admins_may_create_projects, :admin)",
-                      useRef(model->ID()),
-                      useRef(model->UID()),
-                      useRef(model->Name()),
-                      useRef(model->Premium()),
-                      useRef(model->OnlyAdminsMayCreateProjects()),
-                      useRef(model->Admin()),
-                      now;
+            PreparedStatement *statement = prepare(
+                "insert into workspaces(id, uid, name, premium, "
+                "only_admins_may_create_projects, admin) "
+                "values(:id, :uid, :name, :premium, "
+                ":only_admins_may_create_projects, :admin)");
+            statement->Use(model->ID());
+            statement->Use(model->UID());
+            statement->Use(model->Name());
+            statement->Use(model->Premium());
+            statement->Use(model->OnlyAdminsMayCreateProjects());
+            statement->Use(model->Admin());
+            statement->Execute();
             error err = last_error("saveWorkspace");
             if (err != noError) {
                 return err;
             }
-            Poco::Int64 local_id(0);
-            *session_ << "select last_insert_rowid()",
-                      into(local_id),
-                      now;
-            err = last_error("saveWorkspace");
-            if (err != noError) {
-                return err;
-            }
+            Poco::Int64 local_id = lastInsertRowID();
             model->SetLocalID(local_id);
             changes->push_back(ModelChange(
                 model->ModelName(), "insert", model->ID(), ""));
@@ -1828,8 +2267,6 @@ error Database::saveModel(
     Client *model,
     std::vector<ModelChange> *changes) {
 
-    Poco::Mutex::ScopedLock lock(session_m_);
-
     poco_check_ptr(model);
     poco_check_ptr(session_);
 
@@ -1845,27 +2282,29 @@ error Database::saveModel(
             logger().trace(ss.str());
 
             if (model->GUID().empty()) {
-                *session_ << "update clients set "
-                          "id = :id, uid = :uid, name = :name, wid = :wid "
-                          "where local_id = :local_id",
-                          useRef(model->ID()),
-                          useRef(model->UID()),
-                          useRef(model->Name()),
-                          useRef(model->WID()),
-                          useRef(model->LocalID()),
-                          now;
+                PreparedStatement *statement = prepare(
+                    "update clients set "
+                    "id = :id, uid = :uid, name = :name, wid = :wid "
+                    "where local_id = :local_id");
+                statement->Use(model->ID());
+                statement->Use(model->UID());
+                statement->Use(model->Name());
+                statement->Use(model->WID());
+                statement->Use(model->LocalID());
+                statement->Execute();
             } else {
-                *session_ << "update clients set "
-                          "id = :id, uid = :uid, name = :name, guid = :guid, "
-                          "wid = :wid "
-                          "where local_id = :local_id",
-                          useRef(model->ID()),
-                          useRef(model->UID()),
-                          useRef(model->Name()),
-                          useRef(model->GUID()),
-                          useRef(model->WID()),
-                          useRef(model->LocalID()),
-                          now;
+                PreparedStatement *statement = prepare(
+                    "update clients set "
+                    "id = :id, uid = :uid, name = :name, guid = :guid, "
+                    "wid = :wid "
+                    "where local_id = :local_id");
+                statement->Use(model->ID());
+                statement->Use(model->UID());
+                statement->Use(model->Name());
+                statement->Use(model->GUID());
+                statement->Use(model->WID());
+                statement->Use(model->LocalID());
+                statement->Execute();
             }
             error err = last_error("saveClient");
             if (err != noError) {
@@ -1880,35 +2319,30 @@ error Database::saveModel(
                << " in thread " << Poco::Thread::currentTid();
             logger().trace(ss.str());
             if (model->GUID().empty()) {
-                *session_ << "insert into clients(id, uid, name, wid) "
-                          "values(:id, :uid, :name, :wid)",
-                          useRef(model->ID()),
-                          useRef(model->UID()),
-                          useRef(model->Name()),
-                          useRef(model->WID()),
-                          now;
+                PreparedStatement *statement = prepare(
+                    "insert into clients(id, uid, name, wid) "
+                    "values(:id, :uid, :name, :wid)");
+                statement->Use(model->ID());
+                statement->Use(model->UID());
+                statement->Use(model->Name());
+                statement->Use(model->WID());
+                statement->Execute();
             } else {
-                *session_ << "insert into clients(id, uid, name, guid, wid) "
-                          "values(:id, :uid, :name, :guid, :wid)",
-                          useRef(model->ID()),
-                          useRef(model->UID()),
-                          useRef(model->Name()),
-                          useRef(model->GUID()),
-                          useRef(model->WID()),
-                          now;
+                PreparedStatement *statement = prepare(
+                    "insert into clients(id, uid, name, guid, wid) "
+                    "values(:id, :uid, :name, :guid, :wid)");
+                statement->Use(model->ID());
+                statement->Use(model->UID());
+                statement->Use(model->Name());
+                statement->Use(model->GUID());
+                statement->Use(model->WID());
+                statement->Execute();
             }
             error err = last_error("saveClient");
             if (err != noError) {
                 return err;
             }
-            Poco::Int64 local_id(0);
-            *session_ << "select last_insert_rowid()",
-                      into(local_id),
-                      now;
-            err = last_error("saveClient");
-            if (err != noError) {
-                return err;
-            }
+            Poco::Int64 local_id = lastInsertRowID();
             model->SetLocalID(local_id);
             changes->push_back(ModelChange(
                 model->ModelName(), "insert", model->ID(), model->GUID()));
@@ -1928,8 +2362,6 @@ error Database::saveModel(
     Project *model,
     std::vector<ModelChange> *changes) {
 
-    Poco::Mutex::ScopedLock lock(session_m_);
-
     poco_check_ptr(model);
     poco_check_ptr(session_);
 
@@ -1956,80 +2388,84 @@ error Database::saveModel(
 
             if (model->ID()) {
                 if (model->GUID().empty()) {
-                    *session_ << "update projects set "
-                              "id = :id, uid = :uid, name = :name, "
-                              "wid = :wid, color = :color, cid = :cid, "
-                              "active = :active, billable = :billable, "
-                              "client_guid = :client_guid "
-                              "where local_id = :local_id",
-                              useRef(model->ID()),
-                              useRef(model->UID()),
-                              useRef(model->Name()),
-                              useRef(model->WID()),
-                              useRef(model->Color()),
-                              useRef(model->CID()),
-                              useRef(model->Active()),
-                              useRef(model->Billable()),
-                              useRef(model->ClientGUID()),
-                              useRef(model->LocalID()),
-                              now;
+                    PreparedStatement *statement = prepare(
+                        "update projects set "
+                        "id = :id, uid = :uid, name = :name, "
+                        "wid = :wid, color = :color, cid = :cid, "
+                        "active = :active, billable = :billable, "
+                        "client_guid = :client_guid "
+                        "where local_id = :local_id");
+                    statement->Use(model->ID());
+                    statement->Use(model->UID());
+                    statement->Use(model->Name());
+                    statement->Use(model->WID());
+                    statement->Use(model->Color());
+                    statement->Use(model->CID());
+                    statement->Use(model->Active());
+                    statement->Use(model->Billable());
+                    statement->Use(model->ClientGUID());
+                    statement->Use(model->LocalID());
+                    statement->Execute();
                 } else {
-                    *session_ << "update projects set "
-                              "id = :id, uid = :uid, name = :name, "
-                              "guid = :guid,"
-                              "wid = :wid, color = :color, cid = :cid, "
-                              "active = :active, billable = :billable, "
-                              "client_guid = :client_guid "
-                              "where local_id = :local_id",
-                              useRef(model->ID()),
-                              useRef(model->UID()),
-                              useRef(model->Name()),
-                              useRef(model->GUID()),
-                              useRef(model->WID()),
-                              useRef(model->Color()),
-                              useRef(model->CID()),
-                              useRef(model->Active()),
-                              useRef(model->Billable()),
-                              useRef(model->ClientGUID()),
-                              useRef(model->LocalID()),
-                              now;
+                    PreparedStatement *statement = prepare(
+                        "update projects set "
+                        "id = :id, uid = :uid, name = :name, "
+                        "guid = :guid,"
+                        "wid = :wid, color = :color, cid = :cid, "
+                        "active = :active, billable = :billable, "
+                        "client_guid = :client_guid "
+                        "where local_id = :local_id");
+                    statement->Use(model->ID());
+                    statement->Use(model->UID());
+                    statement->Use(model->Name());
+                    statement->Use(model->GUID());
+                    statement->Use(model->WID());
+                    statement->Use(model->Color());
+                    statement->Use(model->CID());
+                    statement->Use(model->Active());
+                    statement->Use(model->Billable());
+                    statement->Use(model->ClientGUID());
+                    statement->Use(model->LocalID());
+                    statement->Execute();
                 }
             } else {
                 if (model->GUID().empty()) {
-                    *session_ << "update projects set "
-                              "uid = :uid, name = :name, "
-                              "wid = :wid, color = :color, cid = :cid, "
-                              "active = :active, billable = :billable, "
-                              "client_guid = :client_guid "
-                              "where local_id = :local_id",
-                              useRef(model->UID()),
-                              useRef(model->Name()),
-                              useRef(model->WID()),
-                              useRef(model->Color()),
-                              useRef(model->CID()),
-                              useRef(model->Active()),
-                              useRef(model->Billable()),
-                              useRef(model->ClientGUID()),
-                              useRef(model->LocalID()),
-                              now;
+                    PreparedStatement *statement = prepare(
+                        "update projects set "
+                        "uid = :uid, name = :name, "
+                        "wid = :wid, color = :color, cid = :cid, "
+                        "active = :active, billable = :billable, "
+                        "client_guid = :client_guid "
+                        "where local_id = :local_id");
+                    statement->Use(model->UID());
+                    statement->Use(model->Name());
+                    statement->Use(model->WID());
+                    statement->Use(model->Color());
+                    statement->Use(model->CID());
+                    statement->Use(model->Active());
+                    statement->Use(model->Billable());
+                    statement->Use(model->ClientGUID());
+                    statement->Use(model->LocalID());
+                    statement->Execute();
                 } else {
-                    *session_ << "update projects set "
-                              "uid = :uid, name = :name, guid = :guid,"
-                              "wid = :wid, color = :color, cid = :cid, "
-                              "active = :active, billable = :billable, "
-                              "client_guid = :client_guid "
-                              "where local_id = :local_id",
-                              useRef(model->UID()),
-                              useRef(model->Name()),
-                              useRef(model->GUID()),
-                              useRef(model->WID()),
-                              useRef(model->Color()),
-                              useRef(model->CID()),
-                              useRef(model->Active()),
-                              useRef(model->Billable()),
-                              useRef(model->ClientGUID()),
-                              useRef(model->LocalID()),
-                              now;
+                    PreparedStatement *statement = prepare(
+                        "update projects set "
+                        "uid = :uid, name = :name, guid = :guid,"
+                        "wid = :wid, color = :color, cid = :cid, "
+                        "active = :active, billable = :billable, "
+                        "client_guid = :client_guid "
+                        "where local_id = :local_id");
+                    statement->Use(model->UID());
+                    statement->Use(model->Name());
+                    statement->Use(model->GUID());
+                    statement->Use(model->WID());
+                    statement->Use(model->Color());
+                    statement->Use(model->CID());
+                    statement->Use(model->Active());
+                    statement->Use(model->Billable());
+                    statement->Use(model->ClientGUID());
+                    statement->Use(model->LocalID());
+                    statement->Execute();
                 }
             }
             error err = last_error("saveProject");
@@ -2046,105 +2482,98 @@ error Database::saveModel(
             logger().debug(ss.str());
             if (model->ID()) {
                 if (model->GUID().empty()) {
-                    *session_ <<
-                              "insert into projects("
-                              "id, uid, name, wid, color, cid, active, "
-                              "is_private, billable, client_guid"
-                              ") values("
-                              ":id, :uid, :name, :wid, :color, :cid, :active, "
-                              ":is_private, :billable, :client_guid"
-                              ")",
-                              useRef(model->ID()),
-                              useRef(model->UID()),
-                              useRef(model->Name()),
-                              useRef(model->WID()),
-                              useRef(model->Color()),
-                              useRef(model->CID()),
-                              useRef(model->Active()),
-                              useRef(model->IsPrivate()),
-                              useRef(model->Billable()),
-                              useRef(model->ClientGUID()),
-                              now;
+                    PreparedStatement *statement = prepare(
+                        "insert into projects("
+                        "id, uid, name, wid, color, cid, active, "
+                        "is_private, billable, client_guid"
+                        ") values("
+                        ":id, :uid, :name, :wid, :color, :cid, :active, "
+                        ":is_private, :billable, :client_guid"
+                        ")");
+                    statement->Use(model->ID());
+                    statement->Use(model->UID());
+                    statement->Use(model->Name());
+                    statement->Use(model->WID());
+                    statement->Use(model->Color());
+                    statement->Use(model->CID());
+                    statement->Use(model->Active());
+                    statement->Use(model->IsPrivate());
+                    statement->Use(model->Billable());
+                    statement->Use(model->ClientGUID());
+                    statement->Execute();
                 } else {
-                    *session_ <<
-                              "insert into projects("
-                              "id, uid, name, guid, wid, color, cid, "
-                              "active, is_private, "
-                              "billable, client_guid"
-                              ") values("
-                              ":id, :uid, :name, :guid, :wid, :color, :cid, "
-                              ":active, :is_private, "
-                              ":billable, :client_guid"
-                              ")",
-                              useRef(model->ID()),
-                              useRef(model->UID()),
-                              useRef(model->Name()),
-                              useRef(model->GUID()),
-                              useRef(model->WID()),
-                              useRef(model->Color()),
-                              useRef(model->CID()),
-                              useRef(model->Active()),
-                              useRef(model->IsPrivate()),
-                              useRef(model->Billable()),
-                              useRef(model->ClientGUID()),
-                              now;
+                    PreparedStatement *statement = prepare(
+                        "insert into projects("
+                        "id, uid, name, guid, wid, color, cid, "
+                        "active, is_private, "
+                        "billable, client_guid"
+                        ") values("
+                        ":id, :uid, :name, :guid, :wid, :color, :cid, "
+                        ":active, :is_private, "
+                        ":billable, :client_guid"
+                        ")");
+                    statement->Use(model->ID());
+                    statement->Use(model->UID());
+                    statement->Use(model->Name());
+                    statement->Use(model->GUID());
+                    statement->Use(model->WID());
+                    statement->Use(model->Color());
+                    statement->Use(model->CID());
+                    statement->Use(model->Active());
+                    statement->Use(model->IsPrivate());
+                    statement->Use(model->Billable());
+                    statement->Use(model->ClientGUID());
+                    statement->Execute();
                 }
             } else {
                 if (model->GUID().empty()) {
-                    *session_ <<
-                              "insert into projects("
-                              "uid, name, wid, color, cid, active, "
-                              "is_private, billable, client_guid"
-                              ") values("
-                              ":uid, :name, :wid, :color, :cid, :active, "
-                              ":is_private, :billable, :client_guid"
-                              ")",
-                              useRef(model->UID()),
-                              useRef(model->Name()),
-                              useRef(model->WID()),
-                              useRef(model->Color()),
-                              useRef(model->CID()),
-                              useRef(model->Active()),
-                              useRef(model->IsPrivate()),
-                              useRef(model->Billable()),
-                              useRef(model->ClientGUID()),
-                              now;
+                    PreparedStatement *statement = prepare(
+                        "insert into projects("
+                        "uid, name, wid, color, cid, active, "
+                        "is_private, billable, client_guid"
+                        ") values("
+                        ":uid, :name, :wid, :color, :cid, :active, "
+                        ":is_private, :billable, :client_guid"
+                        ")");
+                    statement->Use(model->UID());
+                    statement->Use(model->Name());
+                    statement->Use(model->WID());
+                    statement->Use(model->Color());
+                    statement->Use(model->CID());
+                    statement->Use(model->Active());
+                    statement->Use(model->IsPrivate());
+                    statement->Use(model->Billable());
+                    statement->Use(model->ClientGUID());
+                    statement->Execute();
                 } else {
-                    *session_ <<
-                              "insert into projects("
-                              "uid, name, guid, wid, color, cid, "
-                              "active, is_private, billable, "
-                              "client_guid "
-                              ") values("
-                              ":uid, :name, :guid, :wid, :color, :cid, "
-                              ":active, :is_private, :billable, "
-                              ":client_guid "
-                              ")",
-                              useRef(model->UID()),
-                              useRef(model->Name()),
-                              useRef(model->GUID()),
-                              useRef(model->WID()),
-                              useRef(model->Color()),
-                              useRef(model->CID()),
-                              useRef(model->Active()),
-                              useRef(model->IsPrivate()),
-                              useRef(model->Billable()),
-                              useRef(model->ClientGUID()),
-                              now;
+                    PreparedStatement *statement = prepare(
+                        "insert into projects("
+                        "uid, name, guid, wid, color, cid, "
+                        "active, is_private, billable, "
+                        "client_guid "
+                        ") values("
+                        ":uid, :name, :guid, :wid, :color, :cid, "
+                        ":active, :is_private, :billable, "
+                        ":client_guid "
+                        ")");
+                    statement->Use(model->UID());
+                    statement->Use(model->Name());
+                    statement->Use(model->GUID());
+                    statement->Use(model->WID());
+                    statement->Use(model->Color());
+                    statement->Use(model->CID());
+                    statement->Use(model->Active());
+                    statement->Use(model->IsPrivate());
+                    statement->Use(model->Billable());
+                    statement->Use(model->ClientGUID());
+                    statement->Execute();
                 }
             }
             error err = last_error("saveProject");
             if (err != noError) {
                 return err;
             }
-            Poco::Int64 local_id(0);
-            *session_ << "select last_insert_rowid()",
-                      into(local_id),
-                      now;
-            err = last_error("saveProject");
-            if (err != noError) {
-                return err;
-            }
+            Poco::Int64 local_id = lastInsertRowID();
             model->SetLocalID(local_id);
             changes->push_back(ModelChange(
                 model->ModelName(), "insert", model->ID(), model->GUID()));
@@ -2164,8 +2593,6 @@ error Database::saveModel(
     Task *model,
     std::vector<ModelChange> *changes) {
 
-    Poco::Mutex::ScopedLock lock(session_m_);
-
     poco_check_ptr(model);
     poco_check_ptr(session_);
 
@@ -2180,18 +2607,19 @@ error Database::saveModel(
                << " in thread " << Poco::Thread::currentTid();
             logger().trace(ss.str());
 
-            *session_ << "update tasks set "
-                      "id = :id, uid = :uid, name = :name, wid = :wid, "
-                      "pid = :pid, active = :active "
-                      "where local_id = :local_id",
-                      useRef(model->ID()),
-                      useRef(model->UID()),
-                      useRef(model->Name()),
-                      useRef(model->WID()),
-                      useRef(model->PID()),
-                      useRef(model->Active()),
-                      useRef(model->LocalID()),
-                      now;
+            PreparedStatement *statement = prepare(
+                "update tasks set "
+                "id = :id, uid = :uid, name = :name, wid = :wid, "
+                "pid = :pid, active = :active "
+                "where local_id = :local_id");
+            statement->Use(model->ID());
+            statement->Use(model->UID());
+            statement->Use(model->Name());
+            statement->Use(model->WID());
+            statement->Use(model->PID());
+            statement->Use(model->Active());
+            statement->Use(model->LocalID());
+            statement->Execute();
             error err = last_error("saveTask");
             if (err != noError) {
                 return err;
@@ -2204,27 +2632,21 @@ error Database::saveModel(
             ss << "Inserting task " + model->String()
                << " in thread " << Poco::Thread::currentTid();
             logger().trace(ss.str());
-            *session_ << "insert into tasks(id, uid, name, wid, pid, active) "
-                      "values(:id, :uid, :name, :wid, :pid, :active)",
-                      useRef(model->ID()),
-                      useRef(model->UID()),
-                      useRef(model->Name()),
-                      useRef(model->WID()),
-                      useRef(model->PID()),
-                      useRef(model->Active()),
-                      now;
+            PreparedStatement *statement = prepare(
+                "insert into tasks(id, uid, name, wid, pid, active) "
+                "values(:id, :uid, :name, :wid, :pid, :active)");
+            statement->Use(model->ID());
+            statement->Use(model->UID());
+            statement->Use(model->Name());
+            statement->Use(model->WID());
+            statement->Use(model->PID());
+            statement->Use(model->Active());
+            statement->Execute();
             error err = last_error("saveTask");
             if (err != noError) {
                 return err;
             }
-            Poco::Int64 local_id(0);
-            *session_ << "select last_insert_rowid()",
-                      into(local_id),
-                      now;
-            err = last_error("saveTask");
-            if (err != noError) {
-                return err;
-            }
+            Poco::Int64 local_id = lastInsertRowID();
             model->SetLocalID(local_id);
             changes->push_back(ModelChange(
                 model->ModelName(), "insert", model->ID(), ""));
@@ -2244,8 +2666,6 @@ error Database::saveModel(
     Tag *model,
     std::vector<ModelChange> *changes    ) {
 
-    Poco::Mutex::ScopedLock lock(session_m_);
-
     poco_check_ptr(model);
     poco_check_ptr(session_);
 
@@ -2261,27 +2681,29 @@ error Database::saveModel(
             logger().trace(ss.str());
 
             if (model->GUID().empty()) {
-                *session_ << "update tags set "
-                          "id = :id, uid = :uid, name = :name, wid = :wid "
-                          "where local_id = :local_id",
-                          useRef(model->ID()),
-                          useRef(model->UID()),
-                          useRef(model->Name()),
-                          useRef(model->WID()),
-                          useRef(model->LocalID()),
-                          now;
+                PreparedStatement *statement = prepare(
+                    "update tags set "
+                    "id = :id, uid = :uid, name = :name, wid = :wid "
+                    "where local_id = :local_id");
+                statement->Use(model->ID());
+                statement->Use(model->UID());
+                statement->Use(model->Name());
+                statement->Use(model->WID());
+                statement->Use(model->LocalID());
+                statement->Execute();
             } else {
-                *session_ << "update tags set "
-                          "id = :id, uid = :uid, name = :name, wid = :wid, "
-                          "guid = :guid "
-                          "where local_id = :local_id",
-                          useRef(model->ID()),
-                          useRef(model->UID()),
-                          useRef(model->Name()),
-                          useRef(model->WID()),
-                          useRef(model->GUID()),
-                          useRef(model->LocalID()),
-                          now;
+                PreparedStatement *statement = prepare(
+                    "update tags set "
+                    "id = :id, uid = :uid, name = :name, wid = :wid, "
+                    "guid = :guid "
+                    "where local_id = :local_id");
+                statement->Use(model->ID());
+                statement->Use(model->UID());
+                statement->Use(model->Name());
+                statement->Use(model->WID());
+                statement->Use(model->GUID());
+                statement->Use(model->LocalID());
+                statement->Execute();
             }
             error err = last_error("saveTag");
             if (err != noError) {
@@ -2296,35 +2718,30 @@ error Database::saveModel(
                << " in thread " << Poco::Thread::currentTid();
             logger().trace(ss.str());
             if (model->GUID().empty()) {
-                *session_ << "insert into tags(id, uid, name, wid) "
-                          "values(:id, :uid, :name, :wid)",
-                          useRef(model->ID()),
-                          useRef(model->UID()),
-                          useRef(model->Name()),
-                          useRef(model->WID()),
-                          now;
+                PreparedStatement *statement = prepare(
+                    "insert into tags(id, uid, name, wid) "
+                    "values(:id, :uid, :name, :wid)");
+                statement->Use(model->ID());
+                statement->Use(model->UID());
+                statement->Use(model->Name());
+                statement->Use(model->WID());
+                statement->Execute();
             } else {
-                *session_ << "insert into tags(id, uid, name, wid, guid) "
-                          "values(:id, :uid, :name, :wid, :guid)",
-                          useRef(model->ID()),
-                          useRef(model->UID()),
-                          useRef(model->Name()),
-                          useRef(model->WID()),
-                          useRef(model->GUID()),
-                          now;
+                PreparedStatement *statement = prepare(
+                    "insert into tags(id, uid, name, wid, guid) "
+                    "values(:id, :uid, :name, :wid, :guid)");
+                statement->Use(model->ID());
+                statement->Use(model->UID());
+                statement->Use(model->Name());
+                statement->Use(model->WID());
+                statement->Use(model->GUID());
+                statement->Execute();
             }
             error err = last_error("saveTag");
             if (err != noError) {
                 return err;
             }
-            Poco::Int64 local_id(0);
-            *session_ << "select last_insert_rowid()",
-                      into(local_id),
-                      now;
-            err = last_error("saveTag");
-            if (err != noError) {
-                return err;
-            }
+            Poco::Int64 local_id = lastInsertRowID();
             model->SetLocalID(local_id);
             changes->push_back(ModelChange(
                 model->ModelName(), "insert", model->ID(), model->GUID()));
@@ -2382,28 +2799,29 @@ error Database::SaveUser(
                    << " in thread " << Poco::Thread::currentTid();
                 logger().trace(ss.str());
 
-                *session_ << "update users set "
-                          "default_wid = :default_wid, "
-                          "since = :since, id = :id, fullname = :fullname, "
-                          "email = :email, record_timeline = :record_timeline, "
-                          "store_start_and_stop_time = "
-                          " :store_start_and_stop_time, "
-                          "timeofday_format = :timeofday_format, "
-                          "duration_format = :duration_format, "
-                          "offline_data = :offline_data "
-                          "where local_id = :local_id",
-                          useRef(user->DefaultWID()),
-                          useRef(user->Since()),
-                          useRef(user->ID()),
-                          useRef(user->Fullname()),
-                          useRef(user->Email()),
-                          useRef(user->RecordTimeline()),
-                          useRef(user->StoreStartAndStopTime()),
-                          useRef(user->TimeOfDayFormat()),
-                          useRef(user->DurationFormat()),
-                          useRef(user->OfflineData()),
-                          useRef(user->LocalID()),
-                          now;
+                PreparedStatement *statement = prepare(
+                    "update users set "
+                    "default_wid = :default_wid, "
+                    "since = :since, id = :id, fullname = :fullname, "
+                    "email = :email, record_timeline = :record_timeline, "
+                    "store_start_and_stop_time = "
+                    " :store_start_and_stop_time, "
+                    "timeofday_format = :timeofday_format, "
+                    "duration_format = :duration_format, "
+                    "offline_data = :offline_data "
+                    "where local_id = :local_id");
+                statement->Use(user->DefaultWID());
+                statement->Use(user->Since());
+                statement->Use(user->ID());
+                statement->Use(user->Fullname());
+                statement->Use(user->Email());
+                statement->Use(user->RecordTimeline());
+                statement->Use(user->StoreStartAndStopTime());
+                statement->Use(user->TimeOfDayFormat());
+                statement->Use(user->DurationFormat());
+                statement->Use(user->OfflineData());
+                statement->Use(user->LocalID());
+                statement->Execute();
                 error err = last_error("SaveUser");
                 if (err != noError) {
                     session_->rollback();
@@ -2416,41 +2834,34 @@ error Database::SaveUser(
                 ss << "Inserting user " + user->String()
                    << " in thread " << Poco::Thread::currentTid();
                 logger().trace(ss.str());
-                *session_ << "insert into users("
-                          "id, default_wid, since, fullname, email, "
-                          "record_timeline, store_start_and_stop_time, "
-                          "timeofday_format, duration_format, offline_data "
-                          ") values("
-                          ":id, :default_wid, :since, :fullname, "
-                          ":email, "
-                          ":record_timeline, :store_start_and_stop_time, "
-                          ":timeofday_format, :duration_format, :offline_data "
-                          ")",
-                          useRef(user->ID()),
-                          useRef(user->DefaultWID()),
-                          useRef(user->Since()),
-                          useRef(user->Fullname()),
-                          useRef(user->Email()),
-                          useRef(user->RecordTimeline()),
-                          useRef(user->StoreStartAndStopTime()),
-                          useRef(user->TimeOfDayFormat()),
-                          useRef(user->DurationFormat()),
-                          useRef(user->OfflineData()),
-                          now;
+                PreparedStatement *statement = prepare(
+                    "insert into users("
+                    "id, default_wid, since, fullname, email, "
+                    "record_timeline, store_start_and_stop_time, "
+                    "timeofday_format, duration_format, offline_data "
+                    ") values("
+                    ":id, :default_wid, :since, :fullname, "
+                    ":email, "
+                    ":record_timeline, :store_start_and_stop_time, "
+                    ":timeofday_format, :duration_format, :offline_data "
+                    ")");
+                statement->Use(user->ID());
+                statement->Use(user->DefaultWID());
+                statement->Use(user->Since());
+                statement->Use(user->Fullname());
+                statement->Use(user->Email());
+                statement->Use(user->RecordTimeline());
+                statement->Use(user->StoreStartAndStopTime());
+                statement->Use(user->TimeOfDayFormat());
+                statement->Use(user->DurationFormat());
+                statement->Use(user->OfflineData());
+                statement->Execute();
                 error err = last_error("SaveUser");
                 if (err != noError) {
                     session_->rollback();
                     return err;
                 }
-                Poco::Int64 local_id(0);
-                *session_ << "select last_insert_rowid()",
-                          into(local_id),
-                          now;
-                err = last_error("SaveUser");
-                if (err != noError) {
-                    session_->rollback();
-                    return err;
-                }
+                Poco::Int64 local_id = lastInsertRowID();
                 user->SetLocalID(local_id);
                 changes->push_back(ModelChange(
                     user->ModelName(), "insert", user->ID(), ""));
@@ -2468,13 +2879,18 @@ error Database::SaveUser(
         }
     }
 
+    // Number of related models visited and written
+    Poco::UInt64 visited(0);
+    size_t user_changes = changes->size();
+
     if (with_related_data) {
         // Workspaces
         std::vector<ModelChange> workspace_changes;
-        error err = saveRelatedModels(user->ID(),
-                                      "workspaces",
-                                      &user->related.Workspaces,
-                                      &workspace_changes);
+        error err = saveRelatedModels<Workspace>(user->ID(),
+                                                 "workspaces",
+                                                 &user->related,
+                                                 &workspace_changes,
+                                                 &visited);
         if (err != noError) {
             session_->rollback();
             return err;
@@ -2492,10 +2908,11 @@ error Database::SaveUser(
 
         // Clients
         std::vector<ModelChange> client_changes;
-        err = saveRelatedModels(user->ID(),
-                                "clients",
-                                &user->related.Clients,
-                                &client_changes);
+        err = saveRelatedModels<Client>(user->ID(),
+                                        "clients",
+                                        &user->related,
+                                        &client_changes,
+                                        &visited);
         if (err != noError) {
             session_->rollback();
             return err;
@@ -2513,10 +2930,11 @@ error Database::SaveUser(
 
         // Projects
         std::vector<ModelChange> project_changes;
-        err = saveRelatedModels(user->ID(),
-                                "projects",
-                                &user->related.Projects,
-                                &project_changes);
+        err = saveRelatedModels<Project>(user->ID(),
+                                         "projects",
+                                         &user->related,
+                                         &project_changes,
+                                         &visited);
         if (err != noError) {
             session_->rollback();
             return err;
@@ -2534,10 +2952,11 @@ error Database::SaveUser(
 
         // Tasks
         std::vector<ModelChange> task_changes;
-        err = saveRelatedModels(user->ID(),
-                                "tasks",
-                                &user->related.Tasks,
-                                &task_changes);
+        err = saveRelatedModels<Task>(user->ID(),
+                                      "tasks",
+                                      &user->related,
+                                      &task_changes,
+                                      &visited);
         if (err != noError) {
             session_->rollback();
             return err;
@@ -2554,30 +2973,46 @@ error Database::SaveUser(
         }
 
         // Tags
-        err = saveRelatedModels(user->ID(),
-                                "tags",
-                                &user->related.Tags,
-                                changes);
+        err = saveRelatedModels<Tag>(user->ID(),
+                                     "tags",
+                                     &user->related,
+                                     changes,
+                                     &visited);
         if (err != noError) {
             session_->rollback();
             return err;
         }
 
         // Time entries
-        err = saveRelatedModels(user->ID(),
-                                "time_entries",
-                                &user->related.TimeEntries,
-                                changes);
+        err = findTimeEntryLocalIDs(user->ID(), &user->related);
+        if (err != noError) {
+            session_->rollback();
+            return err;
+        }
+        err = insertTimeEntries(user->ID(),
+                                &user->related,
+                                changes,
+                                &visited);
+        if (err != noError) {
+            session_->rollback();
+            return err;
+        }
+        err = saveRelatedModels<TimeEntry>(user->ID(),
+                                           "time_entries",
+                                           &user->related,
+                                           changes,
+                                           &visited);
         if (err != noError) {
             session_->rollback();
             return err;
         }
 
         // autotracker rules
-        err = saveRelatedModels(user->ID(),
-                                "autotracker_settings",
-                                &user->related.AutotrackerRules,
-                                changes);
+        err = saveRelatedModels<AutotrackerRule>(user->ID(),
+                                                 "autotracker_settings",
+                                                 &user->related,
+                                                 changes,
+                                                 &visited);
         if (err != noError) {
             session_->rollback();
             return err;
@@ -2586,13 +3021,20 @@ error Database::SaveUser(
 
     session_->commit();
 
+    if (with_related_data) {
+        // Purge deleted models from memory
+        user->related.PurgeDeletedModels();
+    }
+
     stopwatch.stop();
 
     {
         std::stringstream ss;
         ss  << "User with_related_data=" << with_related_data << " saved in "
             << stopwatch.elapsed() / 1000 << " ms in thread "
-            << Poco::Thread::currentTid();
+            << Poco::Thread::currentTid()
+            << ", related models visited=" << visited
+            << ", written=" << changes->size() - user_changes;
         logger().debug(ss.str());
     }
 
@@ -3074,6 +3516,35 @@ error Database::migrateTimeline() {
         return err;
     }
 
+    // Old events are deleted by start time
+    err = migrate(
+        "timeline_events.start_time",
+        "CREATE INDEX id_timeline_events_start_time "
+        "ON timeline_events (user_id, start_time);");
+    if (err != noError) {
+        return err;
+    }
+
+    // Raw events are compressed by start time
+    err = migrate(
+        "timeline_events.raw",
+        "CREATE INDEX id_timeline_events_raw "
+        "ON timeline_events (user_id, start_time) "
+        "WHERE NOT chunked AND NOT uploaded;");
+    if (err != noError) {
+        return err;
+    }
+
+    // Chunks waiting for upload
+    err = migrate(
+        "timeline_events.upload",
+        "CREATE INDEX id_timeline_events_upload "
+        "ON timeline_events (user_id) "
+        "WHERE chunked AND NOT uploaded;");
+    if (err != noError) {
+        return err;
+    }
+
     return noError;
 }
 
@@ -3330,6 +3801,25 @@ error Database::migrateTimeEntries() {
         return err;
     }
 
+    // Time entries are loaded by start time
+    err = migrate("time_entries.start",
+                  "CREATE INDEX id_time_entries_start "
+                  "ON time_entries (uid, start);");
+    if (err != noError) {
+        return err;
+    }
+
+    // Older time entries that are running or not pushed
+    // yet are loaded at start, too
+    err = migrate("time_entries.unsynced",
+                  "CREATE INDEX id_time_entries_unsynced "
+                  "ON time_entries (uid, start) "
+                  "WHERE id IS NULL OR ui_modified_at > 0 "
+                  "OR deleted_at > 0 OR duration < 0;");
+    if (err != noError) {
+        return err;
+    }
+
     return noError;
 }
 
@@ -3915,143 +4405,98 @@ error Database::CreateCompressedTimelineBatchForUpload(
     const Poco::UInt64 &user_id,
     std::vector<TimelineEvent> *timeline_events) {
 
-    error err = deleteTooOldTimeline(user_id);
-    if (err != noError) {
-        return err;
+    if (!user_id) {
+        return error("Cannot compress timeline without a user ID");
     }
 
-    // Load all uncompressed timeline events into memory
-    std::vector<TimelineEvent> uncompressed;
-    err = selectUnompressedTimelineEvents(user_id, &uncompressed);
-    if (err != noError) {
-        return err;
+    if (!session_) {
+        logger().warning("compress_timeline database is not open, ignoring");
+        return noError;
     }
 
-    // Group events by app name into chunks
-    std::map<std::string, TimelineEvent> compressed;
-    for (std::vector<TimelineEvent>::iterator i = uncompressed.begin();
-            i != uncompressed.end();
-            ++i) {
-        TimelineEvent &event = *i;
-        poco_assert(!event.chunked);
+    // Compress only the events that started before the current
+    // chunk, else we will have no full chunks to compress.
+    time_t chunk_up_to =
+        (time(0) / kTimelineChunkSeconds) * kTimelineChunkSeconds;
 
-        time_t chunk_start_time =
-            (event.start_time / kTimelineChunkSeconds) * kTimelineChunkSeconds;
+    {
+        Poco::Mutex::ScopedLock lock(session_m_);
 
-        std::stringstream ss;
-        ss << event.filename;
-        ss << "::";
-        ss << event.title;
-        ss << "::";
-        ss << event.idle;
-        ss << "::";
-        ss << chunk_start_time;
-        std::string key = ss.str();
-
-        time_t duration = event.end_time - event.start_time;
-        if (duration < 0) {
-            duration = 0;
-        }
+        // The whole compression pass is committed at once
+        session_->begin();
 
-        if (compressed.find(key) == compressed.end()) {
-            TimelineEvent chunk;
-            chunk.user_id = user_id;
-            chunk.start_time = event.start_time;
-            chunk.end_time = chunk.start_time + duration;
-            chunk.filename = event.filename;
-            chunk.title = event.title;
-            chunk.idle = event.idle;
-            chunk.chunked = true;
-            chunk.uploaded = false;
-            compressed[key] = chunk;
-        } else {
-            TimelineEvent chunk = compressed[key];
-            chunk.end_time = chunk.end_time + duration;
-            compressed[key] = chunk;
+        error err = deleteTooOldTimeline(user_id);
+        if (err != noError) {
+            session_->rollback();
+            return err;
         }
-    }
 
-    // Save the new, chunked events
-    for (std::map<std::string, TimelineEvent>::iterator i = compressed.begin();
-            i != compressed.end();
-            ++i) {
-        TimelineEvent &event = i->second;
-        poco_assert(event.chunked);
-        err = InsertTimelineEvent(&event);
+        err = compressTimeline(user_id, chunk_up_to);
         if (err != noError) {
+            session_->rollback();
             return err;
         }
-    }
 
-    // Delete the uncompressed events now
-    err = DeleteTimelineBatch(uncompressed);
-    if (err != noError) {
-        return err;
+        session_->commit();
     }
 
-    err = selectCompressedTimelineBatchForUpload(
+    return selectCompressedTimelineBatchForUpload(
         user_id, timeline_events);
-    if (err != noError) {
-        return err;
-    }
-
-    return noError;
 }
 
-error Database::selectUnompressedTimelineEvents(
+error Database::compressTimeline(
     const Poco::UInt64 &user_id,
-    std::vector<TimelineEvent> *timeline_events) {
+    const time_t &chunk_up_to) {
 
-    if (!user_id) {
-        return error("Cannot load timeline without a user ID");
-    }
-
-    if (!timeline_events->empty()) {
-        return error("Timeline events already loaded");
-    }
-
-    if (!session_) {
-        logger().warning("select_batch database is not open, ignoring request");
-        return noError;
-    }
-
-    // then find the chunk start time of current time.
-    // now process only events that are older that this chunk start time.
-    // else we will have no full chunks to compress.
-    time_t chunk_up_to =
-        (time(0) / kTimelineChunkSeconds) * kTimelineChunkSeconds;
+    Poco::Mutex::ScopedLock lock(session_m_);
 
     {
         std::stringstream s;
-        s << "selectUnompressedTimelineEvents user_id = "
+        s << "compressTimeline user_id = "
           << user_id
           << ", chunk_up_to = " << chunk_up_to;
         logger().debug(s.str());
     }
 
-    Poco::Mutex::ScopedLock lock(session_m_);
+    Poco::Int64 up_to(chunk_up_to);
+    Poco::Int64 chunk_seconds(kTimelineChunkSeconds);
 
     try {
-        Poco::Data::Statement select(*session_);
-        select <<
-               "SELECT id, title, filename, start_time, end_time, idle, "
-               "chunked, uploaded "
-               "FROM timeline_events "
-               "WHERE user_id = :user_id "
-               "AND start_time < :seconds_ago "
-               "AND NOT uploaded "
-               "AND NOT chunked ",
-               useRef(user_id),
-               useRef(chunk_up_to);
-        loadTimelineEvents(user_id, &select, timeline_events);
-
-        {
-            std::stringstream s;
-            s << "selectUnompressedTimelineEvents found "
-              << timeline_events->size()
-              << " events.";
-            logger().debug(s.str());
+        // Group events by app, title and idle state into chunks.
+        // Chunk starts with its first event and lasts
+        // as long as its events together.
+        *session_ << "INSERT INTO timeline_events("
+                  "user_id, title, filename, start_time, end_time, idle, "
+                  "chunked, uploaded"
+                  ") SELECT "
+                  "user_id, title, filename, MIN(start_time), "
+                  "MIN(start_time) + SUM(MAX(end_time - start_time, 0)), "
+                  "idle, 1, 0 "
+                  "FROM timeline_events "
+                  "WHERE user_id = :user_id "
+                  "AND start_time < :chunk_up_to "
+                  "AND NOT uploaded "
+                  "AND NOT chunked "
+                  "GROUP BY filename, title, idle, "
+                  "start_time / :chunk_seconds",
+                  useRef(user_id),
+                  useRef(up_to),
+                  useRef(chunk_seconds),
+                  now;
+        error err = last_error("compressTimeline");
+        if (err != noError) {
+            return err;
         }
+
+        // Delete the uncompressed events now
+        *session_ << "DELETE FROM timeline_events "
+                  "WHERE user_id = :user_id "
+                  "AND start_time < :chunk_up_to "
+                  "AND NOT uploaded "
+                  "AND NOT chunked",
+                  useRef(user_id),
+                  useRef(up_to),
+                  now;
     } catch(const Poco::Exception& exc) {
         return exc.displayText();
     } catch(const std::exception& ex) {
@@ -4059,7 +4504,7 @@ error Database::selectUnompressedTimelineEvents(
     } catch(const std::string& ex) {
         return ex;
     }
-    return last_error("selectUnompressedTimelineEvents");
+    return last_error("compressTimeline");
 }
 
 error Database::selectCompressedTimelineBatchForUpload(
@@ -4197,6 +4642,41 @@ error Database::InsertTimelineEvent(TimelineEvent *event) {
     return last_error("InsertTimelineEvent");
 }
 
+// SQL condition matching the given events by ID, with
+// runs of consecutive IDs as ranges, so that the whole
+// batch is updated by a single statement.
+static std::string timelineEventIDs(
+    const std::vector<TimelineEvent> &timeline_events) {
+    std::vector<Poco::Int64> ids;
+    for (std::vector<TimelineEvent>::const_iterator i = timeline_events.begin();
+            i != timeline_events.end();
+            ++i) {
+        ids.push_back(i->id);
+    }
+    std::sort(ids.begin(), ids.end());
+
+    std::stringstream ranges;
+    std::stringstream singles;
+    size_t i = 0;
+    while (i < ids.size()) {
+        size_t last = i;
+        while (last + 1 < ids.size() && ids[last + 1] <= ids[last] + 1) {
+            last++;
+        }
+        if (ids[last] > ids[i]) {
+            ranges << "id BETWEEN " << ids[i] << " AND " << ids[last]
+                   << " OR ";
+        } else {
+            if (!singles.str().empty()) {
+                singles << ", ";
+            }
+            singles << ids[i];
+        }
+        i = last + 1;
+    }
+    return "(" + ranges.str() + "id IN (" + singles.str() + "))";
+}
+
 error Database::MarkTimelineBatchAsUploaded(
     const std::vector<TimelineEvent> &timeline_events) {
 
@@ -4215,17 +4695,17 @@ error Database::MarkTimelineBatchAsUploaded(
         logger().warning("MarkTimelineBatchAsUploaded db closed, ignoring");
         return noError;
     }
-    std::vector<Poco::Int64> ids;
-    for (std::vector<TimelineEvent>::const_iterator i = timeline_events.begin();
-            i != timeline_events.end();
-            ++i) {
-        const TimelineEvent &event = *i;
-        ids.push_back(event.id);
+    try {
+        *session_ << "UPDATE timeline_events SET uploaded = 1 WHERE "
+                  + timelineEventIDs(timeline_events),
+                  now;
+    } catch(const Poco::Exception& exc) {
+        return exc.displayText();
+    } catch(const std::exception& ex) {
+        return ex.what();
+    } catch(const std::string& ex) {
+        return ex;
     }
-
-    *session_ << "UPDATE timeline_events SET uploaded = 1 WHERE id = :id",
-              useRef(ids),
-              now;
     return last_error("MarkTimelineBatchAsUploaded");
 }
 
@@ -4247,17 +4727,17 @@ error Database::DeleteTimelineBatch(
         logger().warning("DeleteTimelineBatch db closed, ignoring");
         return noError;
     }
-    std::vector<Poco::Int64> ids;
-    for (std::vector<TimelineEvent>::const_iterator i = timeline_events.begin();
-            i != timeline_events.end();
-            ++i) {
-        const TimelineEvent &event = *i;
-        ids.push_back(event.id);
+    try {
+        *session_ << "DELETE FROM timeline_events WHERE "
+                  + timelineEventIDs(timeline_events),
+                  now;
+    } catch(const Poco::Exception& exc) {
+        return exc.displayText();
+    } catch(const std::exception& ex) {
+        return ex.what();
+    } catch(const std::string& ex) {
+        return ex;
     }
-
-    *session_ << "DELETE FROM timeline_events WHERE id = :id",
-              useRef(ids),
-              now;
     return last_error("DeleteTimelineBatch");
 }
 
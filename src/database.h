@@ -9,12 +9,14 @@
 #include "sqlite3.h" // NOLINT
 #endif
 
+#include <map>
 #include <string>
 #include <vector>
 
 #include "Poco/Data/SQLite/Connector.h"
 
 #include "./model_change.h"
+#include "./model_index.h"
 #include "./timeline_event.h"
 #include "./types.h"
 
@@ -32,6 +34,7 @@ class AutotrackerRule;
 class Client;
 class Project;
 class Proxy;
+class RelatedData;
 class Settings;
 class Tag;
 class Task;
@@ -39,6 +42,35 @@ class TimeEntry;
 class User;
 class Workspace;
 
+// SQLite statement that is compiled once and then reused.
+// Parameters are bound in the order they appear in the SQL.
+class PreparedStatement {
+ public:
+    PreparedStatement(sqlite3 *db, const std::string sql);
+    ~PreparedStatement();
+
+    // Clear bindings of the previous execution
+    void Reset();
+
+    void Use(const Poco::Int64 &value);
+    void Use(const Poco::UInt64 &value);
+    void Use(const bool &value);
+    void Use(const std::string &value);
+
+    // Throws Poco::Exception on failure
+    void Execute();
+
+ private:
+    PreparedStatement(const PreparedStatement &);
+    PreparedStatement &operator=(const PreparedStatement &);
+
+    void check(const int rc, const std::string was_doing) const;
+
+    sqlite3 *db_;
+    sqlite3_stmt *stmt_;
+    int position_;
+};
+
 class Database {
  public:
     explicit Database(const std::string db_path);
@@ -58,6 +90,18 @@ class Database {
 
     error LoadCurrentUser(User *user);
 
+    // Server time of the last data pull of the user
+    // with given email, zero if the user is not here.
+    error LoadUserSince(
+        const std::string &email,
+        Poco::UInt64 *since);
+
+    // Users are loaded with the time entries of the last
+    // kTimeEntryResidentDays days, plus older ones that are
+    // running or not pushed yet. This loads the time entries
+    // of the given number of days before those.
+    error LoadMoreTimeEntries(User *user, const int days);
+
     error LoadSettings(Settings *settings);
 
     error LoadWindowSettings(
@@ -205,6 +249,13 @@ class Database {
     error last_error(
         const std::string was_doing);
 
+    // Statement from the cache, compiled on first use.
+    // Throws Poco::Exception if the SQL does not compile.
+    PreparedStatement *prepare(const std::string sql);
+    void clearPreparedStatements();
+
+    Poco::Int64 lastInsertRowID();
+
     error journalMode(std::string *);
     error setJournalMode(const std::string);
 
@@ -212,42 +263,64 @@ class Database {
 
     error loadWorkspaces(
         const Poco::UInt64 &UID,
-        std::vector<Workspace *> *list);
+        ModelList<Workspace> *list);
 
     error loadClients(
         const Poco::UInt64 &UID,
-        std::vector<Client *> *list);
+        ModelList<Client> *list);
 
     error loadProjects(
         const Poco::UInt64 &UID,
-        std::vector<Project *> *list);
+        ModelList<Project> *list);
 
     error loadTasks(
         const Poco::UInt64 &UID,
-        std::vector<Task *> *list);
+        ModelList<Task> *list);
 
     error loadTags(
         const Poco::UInt64 &UID,
-        std::vector<Tag *> *list);
+        ModelList<Tag> *list);
 
     error loadAutotrackerRules(
         const Poco::UInt64 &UID,
-        std::vector<AutotrackerRule *> *list);
+        ModelList<AutotrackerRule> *list);
 
     error loadTimeEntries(
         const Poco::UInt64 &UID,
-        std::vector<TimeEntry *> *list);
+        RelatedData *related);
 
     error loadTimeEntriesFromSQLStatement(
         Poco::Data::Statement *select,
-        std::vector<TimeEntry *> *list);
+        ModelList<TimeEntry> *list);
+
+    // Start of the time range in which all time entries of the
+    // user are in memory, or 0 if there are none before it
+    error residentTimeEntriesSince(
+        const Poco::UInt64 &UID,
+        const Poco::Int64 &since,
+        Poco::Int64 *result);
+
+    // Find the time entries from server that are in database but
+    // were not in memory, so they are updated instead of inserted
+    error findTimeEntryLocalIDs(
+        const Poco::UInt64 &UID,
+        RelatedData *related);
 
     template <typename T>
     error saveRelatedModels(
         const Poco::UInt64 UID,
         const std::string table_name,
-        std::vector<T *> *list,
-        std::vector<ModelChange> *changes);
+        RelatedData *related,
+        std::vector<ModelChange> *changes,
+        Poco::UInt64 *visited);
+
+    // insertTimeEntries and saveModel are called only from SaveUser,
+    // which holds session_m_ for the whole transaction
+    error insertTimeEntries(
+        const Poco::UInt64 UID,
+        RelatedData *related,
+        std::vector<ModelChange> *changes,
+        Poco::UInt64 *visited);
 
     error deleteFromTable(
         const std::string table_name,
@@ -298,15 +371,18 @@ class Database {
         const Poco::UInt64 &user_id,
         std::vector<TimelineEvent> *timeline_events);
 
-    error selectUnompressedTimelineEvents(
+    error compressTimeline(
         const Poco::UInt64 &user_id,
-        std::vector<TimelineEvent> *timeline_events);
+        const time_t &chunk_up_to);
 
     Poco::Logger &logger() const;
 
     Poco::Mutex session_m_;
     Poco::Data::Session *session_;
 
+    // Prepared statements by SQL, valid while the session is open
+    std::map<std::string, PreparedStatement *> prepared_statements_;
+
     std::string desktop_id_;
     std::string analytics_client_id_;
 };
@@ -518,6 +518,15 @@ std::string Formatter::Format8601(const Poco::Timestamp ts) {
 }
 
 std::string Formatter::EscapeJSONString(const std::string input) {
+    // Most strings have nothing to replace
+    std::string::const_iterator first = input.begin();
+    while (first != input.end() && !iscntrl(*first)) {
+        first++;
+    }
+    if (first == input.end()) {
+        return input;
+    }
+
     std::ostringstream ss;
     for (std::string::const_iterator iter = input.begin();
             iter != input.end();
@@ -574,7 +583,11 @@ bool CompareClientByName(Client *a, Client *b) {
 }
 
 bool CompareTimeEntriesByStart(TimeEntry *a, TimeEntry *b) {
-    return a->Start() < b->Start();
+    if (a->Start() != b->Start()) {
+        return a->Start() < b->Start();
+    }
+    // Keep list order stable for time entries started at the same time
+    return a->GUID() < b->GUID();
 }
 
 bool CompareWorkspaceByName(Workspace *a, Workspace *b) {
@@ -11,4 +11,12 @@ int getFocusedWindowInfo(
     std::string *filename,
     bool *idle);
 
+// Wait at most timeout_millis for the focused window, or its title,
+// to change. Return true if it may have changed. Where changes are
+// not announced, this sleeps for a polling interval and returns true.
+bool waitForFocusedWindowChange(const int timeout_millis);
+
+// Make a waitForFocusedWindowChange in progress return now
+void interruptFocusedWindowWait();
+
 #endif  // SRC_GET_FOCUSED_WINDOW_H_
@@ -2,6 +2,7 @@
 
 #include <unistd.h>
 #include <fcntl.h>
+#include <poll.h>
 #include <stdlib.h>
 #include <stdio.h>
 #include <errno.h>
@@ -15,6 +16,8 @@
 
 #include "./get_focused_window.h"
 
+#include "Poco/Mutex.h"
+
 #define HANDLE_EINTR(x) ({ \
   __typeof__(x) __eintr_result__; \
   do { \
@@ -23,12 +26,13 @@
   __eintr_result__;\
 })
 
-static const char kNetActiveWindow[] = "_NET_ACTIVE_WINDOW";
 static const int kMaxPropertyValueLen = 4096;
 
+// Error handler that was installed before ours
+static XErrorHandler previous_x_error_handler = NULL;
+
 static char *get_property(Display *disp, Window win, Atom xa_prop_type,
-                          const char *prop_name, unsigned long *size) { // NOLINT
-    Atom xa_prop_name;
+                          Atom xa_prop_name, unsigned long *size) { // NOLINT
     Atom xa_ret_type;
     int ret_format;
     unsigned long ret_nitems; // NOLINT
@@ -37,8 +41,6 @@ static char *get_property(Display *disp, Window win, Atom xa_prop_type,
     unsigned char *ret_prop;
     char *ret;
 
-    xa_prop_name = XInternAtom(disp, prop_name, False);
-
     // kMaxPropertyValueLen / 4 explanation (XGetWindowProperty manpage):
     // long_length = Specifies the length in 32-bit multiples of the data
     // to be retrieved.
@@ -76,87 +78,275 @@ static char *get_property(Display *disp, Window win, Atom xa_prop_type,
     return ret;
 }
 
-int getFocusedWindowInfo(
-    std::string *title,
-    std::string *filename,
-    bool *idle) {
-    *title = "";
-    *filename = "";
-    *idle = false;
+// Windows can be destroyed between learning about them and asking
+// about them. Ignore such errors instead of exiting, which is what
+// the default error handler does. Other errors are passed on to
+// the handler that was installed before.
+static int ignore_x_error(Display *disp, XErrorEvent *event) {
+    if (event->error_code == BadWindow || event->error_code == BadMatch) {
+        return 0;
+    }
+    if (previous_x_error_handler) {
+        return previous_x_error_handler(disp, event);
+    }
+    return 0;
+}
 
-    Display *display = XOpenDisplay(NULL);
-    if (!display) {
-        return 1;
+static std::string read_process_name(const unsigned long pid) { // NOLINT
+    std::string result("");
+    char buf[256];
+    snprintf(buf, sizeof(buf), "/proc/%lu/stat", pid);
+    const int fd = open(buf, O_RDONLY);
+    if (fd >= 0) {
+        const ssize_t len =
+            HANDLE_EINTR(read(fd, buf, sizeof(buf) - 1));
+        HANDLE_EINTR(close(fd));
+        if (len > 0) {
+            buf[len] = 0;
+            // The start of the file looks like:
+            //   <pid> (<name>) R <parent pid>
+            unsigned tmp_pid, tmp_ppid;
+            char *process_name = 0;
+            if (sscanf(buf, "%u (%m[^)]) %*c %u", // NOLINT
+                       &tmp_pid, &process_name, &tmp_ppid) == 3) {
+                result = std::string(process_name);
+            }
+            free(process_name);
+        }
     }
+    return result;
+}
 
-    // get active window
-    unsigned long size = 0; // NOLINT
-    Window active_window = (Window)0;
-    char *prop = get_property(
-        display,
-        DefaultRootWindow(display),
-        XA_WINDOW,
-        kNetActiveWindow,
-        &size);
-    if (prop) {
-        active_window = *(reinterpret_cast<Window *>(prop));
+// Keeps one display connection open, with the atoms it needs,
+// and listens to changes of the active window and its title.
+class FocusedWindowWatcher {
+ public:
+    FocusedWindowWatcher()
+        : display_(NULL)
+    , root_(0)
+    , net_active_window_(None)
+    , net_wm_name_(None)
+    , net_wm_pid_(None)
+    , wm_name_(None)
+    , utf8_string_(None)
+    , watched_window_(0)
+    , watched_filename_("") {
+        wake_[0] = -1;
+        wake_[1] = -1;
+        if (pipe(wake_) == 0) {
+            fcntl(wake_[0], F_SETFL, O_NONBLOCK);
+            fcntl(wake_[1], F_SETFL, O_NONBLOCK);
+        }
     }
-    free(prop);
 
-    // get title of active window
-    if (active_window) {
+    int Info(
+        std::string *title,
+        std::string *filename) {
+        Poco::Mutex::ScopedLock lock(mutex_);
+
+        if (!connect()) {
+            return 1;
+        }
+
+        // get active window
+        Window active_window = (Window)0;
+        char *prop = get_property(
+            display_, root_, XA_WINDOW, net_active_window_, NULL);
+        if (prop) {
+            active_window = *(reinterpret_cast<Window *>(prop));
+        }
+        free(prop);
+
+        if (active_window != watched_window_) {
+            watch(active_window);
+        }
+
+        if (!active_window) {
+            return 0;
+        }
+
+        // get title of active window
         char *net_wm_name = get_property(
-            display,
-            active_window,
-            XInternAtom(display, "UTF8_STRING", false),
-            "_NET_WM_NAME",
-            NULL);
+            display_, active_window, utf8_string_, net_wm_name_, NULL);
         if (net_wm_name) {
             *title = std::string(net_wm_name);
         } else {
-            char *wm_name = get_property(display, active_window,
-                                         XA_STRING, "WM_NAME", NULL);
+            char *wm_name = get_property(
+                display_, active_window, XA_STRING, wm_name_, NULL);
             if (wm_name) {
                 *title = std::string(wm_name);
             }
             free(wm_name);
         }
         free(net_wm_name);
+
+        *filename = watched_filename_;
+
+        return 0;
     }
 
-    // get pid of active window
-    unsigned long *pid = 0; // NOLINT
-    if (active_window) {
-        pid = (unsigned long *)get_property(display, active_window, // NOLINT
-                                            XA_CARDINAL, "_NET_WM_PID", NULL);
-        if (pid) {
-            // get process name by pid
-            char buf[256];
-            snprintf(buf, sizeof(buf), "/proc/%lu/stat", *pid);
-            const int fd = open(buf, O_RDONLY);
-            if (fd >= 0) {
-                const ssize_t len =
-                    HANDLE_EINTR(read(fd, buf, sizeof(buf) - 1));
-                HANDLE_EINTR(close(fd));
-                if (len > 0) {
-                    buf[len] = 0;
-                    // The start of the file looks like:
-                    //   <pid> (<name>) R <parent pid>
-                    unsigned tmp_pid, tmp_ppid;
-                    char *process_name = 0;
-                    if (sscanf(buf, "%u (%a[^)]) %*c %u", // NOLINT
-                               &tmp_pid, &process_name, &tmp_ppid) == 3) {
-                        *filename = std::string(process_name);
-                    }
-                    free(process_name);
+    bool Wait(const int timeout_millis) {
+        int display_fd(-1);
+        {
+            Poco::Mutex::ScopedLock lock(mutex_);
+            if (connect()) {
+                // Events may have been read already
+                if (takeChanges()) {
+                    return true;
                 }
+                display_fd = ConnectionNumber(display_);
             }
         }
+
+        struct pollfd fds[2];
+        fds[0].fd = wake_[0];
+        fds[0].events = POLLIN;
+        fds[0].revents = 0;
+        fds[1].fd = display_fd;
+        fds[1].events = POLLIN;
+        fds[1].revents = 0;
+        int n = HANDLE_EINTR(poll(fds, display_fd >= 0 ? 2 : 1,
+                                  timeout_millis));
+        if (n <= 0) {
+            return false;
+        }
+
+        if (fds[0].revents) {
+            char buf[64];
+            while (read(wake_[0], buf, sizeof(buf)) > 0) {}
+            return false;
+        }
+
+        Poco::Mutex::ScopedLock lock(mutex_);
+        return display_ && takeChanges();
+    }
+
+    void Interrupt() {
+        if (wake_[1] >= 0) {
+            char c = 0;
+            HANDLE_EINTR(write(wake_[1], &c, 1));
+        }
+    }
+
+ private:
+    bool connect() {
+        if (display_) {
+            return true;
+        }
+
+        display_ = XOpenDisplay(NULL);
+        if (!display_) {
+            return false;
+        }
+
+        XErrorHandler previous = XSetErrorHandler(ignore_x_error);
+        if (previous != ignore_x_error) {
+            previous_x_error_handler = previous;
+        }
+
+        root_ = DefaultRootWindow(display_);
+        net_active_window_ = XInternAtom(display_, "_NET_ACTIVE_WINDOW", False);
+        net_wm_name_ = XInternAtom(display_, "_NET_WM_NAME", False);
+        net_wm_pid_ = XInternAtom(display_, "_NET_WM_PID", False);
+        wm_name_ = XInternAtom(display_, "WM_NAME", False);
+        utf8_string_ = XInternAtom(display_, "UTF8_STRING", False);
+
+        // Active window changes are announced on the root window
+        XSelectInput(display_, root_, PropertyChangeMask);
+
+        watched_window_ = 0;
+        watched_filename_ = "";
+        return true;
+    }
+
+    // Listen to title changes of the given window
+    // only, and find out which process it belongs to
+    void watch(const Window window) {
+        if (watched_window_) {
+            XSelectInput(display_, watched_window_, NoEventMask);
+        }
+        watched_window_ = window;
+        watched_filename_ = "";
+        if (!window) {
+            return;
+        }
+
+        XSelectInput(display_, window, PropertyChangeMask);
+
+        unsigned long *pid = (unsigned long *)get_property( // NOLINT
+            display_, window, XA_CARDINAL, net_wm_pid_, NULL);
+        if (pid) {
+            // Read again on every window change, as
+            // the pid may belong to another process by now
+            watched_filename_ = read_process_name(*pid);
+        }
         free(pid);
     }
 
-    // Must close display, else max window client count is reached quickly
-    XCloseDisplay(display);
+    // Read the events that have arrived, and tell if any of them
+    // changes the active window or the title of the active window
+    bool takeChanges() {
+        bool changed(false);
+        while (XPending(display_)) {
+            XEvent event;
+            XNextEvent(display_, &event);
+            if (event.type != PropertyNotify) {
+                continue;
+            }
+            const XPropertyEvent &property = event.xproperty;
+            if (property.window == root_
+                    && property.atom == net_active_window_) {
+                changed = true;
+            } else if (property.window == watched_window_
+                       && (property.atom == net_wm_name_
+                           || property.atom == wm_name_)) {
+                changed = true;
+            }
+        }
+        return changed;
+    }
+
+    Poco::Mutex mutex_;
 
-    return 0;
+    Display *display_;
+    Window root_;
+
+    Atom net_active_window_;
+    Atom net_wm_name_;
+    Atom net_wm_pid_;
+    Atom wm_name_;
+    Atom utf8_string_;
+
+    // Active window, as of last check, and its process name
+    Window watched_window_;
+    std::string watched_filename_;
+
+    // Written to, to stop waiting
+    int wake_[2];
+};
+
+// Lives as long as the app, as the recorder thread may still be
+// waiting on it when static objects are destroyed
+static FocusedWindowWatcher &watcher() {
+    static FocusedWindowWatcher *instance = new FocusedWindowWatcher();
+    return *instance;
+}
+
+int getFocusedWindowInfo(
+    std::string *title,
+    std::string *filename,
+    bool *idle) {
+    *title = "";
+    *filename = "";
+    *idle = false;
+
+    return watcher().Info(title, filename);
+}
+
+bool waitForFocusedWindowChange(const int timeout_millis) {
+    return watcher().Wait(timeout_millis);
+}
+
+void interruptFocusedWindowWait() {
+    watcher().Interrupt();
 }
@@ -2,6 +2,7 @@
 
 #include <Carbon/Carbon.h>
 #include <CoreGraphics/CGWindow.h>
+#include <unistd.h>
 
 #include <string>
 
@@ -10,6 +11,9 @@
 static const int kTitleBufferSize = 255;
 static const int kFilenameBufferSize = 255;
 
+// Focused window is not watched, but checked this often
+static const int kFocusedWindowPollMillis = 500;
+
 int getFocusedWindowInfo(
     std::string *title,
     std::string *filename,
@@ -89,3 +93,15 @@ int getFocusedWindowInfo(
 
     return 0;
 }
+
+bool waitForFocusedWindowChange(const int timeout_millis) {
+    int millis = timeout_millis;
+    if (millis > kFocusedWindowPollMillis) {
+        millis = kFocusedWindowPollMillis;
+    }
+    usleep(millis * 1000);
+    return true;
+}
+
+void interruptFocusedWindowWait() {
+}
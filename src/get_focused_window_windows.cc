@@ -13,6 +13,9 @@
 static const int kFilenameBufferSize = 255;
 static const int kTitleBufSize = 500;
 
+// Focused window is not watched, but checked this often
+static const int kFocusedWindowPollMillis = 500;
+
 int getFocusedWindowInfo(
     std::string *title,
     std::string *filename,
@@ -61,3 +64,15 @@ int getFocusedWindowInfo(
 
     return 0;
 }
+
+bool waitForFocusedWindowChange(const int timeout_millis) {
+    int millis = timeout_millis;
+    if (millis > kFocusedWindowPollMillis) {
+        millis = kFocusedWindowPollMillis;
+    }
+    Sleep(millis);
+    return true;
+}
+
+void interruptFocusedWindowWait() {
+}
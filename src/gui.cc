@@ -200,6 +200,28 @@ void GUI::DisplayOnlineState(const Poco::Int64 state) {
     on_display_online_state_(state);
 }
 
+void GUI::DisplayCommandState(
+    const Poco::UInt64 command_id,
+    const std::string &name,
+    const Poco::Int64 state,
+    const error err) {
+    if (!on_display_command_state_) {
+        return;
+    }
+
+    std::stringstream ss;
+    ss << "DisplayCommandState command_id=" << command_id
+       << " name=" << name
+       << " state=" << state;
+    logger().debug(ss.str());
+
+    char_t *name_s = copy_string(name);
+    char_t *err_s = copy_string(err);
+    on_display_command_state_(command_id, name_s, state, err_s);
+    free(name_s);
+    free(err_s);
+}
+
 void GUI::DisplayTimeEntryAutocomplete(
     std::vector<toggl::AutocompleteItem> *items) {
     logger().debug("DisplayTimeEntryAutocomplete");
@@ -248,6 +270,22 @@ void GUI::DisplayTimeEntryList(const bool open,
     }
 }
 
+void GUI::DisplayTimeEntryListChanges(TogglTimeEntryListChangeView *first) {
+    if (!on_display_time_entry_list_changes_) {
+        return;
+    }
+    Poco::Stopwatch stopwatch;
+    stopwatch.start();
+    on_display_time_entry_list_changes_(first);
+    stopwatch.stop();
+    {
+        std::stringstream ss;
+        ss << "DisplayTimeEntryListChanges done in "
+           << stopwatch.elapsed() / 1000 << " ms";
+        logger().debug(ss.str());
+    }
+}
+
 void GUI::DisplayTags(std::vector<std::string> *tags) {
     logger().debug("DisplayTags");
 
@@ -7,6 +7,7 @@
 #include <vector>
 
 #include "./autocomplete_item.h"
+#include "./command_queue.h"
 #include "./https_client.h"
 #include "./proxy.h"
 #include "./settings.h"
@@ -23,7 +24,7 @@ class Client;
 class Project;
 class Workspace;
 
-class GUI : public SyncStateMonitor {
+class GUI : public SyncStateMonitor, public CommandStateMonitor {
  public:
     GUI()
         : on_display_app_(nullptr)
@@ -33,6 +34,7 @@ class GUI : public SyncStateMonitor {
     , on_display_url_(nullptr)
     , on_display_reminder_(nullptr)
     , on_display_time_entry_list_(nullptr)
+    , on_display_time_entry_list_changes_(nullptr)
     , on_display_time_entry_autocomplete_(nullptr)
     , on_display_project_autocomplete_(nullptr)
     , on_display_workspace_select_(nullptr)
@@ -48,7 +50,8 @@ class GUI : public SyncStateMonitor {
     , on_display_update_(nullptr)
     , on_display_autotracker_rules_(nullptr)
     , on_display_autotracker_notification_(nullptr)
-    , on_display_promotion_(nullptr) {}
+    , on_display_promotion_(nullptr)
+    , on_display_command_state_(nullptr) {}
 
     ~GUI() {}
 
@@ -76,6 +79,9 @@ class GUI : public SyncStateMonitor {
         const bool open,
         TogglTimeEntryView *first);
 
+    void DisplayTimeEntryListChanges(
+        TogglTimeEntryListChangeView *first);
+
     void DisplayWorkspaceSelect(std::vector<toggl::Workspace *> *list);
 
     void DisplayClientSelect(std::vector<toggl::Client *> *clients);
@@ -151,6 +157,10 @@ class GUI : public SyncStateMonitor {
         on_display_time_entry_list_ = cb;
     }
 
+    void OnDisplayTimeEntryListChanges(TogglDisplayTimeEntryListChanges cb) {
+        on_display_time_entry_list_changes_ = cb;
+    }
+
     void OnDisplayWorkspaceSelect(TogglDisplayViewItems cb) {
         on_display_workspace_select_ = cb;
     }
@@ -215,10 +225,24 @@ class GUI : public SyncStateMonitor {
         return !!on_display_autotracker_rules_;
     }
 
+    bool CanDisplayTimeEntryListChanges() const {
+        return !!on_display_time_entry_list_changes_;
+    }
+
     bool CanDisplayPromotion() const {
         return !!on_display_promotion_;
     }
 
+    void OnDisplayCommandState(TogglDisplayCommandState cb) {
+        on_display_command_state_ = cb;
+    }
+
+    void DisplayCommandState(
+        const Poco::UInt64 command_id,
+        const std::string &name,
+        const Poco::Int64 state,
+        const error err);
+
     void DisplayPromotion(const int64_t promotion_type) {
         if (on_display_promotion_) {
             on_display_promotion_(promotion_type);
@@ -235,6 +259,7 @@ class GUI : public SyncStateMonitor {
     TogglDisplayURL on_display_url_;
     TogglDisplayReminder on_display_reminder_;
     TogglDisplayTimeEntryList on_display_time_entry_list_;
+    TogglDisplayTimeEntryListChanges on_display_time_entry_list_changes_;
     TogglDisplayAutocomplete on_display_time_entry_autocomplete_;
     TogglDisplayAutocomplete on_display_project_autocomplete_;
     TogglDisplayViewItems on_display_workspace_select_;
@@ -251,6 +276,7 @@ class GUI : public SyncStateMonitor {
     TogglDisplayAutotrackerRules on_display_autotracker_rules_;
     TogglDisplayAutotrackerNotification on_display_autotracker_notification_;
     TogglDisplayPromotion on_display_promotion_;
+    TogglDisplayCommandState on_display_command_state_;
 
     Poco::Logger &logger() const;
 };
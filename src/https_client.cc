@@ -12,6 +12,7 @@
 #include "./netconf.h"
 #include "./urls.h"
 
+#include "Poco/CountingStream.h"
 #include "Poco/DeflatingStream.h"
 #include "Poco/Environment.h"
 #include "Poco/Exception.h"
@@ -32,7 +33,9 @@
 #include "Poco/Net/SecureStreamSocket.h"
 #include "Poco/Net/Session.h"
 #include "Poco/Net/SSLManager.h"
+#include "Poco/NullStream.h"
 #include "Poco/NumberParser.h"
+#include "Poco/StreamCopier.h"
 #include "Poco/TextEncoding.h"
 #include "Poco/URI.h"
 #include "Poco/UTF8Encoding.h"
@@ -60,6 +63,7 @@ void ServerStatus::stopStatusCheck(const std::string reason) {
     logger().debug(ss.str());
 
     checker_.stop();
+    wakeup_.Signal();
     checker_.wait();
 }
 
@@ -87,14 +91,9 @@ void ServerStatus::runActivity() {
         }
 
         // Sleep a bit
-        for (int i = 0; i < delay_seconds; i++) {
-            if (checker_.isStopped()) {
-                return;
-            }
-            Poco::Thread::sleep(1000);
-            if (checker_.isStopped()) {
-                return;
-            }
+        wakeup_.Wait(delay_seconds * 1000);
+        if (checker_.isStopped()) {
+            return;
         }
 
         // Check server status
@@ -160,9 +159,215 @@ void ServerStatus::UpdateStatus(const Poco::Int64 code) {
     stopStatusCheck(ss.str());
 }
 
+std::string HTTPSConnectionPool::key(const Poco::URI &uri) {
+    std::stringstream ss;
+    ss << uri.getScheme() << "://" << uri.getHost() << ":" << uri.getPort();
+    return ss.str();
+}
+
+// Connections and the SSL context are thrown away
+// when certificate or proxy settings change
+std::string HTTPSConnectionPool::settingsKey() {
+    const HTTPSClientConfig &config = HTTPSClient::Config;
+    std::stringstream ss;
+    ss << config.CACertPath
+       << "|" << config.IgnoreCert
+       << "|" << config.AutodetectProxy
+       << "|" << config.UseProxy;
+    if (config.UseProxy) {
+        ss << "|" << config.ProxySettings.Host()
+           << "|" << config.ProxySettings.Port()
+           << "|" << config.ProxySettings.Username()
+           << "|" << config.ProxySettings.Password();
+    }
+    return ss.str();
+}
+
+Poco::Net::Context::Ptr HTTPSConnectionPool::context() {
+    if (!context_.isNull()) {
+        return context_;
+    }
+
+    Poco::SharedPtr<Poco::Net::InvalidCertificateHandler>
+    acceptCertHandler =
+        new Poco::Net::AcceptCertificateHandler(true);
+
+    Poco::Net::Context::VerificationMode verification_mode =
+        Poco::Net::Context::VERIFY_RELAXED;
+    if (HTTPSClient::Config.IgnoreCert) {
+        verification_mode = Poco::Net::Context::VERIFY_NONE;
+    }
+    context_ = new Poco::Net::Context(
+        Poco::Net::Context::CLIENT_USE, "", "",
+        HTTPSClient::Config.CACertPath,
+        verification_mode, 9, true, "ALL");
+    context_->enableSessionCache(true);
+
+    Poco::Net::SSLManager::instance().initializeClient(
+        0, acceptCertHandler, context_);
+
+    return context_;
+}
+
+Poco::Net::HTTPSClientSession *HTTPSConnectionPool::Acquire(
+    const Poco::URI &uri) {
+    Poco::Mutex::ScopedLock lock(mutex_);
+
+    std::string settings = settingsKey();
+    if (settings != settings_) {
+        Clear();
+        tls_sessions_.clear();
+        context_ = nullptr;
+        settings_ = settings;
+    }
+
+    std::string host_key = key(uri);
+
+    std::vector<Poco::Net::HTTPSClientSession *> &idle = idle_[host_key];
+    if (!idle.empty()) {
+        Poco::Net::HTTPSClientSession *session = idle.back();
+        idle.pop_back();
+        return session;
+    }
+
+    Poco::Net::HTTPSClientSession *session = nullptr;
+    std::map<std::string, Poco::Net::Session::Ptr>::const_iterator it =
+        tls_sessions_.find(host_key);
+    if (it != tls_sessions_.end()) {
+        session = new Poco::Net::HTTPSClientSession(
+            uri.getHost(), uri.getPort(), context(), it->second);
+    } else {
+        session = new Poco::Net::HTTPSClientSession(
+            uri.getHost(), uri.getPort(), context());
+    }
+    session->setKeepAlive(true);
+    session->setKeepAliveTimeout(
+        Poco::Timespan(kHTTPClientKeepAliveSeconds * Poco::Timespan::SECONDS));
+    session->setTimeout(
+        Poco::Timespan(kHTTPClientTimeoutSeconds * Poco::Timespan::SECONDS));
+    return session;
+}
+
+void HTTPSConnectionPool::Release(
+    const Poco::URI &uri,
+    Poco::Net::HTTPSClientSession *session) {
+    poco_check_ptr(session);
+
+    Poco::Mutex::ScopedLock lock(mutex_);
+
+    if (settingsKey() != settings_) {
+        delete session;
+        return;
+    }
+
+    std::string host_key = key(uri);
+
+    Poco::Net::Session::Ptr tls_session = session->sslSession();
+    if (!tls_session.isNull()) {
+        tls_sessions_[host_key] = tls_session;
+    }
+
+    std::vector<Poco::Net::HTTPSClientSession *> &idle = idle_[host_key];
+    if (idle.size() >= kHTTPClientIdleConnectionsPerHost) {
+        delete session;
+        return;
+    }
+    idle.push_back(session);
+}
+
+void HTTPSConnectionPool::Clear() {
+    Poco::Mutex::ScopedLock lock(mutex_);
+
+    for (std::map<std::string,
+            std::vector<Poco::Net::HTTPSClientSession *> >::iterator
+            it = idle_.begin(); it != idle_.end(); it++) {
+        for (size_t i = 0; i < it->second.size(); i++) {
+            delete it->second[i];
+        }
+    }
+    idle_.clear();
+}
+
+size_t HTTPSConnectionPool::IdleConnections() {
+    Poco::Mutex::ScopedLock lock(mutex_);
+
+    size_t result(0);
+    for (std::map<std::string,
+            std::vector<Poco::Net::HTTPSClientSession *> >::const_iterator
+            it = idle_.begin(); it != idle_.end(); it++) {
+        result += it->second.size();
+    }
+    return result;
+}
+
+// Connection borrowed from the pool for a single request.
+// It is closed when it goes out of scope, unless released.
+class PooledConnection {
+ public:
+    PooledConnection(
+        HTTPSConnectionPool *pool,
+        const Poco::URI &uri)
+        : pool_(pool)
+    , uri_(uri)
+    , session_(pool->Acquire(uri)) {}
+
+    ~PooledConnection() {
+        delete session_;
+    }
+
+    Poco::Net::HTTPSClientSession *Session() const {
+        return session_;
+    }
+
+    void Release() {
+        pool_->Release(uri_, session_);
+        session_ = nullptr;
+    }
+
+ private:
+    HTTPSConnectionPool *pool_;
+    Poco::URI uri_;
+    Poco::Net::HTTPSClientSession *session_;
+};
+
 HTTPSClientConfig HTTPSClient::Config;
+HTTPSConnectionPool HTTPSClient::Connections;
+HTTPSTraffic HTTPSClient::traffic_;
+Poco::Mutex HTTPSClient::traffic_m_;
 std::map<std::string, Poco::Timestamp> HTTPSClient::banned_until_;
 
+HTTPSTraffic HTTPSClient::Traffic() {
+    Poco::Mutex::ScopedLock lock(traffic_m_);
+    return traffic_;
+}
+
+void HTTPSClient::ResetTraffic() {
+    Poco::Mutex::ScopedLock lock(traffic_m_);
+    traffic_ = HTTPSTraffic();
+}
+
+void HTTPSClient::addTraffic(
+    const Poco::UInt64 request_bytes,
+    const Poco::UInt64 request_bytes_on_wire,
+    const Poco::UInt64 response_bytes,
+    const Poco::UInt64 response_bytes_on_wire) {
+    Poco::Mutex::ScopedLock lock(traffic_m_);
+    traffic_.RequestBytes += request_bytes;
+    traffic_.RequestBytesOnWire += request_bytes_on_wire;
+    traffic_.ResponseBytes += response_bytes;
+    traffic_.ResponseBytesOnWire += response_bytes_on_wire;
+}
+
+std::string HTTPSClient::compress(const std::string &payload) {
+    std::ostringstream out;
+    Poco::DeflatingOutputStream deflater(
+        out,
+        Poco::DeflatingStreamBuf::STREAM_GZIP);
+    deflater.write(payload.data(), payload.size());
+    deflater.close();
+    return out.str();
+}
+
 Poco::Logger &HTTPSClient::logger() const {
     return Poco::Logger::get("HTTPSClient");
 }
@@ -253,6 +458,28 @@ error HTTPSClient::Get(
                    &status_code);
 }
 
+error HTTPSClient::Get(
+    const std::string host,
+    const std::string relative_url,
+    const std::string basic_auth_username,
+    const std::string basic_auth_password,
+    HTTPSResponseReader *response_reader) {
+    poco_check_ptr(response_reader);
+
+    Poco::Int64 status_code(0);
+    std::string response_body("");
+    return request(Poco::Net::HTTPRequest::HTTP_GET,
+                   host,
+                   relative_url,
+                   "",
+                   basic_auth_username,
+                   basic_auth_password,
+                   &response_body,
+                   &status_code,
+                   nullptr,
+                   response_reader);
+}
+
 error HTTPSClient::request(
     const std::string method,
     const std::string host,
@@ -262,7 +489,8 @@ error HTTPSClient::request(
     const std::string basic_auth_password,
     std::string *response_body,
     Poco::Int64 *status_code,
-    Poco::Net::HTMLForm *form) {
+    Poco::Net::HTMLForm *form,
+    HTTPSResponseReader *response_reader) {
 
     std::map<std::string, Poco::Timestamp>::const_iterator cit =
         banned_until_.find(host);
@@ -296,29 +524,8 @@ error HTTPSClient::request(
     try {
         Poco::URI uri(host);
 
-        Poco::SharedPtr<Poco::Net::InvalidCertificateHandler>
-        acceptCertHandler =
-            new Poco::Net::AcceptCertificateHandler(true);
-
-        Poco::Net::Context::VerificationMode verification_mode =
-            Poco::Net::Context::VERIFY_RELAXED;
-        if (HTTPSClient::Config.IgnoreCert) {
-            verification_mode = Poco::Net::Context::VERIFY_NONE;
-        }
-        Poco::Net::Context::Ptr context = new Poco::Net::Context(
-            Poco::Net::Context::CLIENT_USE, "", "",
-            HTTPSClient::Config.CACertPath,
-            verification_mode, 9, true, "ALL");
-
-        Poco::Net::SSLManager::instance().initializeClient(
-            0, acceptCertHandler, context);
-
-        Poco::Net::HTTPSClientSession session(uri.getHost(), uri.getPort(),
-                                              context);
-
-        session.setKeepAlive(false);
-        session.setTimeout(Poco::Timespan(kHTTPClientTimeoutSeconds
-                                          * Poco::Timespan::SECONDS));
+        PooledConnection connection(&Connections, uri);
+        Poco::Net::HTTPSClientSession &session = *connection.Session();
 
         {
             std::stringstream ss;
@@ -329,23 +536,27 @@ error HTTPSClient::request(
         std::string encoded_url("");
         Poco::URI::encode(relative_url, "", encoded_url);
 
-        error err = Netconf::ConfigureProxy(host + encoded_url, &session);
-        if (err != noError) {
-            logger().error("Error while configuring proxy: " + err);
-            return err;
+        // Proxy can be set only before connecting. Pooled
+        // connections keep the proxy they were opened with.
+        if (!session.connected()) {
+            error err = Netconf::ConfigureProxy(host + encoded_url, &session);
+            if (err != noError) {
+                logger().error("Error while configuring proxy: " + err);
+                return err;
+            }
         }
 
         Poco::Net::HTTPRequest req(method,
                                    encoded_url,
                                    Poco::Net::HTTPMessage::HTTP_1_1);
-        req.setKeepAlive(false);
+        req.setKeepAlive(true);
 
         // FIXME: should get content type as parameter instead
         if (payload.size()) {
             req.setContentType(kContentTypeApplicationJSON);
         }
         req.set("User-Agent", HTTPSClient::Config.UserAgent());
-        req.setChunkedTransferEncoding(true);
+        req.set("Accept-Encoding", "gzip");
 
         Poco::Net::HTTPBasicCredentials cred(
             basic_auth_username, basic_auth_password);
@@ -353,30 +564,31 @@ error HTTPSClient::request(
             cred.authenticate(req);
         }
 
-
+        Poco::UInt64 bytes_sent(0);
         if (!form) {
-            std::istringstream requestStream(payload);
-
-            Poco::DeflatingInputStream gzipRequest(
-                requestStream,
-                Poco::DeflatingStreamBuf::STREAM_GZIP);
-            Poco::DeflatingStreamBuf *pBuff = gzipRequest.rdbuf();
-
-            Poco::Int64 size =
-                pBuff->pubseekoff(0, std::ios::end, std::ios::in);
-            pBuff->pubseekpos(0, std::ios::in);
-
-            req.setContentLength(size);
-            req.set("Content-Encoding", "gzip");
+            // Body is compressed once, small bodies are sent as they are
+            std::string compressed("");
+            const std::string *body = &payload;
+            if (payload.size() >= kHTTPClientCompressMinBytes) {
+                compressed = compress(payload);
+                body = &compressed;
+                req.set("Content-Encoding", "gzip");
+            }
+            req.setContentLength(body->size());
 
-            session.sendRequest(req) << pBuff << std::flush;
+            session.sendRequest(req).write(body->data(), body->size())
+                    << std::flush;
+            bytes_sent = body->size();
         } else {
             form->prepareSubmit(req);
-            std::ostream& send = session.sendRequest(req);
+            Poco::CountingOutputStream send(session.sendRequest(req));
             form->write(send);
+            send.flush();
+            bytes_sent = send.chars();
         }
 
-        req.set("Accept-Encoding", "gzip");
+        // Forms are not compressed
+        addTraffic(form ? bytes_sent : payload.size(), bytes_sent, 0, 0);
 
         // Log out request contents
         std::stringstream request_string;
@@ -387,7 +599,7 @@ error HTTPSClient::request(
 
         // Receive response
         Poco::Net::HTTPResponse response;
-        std::istream& is = session.receiveResponse(response);
+        Poco::CountingInputStream is(session.receiveResponse(response));
 
         *status_code = response.getStatus();
 
@@ -410,9 +622,43 @@ error HTTPSClient::request(
                            + response.get("X-Toggl-Request-Id"));
         }
 
+        bool gzip = response.has("Content-Encoding") &&
+                    "gzip" == response.get("Content-Encoding");
+
+        // Hand a successful response over to the reader
+        // as it arrives, inflating it if gzip was sent
+        if (response_reader && statusCodeToError(*status_code) == noError) {
+            error err = noError;
+            Poco::UInt64 bytes_read(0);
+            if (gzip) {
+                Poco::InflatingInputStream inflater(
+                    is,
+                    Poco::InflatingStreamBuf::STREAM_GZIP);
+                Poco::CountingInputStream body(inflater);
+                err = response_reader->ReadResponse(&body);
+                bytes_read = body.chars();
+            } else {
+                err = response_reader->ReadResponse(&is);
+                bytes_read = is.chars();
+            }
+            if (err != noError) {
+                logger().error("Error while reading response: " + err);
+                return err;
+            }
+
+            if (response.getKeepAlive()) {
+                // Skip whatever the reader left unread
+                Poco::NullOutputStream rest;
+                Poco::StreamCopier::copyStream(is, rest);
+                connection.Release();
+            }
+
+            addTraffic(0, 0, bytes_read, is.chars());
+            return noError;
+        }
+
         // Inflate, if gzip was sent
-        if (response.has("Content-Encoding") &&
-                "gzip" == response.get("Content-Encoding")) {
+        if (gzip) {
             Poco::InflatingInputStream inflater(
                 is,
                 Poco::InflatingStreamBuf::STREAM_GZIP);
@@ -431,6 +677,15 @@ error HTTPSClient::request(
             logger().trace(*response_body);
         }
 
+        // Response was read completely, the connection can be reused
+        if (response.getKeepAlive()) {
+            Poco::NullOutputStream rest;
+            Poco::StreamCopier::copyStream(is, rest);
+            connection.Release();
+        }
+
+        addTraffic(0, 0, response_body->size(), is.chars());
+
         if (429 == *status_code) {
             Poco::Timestamp ts = Poco::Timestamp() + (60 * kOneSecondInMicros);
             banned_until_[host] = ts;
@@ -467,7 +722,8 @@ error TogglClient::request(
     const std::string basic_auth_password,
     std::string *response_body,
     Poco::Int64 *status_code,
-    Poco::Net::HTMLForm *form) {
+    Poco::Net::HTMLForm *form,
+    HTTPSResponseReader *response_reader) {
 
     error err = TogglStatus.Status();
     if (err != noError) {
@@ -490,7 +746,8 @@ error TogglClient::request(
         basic_auth_password,
         response_body,
         status_code,
-        form);
+        form,
+        response_reader);
 
     if (monitor_) {
         monitor_->DisplaySyncState(kSyncStateIdle);
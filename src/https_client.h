@@ -3,23 +3,30 @@
 #ifndef SRC_HTTPS_CLIENT_H_
 #define SRC_HTTPS_CLIENT_H_
 
+#include <istream>
 #include <string>
 #include <vector>
 #include <map>
 
 #include "./proxy.h"
 #include "./types.h"
+#include "./wakeup.h"
 
 #include "Poco/Activity.h"
+#include "Poco/Mutex.h"
+#include "Poco/Net/Context.h"
+#include "Poco/Net/Session.h"
 #include "Poco/Timestamp.h"
 
 namespace Poco {
 
 class Logger;
+class URI;
 
 namespace Net {
 
 class HTMLForm;
+class HTTPSClientSession;
 
 }
 
@@ -52,6 +59,9 @@ class ServerStatus {
     Poco::Activity<ServerStatus> checker_;
     bool fast_retry_;
 
+    // Ends the wait between checks when checking is stopped
+    Wakeup wakeup_;
+
     void setGone(const bool value);
     bool gone();
 
@@ -87,6 +97,78 @@ class HTTPSClientConfig {
     }
 };
 
+// Keeps HTTPS connections open between requests, so consecutive
+// requests to a host skip the TCP and TLS handshakes. All connections
+// share one SSL context, and new connections to a host resume its
+// last TLS session instead of doing a full handshake.
+class HTTPSConnectionPool {
+ public:
+    HTTPSConnectionPool() {}
+    ~HTTPSConnectionPool() {
+        Clear();
+    }
+
+    // Idle connection to the host of the URI, or a new one.
+    // The connection belongs to the caller until released.
+    Poco::Net::HTTPSClientSession *Acquire(const Poco::URI &uri);
+
+    // Keep the connection for the next request. Pass only connections
+    // whose response was read completely and can be kept alive.
+    void Release(
+        const Poco::URI &uri,
+        Poco::Net::HTTPSClientSession *session);
+
+    // Close idle connections. Their TLS sessions
+    // can still be resumed by new connections.
+    void Clear();
+
+    size_t IdleConnections();
+
+ private:
+    static std::string key(const Poco::URI &uri);
+    static std::string settingsKey();
+
+    Poco::Net::Context::Ptr context();
+
+    Poco::Mutex mutex_;
+
+    // SSL context and the settings it was created with
+    Poco::Net::Context::Ptr context_;
+    std::string settings_;
+
+    // Idle connections by scheme, host and port
+    std::map<std::string,
+        std::vector<Poco::Net::HTTPSClientSession *> > idle_;
+
+    // Last TLS session by scheme, host and port
+    std::map<std::string, Poco::Net::Session::Ptr> tls_sessions_;
+};
+
+// Bytes of request and response bodies, as used by
+// the app and as sent over the network (compressed)
+class HTTPSTraffic {
+ public:
+    HTTPSTraffic()
+        : RequestBytes(0)
+    , RequestBytesOnWire(0)
+    , ResponseBytes(0)
+    , ResponseBytesOnWire(0) {}
+
+    Poco::UInt64 RequestBytes;
+    Poco::UInt64 RequestBytesOnWire;
+    Poco::UInt64 ResponseBytes;
+    Poco::UInt64 ResponseBytesOnWire;
+};
+
+// Reads a successful response body while it is being
+// received, instead of collecting it into a string first
+class HTTPSResponseReader {
+ public:
+    virtual ~HTTPSResponseReader() {}
+
+    virtual error ReadResponse(std::istream *body) = 0;
+};
+
 class HTTPSClient {
  public:
     HTTPSClient() {}
@@ -108,8 +190,24 @@ class HTTPSClient {
         const std::string basic_auth_password,
         std::string *response_body);
 
+    // Response body of a successful request is passed
+    // to the reader, error responses are ignored.
+    error Get(
+        const std::string host,
+        const std::string relative_url,
+        const std::string basic_auth_username,
+        const std::string basic_auth_password,
+        HTTPSResponseReader *response_reader);
+
     static HTTPSClientConfig Config;
 
+    // Connections shared by all clients
+    static HTTPSConnectionPool Connections;
+
+    // Traffic of all clients since start or last reset
+    static HTTPSTraffic Traffic();
+    static void ResetTraffic();
+
  protected:
     virtual error request(
         const std::string method,
@@ -120,7 +218,8 @@ class HTTPSClient {
         const std::string basic_auth_password,
         std::string *response_body,
         Poco::Int64 *response_status,
-        Poco::Net::HTMLForm *form = nullptr);
+        Poco::Net::HTMLForm *form = nullptr,
+        HTTPSResponseReader *response_reader = nullptr);
 
     virtual Poco::Logger &logger() const;
 
@@ -128,6 +227,18 @@ class HTTPSClient {
     // We only make requests if this timestamp lies in the past.
     static std::map<std::string, Poco::Timestamp> banned_until_;
 
+    static HTTPSTraffic traffic_;
+    static Poco::Mutex traffic_m_;
+
+    static void addTraffic(
+        const Poco::UInt64 request_bytes,
+        const Poco::UInt64 request_bytes_on_wire,
+        const Poco::UInt64 response_bytes,
+        const Poco::UInt64 response_bytes_on_wire);
+
+    // Gzip request body
+    static std::string compress(const std::string &payload);
+
     error statusCodeToError(const Poco::Int64 status_code) const;
 };
 
@@ -155,7 +266,8 @@ class TogglClient : public HTTPSClient {
         const std::string basic_auth_password,
         std::string *response_body,
         Poco::Int64 *response_status,
-        Poco::Net::HTMLForm *form = nullptr);
+        Poco::Net::HTMLForm *form = nullptr,
+        HTTPSResponseReader *response_reader = nullptr);
 
     virtual Poco::Logger &logger() const;
 
@@ -0,0 +1,326 @@
+// Copyright 2015 Toggl Desktop developers.
+
+#include "../src/json_stream_reader.h"
+
+#include <sstream>
+
+#include "Poco/Exception.h"
+#include "Poco/NumberParser.h"
+
+namespace toggl {
+
+JSONStreamReader::JSONStreamReader(std::istream *in)
+    : buf_(nullptr)
+, offset_(0) {
+    poco_check_ptr(in);
+    buf_ = in->rdbuf();
+    poco_check_ptr(buf_);
+}
+
+int JSONStreamReader::peek() {
+    return buf_->sgetc();
+}
+
+int JSONStreamReader::get() {
+    int c = buf_->sbumpc();
+    if (std::char_traits<char>::eof() != c) {
+        offset_++;
+    }
+    return c;
+}
+
+int JSONStreamReader::skipWhitespace() {
+    int c = peek();
+    while (' ' == c || '\t' == c || '\n' == c || '\r' == c) {
+        get();
+        c = peek();
+    }
+    return c;
+}
+
+void JSONStreamReader::fail(const std::string what) const {
+    std::stringstream ss;
+    ss << "Invalid JSON at offset " << offset_ << ": " << what;
+    throw Poco::SyntaxException(ss.str());
+}
+
+void JSONStreamReader::expect(const char c) {
+    if (skipWhitespace() != c) {
+        fail(std::string("expected ") + c);
+    }
+    get();
+}
+
+void JSONStreamReader::BeginObject() {
+    expect('{');
+    first_.push_back(true);
+}
+
+void JSONStreamReader::BeginArray() {
+    expect('[');
+    first_.push_back(true);
+}
+
+bool JSONStreamReader::AtObject() {
+    return '{' == skipWhitespace();
+}
+
+bool JSONStreamReader::AtArray() {
+    return '[' == skipWhitespace();
+}
+
+bool JSONStreamReader::NextMember(std::string *key) {
+    poco_check_ptr(key);
+
+    if (first_.empty()) {
+        fail("not in an object");
+    }
+
+    int c = skipWhitespace();
+    if ('}' == c) {
+        get();
+        first_.pop_back();
+        return false;
+    }
+    if (first_.back()) {
+        first_.back() = false;
+    } else {
+        expect(',');
+    }
+
+    if (skipWhitespace() != '"') {
+        fail("expected member name");
+    }
+    *key = readString();
+    expect(':');
+    return true;
+}
+
+bool JSONStreamReader::NextElement() {
+    if (first_.empty()) {
+        fail("not in an array");
+    }
+
+    int c = skipWhitespace();
+    if (']' == c) {
+        get();
+        first_.pop_back();
+        return false;
+    }
+    if (first_.back()) {
+        first_.back() = false;
+    } else {
+        expect(',');
+    }
+    return true;
+}
+
+void JSONStreamReader::End() {
+    if (skipWhitespace() != std::char_traits<char>::eof()) {
+        fail("unexpected data after document");
+    }
+}
+
+void JSONStreamReader::ReadValue(Json::Value *result) {
+    poco_check_ptr(result);
+
+    int c = skipWhitespace();
+    if ('{' == c) {
+        *result = Json::Value(Json::objectValue);
+        BeginObject();
+        std::string key("");
+        while (NextMember(&key)) {
+            ReadValue(&(*result)[key]);
+        }
+    } else if ('[' == c) {
+        *result = Json::Value(Json::arrayValue);
+        BeginArray();
+        while (NextElement()) {
+            ReadValue(&result->append(Json::Value()));
+        }
+    } else if ('"' == c) {
+        *result = Json::Value(readString());
+    } else if ('-' == c || (c >= '0' && c <= '9')) {
+        readNumber(result);
+    } else {
+        std::string literal = readLiteral();
+        if ("true" == literal) {
+            *result = Json::Value(true);
+        } else if ("false" == literal) {
+            *result = Json::Value(false);
+        } else if ("null" == literal) {
+            *result = Json::Value(Json::nullValue);
+        } else {
+            fail("unexpected value");
+        }
+    }
+}
+
+void JSONStreamReader::SkipValue() {
+    int c = skipWhitespace();
+    if ('{' == c) {
+        BeginObject();
+        std::string key("");
+        while (NextMember(&key)) {
+            SkipValue();
+        }
+    } else if ('[' == c) {
+        BeginArray();
+        while (NextElement()) {
+            SkipValue();
+        }
+    } else {
+        Json::Value value;
+        ReadValue(&value);
+    }
+}
+
+std::string JSONStreamReader::readLiteral() {
+    std::string result("");
+    int c = peek();
+    while (c >= 'a' && c <= 'z') {
+        result += static_cast<char>(get());
+        c = peek();
+    }
+    return result;
+}
+
+void JSONStreamReader::readNumber(Json::Value *result) {
+    std::string number("");
+    bool real(false);
+    int c = peek();
+    while ((c >= '0' && c <= '9') || '-' == c || '+' == c
+            || '.' == c || 'e' == c || 'E' == c) {
+        if ('.' == c || 'e' == c || 'E' == c) {
+            real = true;
+        }
+        number += static_cast<char>(get());
+        c = peek();
+    }
+
+    if (!real) {
+        if ('-' == number[0]) {
+            Poco::Int64 value(0);
+            if (Poco::NumberParser::tryParse64(number, value)) {
+                *result = Json::Value(static_cast<Json::Int64>(value));
+                return;
+            }
+        } else {
+            Poco::UInt64 value(0);
+            if (Poco::NumberParser::tryParseUnsigned64(number, value)) {
+                *result = Json::Value(static_cast<Json::UInt64>(value));
+                return;
+            }
+        }
+    }
+
+    // Reals and integers too large for 64 bits
+    double value(0);
+    if (!Poco::NumberParser::tryParseFloat(number, value)) {
+        fail("invalid number " + number);
+    }
+    *result = Json::Value(value);
+}
+
+unsigned int JSONStreamReader::readHex4() {
+    unsigned int result(0);
+    for (int i = 0; i < 4; i++) {
+        int c = get();
+        result <<= 4;
+        if (c >= '0' && c <= '9') {
+            result += c - '0';
+        } else if (c >= 'a' && c <= 'f') {
+            result += c - 'a' + 10;
+        } else if (c >= 'A' && c <= 'F') {
+            result += c - 'A' + 10;
+        } else {
+            fail("invalid unicode escape");
+        }
+    }
+    return result;
+}
+
+void JSONStreamReader::appendUTF8(
+    const unsigned int code_point,
+    std::string *result) {
+    if (code_point < 0x80) {
+        *result += static_cast<char>(code_point);
+    } else if (code_point < 0x800) {
+        *result += static_cast<char>(0xC0 | (code_point >> 6));
+        *result += static_cast<char>(0x80 | (code_point & 0x3F));
+    } else if (code_point < 0x10000) {
+        *result += static_cast<char>(0xE0 | (code_point >> 12));
+        *result += static_cast<char>(0x80 | ((code_point >> 6) & 0x3F));
+        *result += static_cast<char>(0x80 | (code_point & 0x3F));
+    } else {
+        *result += static_cast<char>(0xF0 | (code_point >> 18));
+        *result += static_cast<char>(0x80 | ((code_point >> 12) & 0x3F));
+        *result += static_cast<char>(0x80 | ((code_point >> 6) & 0x3F));
+        *result += static_cast<char>(0x80 | (code_point & 0x3F));
+    }
+}
+
+std::string JSONStreamReader::readString() {
+    expect('"');
+
+    std::string result("");
+    while (true) {
+        int c = get();
+        if (std::char_traits<char>::eof() == c) {
+            fail("unterminated string");
+        }
+        if ('"' == c) {
+            break;
+        }
+        if ('\\' != c) {
+            result += static_cast<char>(c);
+            continue;
+        }
+        c = get();
+        switch (c) {
+        case '"':
+        case '\\':
+        case '/':
+            result += static_cast<char>(c);
+            break;
+        case 'b':
+            result += '\b';
+            break;
+        case 'f':
+            result += '\f';
+            break;
+        case 'n':
+            result += '\n';
+            break;
+        case 'r':
+            result += '\r';
+            break;
+        case 't':
+            result += '\t';
+            break;
+        case 'u': {
+            unsigned int code_point = readHex4();
+            // Surrogate pair
+            if (code_point >= 0xD800 && code_point <= 0xDBFF) {
+                if (get() != '\\' || get() != 'u') {
+                    fail("expected low surrogate");
+                }
+                unsigned int low = readHex4();
+                if (low < 0xDC00 || low > 0xDFFF) {
+                    fail("invalid low surrogate");
+                }
+                code_point = 0x10000
+                             + ((code_point - 0xD800) << 10)
+                             + (low - 0xDC00);
+            }
+            appendUTF8(code_point, &result);
+            break;
+        }
+        default:
+            fail("invalid escape");
+        }
+    }
+    return result;
+}
+
+}   // namespace toggl
@@ -0,0 +1,70 @@
+// Copyright 2015 Toggl Desktop developers.
+
+#ifndef SRC_JSON_STREAM_READER_H_
+#define SRC_JSON_STREAM_READER_H_
+
+#include <json/json.h>  // NOLINT
+
+#include <istream>
+#include <string>
+#include <vector>
+
+#include "Poco/Types.h"
+
+namespace toggl {
+
+// Pull parser that reads a JSON document from a stream without
+// building the whole document in memory. Objects and arrays can be
+// walked member by member, and any single value can be read into
+// a Json::Value. Throws Poco::SyntaxException on invalid input.
+class JSONStreamReader {
+ public:
+    explicit JSONStreamReader(std::istream *in);
+
+    // Start reading an object or an array
+    void BeginObject();
+    void BeginArray();
+
+    // Next member of the current object. Returns false
+    // and leaves the object when there are no more members.
+    bool NextMember(std::string *key);
+
+    // Returns false and leaves the array after the last element
+    bool NextElement();
+
+    // True if next value in the stream is of given type
+    bool AtObject();
+    bool AtArray();
+
+    void ReadValue(Json::Value *result);
+    void SkipValue();
+
+    // Fail, unless only whitespace is left in the stream
+    void End();
+
+ private:
+    int peek();
+    int get();
+    int skipWhitespace();
+    void expect(const char c);
+    void fail(const std::string what) const;
+
+    std::string readString();
+    std::string readLiteral();
+    void readNumber(Json::Value *result);
+    void appendUTF8(const unsigned int code_point, std::string *result);
+    unsigned int readHex4();
+
+    std::streambuf *buf_;
+
+    // Position in input, for error messages
+    Poco::UInt64 offset_;
+
+    // For each object or array being walked, whether
+    // its first member or element is still to come
+    std::vector<bool> first_;
+};
+
+}  // namespace toggl
+
+#endif  // SRC_JSON_STREAM_READER_H_
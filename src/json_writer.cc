@@ -0,0 +1,171 @@
+// Copyright 2015 Toggl Desktop developers.
+
+#include "../src/json_writer.h"
+
+#include <cstring>
+
+#include "Poco/NumberFormatter.h"
+
+namespace toggl {
+
+JSONWriter::JSONWriter(std::string *out)
+    : out_(out)
+, after_key_(false) {
+    poco_check_ptr(out_);
+}
+
+void JSONWriter::separate() {
+    if (after_key_) {
+        after_key_ = false;
+        return;
+    }
+    if (first_.empty()) {
+        return;
+    }
+    if (first_.back()) {
+        first_.back() = false;
+    } else {
+        out_->push_back(',');
+    }
+}
+
+void JSONWriter::BeginObject() {
+    separate();
+    out_->push_back('{');
+    first_.push_back(true);
+}
+
+void JSONWriter::EndObject() {
+    first_.pop_back();
+    out_->push_back('}');
+}
+
+void JSONWriter::BeginArray() {
+    separate();
+    out_->push_back('[');
+    first_.push_back(true);
+}
+
+void JSONWriter::EndArray() {
+    first_.pop_back();
+    out_->push_back(']');
+}
+
+void JSONWriter::Key(const char *key) {
+    separate();
+    writeString(key, strlen(key));
+    out_->push_back(':');
+    after_key_ = true;
+}
+
+void JSONWriter::String(const std::string &value) {
+    separate();
+    writeString(value.data(), value.size());
+}
+
+void JSONWriter::Int(const Poco::Int64 value) {
+    separate();
+    Poco::NumberFormatter::append(*out_, value);
+}
+
+void JSONWriter::UInt(const Poco::UInt64 value) {
+    separate();
+    Poco::NumberFormatter::append(*out_, value);
+}
+
+void JSONWriter::Bool(const bool value) {
+    separate();
+    out_->append(value ? "true" : "false");
+}
+
+void JSONWriter::Null() {
+    separate();
+    out_->append("null");
+}
+
+void JSONWriter::Value(const Json::Value &value) {
+    switch (value.type()) {
+    case Json::nullValue:
+        Null();
+        break;
+    case Json::intValue:
+        Int(value.asInt64());
+        break;
+    case Json::uintValue:
+        UInt(value.asUInt64());
+        break;
+    case Json::realValue:
+        separate();
+        out_->append(Json::valueToString(value.asDouble()));
+        break;
+    case Json::stringValue: {
+        separate();
+        const char *chars = value.asCString();
+        writeString(chars, strlen(chars));
+        break;
+    }
+    case Json::booleanValue:
+        Bool(value.asBool());
+        break;
+    case Json::arrayValue:
+        BeginArray();
+        for (Json::ArrayIndex i = 0; i < value.size(); i++) {
+            Value(value[i]);
+        }
+        EndArray();
+        break;
+    case Json::objectValue:
+        BeginObject();
+        for (Json::Value::const_iterator it = value.begin();
+                it != value.end(); it++) {
+            Key(it.memberName());
+            Value(*it);
+        }
+        EndObject();
+        break;
+    }
+}
+
+void JSONWriter::writeString(const char *value, const size_t size) {
+    static const char hex[] = "0123456789abcdef";
+
+    out_->push_back('"');
+    for (size_t i = 0; i < size; i++) {
+        unsigned char c = static_cast<unsigned char>(value[i]);
+        switch (c) {
+        case '"':
+            out_->append("\\\"");
+            break;
+        case '\\':
+            out_->append("\\\\");
+            break;
+        case '\b':
+            out_->append("\\b");
+            break;
+        case '\f':
+            out_->append("\\f");
+            break;
+        case '\n':
+            out_->append("\\n");
+            break;
+        case '\r':
+            out_->append("\\r");
+            break;
+        case '\t':
+            out_->append("\\t");
+            break;
+        default:
+            if (c < 0x20) {
+                out_->append("\\u00");
+                out_->push_back(hex[c >> 4]);
+                out_->push_back(hex[c & 0xF]);
+            } else {
+                out_->push_back(static_cast<char>(c));
+            }
+            break;
+        }
+    }
+    out_->push_back('"');
+}
+
+}   // namespace toggl
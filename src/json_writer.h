@@ -0,0 +1,57 @@
+// Copyright 2015 Toggl Desktop developers.
+
+#ifndef SRC_JSON_WRITER_H_
+#define SRC_JSON_WRITER_H_
+
+#include <json/json.h>  // NOLINT
+
+#include <string>
+#include <vector>
+
+#include "Poco/Types.h"
+
+namespace toggl {
+
+// Writes compact JSON straight into a string buffer, without
+// building a Json::Value tree first. Members and elements are
+// separated automatically. Counterpart of JSONStreamReader.
+class JSONWriter {
+ public:
+    // Output is appended to the buffer, so a buffer
+    // can be cleared and reused between documents
+    explicit JSONWriter(std::string *out);
+
+    void BeginObject();
+    void EndObject();
+    void BeginArray();
+    void EndArray();
+
+    // Name of the next member of the current object
+    void Key(const char *key);
+
+    void String(const std::string &value);
+    void Int(const Poco::Int64 value);
+    void UInt(const Poco::UInt64 value);
+    void Bool(const bool value);
+    void Null();
+
+    // Any value that has already been built as a tree
+    void Value(const Json::Value &value);
+
+ private:
+    void separate();
+    void writeString(const char *value, const size_t size);
+
+    std::string *out_;
+
+    // For each object or array being written, whether
+    // its first member or element is still to come
+    std::vector<bool> first_;
+
+    // A key has been written, its value comes next
+    bool after_key_;
+};
+
+}  // namespace toggl
+
+#endif  // SRC_JSON_WRITER_H_
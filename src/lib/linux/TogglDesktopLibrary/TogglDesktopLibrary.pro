@@ -21,10 +21,18 @@ SOURCES += \
     ../../../batch_update_result.cc \
     ../../../client.cc \
     ../../../idle.cc \
+    ../../../json_stream_reader.cc \
+    ../../../json_writer.cc \
     ../../../analytics.cc \
+    ../../../autocomplete_index.cc \
     ../../../autotracker.cc \
     ../../../urls.cc \
+    ../../../wakeup.cc \
+    ../../../model_lock.cc \
+    ../../../view_snapshot.cc \
+    ../../../command_queue.cc \
     ../../../context.cc \
+    ../../../context_commands.cc \
     ../../../custom_error_handler.cc \
     ../../../database.cc \
     ../../../feedback.cc \
@@ -41,10 +49,16 @@ SOURCES += \
     ../../../project.cc \
     ../../../proxy.cc \
     ../../../related_data.cc \
+    ../../../string_pool.cc \
+    ../../../model_index.cc \
+    ../../../model_pool.cc \
     ../../../settings.cc \
     ../../../tag.cc \
     ../../../task.cc \
+    ../../../task_scheduler.cc \
     ../../../time_entry.cc \
+    ../../../time_entry_list.cc \
+    ../../../timeline_chunk_accumulator.cc \
     ../../../timeline_uploader.cc \
     ../../../user.cc \
     ../../../websocket_client.cc \
@@ -92,10 +106,18 @@ HEADERS += \
     ../../../client.h \
     ../../../const.h \
     ../../../idle.h \
+    ../../../json_stream_reader.h \
+    ../../../json_writer.h \
     ../../../analytics.h \
+    ../../../autocomplete_index.h \
     ../../../autotracker.h \
     ../../../urls.h \
+    ../../../wakeup.h \
+    ../../../model_lock.h \
+    ../../../view_snapshot.h \
+    ../../../command_queue.h \
     ../../../context.h \
+    ../../../context_commands.h \
     ../../../custom_error_handler.h \
     ../../../database.h \
     ../../../feedback.h \
@@ -109,10 +131,16 @@ HEADERS += \
     ../../../project.h \
     ../../../proxy.h \
     ../../../related_data.h \
+    ../../../string_pool.h \
+    ../../../model_index.h \
+    ../../../model_pool.h \
     ../../../settings.h \
     ../../../tag.h \
     ../../../task.h \
+    ../../../task_scheduler.h \
     ../../../time_entry.h \
+    ../../../time_entry_list.h \
+    ../../../timeline_chunk_accumulator.h \
     ../../../timeline_event.h \
     ../../../timeline_notifications.h \
     ../../../timeline_uploader.h \
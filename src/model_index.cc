@@ -0,0 +1,186 @@
+// Copyright 2015 Toggl Desktop developers.
+
+#include "../src/model_index.h"
+
+#include "./base_model.h"
+
+namespace toggl {
+
+template <typename K>
+void eraseKey(
+    std::unordered_map<K, BaseModel *> *map,
+    const K &key,
+    BaseModel *model) {
+    typename std::unordered_map<K, BaseModel *>::iterator it = map->find(key);
+    // Only drop the key if it belongs to this model; with duplicate
+    // keys the first model that was indexed wins, like a list scan.
+    if (it != map->end() && it->second == model) {
+        map->erase(it);
+    }
+}
+
+template <typename K>
+BaseModel *findKey(
+    const std::unordered_map<K, BaseModel *> &map,
+    const K &key) {
+    typename std::unordered_map<K, BaseModel *>::const_iterator it =
+        map.find(key);
+    if (it == map.end()) {
+        return nullptr;
+    }
+    return it->second;
+}
+
+ModelIndex::~ModelIndex() {
+    Clear();
+}
+
+void ModelIndex::Add(BaseModel *model) {
+    poco_check_ptr(model);
+
+    if (model->index_ == this) {
+        return;
+    }
+    if (model->index_) {
+        model->index_->Remove(model);
+    }
+    model->index_ = this;
+    models_.insert(model);
+    addKeys(model);
+    if (model->NeedsToBeSaved() || model->IsMarkedAsDeletedOnServer()) {
+        MarkDirty(model);
+    }
+}
+
+void ModelIndex::Remove(BaseModel *model) {
+    poco_check_ptr(model);
+
+    if (model->index_ != this) {
+        return;
+    }
+    removeKeys(model);
+    ClearDirty(model);
+    models_.erase(model);
+    model->index_ = nullptr;
+}
+
+void ModelIndex::Clear() {
+    for (std::unordered_set<BaseModel *>::const_iterator it = models_.begin();
+            it != models_.end(); ++it) {
+        (*it)->index_ = nullptr;
+    }
+    models_.clear();
+    by_id_.clear();
+    by_guid_.clear();
+    by_local_id_.clear();
+    journal_.clear();
+    journaled_.clear();
+}
+
+BaseModel *ModelIndex::ByID(const Poco::UInt64 id) const {
+    if (!id) {
+        return nullptr;
+    }
+    return findKey(by_id_, id);
+}
+
+BaseModel *ModelIndex::ByGUID(const guid &GUID) const {
+    if (GUID.empty()) {
+        return nullptr;
+    }
+    return findKey(by_guid_, GUID);
+}
+
+BaseModel *ModelIndex::ByLocalID(const Poco::Int64 local_id) const {
+    if (!local_id) {
+        return nullptr;
+    }
+    return findKey(by_local_id_, local_id);
+}
+
+void ModelIndex::IDChanged(
+    BaseModel *model,
+    const Poco::UInt64 old_value) {
+    if (old_value) {
+        eraseKey(&by_id_, old_value, model);
+    }
+    if (model->ID()) {
+        by_id_.insert(std::make_pair(model->ID(), model));
+    }
+}
+
+void ModelIndex::GUIDChanged(
+    BaseModel *model,
+    const guid &old_value) {
+    if (!old_value.empty()) {
+        eraseKey(&by_guid_, old_value, model);
+    }
+    if (!model->GUID().empty()) {
+        by_guid_.insert(std::make_pair(model->GUID(), model));
+    }
+}
+
+void ModelIndex::LocalIDChanged(
+    BaseModel *model,
+    const Poco::Int64 old_value) {
+    if (old_value) {
+        eraseKey(&by_local_id_, old_value, model);
+    }
+    if (model->LocalID()) {
+        by_local_id_.insert(std::make_pair(model->LocalID(), model));
+    }
+}
+
+void ModelIndex::MarkDirty(BaseModel *model) {
+    if (journaled_.find(model) != journaled_.end()) {
+        return;
+    }
+    journal_seq_++;
+    journal_[journal_seq_] = model;
+    journaled_[model] = journal_seq_;
+}
+
+void ModelIndex::ClearDirty(BaseModel *model) {
+    std::unordered_map<BaseModel *, Poco::UInt64>::iterator it =
+        journaled_.find(model);
+    if (it == journaled_.end()) {
+        return;
+    }
+    journal_.erase(it->second);
+    journaled_.erase(it);
+}
+
+void ModelIndex::DirtyModels(std::vector<BaseModel *> *result) const {
+    poco_check_ptr(result);
+
+    for (std::map<Poco::UInt64, BaseModel *>::const_iterator it =
+        journal_.begin(); it != journal_.end(); ++it) {
+        result->push_back(it->second);
+    }
+}
+
+void ModelIndex::addKeys(BaseModel *model) {
+    if (model->ID()) {
+        by_id_.insert(std::make_pair(model->ID(), model));
+    }
+    if (!model->GUID().empty()) {
+        by_guid_.insert(std::make_pair(model->GUID(), model));
+    }
+    if (model->LocalID()) {
+        by_local_id_.insert(std::make_pair(model->LocalID(), model));
+    }
+}
+
+void ModelIndex::removeKeys(BaseModel *model) {
+    if (model->ID()) {
+        eraseKey(&by_id_, model->ID(), model);
+    }
+    if (!model->GUID().empty()) {
+        eraseKey(&by_guid_, model->GUID(), model);
+    }
+    if (model->LocalID()) {
+        eraseKey(&by_local_id_, model->LocalID(), model);
+    }
+}
+
+}   // namespace toggl
@@ -0,0 +1,150 @@
+// Copyright 2015 Toggl Desktop developers.
+
+#ifndef SRC_MODEL_INDEX_H_
+#define SRC_MODEL_INDEX_H_
+
+#include <map>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "./types.h"
+
+#include "Poco/Types.h"
+
+namespace toggl {
+
+class BaseModel;
+
+// Hash index of models by server ID, GUID and local ID.
+// A model registered in an index reports its key changes
+// back to the index, so lookups never need to scan the
+// model lists in RelatedData.
+// The index also journals models that were changed since they
+// were last saved, so saving does not need to scan the lists.
+class ModelIndex {
+ public:
+    ModelIndex()
+        : generation_(0)
+    , journal_seq_(0) {}
+    ~ModelIndex();
+
+    void Add(BaseModel *model);
+    void Remove(BaseModel *model);
+    void Clear();
+
+    size_t Size() const {
+        return models_.size();
+    }
+
+    // Generation of the model list the index was last synced with
+    Poco::UInt64 Generation() const {
+        return generation_;
+    }
+    void SetGeneration(const Poco::UInt64 value) {
+        generation_ = value;
+    }
+
+    BaseModel *ByID(const Poco::UInt64 id) const;
+    BaseModel *ByGUID(const guid &GUID) const;
+    BaseModel *ByLocalID(const Poco::Int64 local_id) const;
+
+    // Called by BaseModel when a key of a registered model changes
+    void IDChanged(BaseModel *model, const Poco::UInt64 old_value);
+    void GUIDChanged(BaseModel *model, const guid &old_value);
+    void LocalIDChanged(BaseModel *model, const Poco::Int64 old_value);
+
+    // Called by BaseModel when a registered model is changed or saved
+    void MarkDirty(BaseModel *model);
+    void ClearDirty(BaseModel *model);
+
+    // Journaled models, in the order they were first changed
+    void DirtyModels(std::vector<BaseModel *> *result) const;
+    size_t DirtySize() const {
+        return journal_.size();
+    }
+
+ private:
+    ModelIndex(const ModelIndex &);
+    ModelIndex &operator=(const ModelIndex &);
+
+    void addKeys(BaseModel *model);
+    void removeKeys(BaseModel *model);
+
+    Poco::UInt64 generation_;
+
+    std::unordered_set<BaseModel *> models_;
+    std::unordered_map<Poco::UInt64, BaseModel *> by_id_;
+    std::unordered_map<guid, BaseModel *> by_guid_;
+    std::unordered_map<Poco::Int64, BaseModel *> by_local_id_;
+
+    Poco::UInt64 journal_seq_;
+    std::map<Poco::UInt64, BaseModel *> journal_;
+    std::unordered_map<BaseModel *, Poco::UInt64> journaled_;
+};
+
+// List of models that counts its changes. Every change bumps the
+// generation, so an index built from the list can tell that it has
+// fallen out of step with it, even if the list size is unchanged.
+// Items can only be read through const access.
+template<typename T>
+class ModelList {
+ public:
+    typedef typename std::vector<T *>::const_iterator const_iterator;
+    typedef typename std::vector<T *>::size_type size_type;
+
+    ModelList()
+        : generation_(0) {}
+
+    Poco::UInt64 Generation() const {
+        return generation_;
+    }
+
+    const std::vector<T *> &Items() const {
+        return items_;
+    }
+
+    const_iterator begin() const {
+        return items_.begin();
+    }
+    const_iterator end() const {
+        return items_.end();
+    }
+    size_type size() const {
+        return items_.size();
+    }
+    bool empty() const {
+        return items_.empty();
+    }
+    T *operator[](const size_type i) const {
+        return items_[i];
+    }
+
+    void push_back(T *model) {
+        items_.push_back(model);
+        generation_++;
+    }
+    const_iterator erase(const_iterator it) {
+        generation_++;
+        return items_.erase(it);
+    }
+    void clear() {
+        items_.clear();
+        generation_++;
+    }
+    void reserve(const size_type n) {
+        items_.reserve(n);
+    }
+
+ private:
+    ModelList(const ModelList &);
+    ModelList &operator=(const ModelList &);
+
+    std::vector<T *> items_;
+    Poco::UInt64 generation_;
+};
+
+}  // namespace toggl
+
+#endif  // SRC_MODEL_INDEX_H_
@@ -0,0 +1,112 @@
+// Copyright 2015 Toggl Desktop developers.
+
+#include "../src/model_lock.h"
+
+#include "Poco/Timestamp.h"
+
+namespace toggl {
+
+static void addWait(
+    const Poco::Timestamp &since,
+    Poco::UInt64 *total,
+    Poco::UInt64 *max) {
+    Poco::UInt64 wait = since.elapsed();
+    *total += wait;
+    if (wait > *max) {
+        *max = wait;
+    }
+}
+
+ModelLock::ModelLock()
+    : writer_(0)
+, write_depth_(0)
+, waiting_writers_(0)
+, waiting_readers_(0)
+, released_readers_(0) {}
+
+bool ModelLock::otherReaders(const Poco::Thread::TID tid) const {
+    size_t own = readers_.find(tid) != readers_.end() ? 1 : 0;
+    return readers_.size() > own;
+}
+
+void ModelLock::LockRead() {
+    Poco::Thread::TID tid = Poco::Thread::currentTid();
+    Poco::Timestamp since;
+
+    Poco::Mutex::ScopedLock lock(mutex_);
+
+    // A thread holding the lock must not wait
+    // for writers, as they are waiting for it
+    bool holding = (write_depth_ && writer_ == tid)
+                   || readers_.find(tid) != readers_.end();
+    if (!holding && (write_depth_ || waiting_writers_)) {
+        waiting_readers_++;
+        while (write_depth_ || (waiting_writers_ && !released_readers_)) {
+            changed_.wait(mutex_);
+        }
+        waiting_readers_--;
+        if (released_readers_) {
+            released_readers_--;
+        }
+    }
+
+    readers_[tid]++;
+
+    stats_.Reads++;
+    addWait(since, &stats_.ReadWaitMicros, &stats_.MaxReadWaitMicros);
+}
+
+void ModelLock::UnlockRead() {
+    Poco::Thread::TID tid = Poco::Thread::currentTid();
+
+    Poco::Mutex::ScopedLock lock(mutex_);
+
+    std::map<Poco::Thread::TID, Poco::UInt64>::iterator it =
+        readers_.find(tid);
+    poco_assert(it != readers_.end());
+    if (--it->second) {
+        return;
+    }
+    readers_.erase(it);
+    changed_.broadcast();
+}
+
+void ModelLock::LockWrite() {
+    Poco::Thread::TID tid = Poco::Thread::currentTid();
+    Poco::Timestamp since;
+
+    Poco::Mutex::ScopedLock lock(mutex_);
+
+    if (!write_depth_ || writer_ != tid) {
+        waiting_writers_++;
+        while (write_depth_ || otherReaders(tid) || released_readers_) {
+            changed_.wait(mutex_);
+        }
+        waiting_writers_--;
+        writer_ = tid;
+    }
+
+    write_depth_++;
+
+    stats_.Writes++;
+    addWait(since, &stats_.WriteWaitMicros, &stats_.MaxWriteWaitMicros);
+}
+
+void ModelLock::UnlockWrite() {
+    Poco::Mutex::ScopedLock lock(mutex_);
+
+    poco_assert(write_depth_ && writer_ == Poco::Thread::currentTid());
+    if (--write_depth_) {
+        return;
+    }
+    writer_ = 0;
+    released_readers_ = waiting_readers_;
+    changed_.broadcast();
+}
+
+ModelLockStats ModelLock::Stats() const {
+    Poco::Mutex::ScopedLock lock(mutex_);
+    return stats_;
+}
+
+}   // namespace toggl
@@ -0,0 +1,130 @@
+// Copyright 2015 Toggl Desktop developers.
+
+#ifndef SRC_MODEL_LOCK_H_
+#define SRC_MODEL_LOCK_H_
+
+#include <map>
+
+#include "Poco/Condition.h"
+#include "Poco/Mutex.h"
+#include "Poco/Thread.h"
+#include "Poco/Types.h"
+
+namespace toggl {
+
+class ModelLockStats {
+ public:
+    ModelLockStats()
+        : Reads(0)
+    , Writes(0)
+    , ReadWaitMicros(0)
+    , MaxReadWaitMicros(0)
+    , WriteWaitMicros(0)
+    , MaxWriteWaitMicros(0) {}
+
+    Poco::UInt64 Reads;
+    Poco::UInt64 Writes;
+
+    // How long threads waited to get the lock
+    Poco::UInt64 ReadWaitMicros;
+    Poco::UInt64 MaxReadWaitMicros;
+    Poco::UInt64 WriteWaitMicros;
+    Poco::UInt64 MaxWriteWaitMicros;
+};
+
+// Reader/writer lock for the user and related data. Any number of
+// threads may read the models at once (render views, query
+// autocomplete), while changing them (UI edits, sync, save) needs
+// the lock to itself. Waiting writers go before new readers, and
+// readers that waited for a writer go before the next writer, so
+// neither renders nor syncs can hold off the other for long.
+//
+// The lock is reentrant: a thread holding the lock may lock it
+// again for reading or writing. A reader that locks for writing
+// waits until the other readers are done; two readers doing that
+// at the same time would wait for each other, so code that may
+// write should lock for writing from the start.
+class ModelLock {
+ public:
+    ModelLock();
+
+    void LockRead();
+    void UnlockRead();
+
+    void LockWrite();
+    void UnlockWrite();
+
+    ModelLockStats Stats() const;
+
+    // Scoped locks do nothing if given no lock
+    class ScopedRead {
+     public:
+        explicit ScopedRead(ModelLock *lock)
+            : lock_(lock) {
+            if (lock_) {
+                lock_->LockRead();
+            }
+        }
+        ~ScopedRead() {
+            if (lock_) {
+                lock_->UnlockRead();
+            }
+        }
+
+     private:
+        ScopedRead(const ScopedRead &);
+        ScopedRead &operator=(const ScopedRead &);
+
+        ModelLock *lock_;
+    };
+
+    class ScopedWrite {
+     public:
+        explicit ScopedWrite(ModelLock *lock)
+            : lock_(lock) {
+            if (lock_) {
+                lock_->LockWrite();
+            }
+        }
+        ~ScopedWrite() {
+            if (lock_) {
+                lock_->UnlockWrite();
+            }
+        }
+
+     private:
+        ScopedWrite(const ScopedWrite &);
+        ScopedWrite &operator=(const ScopedWrite &);
+
+        ModelLock *lock_;
+    };
+
+ private:
+    ModelLock(const ModelLock &);
+    ModelLock &operator=(const ModelLock &);
+
+    bool otherReaders(const Poco::Thread::TID tid) const;
+
+    mutable Poco::Mutex mutex_;
+    Poco::Condition changed_;
+
+    // Thread holding the write lock, and how many times
+    Poco::Thread::TID writer_;
+    Poco::UInt64 write_depth_;
+
+    // Threads holding the read lock, and how many times
+    std::map<Poco::Thread::TID, Poco::UInt64> readers_;
+
+    Poco::UInt64 waiting_writers_;
+    Poco::UInt64 waiting_readers_;
+
+    // Readers that were waiting when the last writer was done,
+    // still to get the lock before the next writer
+    Poco::UInt64 released_readers_;
+
+    ModelLockStats stats_;
+};
+
+}  // namespace toggl
+
+#endif  // SRC_MODEL_LOCK_H_
@@ -0,0 +1,83 @@
+// Copyright 2015 Toggl Desktop developers.
+
+#include "../src/model_pool.h"
+
+#include <new>
+
+#include "Poco/Bugcheck.h"
+
+namespace toggl {
+
+// Every object is aligned as well as malloc would align it
+static const std::size_t kModelPoolAlignment = 2 * sizeof(void *);
+
+ModelPool::ModelPool(
+    const std::size_t object_size,
+    const std::size_t slab_objects)
+    : object_size_(object_size)
+, slab_objects_(slab_objects)
+, free_(nullptr)
+, size_(0) {
+    poco_assert(slab_objects_ > 0);
+    if (object_size_ < sizeof(void *)) {
+        object_size_ = sizeof(void *);
+    }
+    object_size_ = (object_size_ + kModelPoolAlignment - 1)
+                   / kModelPoolAlignment * kModelPoolAlignment;
+}
+
+ModelPool::~ModelPool() {
+    for (std::vector<char *>::const_iterator it = slabs_.begin();
+            it != slabs_.end(); it++) {
+        ::operator delete(*it);
+    }
+}
+
+void ModelPool::addSlab() {
+    char *slab = static_cast<char *>(
+        ::operator new(object_size_ * slab_objects_));
+    slabs_.push_back(slab);
+
+    // Chain the objects so the first one is handed out first
+    for (std::size_t i = slab_objects_; i > 0; i--) {
+        void *object = slab + (i - 1) * object_size_;
+        *static_cast<void **>(object) = free_;
+        free_ = object;
+    }
+}
+
+void *ModelPool::Allocate() {
+    Poco::Mutex::ScopedLock lock(mutex_);
+
+    if (!free_) {
+        addSlab();
+    }
+    void *object = free_;
+    free_ = *static_cast<void **>(object);
+    size_++;
+    return object;
+}
+
+void ModelPool::Release(void *object) {
+    if (!object) {
+        return;
+    }
+
+    Poco::Mutex::ScopedLock lock(mutex_);
+
+    *static_cast<void **>(object) = free_;
+    free_ = object;
+    size_--;
+}
+
+std::size_t ModelPool::Size() const {
+    Poco::Mutex::ScopedLock lock(mutex_);
+    return size_;
+}
+
+std::size_t ModelPool::Capacity() const {
+    Poco::Mutex::ScopedLock lock(mutex_);
+    return slabs_.size() * slab_objects_ * object_size_;
+}
+
+}   // namespace toggl
@@ -0,0 +1,52 @@
+// Copyright 2015 Toggl Desktop developers.
+
+#ifndef SRC_MODEL_POOL_H_
+#define SRC_MODEL_POOL_H_
+
+#include <cstddef>
+#include <vector>
+
+#include "Poco/Mutex.h"
+
+namespace toggl {
+
+// Allocator for objects of one size, for models that are created
+// in large numbers. Memory is taken in slabs of many objects, so
+// models created together lie next to each other in memory and do
+// not pay per-allocation overhead. Released objects are reused;
+// slabs are kept until the pool is destroyed.
+class ModelPool {
+ public:
+    ModelPool(
+        const std::size_t object_size,
+        const std::size_t slab_objects);
+    ~ModelPool();
+
+    void *Allocate();
+    void Release(void *object);
+
+    // Objects allocated and not released
+    std::size_t Size() const;
+
+    // Bytes held in slabs
+    std::size_t Capacity() const;
+
+ private:
+    void addSlab();
+
+    std::size_t object_size_;
+    std::size_t slab_objects_;
+
+    std::vector<char *> slabs_;
+
+    // Released objects, each holding a pointer to the next one
+    void *free_;
+
+    std::size_t size_;
+
+    mutable Poco::Mutex mutex_;
+};
+
+}  // namespace toggl
+
+#endif  // SRC_MODEL_POOL_H_
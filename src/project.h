@@ -8,6 +8,7 @@
 
 #include "./base_model.h"
 #include "./const.h"
+#include "./string_pool.h"
 #include "./types.h"
 
 #include "Poco/Types.h"
@@ -77,7 +78,7 @@ class Project : public BaseModel {
         return "/api/v8/projects";
     }
 
-    void LoadFromJSON(Json::Value value);
+    void LoadFromJSON(const Json::Value &value);
     Json::Value SaveToJSON() const;
 
     bool DuplicateResource(const toggl::error) const;
@@ -92,8 +93,8 @@ class Project : public BaseModel {
 
     Poco::UInt64 wid_;
     Poco::UInt64 cid_;
-    std::string name_;
-    std::string color_;
+    InternedString name_;
+    InternedString color_;
     bool active_;
     bool private_;
     bool billable_;
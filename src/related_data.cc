@@ -19,7 +19,7 @@
 namespace toggl {
 
 template<typename T>
-void clearList(std::vector<T *> *list) {
+void clearList(ModelList<T> *list) {
     for (size_t i = 0; i < list->size(); i++) {
         T *value = (*list)[i];
         delete value;
@@ -27,7 +27,42 @@ void clearList(std::vector<T *> *list) {
     list->clear();
 }
 
+template<typename T>
+void addModel(T *model, ModelList<T> *list, ModelIndex *index) {
+    poco_check_ptr(model);
+
+    syncIndex(list, index);
+    list->push_back(model);
+    index->Add(model);
+    index->SetGeneration(list->Generation());
+}
+
+template<typename T>
+void purgeDeletedModels(ModelList<T> *list, ModelIndex *index) {
+    syncIndex(list, index);
+    typedef typename ModelList<T>::const_iterator iterator;
+    iterator it = list->begin();
+    while (it != list->end()) {
+        T *model = *it;
+        if (model->IsMarkedAsDeletedOnServer()) {
+            index->Remove(model);
+            it = list->erase(it);
+        } else {
+            ++it;
+        }
+    }
+    index->SetGeneration(list->Generation());
+}
+
 void RelatedData::Clear() {
+    workspace_index_.Clear();
+    client_index_.Clear();
+    project_index_.Clear();
+    task_index_.Clear();
+    tag_index_.Clear();
+    time_entry_index_.Clear();
+    autotracker_rule_index_.Clear();
+
     clearList(&Workspaces);
     clearList(&Clients);
     clearList(&Projects);
@@ -35,16 +70,158 @@ void RelatedData::Clear() {
     clearList(&Tags);
     clearList(&TimeEntries);
     clearList(&AutotrackerRules);
+
+    ResidentTimeEntriesSince = 0;
+}
+
+void RelatedData::Add(Workspace *model) {
+    addModel(model, &Workspaces, &workspace_index_);
+}
+
+void RelatedData::Add(Client *model) {
+    addModel(model, &Clients, &client_index_);
+}
+
+void RelatedData::Add(Project *model) {
+    addModel(model, &Projects, &project_index_);
+}
+
+void RelatedData::Add(Task *model) {
+    addModel(model, &Tasks, &task_index_);
+}
+
+void RelatedData::Add(Tag *model) {
+    addModel(model, &Tags, &tag_index_);
+}
+
+void RelatedData::Add(TimeEntry *model) {
+    addModel(model, &TimeEntries, &time_entry_index_);
+}
+
+void RelatedData::Add(AutotrackerRule *model) {
+    addModel(model, &AutotrackerRules, &autotracker_rule_index_);
+}
+
+void RelatedData::PurgeDeletedModels() {
+    purgeDeletedModels(&Workspaces, &workspace_index_);
+    purgeDeletedModels(&Clients, &client_index_);
+    purgeDeletedModels(&Projects, &project_index_);
+    purgeDeletedModels(&Tasks, &task_index_);
+    purgeDeletedModels(&Tags, &tag_index_);
+    purgeDeletedModels(&TimeEntries, &time_entry_index_);
+    purgeDeletedModels(&AutotrackerRules, &autotracker_rule_index_);
+}
+
+void RelatedData::DirtyModels(std::vector<Workspace *> *result) const {
+    dirtyModels(&Workspaces, &workspace_index_, result);
+}
+
+void RelatedData::DirtyModels(std::vector<Client *> *result) const {
+    dirtyModels(&Clients, &client_index_, result);
+}
+
+void RelatedData::DirtyModels(std::vector<Project *> *result) const {
+    dirtyModels(&Projects, &project_index_, result);
+}
+
+void RelatedData::DirtyModels(std::vector<Task *> *result) const {
+    dirtyModels(&Tasks, &task_index_, result);
+}
+
+void RelatedData::DirtyModels(std::vector<Tag *> *result) const {
+    dirtyModels(&Tags, &tag_index_, result);
+}
+
+void RelatedData::DirtyModels(std::vector<TimeEntry *> *result) const {
+    dirtyModels(&TimeEntries, &time_entry_index_, result);
+}
+
+void RelatedData::DirtyModels(
+    std::vector<AutotrackerRule *> *result) const {
+    dirtyModels(&AutotrackerRules, &autotracker_rule_index_, result);
+}
+
+bool RelatedData::TimeEntryAutocompleteItem(
+    const TimeEntry *te,
+    AutocompleteItem *result) const {
+
+    poco_check_ptr(te);
+    poco_check_ptr(result);
+
+    if (te->DeletedAt() || te->IsMarkedAsDeletedOnServer()
+            || te->Description().empty()) {
+        return false;
+    }
+
+    Task *t = nullptr;
+    if (te->TID()) {
+        t = TaskByID(te->TID());
+    }
+
+    Project *p = nullptr;
+    if (t && t->PID()) {
+        p = ProjectByID(t->PID());
+    } else if (te->PID()) {
+        p = ProjectByID(te->PID());
+    }
+
+    if (p && !p->Active()) {
+        return false;
+    }
+
+    Client *c = nullptr;
+    if (p && p->CID()) {
+        c = ClientByID(p->CID());
+    }
+
+    InternedString project_task_label =
+        Formatter::JoinTaskName(t, p, c);
+
+    std::stringstream search_parts;
+    search_parts << te->Description();
+    if (!project_task_label.empty()) {
+        search_parts << " - " << project_task_label;
+    }
+
+    InternedString text = search_parts.str();
+    if (text.empty()) {
+        return false;
+    }
+
+    result->Text = text;
+    result->Description = te->Description();
+    result->ProjectAndTaskLabel = project_task_label;
+    if (p) {
+        result->ProjectColor = p->ColorCode();
+        result->ProjectID = p->ID();
+        result->ProjectLabel = p->Name();
+    }
+    if (c) {
+        result->ClientLabel = c->Name();
+    }
+    if (t) {
+        result->TaskID = t->ID();
+        result->TaskLabel = t->Name();
+    }
+    result->WorkspaceID = te->WID();
+    result->Type = kAutocompleteItemTE;
+    return true;
 }
 
 // Add time entries, in format:
 // Description - Task. Project. Client
 void RelatedData::timeEntryAutocompleteItems(
-    std::set<std::string> *unique_names,
+    std::set<const std::string *> *unique_names,
     std::vector<AutocompleteItem> *list) {
 
     poco_check_ptr(list);
 
+    // Time entries with the same description, task and project
+    // give the same item. Descriptions are interned, so equal
+    // descriptions have the same address.
+    std::set<std::pair<const std::string *,
+        std::pair<Poco::UInt64, Poco::UInt64> > > visited;
+
     for (std::vector<TimeEntry *>::const_iterator it =
         TimeEntries.begin();
             it != TimeEntries.end(); it++) {
@@ -55,66 +232,21 @@ void RelatedData::timeEntryAutocompleteItems(
             continue;
         }
 
-        Task *t = nullptr;
-        if (te->TID()) {
-            t = TaskByID(te->TID());
-        }
-
-        Project *p = nullptr;
-        if (t && t->PID()) {
-            p = ProjectByID(t->PID());
-        } else if (te->PID()) {
-            p = ProjectByID(te->PID());
-        }
-
-        if (p && !p->Active()) {
+        if (!visited.insert(std::make_pair(&te->Description(),
+                                           std::make_pair(te->TID(),
+                                                   te->PID()))).second) {
             continue;
         }
 
-        Client *c = nullptr;
-        if (p && p->CID()) {
-            c = ClientByID(p->CID());
-        }
-
-        std::string project_task_label =
-            Formatter::JoinTaskName(t, p, c);
-
-        std::string description = te->Description();
-
-        std::stringstream search_parts;
-        search_parts << te->Description();
-        if (!project_task_label.empty()) {
-            search_parts << " - " << project_task_label;
-        }
-
-        std::string text = search_parts.str();
-        if (text.empty()) {
+        AutocompleteItem autocomplete_item;
+        if (!TimeEntryAutocompleteItem(te, &autocomplete_item)) {
             continue;
         }
 
-        if (unique_names->find(text) != unique_names->end()) {
+        if (!unique_names->insert(&autocomplete_item.Text.str()).second) {
             continue;
         }
-        unique_names->insert(text);
 
-        AutocompleteItem autocomplete_item;
-        autocomplete_item.Text = text;
-        autocomplete_item.Description = description;
-        autocomplete_item.ProjectAndTaskLabel = project_task_label;
-        if (p) {
-            autocomplete_item.ProjectColor = p->ColorCode();
-            autocomplete_item.ProjectID = p->ID();
-            autocomplete_item.ProjectLabel = p->Name();
-        }
-        if (c) {
-            autocomplete_item.ClientLabel = c->Name();
-        }
-        if (t) {
-            autocomplete_item.TaskID = t->ID();
-            autocomplete_item.TaskLabel = t->Name();
-        }
-        autocomplete_item.WorkspaceID = te->WID();
-        autocomplete_item.Type = kAutocompleteItemTE;
         list->push_back(autocomplete_item);
     }
 }
@@ -122,8 +254,8 @@ void RelatedData::timeEntryAutocompleteItems(
 // Add tasks, in format:
 // Task. Project. Client
 void RelatedData::taskAutocompleteItems(
-    std::set<std::string> *unique_names,
-    std::map<Poco::UInt64, std::string> *ws_names,
+    std::set<const std::string *> *unique_names,
+    std::map<Poco::UInt64, InternedString> *ws_names,
     std::vector<AutocompleteItem> *list) {
 
     poco_check_ptr(list);
@@ -155,22 +287,21 @@ void RelatedData::taskAutocompleteItems(
             c = ClientByID(p->CID());
         }
 
-        std::string text = Formatter::JoinTaskName(t, p, c);
+        InternedString text = Formatter::JoinTaskName(t, p, c);
         if (text.empty()) {
             continue;
         }
 
-        if (unique_names->find(text) != unique_names->end()) {
+        if (!unique_names->insert(&text.str()).second) {
             continue;
         }
-        unique_names->insert(text);
 
-        std::string client_label("");
+        InternedString client_label("");
         if (c) {
             client_label = c->Name();
         }
 
-        std::string project_label("");
+        InternedString project_label("");
         if (p) {
             project_label = p->Name();
         }
@@ -198,8 +329,8 @@ void RelatedData::taskAutocompleteItems(
 // Add projects, in format:
 // Project. Client
 void RelatedData::projectAutocompleteItems(
-    std::set<std::string> *unique_names,
-    std::map<Poco::UInt64, std::string> *ws_names,
+    std::set<const std::string *> *unique_names,
+    std::map<Poco::UInt64, InternedString> *ws_names,
     std::vector<AutocompleteItem> *list) {
 
     poco_check_ptr(list);
@@ -218,17 +349,16 @@ void RelatedData::projectAutocompleteItems(
             c = ClientByID(p->CID());
         }
 
-        std::string text = Formatter::JoinTaskName(0, p, c);
+        InternedString text = Formatter::JoinTaskName(0, p, c);
         if (text.empty()) {
             continue;
         }
 
-        if (unique_names->find(text) != unique_names->end()) {
+        if (!unique_names->insert(&text.str()).second) {
             continue;
         }
-        unique_names->insert(text);
 
-        std::string client_label("");
+        InternedString client_label("");
         if (c) {
             client_label = c->Name();
         }
@@ -251,7 +381,7 @@ void RelatedData::projectAutocompleteItems(
 
 std::vector<AutocompleteItem> RelatedData::TimeEntryAutocompleteItems() {
     std::vector<AutocompleteItem> result;
-    std::set<std::string> unique_names;
+    std::set<const std::string *> unique_names;
     timeEntryAutocompleteItems(&unique_names, &result);
     std::sort(result.begin(), result.end(), CompareAutocompleteItems);
     return result;
@@ -259,7 +389,7 @@ std::vector<AutocompleteItem> RelatedData::TimeEntryAutocompleteItems() {
 
 std::vector<AutocompleteItem> RelatedData::MinitimerAutocompleteItems() {
     std::vector<AutocompleteItem> result;
-    std::set<std::string> unique_names;
+    std::set<const std::string *> unique_names;
     timeEntryAutocompleteItems(&unique_names, &result);
     taskAutocompleteItems(&unique_names, 0, &result);
     projectAutocompleteItems(&unique_names, 0, &result);
@@ -269,8 +399,8 @@ std::vector<AutocompleteItem> RelatedData::MinitimerAutocompleteItems() {
 
 std::vector<AutocompleteItem> RelatedData::ProjectAutocompleteItems() {
     std::vector<AutocompleteItem> result;
-    std::set<std::string> unique_names;
-    std::map<Poco::UInt64, std::string> ws_names;
+    std::set<const std::string *> unique_names;
+    std::map<Poco::UInt64, InternedString> ws_names;
     workspaceAutocompleteItems(&unique_names, &ws_names, &result);
     projectAutocompleteItems(&unique_names, &ws_names, &result);
     taskAutocompleteItems(&unique_names, &ws_names, &result);
@@ -279,8 +409,8 @@ std::vector<AutocompleteItem> RelatedData::ProjectAutocompleteItems() {
 }
 
 void RelatedData::workspaceAutocompleteItems(
-    std::set<std::string> *unique_names,
-    std::map<Poco::UInt64, std::string> *ws_names,
+    std::set<const std::string *> *unique_names,
+    std::map<Poco::UInt64, InternedString> *ws_names,
     std::vector<AutocompleteItem> *list) {
 
     // remember workspaces that have projects
@@ -304,7 +434,7 @@ void RelatedData::workspaceAutocompleteItems(
             continue;
         }
 
-        std::string ws_name = Poco::UTF8::toUpper(ws->Name());
+        InternedString ws_name = Poco::UTF8::toUpper(ws->Name());
         (*ws_names)[ws->ID()] = ws_name;
 
         AutocompleteItem autocomplete_item;
@@ -318,16 +448,16 @@ void RelatedData::workspaceAutocompleteItems(
 
 std::vector<std::string> RelatedData::TagList() const {
     std::vector<std::string> tags;
-    std::set<std::string> unique_names;
+    // Tag names are interned, equal names have the same address
+    std::set<const std::string *> unique_names;
     for (std::vector<Tag *>::const_iterator it =
         Tags.begin();
             it != Tags.end();
             it++) {
         Tag *tag = *it;
-        if (unique_names.find(tag->Name()) != unique_names.end()) {
+        if (!unique_names.insert(&tag->Name()).second) {
             continue;
         }
-        unique_names.insert(tag->Name());
         tags.push_back(tag->Name());
     }
     std::sort(tags.rbegin(), tags.rend());
@@ -335,13 +465,13 @@ std::vector<std::string> RelatedData::TagList() const {
 }
 
 std::vector<Workspace *> RelatedData::WorkspaceList() const {
-    std::vector<Workspace *> result = Workspaces;
+    std::vector<Workspace *> result = Workspaces.Items();
     std::sort(result.rbegin(), result.rend(), CompareWorkspaceByName);
     return result;
 }
 
 std::vector<Client *> RelatedData::ClientList() const {
-    std::vector<Client *> result = Clients;
+    std::vector<Client *> result = Clients.Items();
     std::sort(result.rbegin(), result.rend(), CompareClientByName);
     return result;
 }
@@ -408,73 +538,104 @@ void RelatedData::ProjectLabelAndColorCode(
 }
 
 Task *RelatedData::TaskByID(const Poco::UInt64 id) const {
-    return modelByID<Task>(id, &Tasks);
+    return byID(id, &Tasks, &task_index_);
 }
 
 Client *RelatedData::ClientByID(const Poco::UInt64 id) const {
-    return modelByID(id, &Clients);
+    return byID(id, &Clients, &client_index_);
 }
 
 Project *RelatedData::ProjectByID(const Poco::UInt64 id) const {
-    return modelByID(id, &Projects);
+    return byID(id, &Projects, &project_index_);
 }
 
 Tag *RelatedData::TagByID(const Poco::UInt64 id) const {
-    return modelByID(id, &Tags);
+    return byID(id, &Tags, &tag_index_);
 }
 
 Workspace *RelatedData::WorkspaceByID(const Poco::UInt64 id) const {
-    return modelByID(id, &Workspaces);
+    return byID(id, &Workspaces, &workspace_index_);
 }
 
 TimeEntry *RelatedData::TimeEntryByID(const Poco::UInt64 id) const {
-    return modelByID(id, &TimeEntries);
+    return byID(id, &TimeEntries, &time_entry_index_);
 }
 
 TimeEntry *RelatedData::TimeEntryByGUID(const guid GUID) const {
-    return modelByGUID(GUID, &TimeEntries);
+    return byGUID(GUID, &TimeEntries, &time_entry_index_);
 }
 
 Tag *RelatedData::TagByGUID(const guid GUID) const {
-    return modelByGUID(GUID, &Tags);
+    return byGUID(GUID, &Tags, &tag_index_);
 }
 
 Project *RelatedData::ProjectByGUID(const guid GUID) const {
-    return modelByGUID(GUID, &Projects);
+    return byGUID(GUID, &Projects, &project_index_);
 }
 
 Client *RelatedData::ClientByGUID(const guid GUID) const {
-    return modelByGUID(GUID, &Clients);
+    return byGUID(GUID, &Clients, &client_index_);
 }
 
-template <typename T>
-T *modelByGUID(const guid GUID, std::vector<T *> const *list) {
-    if (GUID.empty()) {
-        return nullptr;
-    }
-    typedef typename std::vector<T *>::const_iterator iterator;
-    for (iterator it = list->begin(); it != list->end(); it++) {
-        T *model = *it;
-        if (model->GUID() == GUID) {
-            return model;
-        }
+AutotrackerRule *RelatedData::AutotrackerRuleByLocalID(
+    const Poco::Int64 local_id) const {
+    Poco::Mutex::ScopedLock lock(index_m_);
+    syncIndex(&AutotrackerRules, &autotracker_rule_index_);
+    return static_cast<AutotrackerRule *>(
+        autotracker_rule_index_.ByLocalID(local_id));
+}
+
+template<typename T>
+T *RelatedData::byID(
+    const Poco::UInt64 id,
+    ModelList<T> const *list,
+    ModelIndex *index) const {
+    Poco::Mutex::ScopedLock lock(index_m_);
+    syncIndex(list, index);
+    return static_cast<T *>(index->ByID(id));
+}
+
+template<typename T>
+T *RelatedData::byGUID(
+    const guid GUID,
+    ModelList<T> const *list,
+    ModelIndex *index) const {
+    Poco::Mutex::ScopedLock lock(index_m_);
+    syncIndex(list, index);
+    return static_cast<T *>(index->ByGUID(GUID));
+}
+
+template<typename T>
+void RelatedData::dirtyModels(
+    ModelList<T> const *list,
+    ModelIndex *index,
+    std::vector<T *> *result) const {
+    poco_check_ptr(result);
+
+    Poco::Mutex::ScopedLock lock(index_m_);
+    syncIndex(list, index);
+    std::vector<BaseModel *> models;
+    index->DirtyModels(&models);
+    for (std::vector<BaseModel *>::const_iterator it = models.begin();
+            it != models.end(); it++) {
+        result->push_back(static_cast<T *>(*it));
     }
-    return nullptr;
 }
 
+// Lists are public and may be changed directly (for example when
+// loading from database), so rebuild the index when the list has
+// changed since the index was last synced with it.
 template<typename T>
-T *modelByID(const Poco::UInt64 id, std::vector<T *> const *list) {
-    if (!id) {
-        return nullptr;
+void syncIndex(ModelList<T> const *list, ModelIndex *index) {
+    if (index->Generation() == list->Generation()) {
+        return;
     }
-    typedef typename std::vector<T *>::const_iterator iterator;
+    index->Clear();
+    typedef typename ModelList<T>::const_iterator iterator;
     for (iterator it = list->begin(); it != list->end(); it++) {
-        T *model = *it;
-        if (model->ID() == id) {
-            return model;
-        }
+        index->Add(*it);
     }
-    return nullptr;
+    index->SetGeneration(list->Generation());
 }
 
 }   // namespace toggl
@@ -9,8 +9,11 @@
 #include <map>
 
 #include "./autocomplete_item.h"
+#include "./model_index.h"
 #include "./types.h"
 
+#include "Poco/Mutex.h"
+
 namespace toggl {
 
 class AutotrackerRule;
@@ -22,23 +25,51 @@ class TimeEntry;
 class Workspace;
 
 template<typename T>
-T *modelByID(const Poco::UInt64 id, std::vector<T *> const *list);
-
-template <typename T>
-T *modelByGUID(const guid GUID, std::vector<T *> const *list);
+void syncIndex(ModelList<T> const *list, ModelIndex *index);
 
 class RelatedData {
  public:
-    std::vector<Workspace *> Workspaces;
-    std::vector<Client *> Clients;
-    std::vector<Project *> Projects;
-    std::vector<Task *> Tasks;
-    std::vector<Tag *> Tags;
-    std::vector<TimeEntry *> TimeEntries;
-    std::vector<AutotrackerRule *> AutotrackerRules;
+    RelatedData()
+        : ResidentTimeEntriesSince(0) {}
+
+    ModelList<Workspace> Workspaces;
+    ModelList<Client> Clients;
+    ModelList<Project> Projects;
+    ModelList<Task> Tasks;
+    ModelList<Tag> Tags;
+    ModelList<TimeEntry> TimeEntries;
+    ModelList<AutotrackerRule> AutotrackerRules;
+
+    // Time entries that started before this time may be in
+    // database only. Zero if all time entries are in memory.
+    Poco::Int64 ResidentTimeEntriesSince;
 
     void Clear();
 
+    // Add a model to its list and to the lookup indexes.
+    // Lists changed directly are reindexed on the next lookup.
+    void Add(Workspace *model);
+    void Add(Client *model);
+    void Add(Project *model);
+    void Add(Task *model);
+    void Add(Tag *model);
+    void Add(TimeEntry *model);
+    void Add(AutotrackerRule *model);
+
+    // Remove models marked as deleted on server from memory.
+    // The models are not freed.
+    void PurgeDeletedModels();
+
+    // Models changed since they were last saved, including
+    // new models and models marked as deleted on server.
+    void DirtyModels(std::vector<Workspace *> *result) const;
+    void DirtyModels(std::vector<Client *> *result) const;
+    void DirtyModels(std::vector<Project *> *result) const;
+    void DirtyModels(std::vector<Task *> *result) const;
+    void DirtyModels(std::vector<Tag *> *result) const;
+    void DirtyModels(std::vector<TimeEntry *> *result) const;
+    void DirtyModels(std::vector<AutotrackerRule *> *result) const;
+
     Task *TaskByID(const Poco::UInt64 id) const;
     Client *ClientByID(const Poco::UInt64 id) const;
     Project *ProjectByID(const Poco::UInt64 id) const;
@@ -55,8 +86,16 @@ class RelatedData {
     Project *ProjectByGUID(const guid GUID) const;
     Client *ClientByGUID(const guid GUID) const;
 
+    AutotrackerRule *AutotrackerRuleByLocalID(const Poco::Int64 local_id) const;
+
     std::vector<AutocompleteItem> TimeEntryAutocompleteItems();
 
+    // The autocomplete item of a single time entry. Returns false
+    // if the time entry is not listed in autocomplete.
+    bool TimeEntryAutocompleteItem(
+        const TimeEntry *te,
+        AutocompleteItem *result) const;
+
     std::vector<AutocompleteItem> MinitimerAutocompleteItems();
 
     std::vector<AutocompleteItem> ProjectAutocompleteItems();
@@ -71,28 +110,55 @@ class RelatedData {
         std::string *color_code) const;
 
  private:
+    template<typename T>
+    T *byID(const Poco::UInt64 id,
+            ModelList<T> const *list,
+            ModelIndex *index) const;
+
+    template<typename T>
+    T *byGUID(const guid GUID,
+              ModelList<T> const *list,
+              ModelIndex *index) const;
+
+    template<typename T>
+    void dirtyModels(ModelList<T> const *list,
+                     ModelIndex *index,
+                     std::vector<T *> *result) const;
+
     void timeEntryAutocompleteItems(
-        std::set<std::string> *unique_names,
+        std::set<const std::string *> *unique_names,
         std::vector<AutocompleteItem> *list);
 
     void taskAutocompleteItems(
-        std::set<std::string> *unique_names,
-        std::map<Poco::UInt64, std::string> *ws_names,
+        std::set<const std::string *> *unique_names,
+        std::map<Poco::UInt64, InternedString> *ws_names,
         std::vector<AutocompleteItem> *list);
 
     void projectAutocompleteItems(
-        std::set<std::string> *unique_names,
-        std::map<Poco::UInt64, std::string> *ws_names,
+        std::set<const std::string *> *unique_names,
+        std::map<Poco::UInt64, InternedString> *ws_names,
         std::vector<AutocompleteItem> *list);
 
     void workspaceAutocompleteItems(
-        std::set<std::string> *unique_names,
-        std::map<Poco::UInt64, std::string> *ws_names,
+        std::set<const std::string *> *unique_names,
+        std::map<Poco::UInt64, InternedString> *ws_names,
         std::vector<AutocompleteItem> *list);
+
+    // Lookup indexes, one per model list. Lookups may rebuild an
+    // index, and views may look up models from several threads
+    // at once, so lookups take index_m_.
+    mutable Poco::Mutex index_m_;
+    mutable ModelIndex workspace_index_;
+    mutable ModelIndex client_index_;
+    mutable ModelIndex project_index_;
+    mutable ModelIndex task_index_;
+    mutable ModelIndex tag_index_;
+    mutable ModelIndex time_entry_index_;
+    mutable ModelIndex autotracker_rule_index_;
 };
 
 template<typename T>
-void clearList(std::vector<T *> *list);
+void clearList(ModelList<T> *list);
 
 }  // namespace toggl
 
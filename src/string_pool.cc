@@ -0,0 +1,65 @@
+// Copyright 2015 Toggl Desktop developers.
+
+#include "../src/string_pool.h"
+
+namespace toggl {
+
+StringPool::Entry *StringPool::Intern(const std::string &value) {
+    if (value.empty()) {
+        return Empty();
+    }
+
+    Poco::Mutex::ScopedLock lock(mutex_);
+    std::unordered_map<std::string, std::atomic<size_t> >::iterator it =
+        values_.find(value);
+    if (it == values_.end()) {
+        it = values_.emplace(value, 0).first;
+    }
+    it->second++;
+    return &*it;
+}
+
+void StringPool::Retain(Entry *entry) {
+    if (entry != Empty()) {
+        entry->second++;
+    }
+}
+
+void StringPool::Release(Entry *entry) {
+    if (entry == Empty()) {
+        return;
+    }
+
+    // Other references stay, no need to lock
+    size_t refs = entry->second.load();
+    while (refs > 1) {
+        if (entry->second.compare_exchange_weak(refs, refs - 1)) {
+            return;
+        }
+    }
+
+    // The last reference is dropped under the lock, so that
+    // Intern cannot hand out the entry while it is removed
+    Poco::Mutex::ScopedLock lock(mutex_);
+    if (--entry->second) {
+        return;
+    }
+    values_.erase(values_.find(entry->first));
+}
+
+size_t StringPool::Size() const {
+    Poco::Mutex::ScopedLock lock(mutex_);
+    return values_.size();
+}
+
+StringPool::Entry *StringPool::Empty() {
+    static Entry *empty = new Entry("", 0);
+    return empty;
+}
+
+StringPool &StringPool::Shared() {
+    static StringPool *pool = new StringPool();
+    return *pool;
+}
+
+}   // namespace toggl
@@ -0,0 +1,164 @@
+// Copyright 2015 Toggl Desktop developers.
+
+#ifndef SRC_STRING_POOL_H_
+#define SRC_STRING_POOL_H_
+
+#include <atomic>
+#include <ostream>
+#include <string>
+#include <unordered_map>
+#include <utility>
+
+#include "Poco/Mutex.h"
+
+namespace toggl {
+
+// Shared copies of string values that repeat across many models,
+// such as descriptions, tag lists and project names. Each distinct
+// value is stored once, with a count of references to it. Models
+// hold references, and a value is removed from the pool when the
+// last reference is released.
+class StringPool {
+ public:
+    // Stored value and its reference count
+    typedef std::pair<const std::string, std::atomic<size_t> > Entry;
+
+    StringPool() {}
+
+    // Entry of the value, with one more reference to it.
+    // Equal values give the same entry.
+    Entry *Intern(const std::string &value);
+
+    // Add a reference to an entry already referenced by the caller
+    void Retain(Entry *entry);
+
+    // Drop a reference. The value is removed when none are left.
+    void Release(Entry *entry);
+
+    size_t Size() const;
+
+    // Entry of the empty value, shared by all pools. It is
+    // never stored in a pool and never removed.
+    static Entry *Empty();
+
+    // Pool used by InternedString. Never destroyed, as
+    // models may outlive other static objects.
+    static StringPool &Shared();
+
+ private:
+    // Elements keep their address when the map grows
+    std::unordered_map<std::string, std::atomic<size_t> > values_;
+
+    mutable Poco::Mutex mutex_;
+};
+
+// Reference to a value in the shared string pool. Equal values
+// have equal handles, so comparing two handles is a pointer
+// compare. Copying a handle adds a reference to the value.
+class InternedString {
+ public:
+    InternedString()
+        : entry_(StringPool::Empty()) {}
+    InternedString(const std::string &value)  // NOLINT
+        : entry_(StringPool::Shared().Intern(value)) {}
+    InternedString(const char *value)  // NOLINT
+        : entry_(StringPool::Shared().Intern(value)) {}
+    InternedString(const InternedString &other)
+        : entry_(other.entry_) {
+        StringPool::Shared().Retain(entry_);
+    }
+    ~InternedString() {
+        StringPool::Shared().Release(entry_);
+    }
+
+    InternedString &operator=(const InternedString &other) {
+        if (entry_ != other.entry_) {
+            StringPool::Shared().Retain(other.entry_);
+            StringPool::Shared().Release(entry_);
+            entry_ = other.entry_;
+        }
+        return *this;
+    }
+
+    const std::string &str() const {
+        return entry_->first;
+    }
+    operator const std::string &() const {
+        return entry_->first;
+    }
+
+    const char *c_str() const {
+        return entry_->first.c_str();
+    }
+    bool empty() const {
+        return entry_->first.empty();
+    }
+    size_t size() const {
+        return entry_->first.size();
+    }
+
+    InternedString &operator+=(const std::string &value) {
+        return *this = InternedString(entry_->first + value);
+    }
+
+    bool operator==(const InternedString &other) const {
+        return entry_ == other.entry_;
+    }
+    bool operator!=(const InternedString &other) const {
+        return entry_ != other.entry_;
+    }
+    bool operator==(const std::string &other) const {
+        return entry_->first == other;
+    }
+    bool operator!=(const std::string &other) const {
+        return entry_->first != other;
+    }
+    bool operator==(const char *other) const {
+        return entry_->first == other;
+    }
+    bool operator!=(const char *other) const {
+        return entry_->first != other;
+    }
+
+ private:
+    StringPool::Entry *entry_;
+};
+
+inline bool operator==(const std::string &a, const InternedString &b) {
+    return b == a;
+}
+inline bool operator!=(const std::string &a, const InternedString &b) {
+    return b != a;
+}
+inline bool operator==(const char *a, const InternedString &b) {
+    return b == a;
+}
+inline bool operator!=(const char *a, const InternedString &b) {
+    return b != a;
+}
+
+inline std::string operator+(
+    const InternedString &a, const InternedString &b) {
+    return a.str() + b.str();
+}
+inline std::string operator+(const InternedString &a, const std::string &b) {
+    return a.str() + b;
+}
+inline std::string operator+(const std::string &a, const InternedString &b) {
+    return a + b.str();
+}
+inline std::string operator+(const InternedString &a, const char *b) {
+    return a.str() + b;
+}
+inline std::string operator+(const char *a, const InternedString &b) {
+    return a + b.str();
+}
+
+inline std::ostream &operator<<(
+    std::ostream &out, const InternedString &value) {
+    return out << value.str();
+}
+
+}  // namespace toggl
+
+#endif  // SRC_STRING_POOL_H_
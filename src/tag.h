@@ -8,6 +8,7 @@
 #include "Poco/Types.h"
 
 #include "./base_model.h"
+#include "./string_pool.h"
 
 namespace toggl {
 
@@ -37,11 +38,11 @@ class Tag : public BaseModel {
         return "/api/v8/tags";
     }
 
-    void LoadFromJSON(Json::Value data);
+    void LoadFromJSON(const Json::Value &data);
 
  private:
     Poco::UInt64 wid_;
-    std::string name_;
+    InternedString name_;
 };
 
 }  // namespace toggl
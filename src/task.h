@@ -11,6 +11,7 @@
 
 #include "./base_model.h"
 #include "./const.h"
+#include "./string_pool.h"
 
 namespace toggl {
 
@@ -52,10 +53,10 @@ class Task : public BaseModel {
         return "/api/v8/tasks";
     }
 
-    void LoadFromJSON(Json::Value value);
+    void LoadFromJSON(const Json::Value &value);
 
  private:
-    std::string name_;
+    InternedString name_;
     Poco::UInt64 wid_;
     Poco::UInt64 pid_;
     bool active_;
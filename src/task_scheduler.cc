@@ -0,0 +1,213 @@
+// Copyright 2015 Toggl Desktop developers.
+
+#include "../src/task_scheduler.h"
+
+#include <sstream>
+
+#include "Poco/Logger.h"
+
+namespace toggl {
+
+// Longest sleep while nothing is due. Scheduling and
+// shutdown wake the loop up, so this can be long.
+#define kTaskSchedulerIdleMillis 60000
+
+TaskScheduler::TaskScheduler()
+    : sequence_(0)
+, shutdown_(false)
+, busy_(false)
+, pool_(1, 1)
+, running_(this, &TaskScheduler::run) {
+    running_.start(pool_);
+}
+
+TaskScheduler::~TaskScheduler() {
+    Shutdown();
+}
+
+bool TaskScheduler::runsBefore(const Entry &a, const Entry &b) {
+    if (a.Priority != b.Priority) {
+        return a.Priority > b.Priority;
+    }
+    if (a.At != b.At) {
+        return a.At < b.At;
+    }
+    return a.Sequence < b.Sequence;
+}
+
+Poco::Logger &TaskScheduler::logger() const {
+    return Poco::Logger::get("TaskScheduler");
+}
+
+void TaskScheduler::Schedule(
+    const std::string &key,
+    Poco::Util::TimerTask::Ptr task,
+    const Poco::Timestamp &at,
+    const int priority) {
+
+    poco_check_ptr(task.get());
+
+    {
+        Poco::Mutex::ScopedLock lock(mutex_);
+        if (shutdown_) {
+            return;
+        }
+
+        Entry &entry = pending_[key];
+        if (entry.Task) {
+            entry.Task->cancel();
+        }
+        entry.Task = task;
+        entry.At = at;
+        entry.Priority = priority;
+        entry.Sequence = ++sequence_;
+        entry.Requests++;
+
+        stats_[key].Requests++;
+    }
+
+    wake_.Signal();
+}
+
+void TaskScheduler::Cancel(const std::string &key) {
+    {
+        Poco::Mutex::ScopedLock lock(mutex_);
+        std::map<std::string, Entry>::iterator it = pending_.find(key);
+        if (it == pending_.end()) {
+            return;
+        }
+        it->second.Task->cancel();
+        pending_.erase(it);
+    }
+
+    wake_.Signal();
+}
+
+void TaskScheduler::CancelAll() {
+    {
+        Poco::Mutex::ScopedLock lock(mutex_);
+        for (std::map<std::string, Entry>::iterator it = pending_.begin();
+                it != pending_.end(); it++) {
+            it->second.Task->cancel();
+        }
+        pending_.clear();
+        while (busy_) {
+            idle_.wait(mutex_);
+        }
+    }
+
+    wake_.Signal();
+}
+
+void TaskScheduler::Shutdown() {
+    {
+        Poco::Mutex::ScopedLock lock(mutex_);
+        if (shutdown_) {
+            return;
+        }
+        shutdown_ = true;
+    }
+
+    CancelAll();
+
+    running_.stop();
+    wake_.Signal();
+    running_.wait();
+}
+
+bool TaskScheduler::IsPending(const std::string &key) const {
+    Poco::Mutex::ScopedLock lock(mutex_);
+    return pending_.find(key) != pending_.end();
+}
+
+size_t TaskScheduler::QueueDepth() const {
+    Poco::Mutex::ScopedLock lock(mutex_);
+    return pending_.size();
+}
+
+TaskStats TaskScheduler::Stats(const std::string &key) const {
+    Poco::Mutex::ScopedLock lock(mutex_);
+    std::map<std::string, TaskStats>::const_iterator it = stats_.find(key);
+    if (it == stats_.end()) {
+        return TaskStats();
+    }
+    return it->second;
+}
+
+void TaskScheduler::run() {
+    while (!running_.isStopped()) {
+        Poco::Util::TimerTask::Ptr task;
+        std::string key("");
+        Poco::Timestamp::TimeDiff wait =
+            kTaskSchedulerIdleMillis * Poco::Timestamp::TimeDiff(1000);
+
+        {
+            Poco::Mutex::ScopedLock lock(mutex_);
+
+            // Of the tasks that are due, the one with highest priority,
+            // and of those the one due first, or scheduled first
+            Poco::Timestamp now;
+            std::map<std::string, Entry>::iterator next = pending_.end();
+            for (std::map<std::string, Entry>::iterator it =
+                pending_.begin(); it != pending_.end(); it++) {
+                if (it->second.At > now) {
+                    if (it->second.At - now < wait) {
+                        wait = it->second.At - now;
+                    }
+                    continue;
+                }
+                if (next == pending_.end()
+                        || runsBefore(it->second, next->second)) {
+                    next = it;
+                }
+            }
+
+            if (next != pending_.end()) {
+                key = next->first;
+                task = next->second.Task;
+
+                Poco::UInt64 latency = now - next->second.At;
+                TaskStats &stats = stats_[key];
+                stats.Runs++;
+                stats.TotalLatencyMicros += latency;
+                if (latency > stats.MaxLatencyMicros) {
+                    stats.MaxLatencyMicros = latency;
+                }
+
+                std::stringstream ss;
+                ss << "Running task " << key
+                   << ", " << latency / 1000 << " ms after due time, "
+                   << next->second.Requests - 1 << " requests coalesced, "
+                   << pending_.size() - 1 << " tasks pending";
+                logger().debug(ss.str());
+
+                pending_.erase(next);
+                busy_ = true;
+            }
+        }
+
+        if (!task) {
+            // Round up, so that the task is due when we wake up
+            wake_.Wait(static_cast<long>((wait + 999) / 1000));  // NOLINT
+            continue;
+        }
+
+        try {
+            task->run();
+        } catch(const Poco::Exception& exc) {
+            logger().error(key + ": " + exc.displayText());
+        } catch(const std::exception& ex) {
+            logger().error(key + ": " + ex.what());
+        } catch(const std::string& ex) {
+            logger().error(key + ": " + ex);
+        }
+
+        {
+            Poco::Mutex::ScopedLock lock(mutex_);
+            busy_ = false;
+        }
+        idle_.broadcast();
+    }
+}
+
+}   // namespace toggl
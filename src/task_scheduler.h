@@ -0,0 +1,132 @@
+// Copyright 2015 Toggl Desktop developers.
+
+#ifndef SRC_TASK_SCHEDULER_H_
+#define SRC_TASK_SCHEDULER_H_
+
+#include <map>
+#include <string>
+
+#include "Poco/Activity.h"
+#include "Poco/Condition.h"
+#include "Poco/Mutex.h"
+#include "Poco/ThreadPool.h"
+#include "Poco/Timestamp.h"
+#include "Poco/Types.h"
+#include "Poco/Util/TimerTask.h"
+
+#include "./wakeup.h"
+
+namespace Poco {
+class Logger;
+}
+
+namespace toggl {
+
+// Order of tasks that are due at the same time, higher runs first
+#define kTaskPriorityLow 0
+#define kTaskPriorityNormal 1
+#define kTaskPriorityHigh 2
+#define kTaskPriorityUI 3
+
+class TaskStats {
+ public:
+    TaskStats()
+        : Requests(0)
+    , Runs(0)
+    , TotalLatencyMicros(0)
+    , MaxLatencyMicros(0) {}
+
+    // Times the task was scheduled, and times it actually ran.
+    // The difference is the number of requests coalesced.
+    Poco::UInt64 Requests;
+    Poco::UInt64 Runs;
+
+    // How late the runs started, compared to their due time
+    Poco::UInt64 TotalLatencyMicros;
+    Poco::UInt64 MaxLatencyMicros;
+};
+
+// Runs tasks one at a time on a thread of its own, like
+// Poco::Util::Timer, but keeps at most one pending task per key.
+// Scheduling a key that is already pending moves the pending task
+// to the new time instead of adding another one, so a burst of
+// requests ends up as a single run after the last of them.
+class TaskScheduler {
+ public:
+    TaskScheduler();
+    ~TaskScheduler();
+
+    void Schedule(
+        const std::string &key,
+        Poco::Util::TimerTask::Ptr task,
+        const Poco::Timestamp &at,
+        const int priority = kTaskPriorityNormal);
+
+    void Cancel(const std::string &key);
+
+    // Cancel pending tasks and wait for the running one to finish.
+    // Tasks scheduled after this run as usual.
+    void CancelAll();
+
+    // Cancel pending tasks, wait for the running one to finish
+    // and stop. Tasks scheduled after this are ignored.
+    void Shutdown();
+
+    bool IsPending(const std::string &key) const;
+
+    // Number of pending tasks
+    size_t QueueDepth() const;
+
+    TaskStats Stats(const std::string &key) const;
+
+ protected:
+    // Activity callback
+    void run();
+
+ private:
+    class Entry {
+     public:
+        Entry()
+            : Task(nullptr)
+        , At(0)
+        , Priority(kTaskPriorityNormal)
+        , Sequence(0)
+        , Requests(0) {}
+
+        Poco::Util::TimerTask::Ptr Task;
+        Poco::Timestamp At;
+        int Priority;
+
+        // Order of scheduling, for tasks due at the same time
+        Poco::UInt64 Sequence;
+
+        Poco::UInt64 Requests;
+    };
+
+    static bool runsBefore(const Entry &a, const Entry &b);
+
+    Poco::Logger &logger() const;
+
+    mutable Poco::Mutex mutex_;
+
+    std::map<std::string, Entry> pending_;
+    std::map<std::string, TaskStats> stats_;
+    Poco::UInt64 sequence_;
+    bool shutdown_;
+
+    // Set while a task runs, and signalled when it is done
+    bool busy_;
+    Poco::Condition idle_;
+
+    // Set when tasks are added or removed
+    Wakeup wake_;
+
+    // The activity runs on a pool of its own, so that stopping
+    // the default pool does not stop the scheduler
+    Poco::ThreadPool pool_;
+    Poco::Activity<TaskScheduler> running_;
+};
+
+}  // namespace toggl
+
+#endif  // SRC_TASK_SCHEDULER_H_
@@ -2,29 +2,70 @@
 
 #include "gtest/gtest.h"
 
+#include <algorithm>
 #include <iostream>  // NOLINT
 
+#if defined(__linux__)
+#include <malloc.h>
+#endif
+
+#include "./../autocomplete_index.h"
 #include "./../autotracker.h"
 #include "./../client.h"
+#include "./../command_queue.h"
 #include "./../const.h"
 #include "./../database.h"
 #include "./../formatter.h"
+#include "./../https_client.h"
+#include "./../json_stream_reader.h"
+#include "./../json_writer.h"
+#include "./../model_lock.h"
+#include "./../model_pool.h"
 #include "./../project.h"
 #include "./../proxy.h"
+#include "./../string_pool.h"
 #include "./../tag.h"
+#include "./../task_scheduler.h"
 #include "./../task.h"
 #include "./../time_entry.h"
+#include "./../time_entry_list.h"
+#include "./../timeline_chunk_accumulator.h"
 #include "./../timeline_event.h"
 #include "./../timeline_uploader.h"
+#include "./../urls.h"
 #include "./../user.h"
+#include "./../view_snapshot.h"
+#include "./../wakeup.h"
 #include "./../workspace.h"
 
 #include "./test_data.h"
 
+#include "Poco/Data/Binding.h"
+#include "Poco/Data/Extraction.h"
+#include "Poco/Data/RecordSet.h"
+#include "Poco/Data/Session.h"
+#include "Poco/DeflatingStream.h"
+#include "Poco/Event.h"
 #include "Poco/File.h"
 #include "Poco/FileStream.h"
+#include "Poco/InflatingStream.h"
 #include "Poco/Logger.h"
 #include "Poco/LocalDateTime.h"
+#include "Poco/Net/Context.h"
+#include "Poco/Net/DatagramSocket.h"
+#include "Poco/Net/HTTPRequestHandler.h"
+#include "Poco/Net/HTTPRequestHandlerFactory.h"
+#include "Poco/Net/HTTPServer.h"
+#include "Poco/Net/HTTPServerParams.h"
+#include "Poco/Net/HTTPServerRequest.h"
+#include "Poco/Net/HTTPServerResponse.h"
+#include "Poco/Net/SecureServerSocket.h"
+#include "Poco/NullStream.h"
+#include "Poco/NumberParser.h"
+#include "Poco/Stopwatch.h"
+#include "Poco/StreamCopier.h"
+#include "Poco/String.h"
+#include "Poco/Thread.h"
 
 namespace toggl {
 
@@ -47,6 +88,15 @@ class Database {
         return db_;
     }
 
+    // Load user with older time entries paged in, too
+    error LoadUserWithAllTimeEntries(const Poco::UInt64 UID, User *user) {
+        error err = db_->LoadUserByID(UID, user);
+        while (noError == err && user->related.ResidentTimeEntriesSince) {
+            err = db_->LoadMoreTimeEntries(user, kTimeEntryPageDays);
+        }
+        return err;
+    }
+
  private:
     toggl::Database *db_;
 };
@@ -192,6 +242,466 @@ TEST(Database, CreateCompressedTimelineBatchForUpload) {
     ASSERT_EQ(std::size_t(0), left_for_upload.size());
 }
 
+namespace testing {
+
+// Default SQLite VFS while it exists, counting the syncs
+// of the files it opens. Everything else is done by the
+// VFS it replaces.
+class SyncCountingVFS {
+ public:
+    SyncCountingVFS() {
+        real_ = sqlite3_vfs_find(nullptr);
+        vfs_ = *real_;
+        vfs_.pNext = nullptr;
+        vfs_.zName = "sync_counting";
+        vfs_.szOsFile = sizeof(File) + real_->szOsFile;
+        vfs_.xOpen = open;
+        syncs_ = 0;
+        sqlite3_vfs_register(&vfs_, 1);
+    }
+    ~SyncCountingVFS() {
+        sqlite3_vfs_unregister(&vfs_);
+        sqlite3_vfs_register(real_, 1);
+    }
+
+    int Syncs() const {
+        return syncs_;
+    }
+    void ResetSyncs() {
+        syncs_ = 0;
+    }
+
+ private:
+    struct File {
+        sqlite3_file base;
+        sqlite3_file *real;
+    };
+
+    static sqlite3_file *real(sqlite3_file *file) {
+        return reinterpret_cast<File *>(file)->real;
+    }
+
+    static int open(sqlite3_vfs *vfs, const char *name, sqlite3_file *file,
+                    int flags, int *out_flags) {
+        File *f = reinterpret_cast<File *>(file);
+        f->base.pMethods = nullptr;
+        f->real = reinterpret_cast<sqlite3_file *>(f + 1);
+        int rc = real_->xOpen(real_, name, f->real, flags, out_flags);
+        if (SQLITE_OK == rc && f->real->pMethods) {
+            f->base.pMethods = &methods_;
+        }
+        return rc;
+    }
+
+    static int close(sqlite3_file *f) {
+        return real(f)->pMethods->xClose(real(f));
+    }
+    static int read(sqlite3_file *f, void *p, int n, sqlite3_int64 o) {
+        return real(f)->pMethods->xRead(real(f), p, n, o);
+    }
+    static int write(sqlite3_file *f, const void *p, int n,
+                     sqlite3_int64 o) {
+        return real(f)->pMethods->xWrite(real(f), p, n, o);
+    }
+    static int truncate(sqlite3_file *f, sqlite3_int64 size) {
+        return real(f)->pMethods->xTruncate(real(f), size);
+    }
+    static int sync(sqlite3_file *f, int flags) {
+        syncs_++;
+        return real(f)->pMethods->xSync(real(f), flags);
+    }
+    static int fileSize(sqlite3_file *f, sqlite3_int64 *size) {
+        return real(f)->pMethods->xFileSize(real(f), size);
+    }
+    static int lock(sqlite3_file *f, int level) {
+        return real(f)->pMethods->xLock(real(f), level);
+    }
+    static int unlock(sqlite3_file *f, int level) {
+        return real(f)->pMethods->xUnlock(real(f), level);
+    }
+    static int checkReservedLock(sqlite3_file *f, int *out) {
+        return real(f)->pMethods->xCheckReservedLock(real(f), out);
+    }
+    static int fileControl(sqlite3_file *f, int op, void *arg) {
+        return real(f)->pMethods->xFileControl(real(f), op, arg);
+    }
+    static int sectorSize(sqlite3_file *f) {
+        return real(f)->pMethods->xSectorSize(real(f));
+    }
+    static int deviceCharacteristics(sqlite3_file *f) {
+        return real(f)->pMethods->xDeviceCharacteristics(real(f));
+    }
+    static int shmMap(sqlite3_file *f, int page, int size, int extend,
+                      void volatile **p) {
+        return real(f)->pMethods->xShmMap(real(f), page, size, extend, p);
+    }
+    static int shmLock(sqlite3_file *f, int offset, int n, int flags) {
+        return real(f)->pMethods->xShmLock(real(f), offset, n, flags);
+    }
+    static void shmBarrier(sqlite3_file *f) {
+        real(f)->pMethods->xShmBarrier(real(f));
+    }
+    static int shmUnmap(sqlite3_file *f, int delete_flag) {
+        return real(f)->pMethods->xShmUnmap(real(f), delete_flag);
+    }
+    static int fetch(sqlite3_file *f, sqlite3_int64 o, int n, void **p) {
+        return real(f)->pMethods->xFetch(real(f), o, n, p);
+    }
+    static int unfetch(sqlite3_file *f, sqlite3_int64 o, void *p) {
+        return real(f)->pMethods->xUnfetch(real(f), o, p);
+    }
+
+    static sqlite3_vfs *real_;
+    static sqlite3_vfs vfs_;
+    static const sqlite3_io_methods methods_;
+    static int syncs_;
+};
+
+sqlite3_vfs *SyncCountingVFS::real_ = nullptr;
+sqlite3_vfs SyncCountingVFS::vfs_;
+int SyncCountingVFS::syncs_ = 0;
+const sqlite3_io_methods SyncCountingVFS::methods_ = {
+    3,
+    SyncCountingVFS::close,
+    SyncCountingVFS::read,
+    SyncCountingVFS::write,
+    SyncCountingVFS::truncate,
+    SyncCountingVFS::sync,
+    SyncCountingVFS::fileSize,
+    SyncCountingVFS::lock,
+    SyncCountingVFS::unlock,
+    SyncCountingVFS::checkReservedLock,
+    SyncCountingVFS::fileControl,
+    SyncCountingVFS::sectorSize,
+    SyncCountingVFS::deviceCharacteristics,
+    SyncCountingVFS::shmMap,
+    SyncCountingVFS::shmLock,
+    SyncCountingVFS::shmBarrier,
+    SyncCountingVFS::shmUnmap,
+    SyncCountingVFS::fetch,
+    SyncCountingVFS::unfetch
+};
+
+#define kTimelineBenchmarkEvents 1000000
+#define kTimelineBenchmarkApps 10
+#define kTimelineBenchmarkTitles 50
+
+// Compresses given number of raw timeline events, recording
+// time taken and syncs made as test properties.
+void compressTimeline(const Poco::Int64 event_count) {
+    SyncCountingVFS vfs;
+    Database db;
+
+    const Poco::UInt64 user_id = 123;
+
+    // Window changes every half a second, over the six days
+    // before the current chunk
+    time_t chunk_up_to =
+        (time(0) / kTimelineChunkSeconds) * kTimelineChunkSeconds;
+    Poco::Int64 first_start(chunk_up_to - event_count / 2);
+
+    Poco::Data::Session session("SQLite", TESTDB);
+    Poco::Int64 events(event_count);
+    Poco::Int64 titles(kTimelineBenchmarkTitles);
+    Poco::Int64 apps(kTimelineBenchmarkApps);
+    session << "insert into timeline_events("
+            "user_id, title, filename, start_time, end_time, idle, "
+            "chunked, uploaded) "
+            "with recursive n(i) as ("
+            " select 0 union all select i + 1 from n where i + 1 < :events) "
+            "select :user_id, 'Window ' || (i % :titles), "
+            "'app' || (i % :apps) || '.exe', "
+            ":first_start + i / 2, :first_start + i / 2 + 1, 0, 0, 0 "
+            "from n",
+            Poco::Data::Keywords::useRef(events),
+            Poco::Data::Keywords::useRef(user_id),
+            Poco::Data::Keywords::useRef(titles),
+            Poco::Data::Keywords::useRef(apps),
+            Poco::Data::Keywords::useRef(first_start),
+            Poco::Data::Keywords::useRef(first_start),
+            Poco::Data::Keywords::now;
+
+    vfs.ResetSyncs();
+    Poco::Stopwatch stopwatch;
+    stopwatch.start();
+    std::vector<TimelineEvent> timeline_events;
+    ASSERT_EQ(noError, db.instance()->CreateCompressedTimelineBatchForUpload(
+        user_id, &timeline_events));
+    stopwatch.stop();
+    int syncs = vfs.Syncs();
+
+    ASSERT_EQ(size_t(100), timeline_events.size());
+
+    Poco::Int64 raw(0), chunks(0), duration(0);
+    session << "select count(*) from timeline_events where not chunked",
+            Poco::Data::Keywords::into(raw),
+            Poco::Data::Keywords::now;
+    session << "select count(*), sum(end_time - start_time) "
+            "from timeline_events where chunked",
+            Poco::Data::Keywords::into(chunks),
+            Poco::Data::Keywords::into(duration),
+            Poco::Data::Keywords::now;
+    ASSERT_EQ(0, raw);
+    ASSERT_EQ(event_count, duration);
+
+    // Every app and title pair in every chunk
+    Poco::Int64 chunk_count(
+        (chunk_up_to - first_start + kTimelineChunkSeconds - 1)
+        / kTimelineChunkSeconds);
+    ASSERT_GE(chunks, (chunk_count - 1) * kTimelineBenchmarkTitles);
+    ASSERT_LE(chunks, chunk_count * kTimelineBenchmarkTitles);
+
+    // Pass is committed at once, not per chunk
+    ASSERT_LE(syncs, 10);
+
+    ::testing::Test::RecordProperty("chunks", static_cast<int>(chunks));
+    ::testing::Test::RecordProperty("elapsed_us",
+                                    static_cast<int>(stopwatch.elapsed()));
+    ::testing::Test::RecordProperty("syncs", syncs);
+}
+
+}  // namespace testing
+
+TEST(Database, CompressesTimelineInOneCommit) {
+    testing::compressTimeline(20000);
+}
+
+TEST(Database, DISABLED_TimelineCompressionBenchmark) {
+    testing::compressTimeline(kTimelineBenchmarkEvents);
+}
+
+namespace testing {
+
+// Steps of the query plan of given SQL, one per line
+std::string queryPlan(Poco::Data::Session *session, const std::string sql) {
+    Poco::Data::Statement select(*session);
+    select << "EXPLAIN QUERY PLAN " + sql;
+    select.execute();
+    Poco::Data::RecordSet rs(select);
+    std::stringstream plan;
+    for (bool more = rs.moveFirst(); more; more = rs.moveNext()) {
+        plan << rs[rs.columnCount() - 1].convert<std::string>() << "\n";
+    }
+    return plan.str();
+}
+
+}  // namespace testing
+
+TEST(Database, TimelineAndTimeEntryQueriesUseIndexes) {
+    testing::Database db;
+    Poco::Data::Session session("SQLite", TESTDB);
+
+    const std::string queries[][2] = {
+        // deleteTooOldTimeline
+        {   "DELETE FROM timeline_events "
+            "WHERE user_id = 1 AND start_time < 2",
+            "id_timeline_events_start_time"
+        },
+        // deleteUserTimeline
+        {   "DELETE FROM timeline_events WHERE user_id = 1",
+            "id_timeline_events_start_time"
+        },
+        // compressTimeline
+        {   "SELECT user_id, title, filename, MIN(start_time), "
+            "MIN(start_time) + SUM(MAX(end_time - start_time, 0)), idle "
+            "FROM timeline_events "
+            "WHERE user_id = 1 AND start_time < 2 "
+            "AND NOT uploaded AND NOT chunked "
+            "GROUP BY filename, title, idle, start_time / 900",
+            "id_timeline_events_raw"
+        },
+        {   "DELETE FROM timeline_events "
+            "WHERE user_id = 1 AND start_time < 2 "
+            "AND NOT uploaded AND NOT chunked",
+            "id_timeline_events_raw"
+        },
+        // selectCompressedTimelineBatchForUpload
+        {   "SELECT id, title, filename, start_time, end_time, idle, "
+            "chunked, uploaded FROM timeline_events "
+            "WHERE user_id = 1 AND NOT uploaded AND chunked LIMIT 100",
+            "id_timeline_events_upload"
+        },
+        // loadTimeEntries
+        {   "SELECT local_id FROM time_entries "
+            "WHERE uid = 1 AND start >= 2 ORDER BY start DESC",
+            "id_time_entries_start"
+        },
+        {   "SELECT local_id FROM time_entries "
+            "WHERE uid = 1 AND start < 2 "
+            "AND (id IS NULL OR ui_modified_at > 0 "
+            "OR deleted_at > 0 OR duration < 0)",
+            "id_time_entries_unsynced"
+        },
+        // LoadMoreTimeEntries
+        {   "SELECT local_id FROM time_entries "
+            "WHERE uid = 1 AND start >= 2 AND start < 3 "
+            "ORDER BY start DESC",
+            "id_time_entries_start"
+        },
+        // deleteAllFromTableByUID
+        {   "DELETE FROM time_entries WHERE uid = 1",
+            "id_time_entries"
+        }
+    };
+
+    for (size_t i = 0; i < sizeof(queries) / sizeof(queries[0]); i++) {
+        std::string plan = testing::queryPlan(&session, queries[i][0]);
+        ASSERT_EQ(std::string::npos, plan.find("SCAN ")) <<
+                queries[i][0] << "\n" << plan;
+        ASSERT_EQ(std::string::npos, plan.find("FOR ORDER BY")) <<
+                queries[i][0] << "\n" << plan;
+        ASSERT_NE(std::string::npos, plan.find(queries[i][1])) <<
+                queries[i][0] << "\n" << plan;
+    }
+}
+
+#define kTimelineIndexBenchmarkEvents 2000000
+#define kTimelineIndexBenchmarkRawEvents 10000
+
+namespace testing {
+
+// Timeline of a week: uploaded chunks and, in the last
+// hours before current chunk, raw events.
+void insertBenchmarkTimeline(
+    Poco::Data::Session *session,
+    const Poco::UInt64 user_id,
+    const bool raw_only) {
+    Poco::Int64 chunk_up_to(
+        (time(0) / kTimelineChunkSeconds) * kTimelineChunkSeconds);
+    Poco::Int64 week_ago(chunk_up_to - kTimelineSecondsToKeep + 3600);
+    Poco::Int64 chunks(kTimelineIndexBenchmarkEvents);
+    Poco::Int64 raw(kTimelineIndexBenchmarkRawEvents);
+    Poco::Int64 chunk_step(
+        (chunk_up_to - week_ago) / kTimelineIndexBenchmarkEvents);
+
+    if (!raw_only) {
+        *session << "insert into timeline_events("
+                 "user_id, title, filename, start_time, end_time, idle, "
+                 "chunked, uploaded) "
+                 "with recursive n(i) as ("
+                 " select 0 union all select i + 1 from n where i + 1 < :n) "
+                 "select :user_id, 'Window ' || (i % 50), "
+                 "'app' || (i % 10) || '.exe', "
+                 ":start + i * :step, :start + i * :step + 1, 0, 1, 1 "
+                 "from n",
+                 Poco::Data::Keywords::useRef(chunks),
+                 Poco::Data::Keywords::useRef(user_id),
+                 Poco::Data::Keywords::useRef(week_ago),
+                 Poco::Data::Keywords::useRef(chunk_step),
+                 Poco::Data::Keywords::useRef(week_ago),
+                 Poco::Data::Keywords::useRef(chunk_step),
+                 Poco::Data::Keywords::now;
+    }
+
+    Poco::Int64 raw_start(chunk_up_to - raw);
+    *session << "insert into timeline_events("
+             "user_id, title, filename, start_time, end_time, idle, "
+             "chunked, uploaded) "
+             "with recursive n(i) as ("
+             " select 0 union all select i + 1 from n where i + 1 < :n) "
+             "select :user_id, 'Window ' || (i % 50), "
+             "'app' || (i % 10) || '.exe', "
+             ":start + i, :start + i + 1, 0, 0, 0 "
+             "from n",
+             Poco::Data::Keywords::useRef(raw),
+             Poco::Data::Keywords::useRef(user_id),
+             Poco::Data::Keywords::useRef(raw_start),
+             Poco::Data::Keywords::useRef(raw_start),
+             Poco::Data::Keywords::now;
+}
+
+}  // namespace testing
+
+TEST(Database, DISABLED_TimelineIndexBenchmark) {
+    testing::Database db;
+    Poco::Data::Session session("SQLite", TESTDB);
+
+    const Poco::UInt64 user_id = 123;
+
+    testing::insertBenchmarkTimeline(&session, user_id, false);
+
+    Poco::Stopwatch indexed;
+    indexed.start();
+    std::vector<TimelineEvent> timeline_events;
+    ASSERT_EQ(noError, db.instance()->CreateCompressedTimelineBatchForUpload(
+        user_id, &timeline_events));
+    indexed.stop();
+    ASSERT_EQ(size_t(100), timeline_events.size());
+
+    session << "drop index id_timeline_events_start_time",
+            Poco::Data::Keywords::now;
+    session << "drop index id_timeline_events_raw",
+            Poco::Data::Keywords::now;
+    session << "drop index id_timeline_events_upload",
+            Poco::Data::Keywords::now;
+    testing::insertBenchmarkTimeline(&session, user_id, true);
+
+    Poco::Stopwatch unindexed;
+    unindexed.start();
+    timeline_events.clear();
+    ASSERT_EQ(noError, db.instance()->CreateCompressedTimelineBatchForUpload(
+        user_id, &timeline_events));
+    unindexed.stop();
+    ASSERT_EQ(size_t(100), timeline_events.size());
+
+    RecordProperty("indexed_us", static_cast<int>(indexed.elapsed()));
+    RecordProperty("unindexed_us", static_cast<int>(unindexed.elapsed()));
+}
+
+TEST(TimelineChunkAccumulator, MergesEventsIntoChunks) {
+    TimelineChunkAccumulator chunks;
+
+    const time_t chunk_start = 1420113600;
+
+    TimelineEvent event;
+    event.filename = "Notepad.exe";
+    event.title = "untitled";
+    event.start_time = chunk_start + 10;
+    event.end_time = event.start_time + 30;
+    chunks.Add(event);
+
+    event.start_time = event.end_time + 60;
+    event.end_time = event.start_time + 20;
+    chunks.Add(event);
+
+    event.title = "notes";
+    chunks.Add(event);
+
+    // Same window, next chunk
+    event.title = "untitled";
+    event.start_time = chunk_start + kTimelineChunkSeconds + 5;
+    event.end_time = event.start_time + 40;
+    chunks.Add(event);
+
+    ASSERT_EQ(size_t(3), chunks.Size());
+
+    // First chunk is not complete while events can still start in it
+    std::vector<TimelineEvent> completed;
+    chunks.TakeCompleted(chunk_start + kTimelineChunkSeconds - 1,
+                         &completed);
+    ASSERT_EQ(size_t(0), completed.size());
+
+    chunks.TakeCompleted(chunk_start + kTimelineChunkSeconds, &completed);
+    ASSERT_EQ(size_t(2), completed.size());
+    ASSERT_EQ(size_t(1), chunks.Size());
+
+    TimelineEvent untitled = completed[1];
+    ASSERT_EQ("untitled", untitled.title);
+    ASSERT_TRUE(untitled.chunked);
+    ASSERT_EQ(chunk_start + 10, untitled.start_time);
+    ASSERT_EQ(untitled.start_time + 50, untitled.end_time);
+    ASSERT_EQ("notes", completed[0].title);
+    ASSERT_EQ(20, completed[0].end_time - completed[0].start_time);
+
+    // Incomplete chunk is left as raw event
+    std::vector<TimelineEvent> rest;
+    chunks.TakeAll(&rest);
+    ASSERT_EQ(size_t(1), rest.size());
+    ASSERT_FALSE(rest[0].chunked);
+    ASSERT_EQ(40, rest[0].end_time - rest[0].start_time);
+    ASSERT_EQ(size_t(0), chunks.Size());
+}
+
 TEST(Database, SaveAndLoadCurrentAPIToken) {
     testing::Database db;
     std::string api_token("");
@@ -486,7 +996,7 @@ TEST(Database,
     ASSERT_EQ(Poco::UInt64(5), n);
 
     User user2;
-    ASSERT_EQ(noError, db.instance()->LoadUserByID(user1.ID(), &user2));
+    ASSERT_EQ(noError, db.LoadUserWithAllTimeEntries(user1.ID(), &user2));
 
     ASSERT_EQ(user1.related.Workspaces.size(),
               user2.related.Workspaces.size());
@@ -680,7 +1190,7 @@ TEST(User, ParsesAndSavesData) {
     ASSERT_EQ(6356, user.related.TimeEntries[0]->DurationInSeconds());
     ASSERT_EQ("Important things",
               user.related.TimeEntries[0]->Description());
-    ASSERT_EQ(uint(0), user.related.TimeEntries[0]->TagNames.size());
+    ASSERT_EQ(uint(0), user.related.TimeEntries[0]->TagNames().size());
     ASSERT_FALSE(user.related.TimeEntries[0]->DurOnly());
     ASSERT_EQ(user.ID(), user.related.TimeEntries[0]->UID());
 
@@ -778,7 +1288,7 @@ TEST(User, ParsesAndSavesData) {
 
     // Select
     User user2;
-    ASSERT_EQ(noError, db.instance()->LoadUserByID(user.ID(), &user2));
+    ASSERT_EQ(noError, db.LoadUserWithAllTimeEntries(user.ID(), &user2));
 
     ASSERT_TRUE(user2.ID());
     ASSERT_EQ(user.ID(), user2.ID());
@@ -1188,477 +1698,2725 @@ TEST(User, Continue) {
     ASSERT_EQ(count+1, user.related.TimeEntries.size());
 }
 
-TEST(TimeEntry, SetDurationOnRunningTimeEntryWithDurOnlySetting) {
-    testing::Database db;
-
-    std::string json = loadTestDataFile("../testdata/user_with_duronly.json");
+TEST(RelatedData, FindsModelsByKeysAssignedAfterAdding) {
+    RelatedData related;
 
-    User user;
-    ASSERT_EQ(noError,
-              user.LoadUserAndRelatedDataFromJSONString(json, true));
+    TimeEntry *te = new TimeEntry();
+    related.Add(te);
+    ASSERT_FALSE(related.TimeEntryByID(123));
+    ASSERT_FALSE(related.TimeEntryByGUID("abc"));
 
-    TimeEntry *te = user.related.TimeEntryByID(164891639);
-    ASSERT_TRUE(te);
-    ASSERT_TRUE(te->IsTracking());
-    ASSERT_LT(te->Start(), te->Stop());
+    te->SetID(123);
+    te->SetGUID("abc");
+    ASSERT_EQ(te, related.TimeEntryByID(123));
+    ASSERT_EQ(te, related.TimeEntryByGUID("abc"));
 
-    te->SetDurationUserInput("00:59:47");
-    ASSERT_TRUE(te->IsTracking());
-    ASSERT_LT(te->Start(), te->Stop());
+    te->SetID(456);
+    te->SetGUID("def");
+    ASSERT_FALSE(related.TimeEntryByID(123));
+    ASSERT_FALSE(related.TimeEntryByGUID("abc"));
+    ASSERT_EQ(te, related.TimeEntryByID(456));
+    ASSERT_EQ(te, related.TimeEntryByGUID("def"));
 
-    te->StopTracking();
-    ASSERT_FALSE(te->IsTracking());
-    ASSERT_LT(te->Start(), te->Stop());
+    related.Clear();
 }
 
-TEST(Formatter, CollectErrors) {
-    {
-        std::vector<error> errors;
-        errors.push_back(error("foo"));
-        errors.push_back(error("bar"));
-        errors.push_back(error("foo"));
-        error err = Formatter::CollectErrors(&errors);
-        ASSERT_EQ("Errors encountered while syncing data: foo bar", err);
-    }
+TEST(RelatedData, FindsModelsAddedDirectlyToLists) {
+    RelatedData related;
 
-    {
-        std::vector<error> errors;
-        errors.push_back(error("foo\n"));
-        errors.push_back(error("bar\n"));
-        errors.push_back(error("foo\n"));
-        error err = Formatter::CollectErrors(&errors);
-        ASSERT_EQ("Errors encountered while syncing data: foo. bar.", err);
-    }
-}
+    Project *p = new Project();
+    p->SetID(1);
+    p->SetGUID("project-guid");
+    related.Projects.push_back(p);
 
-TEST(Formatter, ParseTimeInput) {
-    int hours = 0;
-    int minutes = 0;
+    ASSERT_EQ(p, related.ProjectByID(1));
+    ASSERT_EQ(p, related.ProjectByGUID("project-guid"));
 
-    ASSERT_FALSE(Formatter::ParseTimeInput("", &hours, &minutes));
-    ASSERT_EQ(0, hours);
-    ASSERT_EQ(0, minutes);
+    AutotrackerRule *rule = new AutotrackerRule();
+    rule->SetLocalID(7);
+    related.AutotrackerRules.push_back(rule);
+    ASSERT_EQ(rule, related.AutotrackerRuleByLocalID(7));
 
-    ASSERT_TRUE(Formatter::ParseTimeInput("120a", &hours, &minutes));
-    ASSERT_EQ(1, hours);
-    ASSERT_EQ(20, minutes);
+    related.Clear();
+}
 
-    ASSERT_TRUE(Formatter::ParseTimeInput("120a", &hours, &minutes));
-    ASSERT_EQ(1, hours);
-    ASSERT_EQ(20, minutes);
+TEST(RelatedData, FindsModelsReplacedDirectlyInLists) {
+    RelatedData related;
 
-    ASSERT_TRUE(Formatter::ParseTimeInput("1P", &hours, &minutes));
-    ASSERT_EQ(13, hours);
-    ASSERT_EQ(0, minutes);
+    Tag *old_tag = new Tag();
+    old_tag->SetID(1);
+    related.Add(old_tag);
+    ASSERT_EQ(old_tag, related.TagByID(1));
 
-    ASSERT_FALSE(Formatter::ParseTimeInput("x", &hours, &minutes));
+    // Replace the model without changing the list size
+    Tag *new_tag = new Tag();
+    new_tag->SetID(2);
+    related.Tags.erase(related.Tags.begin());
+    related.Tags.push_back(new_tag);
+    delete old_tag;
 
-    ASSERT_TRUE(Formatter::ParseTimeInput("2", &hours, &minutes));
-    ASSERT_EQ(2, hours);
-    ASSERT_EQ(0, minutes);
+    ASSERT_EQ(size_t(1), related.Tags.size());
+    ASSERT_FALSE(related.TagByID(1));
+    ASSERT_EQ(new_tag, related.TagByID(2));
 
-    ASSERT_TRUE(Formatter::ParseTimeInput("12", &hours, &minutes));
-    ASSERT_EQ(12, hours);
-    ASSERT_EQ(0, minutes);
+    related.Clear();
+}
 
-    ASSERT_TRUE(Formatter::ParseTimeInput("1230", &hours, &minutes));
-    ASSERT_EQ(12, hours);
-    ASSERT_EQ(30, minutes);
+TEST(RelatedData, ForgetsPurgedAndDeletedModels) {
+    RelatedData related;
 
-    ASSERT_FALSE(Formatter::ParseTimeInput("12x", &hours, &minutes));
+    Client *c = new Client();
+    c->SetID(1);
+    related.Add(c);
 
-    ASSERT_FALSE(Formatter::ParseTimeInput("12xx", &hours, &minutes));
+    Client *deleted = new Client();
+    deleted->SetID(2);
+    related.Add(deleted);
 
-    ASSERT_FALSE(Formatter::ParseTimeInput(":", &hours, &minutes));
+    deleted->MarkAsDeletedOnServer();
+    related.PurgeDeletedModels();
+    ASSERT_EQ(c, related.ClientByID(1));
+    ASSERT_FALSE(related.ClientByID(2));
+    ASSERT_EQ(size_t(1), related.Clients.size());
 
-    ASSERT_FALSE(Formatter::ParseTimeInput("11:", &hours, &minutes));
+    // A purged model is no longer indexed
+    deleted->SetID(1);
+    ASSERT_EQ(c, related.ClientByID(1));
+    delete deleted;
 
-    ASSERT_FALSE(Formatter::ParseTimeInput(":20", &hours, &minutes));
+    related.Clear();
+    ASSERT_FALSE(related.ClientByID(1));
+}
 
-    ASSERT_FALSE(Formatter::ParseTimeInput("11:xx", &hours, &minutes));
+TEST(RelatedData, KeepsIndexesWhenLoadingAndSaving) {
+    testing::Database db;
 
-    ASSERT_TRUE(Formatter::ParseTimeInput("11:20", &hours, &minutes));
-    ASSERT_EQ(11, hours);
-    ASSERT_EQ(20, minutes);
+    User user;
+    ASSERT_EQ(noError,
+              user.LoadUserAndRelatedDataFromJSONString(loadTestData(), true));
 
-    ASSERT_TRUE(Formatter::ParseTimeInput("5:30", &hours, &minutes));
-    ASSERT_EQ(5, hours);
-    ASSERT_EQ(30, minutes);
+    TimeEntry *te = user.related.TimeEntryByID(89818605);
+    ASSERT_TRUE(te);
+    ASSERT_EQ(te, user.related.TimeEntryByGUID(te->GUID()));
 
-    ASSERT_TRUE(Formatter::ParseTimeInput("5:30 PM", &hours, &minutes));
-    ASSERT_EQ(17, hours);
-    ASSERT_EQ(30, minutes);
+    std::vector<ModelChange> changes;
+    ASSERT_EQ(noError, db.instance()->SaveUser(&user, true, &changes));
+    ASSERT_EQ(te, user.related.TimeEntryByID(89818605));
 
-    ASSERT_TRUE(Formatter::ParseTimeInput("5:30 odp.", &hours, &minutes));
-    ASSERT_EQ(17, hours);
-    ASSERT_EQ(30, minutes);
+    te->MarkAsDeletedOnServer();
+    ASSERT_EQ(noError, db.instance()->SaveUser(&user, true, &changes));
+    ASSERT_FALSE(user.related.TimeEntryByID(89818605));
+}
 
-    ASSERT_TRUE(Formatter::ParseTimeInput("17:10", &hours, &minutes));
-    ASSERT_EQ(17, hours);
-    ASSERT_EQ(10, minutes);
+TEST(RelatedData, JournalsChangedModelsUntilSaved) {
+    testing::Database db;
 
-    ASSERT_TRUE(Formatter::ParseTimeInput("12:00 AM", &hours, &minutes));
-    ASSERT_EQ(0, hours);
-    ASSERT_EQ(0, minutes);
+    User user;
+    ASSERT_EQ(noError,
+              user.LoadUserAndRelatedDataFromJSONString(loadTestData(), true));
 
-    ASSERT_TRUE(Formatter::ParseTimeInput("12:00 dop.", &hours, &minutes));
-    ASSERT_EQ(0, hours);
-    ASSERT_EQ(0, minutes);
+    // Everything is new before the first save
+    std::vector<TimeEntry *> dirty;
+    user.related.DirtyModels(&dirty);
+    ASSERT_EQ(user.related.TimeEntries.size(), dirty.size());
 
-    ASSERT_FALSE(Formatter::ParseTimeInput("NOT VALID", &hours, &minutes));
-}
+    std::vector<ModelChange> changes;
+    ASSERT_EQ(noError, db.instance()->SaveUser(&user, true, &changes));
 
-TEST(Formatter, FormatTimeForTimeEntryEditor) {
-    ASSERT_EQ("", Formatter::FormatTimeForTimeEntryEditor(0));
+    dirty.clear();
+    user.related.DirtyModels(&dirty);
+    ASSERT_TRUE(dirty.empty());
 
-    //  date -r 1412950844
-    //  Fri Oct 10 16:20:44 CEST 2014
-    time_t t(1412950844);
+    // A save after a single change writes that model only
+    TimeEntry *te = user.related.TimeEntryByID(89818605);
+    ASSERT_TRUE(te);
+    te->SetDescription("Changed");
 
-    std::string res = Formatter::FormatTimeForTimeEntryEditor(t);
-    ASSERT_NE(std::string::npos, res.find(":20"));
+    std::vector<Project *> dirty_projects;
+    user.related.DirtyModels(&dirty_projects);
+    ASSERT_TRUE(dirty_projects.empty());
 
-    res = Formatter::FormatTimeForTimeEntryEditor(t);
-    ASSERT_NE(std::string::npos, res.find(":20"));
+    dirty.clear();
+    user.related.DirtyModels(&dirty);
+    ASSERT_EQ(size_t(1), dirty.size());
+    ASSERT_EQ(te, dirty[0]);
+
+    changes.clear();
+    ASSERT_EQ(noError, db.instance()->SaveUser(&user, true, &changes));
+    ASSERT_EQ(size_t(1), changes.size());
+    ASSERT_EQ(te->GUID(), changes[0].GUID());
+
+    dirty.clear();
+    user.related.DirtyModels(&dirty);
+    ASSERT_TRUE(dirty.empty());
+
+    // Changes are persisted
+    User loaded;
+    ASSERT_EQ(noError, db.LoadUserWithAllTimeEntries(user.ID(), &loaded));
+    TimeEntry *saved = loaded.related.TimeEntryByID(89818605);
+    ASSERT_TRUE(saved);
+    ASSERT_EQ("Changed", saved->Description());
 }
 
-TEST(Formatter, FormatDateHeader) {
-    ASSERT_EQ("", Formatter::FormatDateHeader(0));
+// Imports an account with given number of time entries,
+// recording time taken as a test property.
+void importAccount(const size_t time_entry_count) {
+    testing::Database db;
 
-    //  date -r 1412120844
-    //  Wed Oct  1 01:47:24 CEST 2014
-    time_t t(1412120844);
-    std::string res = Formatter::FormatDateHeader(t);
-    ASSERT_TRUE("Wed, 01 Oct" == res || "Tue, 30 Sep" == res);
+    std::stringstream json;
+    json << "{\"since\":1412220389,\"data\":{\"id\":10471231,"
+         << "\"api_token\":\"30eb0ae954b536d2f6628f7fec47beb6\","
+         << "\"default_wid\":123456789,\"email\":\"bulk@toggl.com\","
+         << "\"workspaces\":[{\"id\":123456789,\"name\":\"Bulk\"}],"
+         << "\"time_entries\":[";
+    for (size_t i = 0; i < time_entry_count; i++) {
+        if (i) {
+            json << ",";
+        }
+        json << "{\"id\":" << i + 1
+             << ",\"guid\":\"07fba193-91c4-0ec8-2894-" << 100000000000 + i
+             << "\",\"wid\":123456789,\"billable\":false"
+             << ",\"start\":\"2015-01-01T12:00:00+00:00\""
+             << ",\"stop\":\"2015-01-01T12:01:00+00:00\""
+             << ",\"duration\":60,\"description\":\"Entry " << i
+             << "\",\"tags\":[\"alfa\"]"
+             << ",\"at\":\"2015-01-01T12:01:00+00:00\"}";
+    }
+    json << "]}}";
 
-    t = time(0);
-    ASSERT_EQ("Today", Formatter::FormatDateHeader(t));
+    User user;
+    Poco::Stopwatch stopwatch;
+    stopwatch.start();
+    ASSERT_EQ(noError,
+              user.LoadUserAndRelatedDataFromJSONString(json.str(), true));
+    ASSERT_EQ(time_entry_count, user.related.TimeEntries.size());
 
-    t = t - 86400;
-    ASSERT_EQ("Yesterday", Formatter::FormatDateHeader(t));
-}
+    std::vector<ModelChange> changes;
+    ASSERT_EQ(noError, db.instance()->SaveUser(&user, true, &changes));
+    stopwatch.stop();
 
-TEST(Formatter, Format8601) {
-    ASSERT_EQ("null", Formatter::Format8601(0));
+    ::testing::Test::RecordProperty("import_us",
+                                    static_cast<int>(stopwatch.elapsed()));
 
-    //  date -r 1412220844
-    //  Thu Oct  2 05:34:04 CEST 2014
-    time_t t(1412220844);
+    size_t inserts(0);
+    for (size_t i = 0; i < changes.size(); i++) {
+        if (changes[i].ModelType() == kModelTimeEntry) {
+            ASSERT_EQ("insert", changes[i].ChangeType());
+            inserts++;
+        }
+    }
+    ASSERT_EQ(time_entry_count, inserts);
+
+    std::vector<TimeEntry *> dirty;
+    user.related.DirtyModels(&dirty);
+    ASSERT_TRUE(dirty.empty());
+
+    // Local IDs assigned in memory match the saved rows
+    User loaded;
+    ASSERT_EQ(noError, db.LoadUserWithAllTimeEntries(user.ID(), &loaded));
+    ASSERT_EQ(time_entry_count, loaded.related.TimeEntries.size());
+    for (size_t i = 0; i < loaded.related.TimeEntries.size(); i++) {
+        TimeEntry *saved = loaded.related.TimeEntries[i];
+        TimeEntry *te = user.related.TimeEntryByID(saved->ID());
+        ASSERT_TRUE(te);
+        ASSERT_EQ(te->LocalID(), saved->LocalID());
+        ASSERT_EQ(te->GUID(), saved->GUID());
+        ASSERT_EQ(te->Description(), saved->Description());
+        ASSERT_EQ("alfa", saved->Tags());
+    }
+}
 
-    ASSERT_EQ("2014-10-02T03:34:04Z", Formatter::Format8601(t));
+// Not a multiple of the bulk insert size, so both
+// multi-row and single row inserts are used.
+TEST(Database, ImportsAccount) {
+    importAccount(107);
 }
 
-TEST(Formatter, Parse8601) {
-    ASSERT_EQ(0, Formatter::Parse8601("null"));
+TEST(Database, DISABLED_ImportsLargeAccount) {
+    importAccount(10007);
+}
 
-    //  date -r 1412220844
-    //  Thu Oct  2 05:34:04 CEST 2014
-    time_t t(1412220844);
+#define kSaveBenchmarkTimeEntries 50000
+#define kSaveBenchmarkStart 1420113600
 
-    ASSERT_EQ(t, Formatter::Parse8601("2014-10-02T03:34:04Z"));
+TimeEntry *saveBenchmarkTimeEntry(const Poco::UInt64 uid,
+                                  const size_t i) {
+    TimeEntry *te = new TimeEntry();
+    te->SetID(i + 1);
+    te->SetUID(uid);
+    te->SetWID(123456789);
+    std::stringstream ss;
+    ss << "Time entry " << i;
+    te->SetDescription(ss.str());
+    te->SetStart(kSaveBenchmarkStart + i * 60);
+    te->SetDurationInSeconds(60);
+    te->SetStop(kSaveBenchmarkStart + i * 60 + 60);
+    te->SetTags("alfa|beeta");
+    return te;
+}
+
+// Saves given number of new time entries, then changes
+// to all of them, recording time taken as test properties.
+void saveTimeEntries(testing::Database *db,
+                     User *user,
+                     const size_t count) {
+    user->SetID(10471231);
+    user->SetAPIToken("30eb0ae954b536d2f6628f7fec47beb6");
+    user->SetEmail("bench@toggl.com");
+    for (size_t i = 0; i < count; i++) {
+        user->related.TimeEntries.push_back(
+            saveBenchmarkTimeEntry(user->ID(), i));
+    }
+
+    std::vector<ModelChange> changes;
+    Poco::Stopwatch insert;
+    insert.start();
+    ASSERT_EQ(noError, db->instance()->SaveUser(user, true, &changes));
+    insert.stop();
+    ASSERT_EQ(count + 1, changes.size());
+
+    for (size_t i = 0; i < user->related.TimeEntries.size(); i++) {
+        TimeEntry *te = user->related.TimeEntries[i];
+        ASSERT_TRUE(te->LocalID());
+        te->SetDescription(te->Description() + " changed");
+    }
+
+    changes.clear();
+    Poco::Stopwatch update;
+    update.start();
+    ASSERT_EQ(noError, db->instance()->SaveUser(user, true, &changes));
+    update.stop();
+    ASSERT_EQ(count, changes.size());
+
+    User loaded;
+    ASSERT_EQ(noError, db->LoadUserWithAllTimeEntries(user->ID(), &loaded));
+    ASSERT_EQ(count, loaded.related.TimeEntries.size());
+    TimeEntry *te = loaded.related.TimeEntryByID(count);
+    ASSERT_TRUE(te);
+    std::stringstream description;
+    description << "Time entry " << count - 1 << " changed";
+    ASSERT_EQ(description.str(), te->Description());
+    ASSERT_EQ("alfa|beeta", te->Tags());
+
+    ::testing::Test::RecordProperty("insert_us",
+                                    static_cast<int>(insert.elapsed()));
+    ::testing::Test::RecordProperty("update_us",
+                                    static_cast<int>(update.elapsed()));
+}
+
+TEST(Database, SavesAndUpdatesTimeEntries) {
+    testing::Database db;
+    User user;
+    saveTimeEntries(&db, &user, 1000);
+}
+
+TEST(Database, DISABLED_SaveBenchmark) {
+    testing::Database db;
+    User user;
+    saveTimeEntries(&db, &user, kSaveBenchmarkTimeEntries);
+    ASSERT_FALSE(HasFatalFailure());
+
+    // The same inserts, compiled per execution as Poco::Data does
+    Poco::Data::Session session("SQLite", TESTDB);
+    session << "delete from time_entries", Poco::Data::Keywords::now;
+    Poco::Stopwatch compiled;
+    compiled.start();
+    session.begin();
+    for (size_t i = 0; i < kSaveBenchmarkTimeEntries; i++) {
+        Poco::UInt64 id(i + 1);
+        std::string description(user.related.TimeEntries[i]->Description());
+        std::string guid(user.related.TimeEntries[i]->GUID());
+        std::string tags(user.related.TimeEntries[i]->Tags());
+        Poco::UInt64 start(kSaveBenchmarkStart + i * 60);
+        Poco::Int64 local_id(0);
+        session << "insert into time_entries(id, uid, description, wid, "
+                "guid, start, stop, duration, tags) "
+                "values(:id, :uid, :description, :wid, "
+                ":guid, :start, :stop, :duration, :tags)",
+                Poco::Data::Keywords::useRef(id),
+                Poco::Data::Keywords::useRef(user.ID()),
+                Poco::Data::Keywords::useRef(description),
+                Poco::Data::Keywords::useRef(
+                    user.related.TimeEntries[i]->WID()),
+                Poco::Data::Keywords::useRef(guid),
+                Poco::Data::Keywords::useRef(start),
+                Poco::Data::Keywords::useRef(start),
+                Poco::Data::Keywords::useRef(id),
+                Poco::Data::Keywords::useRef(tags),
+                Poco::Data::Keywords::now;
+        session << "select last_insert_rowid()",
+                Poco::Data::Keywords::into(local_id),
+                Poco::Data::Keywords::now;
+        ASSERT_TRUE(local_id);
+    }
+    session.commit();
+    compiled.stop();
+
+    RecordProperty("compiled_insert_us",
+                   static_cast<int>(compiled.elapsed()));
+}
+
+std::string timeEntryUpdateJSON(const TimeEntry &te, const bool deleted) {
+    Json::Value update;
+    update["model"] = kModelTimeEntry;
+    update["action"] = "update";
+    update["data"] = te.SaveToJSON();
+    if (deleted) {
+        update["data"]["server_deleted_at"] = "2015-08-22T09:05:31+00:00";
+    }
+    Json::FastWriter writer;
+    return writer.write(update);
+}
+
+TEST(Database, LoadsOlderTimeEntriesOnDemand) {
+    testing::Database db;
+
+    User user;
+    user.SetID(10471231);
+    user.SetAPIToken("30eb0ae954b536d2f6628f7fec47beb6");
+    user.SetEmail("lazy@toggl.com");
+
+    // A synced time entry on each of the last 60 days
+    Poco::Int64 now = time(0);
+    for (size_t i = 0; i < 60; i++) {
+        TimeEntry *te = new TimeEntry();
+        te->SetID(i + 1);
+        te->SetUID(user.ID());
+        te->SetWID(123456789);
+        te->SetDescription("Synced");
+        te->SetStart(now - i * 86400);
+        te->SetDurationInSeconds(60);
+        te->SetStop(now - i * 86400 + 60);
+        user.related.TimeEntries.push_back(te);
+    }
+
+    // An old time entry that is not synced yet
+    TimeEntry *unsynced = new TimeEntry();
+    unsynced->SetUID(user.ID());
+    unsynced->SetWID(123456789);
+    unsynced->SetDescription("Unsynced");
+    unsynced->SetStart(now - 50 * 86400);
+    unsynced->SetDurationInSeconds(60);
+    unsynced->SetStop(now - 50 * 86400 + 60);
+    user.related.TimeEntries.push_back(unsynced);
+
+    std::vector<ModelChange> changes;
+    ASSERT_EQ(noError, db.instance()->SaveUser(&user, true, &changes));
+
+    // Only recent and unsynced time entries are loaded
+    User loaded;
+    ASSERT_EQ(noError, db.instance()->LoadUserByID(user.ID(), &loaded));
+    Poco::Int64 since = loaded.related.ResidentTimeEntriesSince;
+    ASSERT_TRUE(since);
+    ASSERT_LT(since, now - 8 * 86400);
+    ASSERT_GT(since, now - 11 * 86400);
+    ASSERT_TRUE(loaded.related.TimeEntryByGUID(unsynced->GUID()));
+    ASSERT_FALSE(loaded.related.TimeEntryByID(60));
+    for (size_t i = 0; i < loaded.related.TimeEntries.size(); i++) {
+        TimeEntry *te = loaded.related.TimeEntries[i];
+        ASSERT_TRUE(Poco::Int64(te->Start()) >= since
+                    || te->GUID() == unsynced->GUID());
+    }
+    size_t resident = loaded.related.TimeEntries.size();
+    ASSERT_LT(resident, size_t(20));
+
+    // Server updates and deletes time entries that are in database only
+    TimeEntry *oldest = user.related.TimeEntryByID(60);
+    oldest->SetDescription("Updated on server");
+    ASSERT_EQ(noError, loaded.LoadUserUpdateFromJSONString(
+        timeEntryUpdateJSON(*oldest, false)));
+    ASSERT_EQ(noError, loaded.LoadUserUpdateFromJSONString(
+        timeEntryUpdateJSON(*user.related.TimeEntryByID(59), true)));
+    loaded.SetAPIToken(user.APIToken());
+    ASSERT_EQ(noError, db.instance()->SaveUser(&loaded, true, &changes));
+
+    // Older time entries are paged in, without duplicates
+    User all;
+    ASSERT_EQ(noError, db.instance()->LoadUserByID(user.ID(), &all));
+    ASSERT_EQ(resident, all.related.TimeEntries.size());
+    ASSERT_EQ(noError, db.instance()->LoadMoreTimeEntries(&all, 30));
+    ASSERT_EQ(since - 30 * 86400, all.related.ResidentTimeEntriesSince);
+    ASSERT_LT(resident, all.related.TimeEntries.size());
+    ASSERT_EQ(noError, db.LoadUserWithAllTimeEntries(user.ID(), &all));
+    ASSERT_FALSE(all.related.ResidentTimeEntriesSince);
+    ASSERT_EQ(size_t(60), all.related.TimeEntries.size());
+    ASSERT_EQ("Updated on server",
+              all.related.TimeEntryByID(60)->Description());
+    ASSERT_FALSE(all.related.TimeEntryByID(59));
+    ASSERT_TRUE(all.related.TimeEntryByGUID(unsynced->GUID()));
+}
+
+TEST(Database, LoadedTimeEntriesWithoutGUIDGetOneAndAreListed) {
+    testing::Database db;
+
+    User user;
+    user.SetID(10471231);
+    user.SetAPIToken("30eb0ae954b536d2f6628f7fec47beb6");
+    user.SetEmail("lazy@toggl.com");
+
+    Poco::Int64 now = time(0);
+    for (size_t i = 0; i < 2; i++) {
+        TimeEntry *te = new TimeEntry();
+        te->SetID(i + 1);
+        te->SetUID(user.ID());
+        te->SetWID(123456789);
+        te->SetStart(now - i * 40 * 86400);
+        te->SetDurationInSeconds(60);
+        te->SetStop(now - i * 40 * 86400 + 60);
+        user.related.TimeEntries.push_back(te);
+    }
+
+    std::vector<ModelChange> changes;
+    ASSERT_EQ(noError, db.instance()->SaveUser(&user, true, &changes));
+
+    // A recent, then an older time entry loses its GUID in database.
+    // The older one is loaded by paging.
+    for (Poco::UInt64 id = 1; id <= 2; id++) {
+        {
+            Poco::Data::Session session("SQLite", TESTDB);
+            session << "UPDATE time_entries SET guid = 'restored' "
+                    "WHERE guid = ''",
+                    Poco::Data::Keywords::now;
+            session << "UPDATE time_entries SET guid = '' WHERE id = :id",
+                    Poco::Data::Keywords::useRef(id),
+                    Poco::Data::Keywords::now;
+        }
+
+        User loaded;
+        ASSERT_EQ(noError, db.LoadUserWithAllTimeEntries(user.ID(), &loaded));
+        ASSERT_EQ(size_t(2), loaded.related.TimeEntries.size());
+
+        TimeEntry *te = loaded.related.TimeEntryByID(id);
+        ASSERT_TRUE(te);
+        ASSERT_FALSE(te->GUID().empty());
+        ASSERT_TRUE(te->UIModifiedAt());
+        ASSERT_EQ(te, loaded.related.TimeEntryByGUID(te->GUID()));
+
+        ViewSnapshot empty;
+        ViewSnapshotPtr snapshot(
+            ViewSnapshot::Next(empty, &loaded, ViewSnapshotChanges()));
+        ASSERT_TRUE(snapshot->TimeEntryByGUID(te->GUID()));
+
+        TimeEntryList list;
+        list.Reset(snapshot->TimeEntries());
+        std::vector<guid> rows;
+        list.GUIDs(&rows);
+        ASSERT_EQ(size_t(2), rows.size());
+        ASSERT_TRUE(std::find(rows.begin(), rows.end(), te->GUID())
+                    != rows.end());
+    }
+}
+
+template<typename T>
+T *findByIDLinear(const Poco::UInt64 id, const std::vector<T *> &list) {
+    for (size_t i = 0; i < list.size(); i++) {
+        if (list[i]->ID() == id) {
+            return list[i];
+        }
+    }
+    return nullptr;
+}
+
+template<typename T>
+T *findByGUIDLinear(const guid GUID, const std::vector<T *> &list) {
+    for (size_t i = 0; i < list.size(); i++) {
+        if (list[i]->GUID() == GUID) {
+            return list[i];
+        }
+    }
+    return nullptr;
+}
+
+TEST(RelatedData, IndexedLookupsMatchLinearSearch) {
+    RelatedData related;
+    for (size_t i = 0; i < 1000; i++) {
+        TimeEntry *te = new TimeEntry();
+        te->SetID(i + 1);
+        std::stringstream ss;
+        ss << "guid-" << i + 1;
+        te->SetGUID(ss.str());
+        related.Add(te);
+    }
+
+    for (Poco::UInt64 id = 1; id <= 1000; id += 7) {
+        std::stringstream ss;
+        ss << "guid-" << id;
+        TimeEntry *te = related.TimeEntryByID(id);
+        ASSERT_TRUE(te);
+        ASSERT_EQ(findByIDLinear(id, related.TimeEntries.Items()), te);
+        ASSERT_EQ(findByGUIDLinear(ss.str(), related.TimeEntries.Items()),
+                  related.TimeEntryByGUID(ss.str()));
+        ASSERT_EQ(te, related.TimeEntryByGUID(ss.str()));
+    }
+    ASSERT_FALSE(related.TimeEntryByID(1001));
+    ASSERT_FALSE(related.TimeEntryByGUID("guid-1001"));
+
+    related.Clear();
+}
+
+TEST(RelatedData, DISABLED_LookupBenchmark) {
+    const size_t kLookups = 1000;
+    const size_t sizes[] = { 1000, 10000, 100000 };
+
+    for (size_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); s++) {
+        const size_t n = sizes[s];
+
+        RelatedData related;
+        for (size_t i = 0; i < n; i++) {
+            TimeEntry *te = new TimeEntry();
+            te->SetID(i + 1);
+            std::stringstream ss;
+            ss << "guid-" << i + 1;
+            te->SetGUID(ss.str());
+            related.Add(te);
+        }
+
+        std::vector<Poco::UInt64> ids;
+        std::vector<guid> guids;
+        for (size_t i = 0; i < kLookups; i++) {
+            Poco::UInt64 id = (i * 7919) % n + 1;
+            ids.push_back(id);
+            std::stringstream ss;
+            ss << "guid-" << id;
+            guids.push_back(ss.str());
+        }
+
+        Poco::Stopwatch linear;
+        linear.start();
+        for (size_t i = 0; i < kLookups; i++) {
+            ASSERT_TRUE(findByIDLinear(ids[i], related.TimeEntries.Items()));
+            ASSERT_TRUE(findByGUIDLinear(guids[i],
+                                         related.TimeEntries.Items()));
+        }
+        linear.stop();
+
+        Poco::Stopwatch indexed;
+        indexed.start();
+        for (size_t i = 0; i < kLookups; i++) {
+            ASSERT_TRUE(related.TimeEntryByID(ids[i]));
+            ASSERT_TRUE(related.TimeEntryByGUID(guids[i]));
+        }
+        indexed.stop();
+
+        std::stringstream size;
+        size << n;
+        RecordProperty("linear_us_" + size.str(),
+                       static_cast<int>(linear.elapsed()));
+        RecordProperty("indexed_us_" + size.str(),
+                       static_cast<int>(indexed.elapsed()));
+
+        related.Clear();
+    }
+}
+
+// Noon UTC, so the test time entries stay on one local date
+#define kTimeEntryListDay 1420113600
+
+TimeEntry *timeEntryListEntry(const std::string GUID,
+                              const Poco::UInt64 start,
+                              const Poco::Int64 duration) {
+    TimeEntry *te = new TimeEntry();
+    te->SetGUID(GUID);
+    te->SetStart(start);
+    te->SetDurationInSeconds(duration);
+    return te;
+}
+
+// Replay list deltas, like UI would
+void applyTimeEntryListChanges(
+    const std::vector<TimeEntryListChange> &changes,
+    std::vector<guid> *rows) {
+    for (std::vector<TimeEntryListChange>::const_iterator it =
+        changes.begin();
+            it != changes.end(); it++) {
+        if (kTimeEntryListInsert == it->ChangeType()) {
+            rows->insert(rows->begin() + it->Position(), it->GUID());
+        } else if (kTimeEntryListDelete == it->ChangeType()) {
+            ASSERT_EQ(it->GUID(), rows->at(it->Position()));
+            rows->erase(rows->begin() + it->Position());
+        } else {
+            ASSERT_EQ(it->GUID(), rows->at(it->Position()));
+        }
+    }
+}
+
+// Deltas must leave the list as a full render would
+void expectSameAsFullRender(const TimeEntryList &list,
+                            const std::vector<TimeEntry *> &entries) {
+    TimeEntryList full;
+    full.Reset(entries);
+
+    std::vector<guid> expected;
+    full.GUIDs(&expected);
+    std::vector<guid> actual;
+    list.GUIDs(&actual);
+    ASSERT_EQ(expected, actual);
+
+    for (size_t i = 0; i < full.Size(); i++) {
+        ASSERT_EQ(full.IsHeader(i), list.IsHeader(i));
+        ASSERT_EQ(full.DateDuration(i), list.DateDuration(i));
+    }
+}
+
+TEST(TimeEntryList, ResetsNewestFirstWithDateHeaders) {
+    std::vector<TimeEntry *> entries;
+    entries.push_back(timeEntryListEntry("a", kTimeEntryListDay, 60));
+    entries.push_back(timeEntryListEntry("b", kTimeEntryListDay + 3600, 120));
+    entries.push_back(timeEntryListEntry("c", kTimeEntryListDay + 86400, 60));
+    entries.push_back(timeEntryListEntry("d", kTimeEntryListDay + 90000, -1));
+
+    TimeEntryList list;
+    ASSERT_FALSE(list.Initialized());
+    list.Reset(entries);
+    ASSERT_TRUE(list.Initialized());
+
+    // Running time entry is not listed
+    std::vector<guid> rows;
+    list.GUIDs(&rows);
+    ASSERT_EQ(size_t(3), rows.size());
+    ASSERT_EQ("c", rows[0]);
+    ASSERT_EQ("b", rows[1]);
+    ASSERT_EQ("a", rows[2]);
+
+    ASSERT_TRUE(list.IsHeader(0));
+    ASSERT_TRUE(list.IsHeader(1));
+    ASSERT_FALSE(list.IsHeader(2));
+
+    ASSERT_EQ(Formatter::FormatDurationForDateHeader(180),
+              list.DateDuration(1));
+    ASSERT_EQ(list.DateDuration(1), list.DateDuration(2));
+
+    for (size_t i = 0; i < entries.size(); i++) {
+        delete entries[i];
+    }
+}
+
+TEST(TimeEntryList, SendsOnlyAffectedRows) {
+    std::vector<TimeEntry *> entries;
+    entries.push_back(timeEntryListEntry("a", kTimeEntryListDay, 60));
+    entries.push_back(timeEntryListEntry("b", kTimeEntryListDay + 3600, 60));
+    entries.push_back(timeEntryListEntry("c", kTimeEntryListDay + 86400, 60));
+
+    TimeEntryList list;
+    list.Reset(entries);
+
+    // Description edit: one update, no other rows touched
+    std::vector<TimeEntryListChange> changes;
+    list.Update("c", entries[2], &changes);
+    ASSERT_EQ(size_t(1), changes.size());
+    ASSERT_EQ(kTimeEntryListUpdate, changes[0].ChangeType());
+    ASSERT_EQ(0, changes[0].Position());
+    ASSERT_TRUE(changes[0].IsHeader());
+
+    // Duration edit updates the date duration of the whole day
+    changes.clear();
+    entries[0]->SetDurationInSeconds(120);
+    list.Update("a", entries[0], &changes);
+    ASSERT_EQ(size_t(2), changes.size());
+    ASSERT_EQ("a", changes[0].GUID());
+    ASSERT_EQ("b", changes[1].GUID());
+    ASSERT_EQ(Formatter::FormatDurationForDateHeader(180),
+              changes[1].DateDuration());
+    expectSameAsFullRender(list, entries);
+
+    // Unrelated GUID changes nothing
+    changes.clear();
+    list.Update("x", nullptr, &changes);
+    ASSERT_TRUE(changes.empty());
+
+    for (size_t i = 0; i < entries.size(); i++) {
+        delete entries[i];
+    }
+}
+
+TEST(TimeEntryList, KeepsDateTotals) {
+    Poco::Int64 now = time(0);
+    std::vector<TimeEntry *> entries;
+    entries.push_back(timeEntryListEntry("a", now - 120, 60));
+    entries.push_back(timeEntryListEntry("b", now - 60, -(now - 60)));
+    entries.push_back(timeEntryListEntry("c", now - 86400, 30));
+
+    TimeEntryList list;
+    list.Reset(entries);
+
+    int today = ViewSnapshot::DayOf(entries[0]->Start());
+    ASSERT_LE(120, list.DateTotal(today));
+    ASSERT_GE(180, list.DateTotal(today));
+    ASSERT_EQ(30, list.DateTotal(ViewSnapshot::DayOf(entries[2]->Start())));
+
+    // Stopping the running entry moves it into the stopped total
+    std::vector<TimeEntryListChange> changes;
+    entries[1]->SetDurationInSeconds(60);
+    list.Update("b", entries[1], &changes);
+    ASSERT_EQ(120, list.DateTotal(today));
+
+    // Without running time entries, ticks change nothing
+    changes.clear();
+    list.Tick(&changes);
+    ASSERT_TRUE(changes.empty());
+
+    for (size_t i = 0; i < entries.size(); i++) {
+        delete entries[i];
+    }
+}
+
+TEST(TimeEntryList, KeepsDateTotalsOfTimeEntryRunningPastMidnight) {
+    Poco::LocalDateTime now;
+    Poco::LocalDateTime midnight(now.year(), now.month(), now.day());
+    Poco::Int64 today_start = midnight.utc().timestamp().epochTime();
+
+    std::vector<TimeEntry *> entries;
+    entries.push_back(timeEntryListEntry("evening", today_start - 7200, 600));
+    entries.push_back(timeEntryListEntry("late", today_start - 1800,
+                                         -(today_start - 1800)));
+    entries.push_back(timeEntryListEntry("early", today_start + 60, 60));
+
+    TimeEntryList list;
+    list.Reset(entries);
+
+    // The running time entry counts on the day it was started
+    int yesterday = ViewSnapshot::DayOf(today_start - 1800);
+    int today = ViewSnapshot::DayOf(today_start + 60);
+    ASSERT_NE(yesterday, today);
+    ASSERT_LE(600 + 1800, list.DateTotal(yesterday));
+    ASSERT_EQ(60, list.DateTotal(today));
+
+    // Ticks update the day the running time entry was started on
+    std::vector<TimeEntryListChange> changes;
+    list.Tick(&changes);
+    for (size_t i = 0; i < changes.size(); i++) {
+        ASSERT_EQ("evening", changes[i].GUID());
+    }
+    ASSERT_EQ(size_t(2), list.Size());
+    ASSERT_TRUE(list.IsHeader(0));
+    ASSERT_TRUE(list.IsHeader(1));
+    ASSERT_EQ(Formatter::FormatDurationForDateHeader(60),
+              list.DateDuration(0));
+    ASSERT_EQ(Formatter::FormatDurationForDateHeader(
+        list.DateTotal(yesterday)), list.DateDuration(1));
+
+    for (size_t i = 0; i < entries.size(); i++) {
+        delete entries[i];
+    }
+}
+
+TEST(TimeEntryList, DeltasMatchFullRender) {
+    std::vector<TimeEntry *> entries;
+    for (int i = 0; i < 20; i++) {
+        std::stringstream ss;
+        ss << "te" << i;
+        entries.push_back(timeEntryListEntry(ss.str(),
+                                             kTimeEntryListDay
+                                             + (i / 4) * 86400 + i * 60,
+                                             60 + i));
+    }
+
+    TimeEntryList list;
+    list.Reset(entries);
+    std::vector<guid> rows;
+    list.GUIDs(&rows);
+
+    std::vector<TimeEntryListChange> changes;
+
+    // Move a day header to another day
+    entries[7]->SetStart(kTimeEntryListDay + 3 * 86400 + 30);
+    list.Update(entries[7]->GUID(), entries[7], &changes);
+
+    // Start and stop a time entry
+    TimeEntry *running =
+        timeEntryListEntry("running", kTimeEntryListDay + 86400 + 10, -1);
+    entries.push_back(running);
+    list.Update(running->GUID(), running, &changes);
+    running->SetDurationInSeconds(300);
+    list.Update(running->GUID(), running, &changes);
+
+    // Delete the last time entry of a day
+    entries[19]->SetDeletedAt(kTimeEntryListDay);
+    list.Update(entries[19]->GUID(), entries[19], &changes);
+
+    // Delete the first one
+    list.Update(entries[0]->GUID(), nullptr, &changes);
+    delete entries[0];
+    entries.erase(entries.begin());
+
+    applyTimeEntryListChanges(changes, &rows);
+
+    std::vector<guid> actual;
+    list.GUIDs(&actual);
+    ASSERT_EQ(actual, rows);
+
+    expectSameAsFullRender(list, entries);
+
+    for (size_t i = 0; i < entries.size(); i++) {
+        delete entries[i];
+    }
+}
+
+AutocompleteItem autocompleteItem(const std::string description,
+                                  const std::string project) {
+    AutocompleteItem item;
+    item.Description = description;
+    item.ProjectLabel = project;
+    item.Text = description;
+    if (!project.empty()) {
+        item.Text += " - " + project;
+    }
+    return item;
+}
+
+TEST(AutocompleteIndex, RanksPrefixThenWordThenSubstringMatches) {
+    std::vector<AutocompleteItem> items;
+    items.push_back(autocompleteItem("Reading mail", ""));
+    items.push_back(autocompleteItem("Writing", "Mailing list"));
+    items.push_back(autocompleteItem("Email triage", ""));
+    items.push_back(autocompleteItem("Mail", ""));
+    items.push_back(autocompleteItem("Meeting", ""));
+
+    RelatedData related;
+    AutocompleteIndex index(CompareAutocompleteItems);
+    index.Update(items, related);
+    ASSERT_EQ(size_t(5), index.Size());
+
+    std::vector<AutocompleteItem> result;
+    index.Query("MAIL", 0, &result);
+    ASSERT_EQ(size_t(4), result.size());
+    ASSERT_EQ("Mail", result[0].Description);
+    ASSERT_EQ("Reading mail", result[1].Description);
+    ASSERT_EQ("Writing", result[2].Description);
+    ASSERT_EQ("Email triage", result[3].Description);
+
+    result.clear();
+    index.Query("mail", 2, &result);
+    ASSERT_EQ(size_t(2), result.size());
+
+    // Short queries use the same index
+    result.clear();
+    index.Query("m", 0, &result);
+    ASSERT_EQ(size_t(5), result.size());
+
+    result.clear();
+    index.Query("xyz", 0, &result);
+    ASSERT_TRUE(result.empty());
+
+    // Empty query lists everything in list order
+    result.clear();
+    index.Query("", 3, &result);
+    ASSERT_EQ(size_t(3), result.size());
+    ASSERT_EQ("Reading mail", result[0].Description);
+}
+
+TEST(AutocompleteIndex, FoldsUnicodeCase) {
+    std::vector<AutocompleteItem> items;
+    items.push_back(autocompleteItem("Übersetzung", "Straße"));
+    items.push_back(autocompleteItem("Ärger", ""));
+
+    RelatedData related;
+    AutocompleteIndex index(CompareAutocompleteItems);
+    index.Update(items, related);
+
+    std::vector<AutocompleteItem> result;
+    index.Query("übers", 0, &result);
+    ASSERT_EQ(size_t(1), result.size());
+    ASSERT_EQ("Übersetzung", result[0].Description);
+
+    result.clear();
+    index.Query("STRASSE", 0, &result);
+    ASSERT_TRUE(result.empty());
+
+    result.clear();
+    index.Query("STRAßE", 0, &result);
+    ASSERT_EQ(size_t(1), result.size());
+
+    result.clear();
+    index.Query("är", 0, &result);
+    ASSERT_EQ(size_t(1), result.size());
+    ASSERT_EQ("Ärger", result[0].Description);
+}
+
+TEST(AutocompleteIndex, UpdatesChangedItemsOnly) {
+    std::vector<AutocompleteItem> items;
+    items.push_back(autocompleteItem("Design", "Website"));
+    items.push_back(autocompleteItem("Coding", "Website"));
+
+    RelatedData related;
+    AutocompleteIndex index(CompareAutocompleteItems);
+    index.Update(items, related);
+
+    items[1] = autocompleteItem("Testing", "Website");
+    items.push_back(autocompleteItem("Design review", ""));
+    index.Update(items, related);
+    ASSERT_EQ(size_t(3), index.Size());
+
+    std::vector<AutocompleteItem> result;
+    index.Query("coding", 0, &result);
+    ASSERT_TRUE(result.empty());
+
+    index.Query("test", 0, &result);
+    ASSERT_EQ(size_t(1), result.size());
+
+    result.clear();
+    index.Query("design", 0, &result);
+    ASSERT_EQ(size_t(2), result.size());
+    ASSERT_EQ("Design", result[0].Description);
+
+    index.Clear();
+    result.clear();
+    index.Query("design", 0, &result);
+    ASSERT_TRUE(result.empty());
+}
+
+TEST(AutocompleteIndex, AppliesTimeEntryChanges) {
+    RelatedData related;
+    const char *descriptions[] = { "Design", "Coding", "Design" };
+    for (size_t i = 0; i < 3; i++) {
+        TimeEntry *te = new TimeEntry();
+        te->SetID(i + 1);
+        std::stringstream ss;
+        ss << "guid-" << i + 1;
+        te->SetGUID(ss.str());
+        te->SetDescription(descriptions[i]);
+        related.Add(te);
+    }
+
+    AutocompleteIndex index(CompareAutocompleteItems);
+    std::vector<ModelChange> changes;
+    changes.push_back(ModelChange(kModelTimeEntry, "update", 2, "guid-2"));
+    ASSERT_FALSE(index.Apply(changes, related));
+
+    index.Update(related.TimeEntryAutocompleteItems(), related);
+    ASSERT_EQ(size_t(2), index.Size());
+
+    // The item stays while another time entry gives it
+    related.TimeEntryByGUID("guid-1")->SetDescription("Testing");
+    changes.clear();
+    changes.push_back(ModelChange(kModelTimeEntry, "update", 1, "guid-1"));
+    ASSERT_TRUE(index.Apply(changes, related));
+    ASSERT_EQ(size_t(3), index.Size());
+
+    std::vector<AutocompleteItem> result;
+    index.Query("design", 0, &result);
+    ASSERT_EQ(size_t(1), result.size());
+
+    related.TimeEntryByGUID("guid-3")->SetDescription("Testing");
+    changes.clear();
+    changes.push_back(ModelChange(kModelTimeEntry, "update", 3, "guid-3"));
+    ASSERT_TRUE(index.Apply(changes, related));
+    ASSERT_EQ(size_t(2), index.Size());
+
+    result.clear();
+    index.Query("design", 0, &result);
+    ASSERT_TRUE(result.empty());
+
+    // Applied items keep list order
+    result.clear();
+    index.Query("", 0, &result);
+    ASSERT_EQ(size_t(2), result.size());
+    ASSERT_EQ("Coding", result[0].Description);
+    ASSERT_EQ("Testing", result[1].Description);
+
+    // Deleted time entries give no items
+    related.TimeEntryByGUID("guid-2")->SetDeletedAt(time(0));
+    changes.clear();
+    changes.push_back(ModelChange(kModelTimeEntry, "delete", 2, "guid-2"));
+    ASSERT_TRUE(index.Apply(changes, related));
+    result.clear();
+    index.Query("cod", 0, &result);
+    ASSERT_TRUE(result.empty());
+
+    // Project changes relabel items, the full list is needed
+    changes.clear();
+    changes.push_back(ModelChange(kModelProject, "update", 1, "project"));
+    ASSERT_FALSE(index.Apply(changes, related));
+}
+
+TEST(AutocompleteIndex, AppliesRenamedTimeEntry) {
+    RelatedData related;
+    const char *descriptions[] = { "Ax1", "Bx2", "Cx3", "Dx4" };
+    for (size_t i = 0; i < 4; i++) {
+        TimeEntry *te = new TimeEntry();
+        te->SetID(i + 1);
+        std::stringstream ss;
+        ss << "guid-" << i + 1;
+        te->SetGUID(ss.str());
+        te->SetDescription(descriptions[i]);
+        related.Add(te);
+    }
+
+    AutocompleteIndex index(CompareAutocompleteItems);
+    index.Update(related.TimeEntryAutocompleteItems(), related);
+    ASSERT_EQ(size_t(4), index.Size());
+
+    // Edits that keep the item leave the list as it is
+    Poco::UInt64 version = index.Version();
+    related.TimeEntryByGUID("guid-2")->SetDurationInSeconds(60);
+    std::vector<ModelChange> changes;
+    changes.push_back(ModelChange(kModelTimeEntry, "update", 2, "guid-2"));
+    ASSERT_TRUE(index.Apply(changes, related));
+    ASSERT_EQ(version, index.Version());
+
+    // Renaming removes one item and adds another, the size stays
+    related.TimeEntryByGUID("guid-1")->SetDescription("Cz5");
+    changes.clear();
+    changes.push_back(ModelChange(kModelTimeEntry, "update", 1, "guid-1"));
+    ASSERT_TRUE(index.Apply(changes, related));
+    ASSERT_EQ(size_t(4), index.Size());
+    ASSERT_NE(version, index.Version());
+
+    // Matches of equal quality are in list order
+    std::vector<AutocompleteItem> result;
+    index.Query("x", 0, &result);
+    ASSERT_EQ(size_t(3), result.size());
+    ASSERT_EQ("Bx2", result[0].Description);
+    ASSERT_EQ("Cx3", result[1].Description);
+    ASSERT_EQ("Dx4", result[2].Description);
+
+    result.clear();
+    index.Query("c", 0, &result);
+    ASSERT_EQ(size_t(2), result.size());
+    ASSERT_EQ("Cx3", result[0].Description);
+    ASSERT_EQ("Cz5", result[1].Description);
+}
+
+TEST(TimeEntry, SetDurationOnRunningTimeEntryWithDurOnlySetting) {
+    testing::Database db;
+
+    std::string json = loadTestDataFile("../testdata/user_with_duronly.json");
+
+    User user;
+    ASSERT_EQ(noError,
+              user.LoadUserAndRelatedDataFromJSONString(json, true));
+
+    TimeEntry *te = user.related.TimeEntryByID(164891639);
+    ASSERT_TRUE(te);
+    ASSERT_TRUE(te->IsTracking());
+    ASSERT_LT(te->Start(), te->Stop());
+
+    te->SetDurationUserInput("00:59:47");
+    ASSERT_TRUE(te->IsTracking());
+    ASSERT_LT(te->Start(), te->Stop());
+
+    te->StopTracking();
+    ASSERT_FALSE(te->IsTracking());
+    ASSERT_LT(te->Start(), te->Stop());
+}
+
+TEST(Formatter, CollectErrors) {
+    {
+        std::vector<error> errors;
+        errors.push_back(error("foo"));
+        errors.push_back(error("bar"));
+        errors.push_back(error("foo"));
+        error err = Formatter::CollectErrors(&errors);
+        ASSERT_EQ("Errors encountered while syncing data: foo bar", err);
+    }
+
+    {
+        std::vector<error> errors;
+        errors.push_back(error("foo\n"));
+        errors.push_back(error("bar\n"));
+        errors.push_back(error("foo\n"));
+        error err = Formatter::CollectErrors(&errors);
+        ASSERT_EQ("Errors encountered while syncing data: foo. bar.", err);
+    }
+}
+
+TEST(Formatter, ParseTimeInput) {
+    int hours = 0;
+    int minutes = 0;
+
+    ASSERT_FALSE(Formatter::ParseTimeInput("", &hours, &minutes));
+    ASSERT_EQ(0, hours);
+    ASSERT_EQ(0, minutes);
+
+    ASSERT_TRUE(Formatter::ParseTimeInput("120a", &hours, &minutes));
+    ASSERT_EQ(1, hours);
+    ASSERT_EQ(20, minutes);
+
+    ASSERT_TRUE(Formatter::ParseTimeInput("120a", &hours, &minutes));
+    ASSERT_EQ(1, hours);
+    ASSERT_EQ(20, minutes);
+
+    ASSERT_TRUE(Formatter::ParseTimeInput("1P", &hours, &minutes));
+    ASSERT_EQ(13, hours);
+    ASSERT_EQ(0, minutes);
+
+    ASSERT_FALSE(Formatter::ParseTimeInput("x", &hours, &minutes));
+
+    ASSERT_TRUE(Formatter::ParseTimeInput("2", &hours, &minutes));
+    ASSERT_EQ(2, hours);
+    ASSERT_EQ(0, minutes);
+
+    ASSERT_TRUE(Formatter::ParseTimeInput("12", &hours, &minutes));
+    ASSERT_EQ(12, hours);
+    ASSERT_EQ(0, minutes);
+
+    ASSERT_TRUE(Formatter::ParseTimeInput("1230", &hours, &minutes));
+    ASSERT_EQ(12, hours);
+    ASSERT_EQ(30, minutes);
+
+    ASSERT_FALSE(Formatter::ParseTimeInput("12x", &hours, &minutes));
+
+    ASSERT_FALSE(Formatter::ParseTimeInput("12xx", &hours, &minutes));
+
+    ASSERT_FALSE(Formatter::ParseTimeInput(":", &hours, &minutes));
+
+    ASSERT_FALSE(Formatter::ParseTimeInput("11:", &hours, &minutes));
+
+    ASSERT_FALSE(Formatter::ParseTimeInput(":20", &hours, &minutes));
+
+    ASSERT_FALSE(Formatter::ParseTimeInput("11:xx", &hours, &minutes));
+
+    ASSERT_TRUE(Formatter::ParseTimeInput("11:20", &hours, &minutes));
+    ASSERT_EQ(11, hours);
+    ASSERT_EQ(20, minutes);
+
+    ASSERT_TRUE(Formatter::ParseTimeInput("5:30", &hours, &minutes));
+    ASSERT_EQ(5, hours);
+    ASSERT_EQ(30, minutes);
+
+    ASSERT_TRUE(Formatter::ParseTimeInput("5:30 PM", &hours, &minutes));
+    ASSERT_EQ(17, hours);
+    ASSERT_EQ(30, minutes);
+
+    ASSERT_TRUE(Formatter::ParseTimeInput("5:30 odp.", &hours, &minutes));
+    ASSERT_EQ(17, hours);
+    ASSERT_EQ(30, minutes);
+
+    ASSERT_TRUE(Formatter::ParseTimeInput("17:10", &hours, &minutes));
+    ASSERT_EQ(17, hours);
+    ASSERT_EQ(10, minutes);
+
+    ASSERT_TRUE(Formatter::ParseTimeInput("12:00 AM", &hours, &minutes));
+    ASSERT_EQ(0, hours);
+    ASSERT_EQ(0, minutes);
+
+    ASSERT_TRUE(Formatter::ParseTimeInput("12:00 dop.", &hours, &minutes));
+    ASSERT_EQ(0, hours);
+    ASSERT_EQ(0, minutes);
+
+    ASSERT_FALSE(Formatter::ParseTimeInput("NOT VALID", &hours, &minutes));
+}
+
+TEST(Formatter, FormatTimeForTimeEntryEditor) {
+    ASSERT_EQ("", Formatter::FormatTimeForTimeEntryEditor(0));
+
+    //  date -r 1412950844
+    //  Fri Oct 10 16:20:44 CEST 2014
+    time_t t(1412950844);
+
+    std::string res = Formatter::FormatTimeForTimeEntryEditor(t);
+    ASSERT_NE(std::string::npos, res.find(":20"));
+
+    res = Formatter::FormatTimeForTimeEntryEditor(t);
+    ASSERT_NE(std::string::npos, res.find(":20"));
+}
+
+TEST(Formatter, FormatDateHeader) {
+    ASSERT_EQ("", Formatter::FormatDateHeader(0));
+
+    //  date -r 1412120844
+    //  Wed Oct  1 01:47:24 CEST 2014
+    time_t t(1412120844);
+    std::string res = Formatter::FormatDateHeader(t);
+    ASSERT_TRUE("Wed, 01 Oct" == res || "Tue, 30 Sep" == res);
+
+    t = time(0);
+    ASSERT_EQ("Today", Formatter::FormatDateHeader(t));
+
+    t = t - 86400;
+    ASSERT_EQ("Yesterday", Formatter::FormatDateHeader(t));
+}
+
+TEST(Formatter, Format8601) {
+    ASSERT_EQ("null", Formatter::Format8601(0));
+
+    //  date -r 1412220844
+    //  Thu Oct  2 05:34:04 CEST 2014
+    time_t t(1412220844);
+
+    ASSERT_EQ("2014-10-02T03:34:04Z", Formatter::Format8601(t));
+}
+
+TEST(Formatter, Parse8601) {
+    ASSERT_EQ(0, Formatter::Parse8601("null"));
+
+    //  date -r 1412220844
+    //  Thu Oct  2 05:34:04 CEST 2014
+    time_t t(1412220844);
+
+    ASSERT_EQ(t, Formatter::Parse8601("2014-10-02T03:34:04Z"));
+
+    ASSERT_EQ(0, Formatter::Parse8601("invalid value"));
+}
+
+TEST(Formatter, FormatDurationForDateHeader) {
+    ASSERT_EQ("0 h 00 min", Formatter::FormatDurationForDateHeader(0));
+    ASSERT_EQ("0 h 00 min", Formatter::FormatDurationForDateHeader(30));
+    ASSERT_EQ("0 h 02 min", Formatter::FormatDurationForDateHeader(120));
+    ASSERT_EQ("1 h 30 min", Formatter::FormatDurationForDateHeader(5400));
+}
+
+TEST(Formatter, FormatDurationClassic) {
+    ASSERT_EQ("0 sec", Formatter::FormatDuration(0, Format::Classic));
+    ASSERT_EQ("30 sec", Formatter::FormatDuration(30, Format::Classic));
+    ASSERT_EQ("02:00 min", Formatter::FormatDuration(120, Format::Classic));
+    ASSERT_EQ("01:30:00", Formatter::FormatDuration(5400, Format::Classic));
+    ASSERT_EQ("01:00:00", Formatter::FormatDuration(3600, Format::Classic));
+}
+
+TEST(Formatter, FormatDurationImproved) {
+    ASSERT_EQ("0:00:00", Formatter::FormatDuration(0, Format::Improved));
+    ASSERT_EQ("0:00:30", Formatter::FormatDuration(30, Format::Improved));
+    ASSERT_EQ("0:02:00", Formatter::FormatDuration(120, Format::Improved));
+    ASSERT_EQ("1:30:00", Formatter::FormatDuration(5400, Format::Improved));
+}
+
+TEST(Formatter, FormatDurationDecimal) {
+    ASSERT_EQ("0.00 h", Formatter::FormatDuration(0, Format::Decimal));
+    ASSERT_EQ("0.01 h", Formatter::FormatDuration(30, Format::Decimal));
+    ASSERT_EQ("0.03 h", Formatter::FormatDuration(120, Format::Decimal));
+    ASSERT_EQ("1.50 h", Formatter::FormatDuration(5400, Format::Decimal));
+}
+
+TEST(Formatter, FormatDecimal) {
+    const int kMinute = 60;
+    ASSERT_EQ("0.00 h",
+              Formatter::FormatDuration(0*kMinute, Format::Decimal));
+    ASSERT_EQ("0.17 h",
+              Formatter::FormatDuration(10*kMinute, Format::Decimal));
+    ASSERT_EQ("0.25 h",
+              Formatter::FormatDuration(15*kMinute, Format::Decimal));
+    ASSERT_EQ("0.33 h",
+              Formatter::FormatDuration(20*kMinute, Format::Decimal));
+    ASSERT_EQ("0.50 h",
+              Formatter::FormatDuration(30*kMinute, Format::Decimal));
+    ASSERT_EQ("0.58 h",
+              Formatter::FormatDuration(35*kMinute, Format::Decimal));
+    ASSERT_EQ("0.67 h",
+              Formatter::FormatDuration(40*kMinute, Format::Decimal));
+    ASSERT_EQ("0.75 h",
+              Formatter::FormatDuration(45*kMinute, Format::Decimal));
+    ASSERT_EQ("0.83 h",
+              Formatter::FormatDuration(50*kMinute, Format::Decimal));
+    ASSERT_EQ("0.92 h",
+              Formatter::FormatDuration(55*kMinute, Format::Decimal));
+    ASSERT_EQ("1.00 h",
+              Formatter::FormatDuration(60*kMinute, Format::Decimal));
+}
+
+TEST(Formatter, JoinTaskName) {
+    std::string res = Formatter::JoinTaskName(0, 0, 0);
+    ASSERT_EQ("", res);
+
+    Task t;
+    t.SetName("Task name");
+    res = Formatter::JoinTaskName(&t, 0, 0);
+    ASSERT_EQ("Task name", res);
+
+    Project p;
+    p.SetName("Project name");
+    res = Formatter::JoinTaskName(0, &p, 0);
+    ASSERT_EQ(p.Name(), res);
+
+    res = Formatter::JoinTaskName(&t, &p, 0);
+    ASSERT_EQ("Task name. Project name", res);
+
+    Client c;
+    c.SetName("Customer name");
+    res = Formatter::JoinTaskName(0, 0, &c);
+    ASSERT_EQ(c.Name(), res);
+
+    res = Formatter::JoinTaskName(&t, 0, &c);
+    ASSERT_EQ("Task name. Customer name", res);
+
+    res = Formatter::JoinTaskName(0, &p, &c);
+    ASSERT_EQ("Project name. Customer name", res);
+
+    res = Formatter::JoinTaskName(&t, &p, &c);
+    ASSERT_EQ("Task name. Project name. Customer name", res);
+}
+
+TEST(JSON, EscapeJSONString) {
+    std::string text("https://github.com/bartschuller");
+    ASSERT_EQ(text, Formatter::EscapeJSONString(text));
+    ASSERT_EQ("\"", Formatter::EscapeJSONString("\""));
+    ASSERT_EQ(" ", Formatter::EscapeJSONString("\t"));
+}
+
+TEST(JSON, UserID) {
+    Poco::UInt64 user_id(0);
+    ASSERT_EQ(noError,
+              User::UserID("{\"data\": {\"id\": 12345}}", &user_id));
+    ASSERT_EQ(Poco::UInt64(12345), user_id);
+}
+
+TEST(JSON, LoginToken) {
+    std::string token("");
+    ASSERT_EQ(noError,
+              User::LoginToken("{\"login_token\": \"foobar\"}", &token));
+    ASSERT_EQ("foobar", token);
+}
+
+TEST(JSON, StreamReaderReadsValuesOneByOne) {
+    std::istringstream in(
+        "{\"since\": 1412220389, \"data\": {"
+        "\"name\": \"caf\\u00e9 \\ud83d\\ude00\","
+        " \"list\": [ {\"id\": 1, \"ok\": true},"
+        " {\"id\": 18446744073709551615, \"x\": null}, -2.5e1, [] ],"
+        " \"skipped\": {\"a\": [1, {\"b\": \"\\\"}\"}]}}}");
+    JSONStreamReader reader(&in);
+
+    reader.BeginObject();
+    std::string key("");
+    ASSERT_TRUE(reader.NextMember(&key));
+    ASSERT_EQ("since", key);
+    Json::Value value;
+    reader.ReadValue(&value);
+    ASSERT_EQ(Poco::UInt64(1412220389), value.asUInt64());
+
+    ASSERT_TRUE(reader.NextMember(&key));
+    ASSERT_EQ("data", key);
+    ASSERT_TRUE(reader.AtObject());
+    reader.BeginObject();
+
+    ASSERT_TRUE(reader.NextMember(&key));
+    ASSERT_EQ("name", key);
+    reader.ReadValue(&value);
+    ASSERT_EQ("caf\xC3\xA9 \xF0\x9F\x98\x80", value.asString());
+
+    ASSERT_TRUE(reader.NextMember(&key));
+    ASSERT_EQ("list", key);
+    ASSERT_TRUE(reader.AtArray());
+    reader.BeginArray();
+    ASSERT_TRUE(reader.NextElement());
+    reader.ReadValue(&value);
+    ASSERT_EQ(Poco::UInt64(1), value["id"].asUInt64());
+    ASSERT_TRUE(value["ok"].asBool());
+    ASSERT_TRUE(reader.NextElement());
+    reader.ReadValue(&value);
+    ASSERT_EQ(Poco::UInt64(18446744073709551615ULL), value["id"].asUInt64());
+    ASSERT_TRUE(value["x"].isNull());
+    ASSERT_TRUE(reader.NextElement());
+    reader.ReadValue(&value);
+    ASSERT_EQ(-25.0, value.asDouble());
+    ASSERT_TRUE(reader.NextElement());
+    reader.ReadValue(&value);
+    ASSERT_TRUE(value.isArray());
+    ASSERT_EQ(Json::ArrayIndex(0), value.size());
+    ASSERT_FALSE(reader.NextElement());
+
+    ASSERT_TRUE(reader.NextMember(&key));
+    ASSERT_EQ("skipped", key);
+    reader.SkipValue();
+    ASSERT_FALSE(reader.NextMember(&key));
+    ASSERT_FALSE(reader.NextMember(&key));
+    reader.End();
+
+    std::istringstream broken("{\"a\": 1 \"b\": 2}");
+    JSONStreamReader broken_reader(&broken);
+    ASSERT_THROW(broken_reader.ReadValue(&value), Poco::SyntaxException);
+}
+
+TEST(JSON, WriterWritesCompactJSON) {
+    std::string json("");
+    JSONWriter writer(&json);
+    writer.BeginObject();
+    writer.Key("id");
+    writer.UInt(36253522);
+    writer.Key("duration");
+    writer.Int(-1417000000);
+    writer.Key("title");
+    writer.String("\"Õhtu\"\t\\ {päev}\n\x01");
+    writer.Key("tags");
+    writer.BeginArray();
+    writer.String("a");
+    writer.Bool(true);
+    writer.Null();
+    writer.BeginObject();
+    writer.EndObject();
+    writer.EndArray();
+    writer.EndObject();
+
+    ASSERT_EQ("{\"id\":36253522,\"duration\":-1417000000,"
+              "\"title\":\"\\\"Õhtu\\\"\\t\\\\ {päev}\\n\\u0001\","
+              "\"tags\":[\"a\",true,null,{}]}", json);
+
+    Json::Value root;
+    Json::Reader reader;
+    ASSERT_TRUE(reader.parse(json, root));
+    ASSERT_EQ("\"Õhtu\"\t\\ {päev}\n\x01", root["title"].asString());
+
+    // Trees come out the same as from Json::FastWriter, less the newline
+    std::string rewritten("");
+    JSONWriter tree_writer(&rewritten);
+    tree_writer.Value(root);
+    std::string fast = Json::FastWriter().write(root);
+    ASSERT_EQ(fast.substr(0, fast.size() - 1), rewritten);
+}
+
+TEST(JSON, ConvertTimelineToJSON) {
+    const std::string desktop_id("12345");
+
+    TimelineEvent event;
+    event.start_time = time(0) - 10;
+    event.end_time = time(0);
+    event.filename = "Is this the real life?";
+    event.title = "Is this just fantasy?";
+    event.idle = true;
+    {
+        std::vector<TimelineEvent> list;
+        list.push_back(event);
+
+        std::string json = convertTimelineToJSON(list, desktop_id);
+
+        Json::Value root;
+        Json::Reader reader;
+        ASSERT_TRUE(reader.parse(json, root));
+        ASSERT_EQ(std::size_t(1), root.size());
+
+        const Json::Value v = root[0];
+        ASSERT_EQ("timeline", v["created_with"].asString());
+        ASSERT_EQ(desktop_id, v["desktop_id"].asString());
+        ASSERT_EQ(event.start_time, v["start_time"].asInt());
+        ASSERT_EQ(event.end_time, v["end_time"].asInt());
+    }
+
+    event.idle = false;
+    {
+        std::vector<TimelineEvent> list;
+        list.push_back(event);
+
+        std::string json = convertTimelineToJSON(list, desktop_id);
+
+        Json::Value root;
+        Json::Reader reader;
+        ASSERT_TRUE(reader.parse(json, root));
+        ASSERT_EQ(std::size_t(1), root.size());
+
+        const Json::Value v = root[0];
+        ASSERT_EQ("timeline", v["created_with"].asString());
+        ASSERT_EQ(desktop_id, v["desktop_id"].asString());
+        ASSERT_EQ(event.start_time, v["start_time"].asInt());
+        ASSERT_EQ(event.end_time, v["end_time"].asInt());
+        ASSERT_EQ(event.filename, v["filename"].asString());
+        ASSERT_EQ(event.title, v["title"].asString());
+    }
+
+    event.title = "Õhtu jõuab, päev veereb {\"\b\t";
+    {
+        std::vector<TimelineEvent> list;
+        list.push_back(event);
+
+        std::string json = convertTimelineToJSON(list, desktop_id);
+
+        Json::Value root;
+        Json::Reader reader;
+        ASSERT_TRUE(reader.parse(json, root));
+        ASSERT_EQ(std::size_t(1), root.size());
+
+        const Json::Value v = root[0];
+        ASSERT_EQ(event.title, v["title"].asString());
+    }
+}
+
+TEST(JSON, Tag) {
+    std::string json("{\"id\":36253522,\"wid\":123456788,\"name\":\"create new\",\"at\":\"2013-10-15T08:51:46+00:00\",\"guid\":\"041390ba-ed9c-b477-b949-1a4ebb60a9ce\"}");  // NOLINT
+
+    Tag t;
+    t.LoadFromJSON(jsonStringToValue(json));
+    ASSERT_EQ(Poco::UInt64(36253522), t.ID());
+    ASSERT_EQ(Poco::UInt64(123456788), t.WID());
+    ASSERT_EQ("create new", t.Name());
+    ASSERT_EQ("041390ba-ed9c-b477-b949-1a4ebb60a9ce", t.GUID());
+}
+
+TEST(JSON, Workspace) {
+    std::string json("{\"id\":123456722,\"name\":\"A deleted workspace\",\"premium\":false,\"admin\":true,\"default_hourly_rate\":0,\"default_currency\":\"USD\",\"only_admins_may_create_projects\":false,\"only_admins_see_billable_rates\":false,\"rounding\":1,\"rounding_minutes\":0,\"at\":\"2013-07-02T13:45:36+00:00\",\"server_deleted_at\":\"2013-08-22T09:05:31+00:00\"}");  // NOLINT
+
+    Workspace w;
+    w.LoadFromJSON(jsonStringToValue(json));
+    ASSERT_EQ(Poco::UInt64(123456722), w.ID());
+    ASSERT_EQ("A deleted workspace", w.Name());
+    ASSERT_FALSE(w.Premium());
+    ASSERT_TRUE(w.Admin());
+    ASSERT_FALSE(w.OnlyAdminsMayCreateProjects());
+}
+
+TEST(JSON, Task) {
+    std::string json("{\"id\":1894712,\"name\":\"A deleted task\",\"wid\":123456789,\"pid\":2598305,\"active\":true,\"at\":\"2013-06-05T07:58:41+00:00\",\"estimated_seconds\":0,\"server_deleted_at\":\"2013-08-22T09:05:31+00:00\"}");  // NOLINT
+
+    Task t;
+    t.LoadFromJSON(jsonStringToValue(json));
+    ASSERT_EQ(Poco::UInt64(1894712), t.ID());
+    ASSERT_EQ("A deleted task", t.Name());
+    ASSERT_EQ(Poco::UInt64(123456789), t.WID());
+    ASSERT_EQ(Poco::UInt64(2598305), t.PID());
+}
+
+TEST(JSON, Project) {
+    std::string json("{\"id\":2598323,\"guid\":\"2f0b8f11-f898-d992-3e1a-6bc261fc41ef\",\"wid\":123456789,\"name\":\"A deleted project\",\"billable\":true,\"is_private\":false,\"active\":false,\"template\":false,\"at\":\"2013-05-13T10:19:24+00:00\",\"color\":\"21\",\"auto_estimates\":true,\"server_deleted_at\":\"2013-08-22T09:05:31+00:00\"}");  // NOLINT
+
+    Project p;
+    p.LoadFromJSON(jsonStringToValue(json));
+    ASSERT_EQ(Poco::UInt64(2598323), p.ID());
+    ASSERT_EQ("A deleted project", p.Name());
+    ASSERT_EQ(Poco::UInt64(123456789), p.WID());
+    ASSERT_EQ("2f0b8f11-f898-d992-3e1a-6bc261fc41ef", p.GUID());
+
+    Project p2;
+    p2.LoadFromJSON(p.SaveToJSON());
+    ASSERT_EQ(p.ID(), p2.ID());
+    ASSERT_EQ(p.Name(), p2.Name());
+    ASSERT_EQ(p.WID(), p2.WID());
+    ASSERT_EQ(p.GUID(), p2.GUID());
+    ASSERT_EQ(p.CID(), p2.CID());
+    ASSERT_EQ(p.Billable(), p2.Billable());
+    ASSERT_EQ(p.IsPrivate(), p2.IsPrivate());
+    ASSERT_EQ(p.UIModifiedAt(), p2.UIModifiedAt());
+}
+
+TEST(JSON, Client) {
+    std::string json("{\"id\":878318,\"guid\":\"59b464cd-0f8e-e601-ff44-f135225a6738\",\"wid\":123456789,\"name\":\"Big Client\",\"at\":\"2013-03-27T13:17:18+00:00\"}");  // NOLINT
+
+    Client c;
+    c.LoadFromJSON(jsonStringToValue(json));
+    ASSERT_EQ(Poco::UInt64(878318), c.ID());
+    ASSERT_EQ("Big Client", c.Name());
+    ASSERT_EQ(Poco::UInt64(123456789), c.WID());
+    ASSERT_EQ("59b464cd-0f8e-e601-ff44-f135225a6738", c.GUID());
+
+    Client c2;
+    c2.LoadFromJSON(c.SaveToJSON());
+    ASSERT_EQ(c.ID(), c2.ID());
+    ASSERT_EQ(c.Name(), c2.Name());
+    ASSERT_EQ(c.WID(), c2.WID());
+    ASSERT_EQ(c.GUID(), c2.GUID());
+}
+
+TEST(JSON, TimeEntry) {
+    std::string json("{\"id\":89818612,\"guid\":\"07fba193-91c4-0ec8-2345-820df0548123\",\"wid\":123456789,\"pid\":2567324,\"billable\":true,\"start\":\"2013-09-05T06:33:50+00:00\",\"stop\":\"2013-09-05T08:19:46+00:00\",\"duration\":6356,\"description\":\"A deleted time entry\",\"tags\":[\"ahaa\"],\"duronly\":false,\"at\":\"2013-09-05T08:19:45+00:00\",\"server_deleted_at\":\"2013-08-22T09:05:31+00:00\"}");  // NOLINT
+
+    TimeEntry t;
+    t.LoadFromJSON(jsonStringToValue(json));
+    ASSERT_EQ(Poco::UInt64(89818612), t.ID());
+    ASSERT_EQ(Poco::UInt64(2567324), t.PID());
+    ASSERT_EQ(Poco::UInt64(123456789), t.WID());
+    ASSERT_EQ("07fba193-91c4-0ec8-2345-820df0548123", t.GUID());
+    ASSERT_TRUE(t.Billable());
+    ASSERT_EQ(Poco::UInt64(1378362830000 / 1000), t.Start());
+    ASSERT_EQ(Poco::UInt64(1378369186000 / 1000), t.Stop());
+    ASSERT_EQ(Poco::Int64(6356), t.DurationInSeconds());
+    ASSERT_EQ("A deleted time entry", t.Description());
+    ASSERT_EQ("ahaa", t.Tags());
+    ASSERT_FALSE(t.DurOnly());
 
-    ASSERT_EQ(0, Formatter::Parse8601("invalid value"));
+    TimeEntry t2;
+    t2.LoadFromJSON(t.SaveToJSON());
+    ASSERT_EQ(t.ID(), t2.ID());
+    ASSERT_EQ(t.PID(), t2.PID());
+    ASSERT_EQ(t.WID(), t2.WID());
+    ASSERT_EQ(t.GUID(), t2.GUID());
+    ASSERT_EQ(t.Billable(), t2.Billable());
+    ASSERT_EQ(t.Start(), t2.Start());
+    ASSERT_EQ(t.Stop(), t2.Stop());
+    ASSERT_EQ(t.DurationInSeconds(), t2.DurationInSeconds());
+    ASSERT_EQ(t.Description(), t2.Description());
+    ASSERT_EQ(t.Tags(), t2.Tags());
+    ASSERT_EQ(t.DurOnly(), t2.DurOnly());
 }
 
-TEST(Formatter, FormatDurationForDateHeader) {
-    ASSERT_EQ("0 h 00 min", Formatter::FormatDurationForDateHeader(0));
-    ASSERT_EQ("0 h 00 min", Formatter::FormatDurationForDateHeader(30));
-    ASSERT_EQ("0 h 02 min", Formatter::FormatDurationForDateHeader(120));
-    ASSERT_EQ("1 h 30 min", Formatter::FormatDurationForDateHeader(5400));
+TEST(User, TimeOfDayFormat) {
+    User u;
+    u.SetTimeOfDayFormat("H:mm");
+    ASSERT_EQ("H:mm", u.TimeOfDayFormat());
+    ASSERT_EQ("H:mm", Formatter::TimeOfDayFormat);
+
+    u.SetTimeOfDayFormat("h:mm A");
+    ASSERT_EQ("h:mm A", u.TimeOfDayFormat());
+    ASSERT_EQ("h:mm A", Formatter::TimeOfDayFormat);
 }
 
-TEST(Formatter, FormatDurationClassic) {
-    ASSERT_EQ("0 sec", Formatter::FormatDuration(0, Format::Classic));
-    ASSERT_EQ("30 sec", Formatter::FormatDuration(30, Format::Classic));
-    ASSERT_EQ("02:00 min", Formatter::FormatDuration(120, Format::Classic));
-    ASSERT_EQ("01:30:00", Formatter::FormatDuration(5400, Format::Classic));
-    ASSERT_EQ("01:00:00", Formatter::FormatDuration(3600, Format::Classic));
+TEST(User, DurationFormat) {
+    User u;
+    u.SetDurationFormat("classic");
+    ASSERT_EQ("classic", u.DurationFormat());
+    ASSERT_EQ("classic", Formatter::DurationFormat);
+
+    u.SetDurationFormat("decimal");
+    ASSERT_EQ("decimal", u.DurationFormat());
+    ASSERT_EQ("decimal", Formatter::DurationFormat);
 }
 
-TEST(Formatter, FormatDurationImproved) {
-    ASSERT_EQ("0:00:00", Formatter::FormatDuration(0, Format::Improved));
-    ASSERT_EQ("0:00:30", Formatter::FormatDuration(30, Format::Improved));
-    ASSERT_EQ("0:02:00", Formatter::FormatDuration(120, Format::Improved));
-    ASSERT_EQ("1:30:00", Formatter::FormatDuration(5400, Format::Improved));
+#if defined(__linux__)
+// Peak resident memory, in kB
+static Poco::UInt64 peakMemory() {
+    Poco::FileInputStream status("/proc/self/status");
+    std::string line("");
+    while (std::getline(status, line)) {
+        if (line.find("VmHWM:") == 0) {
+            return Poco::NumberParser::parseUnsigned64(
+                Poco::trim(line.substr(6, line.find("kB") - 6)));
+        }
+    }
+    return 0;
 }
 
-TEST(Formatter, FormatDurationDecimal) {
-    ASSERT_EQ("0.00 h", Formatter::FormatDuration(0, Format::Decimal));
-    ASSERT_EQ("0.01 h", Formatter::FormatDuration(30, Format::Decimal));
-    ASSERT_EQ("0.03 h", Formatter::FormatDuration(120, Format::Decimal));
-    ASSERT_EQ("1.50 h", Formatter::FormatDuration(5400, Format::Decimal));
+// Reset peak to current resident memory
+static Poco::UInt64 resetPeakMemory() {
+    // Return freed memory first, so it is not reused unseen
+    malloc_trim(0);
+    Poco::FileOutputStream clear_refs("/proc/self/clear_refs");
+    clear_refs << "5";
+    clear_refs.close();
+    return peakMemory();
 }
 
-TEST(Formatter, FormatDecimal) {
-    const int kMinute = 60;
-    ASSERT_EQ("0.00 h",
-              Formatter::FormatDuration(0*kMinute, Format::Decimal));
-    ASSERT_EQ("0.17 h",
-              Formatter::FormatDuration(10*kMinute, Format::Decimal));
-    ASSERT_EQ("0.25 h",
-              Formatter::FormatDuration(15*kMinute, Format::Decimal));
-    ASSERT_EQ("0.33 h",
-              Formatter::FormatDuration(20*kMinute, Format::Decimal));
-    ASSERT_EQ("0.50 h",
-              Formatter::FormatDuration(30*kMinute, Format::Decimal));
-    ASSERT_EQ("0.58 h",
-              Formatter::FormatDuration(35*kMinute, Format::Decimal));
-    ASSERT_EQ("0.67 h",
-              Formatter::FormatDuration(40*kMinute, Format::Decimal));
-    ASSERT_EQ("0.75 h",
-              Formatter::FormatDuration(45*kMinute, Format::Decimal));
-    ASSERT_EQ("0.83 h",
-              Formatter::FormatDuration(50*kMinute, Format::Decimal));
-    ASSERT_EQ("0.92 h",
-              Formatter::FormatDuration(55*kMinute, Format::Decimal));
-    ASSERT_EQ("1.00 h",
-              Formatter::FormatDuration(60*kMinute, Format::Decimal));
+// Heap memory in use, including large mmapped blocks, in bytes
+static Poco::UInt64 heapInUse() {
+#if __GLIBC_PREREQ(2, 33)
+    struct mallinfo2 info = mallinfo2();
+#else
+    struct mallinfo info = mallinfo();
+#endif
+    return info.uordblks + info.hblkhd;
 }
+#endif
 
-TEST(Formatter, JoinTaskName) {
-    std::string res = Formatter::JoinTaskName(0, 0, 0);
-    ASSERT_EQ("", res);
+// testdata/me.json with its time entries repeated,
+// written without building the document in memory
+void writeUserDataJSON(const std::string filename,
+                       const Json::ArrayIndex copies) {
+    Json::Value root;
+    Json::Reader reader;
+    ASSERT_TRUE(reader.parse(loadTestData(), root));
+    Json::Value list = root["data"]["time_entries"];
+    const std::string placeholder("\"TIME_ENTRIES\"");
+    root["data"]["time_entries"] = "TIME_ENTRIES";
+    std::string json = Json::FastWriter().write(root);
+    size_t pos = json.find(placeholder);
+    ASSERT_NE(std::string::npos, pos);
+
+    Poco::FileOutputStream out(filename);
+    out << json.substr(0, pos) << "[";
+    Json::UInt64 id(0);
+    for (Json::ArrayIndex i = 0; i < copies; i++) {
+        for (Json::ArrayIndex j = 0; j < list.size(); j++) {
+            Json::Value te = list[j];
+            te.removeMember("server_deleted_at");
+            std::stringstream guid;
+            guid << "07fba193-91c4-0ec8-" << j << "-" << i;
+            te["id"] = ++id;
+            te["guid"] = guid.str();
+            if (id > 1) {
+                out << ",";
+            }
+            out << Json::FastWriter().write(te);
+        }
+    }
+    out << "]" << json.substr(pos + placeholder.size());
+    out.close();
+}
 
-    Task t;
-    t.SetName("Task name");
-    res = Formatter::JoinTaskName(&t, 0, 0);
-    ASSERT_EQ("Task name", res);
+TEST(User, StreamsUserDataJSON) {
+    const std::string filename("streamed_me.json");
+    const Json::ArrayIndex kCopies = 100;
+    writeUserDataJSON(filename, kCopies);
+    ASSERT_FALSE(HasFatalFailure());
+
+    User streamed;
+    {
+        Poco::FileInputStream in(filename);
+        ASSERT_EQ(noError,
+                  streamed.LoadUserAndRelatedDataFromJSONStream(&in, true));
+    }
+    ASSERT_EQ(Poco::UInt64(10471231), streamed.ID());
+    ASSERT_EQ(Poco::UInt64(1379068550), streamed.Since());
+    ASSERT_EQ(size_t(6 * kCopies), streamed.related.TimeEntries.size());
+    ASSERT_EQ(size_t(2), streamed.related.Projects.size());
+
+    // The same data loaded from a string gives the same models
+    User loaded;
+    ASSERT_EQ(noError,
+              loaded.LoadUserAndRelatedDataFromJSONString(
+                  loadTestDataFile(filename), true));
+    ASSERT_EQ(streamed.related.TimeEntries.size(),
+              loaded.related.TimeEntries.size());
+    for (size_t i = 0; i < loaded.related.TimeEntries.size(); i++) {
+        TimeEntry *te = loaded.related.TimeEntries[i];
+        ASSERT_TRUE(streamed.related.TimeEntryByID(te->ID()));
+        ASSERT_EQ(te->String(),
+                  streamed.related.TimeEntryByID(te->ID())->String());
+    }
+
+    Poco::File(filename).remove(false);
+}
+
+#if defined(__linux__)
+TEST(User, DISABLED_StreamsLargeUserDataJSON) {
+    const std::string filename("large_me.json");
+    const Json::ArrayIndex kCopies = 10000;
+    writeUserDataJSON(filename, kCopies);
+    ASSERT_FALSE(HasFatalFailure());
+    Poco::UInt64 size = Poco::File(filename).getSize();
+
+    // For reference, loading the models while the body
+    // and its DOM are held in memory, as it used to be
+    Poco::UInt64 before = resetPeakMemory();
+    {
+        std::string body = loadTestDataFile(filename);
+        Json::Value root;
+        ASSERT_TRUE(Json::Reader().parse(body, root));
+        User user;
+        std::istringstream in(body);
+        ASSERT_EQ(noError,
+                  user.LoadUserAndRelatedDataFromJSONStream(&in, true));
+    }
+    Poco::UInt64 dom_peak = peakMemory() - before;
+
+    before = resetPeakMemory();
+    Poco::UInt64 streamed_peak(0);
+    {
+        User streamed;
+        {
+            Poco::FileInputStream in(filename);
+            ASSERT_EQ(noError,
+                      streamed.LoadUserAndRelatedDataFromJSONStream(
+                          &in, true));
+        }
+        streamed_peak = peakMemory() - before;
+        ASSERT_EQ(size_t(6 * kCopies), streamed.related.TimeEntries.size());
+    }
+
+    RecordProperty("json_kb", static_cast<int>(size / 1024));
+    RecordProperty("streamed_peak_kb", static_cast<int>(streamed_peak));
+    RecordProperty("dom_peak_kb", static_cast<int>(dom_peak));
+
+    ASSERT_LT(streamed_peak, dom_peak);
+
+    Poco::File(filename).remove(false);
+}
+#endif
+
+TEST(ModelPool, AllocatesFromSlabsAndReusesReleasedObjects) {
+    ModelPool pool(40, 4);
+    ASSERT_EQ(size_t(0), pool.Capacity());
+
+    std::vector<char *> objects;
+    for (size_t i = 0; i < 5; i++) {
+        objects.push_back(static_cast<char *>(pool.Allocate()));
+    }
+    ASSERT_EQ(size_t(5), pool.Size());
+    ASSERT_EQ(size_t(2 * 4 * 48), pool.Capacity());
 
+    // Objects of a slab are next to each other
+    ASSERT_EQ(objects[0] + 48, objects[1]);
+    ASSERT_EQ(objects[2] + 48, objects[3]);
+
+    pool.Release(objects[1]);
+    ASSERT_EQ(size_t(4), pool.Size());
+    ASSERT_EQ(objects[1], pool.Allocate());
+    ASSERT_EQ(size_t(2 * 4 * 48), pool.Capacity());
+}
+
+TEST(StringPool, InternsEqualValuesOnce) {
+    StringPool pool;
+    std::string value("TogglDesktop/7.3.346");
+    StringPool::Entry *interned = pool.Intern(value);
+    ASSERT_EQ(value, interned->first);
+    ASSERT_EQ(interned, pool.Intern(std::string("TogglDesktop/7.3.346")));
+    StringPool::Entry *other = pool.Intern("TogglDesktop/7.3.347");
+    ASSERT_NE(interned, other);
+    ASSERT_EQ(StringPool::Empty(), pool.Intern(""));
+    ASSERT_EQ(size_t(2), pool.Size());
+
+    // Values are removed with their last reference
+    pool.Release(other);
+    ASSERT_EQ(size_t(1), pool.Size());
+    pool.Release(interned);
+    ASSERT_EQ(size_t(1), pool.Size());
+    pool.Release(interned);
+    ASSERT_EQ(size_t(0), pool.Size());
+}
+
+TEST(InternedString, DropsValuesNoLongerReferenced) {
+    StringPool &pool = StringPool::Shared();
+    const size_t size = pool.Size();
+    {
+        InternedString a("Unreferenced after this test");
+        InternedString b(a);
+        InternedString c;
+        c = b;
+        ASSERT_EQ(&a.str(), &c.str());
+        ASSERT_EQ(size + 1, pool.Size());
+
+        a = "Another unreferenced value";
+        ASSERT_EQ(size + 2, pool.Size());
+        a += " with a suffix";
+        ASSERT_EQ(size + 2, pool.Size());
+
+        // Models release the values they no longer use
+        TimeEntry te;
+        te.SetDescription("Unreferenced description");
+        ASSERT_EQ(size + 3, pool.Size());
+        te.SetDescription("Another unreferenced value with a suffix");
+        ASSERT_EQ(size + 2, pool.Size());
+    }
+    ASSERT_EQ(size, pool.Size());
+}
+
+TEST(InternedString, EqualValuesShareStorage) {
+    std::string value("Meet");
+    value += "ing";
+    InternedString a(value);
+    InternedString b("Meeting");
+    ASSERT_TRUE(a == b);
+    ASSERT_EQ(&a.str(), &b.str());
+    ASSERT_EQ("Meeting", a);
+    ASSERT_EQ(value, a);
+    ASSERT_TRUE(a != InternedString("Review"));
+    ASSERT_EQ("Meeting - Design", a + " - Design");
+    ASSERT_TRUE(InternedString().empty());
+
+    // Models share the interned values
+    TimeEntry te1;
+    te1.SetDescription(value);
+    TimeEntry te2;
+    te2.SetDescription("Meeting");
+    ASSERT_EQ(&te1.Description(), &te2.Description());
     Project p;
-    p.SetName("Project name");
-    res = Formatter::JoinTaskName(0, &p, 0);
-    ASSERT_EQ(p.Name(), res);
+    p.SetName("Meeting");
+    ASSERT_EQ(&te1.Description(), &p.Name());
+}
 
-    res = Formatter::JoinTaskName(&t, &p, 0);
-    ASSERT_EQ("Task name. Project name", res);
+#define kMemoryBenchmarkTimeEntries 100000
+
+// Tags, project and client are shared by many time entries
+TimeEntry *memoryBenchmarkTimeEntry(const size_t i) {
+    const char *tags[] = { "", "billable", "billable\tmeeting",
+                           "internal\tdesign review", "support"
+                         };
+    TimeEntry *te = new TimeEntry();
+    te->SetID(i + 1);
+    te->SetUID(10471231);
+    te->SetWID(123456789);
+    te->SetPID(i % 50 + 1);
+    std::stringstream project_guid;
+    project_guid << "2f0b8f11-f898-d992-3e1a-" << 100000000000 + i % 50;
+    te->SetProjectGUID(project_guid.str());
+    std::stringstream description;
+    description << "Working on the feature number " << i % 1000;
+    te->SetDescription(description.str());
+    te->SetStart(1420113600 + i * 3600);
+    te->SetDurationInSeconds(1800);
+    te->SetStop(1420113600 + i * 3600 + 1800);
+    te->SetTags(tags[i % 5]);
+    te->SetCreatedWith("TogglDesktop/7.3.346");
+    te->EnsureGUID();
+    return te;
+}
 
-    Client c;
-    c.SetName("Customer name");
-    res = Formatter::JoinTaskName(0, 0, &c);
-    ASSERT_EQ(c.Name(), res);
+TEST(TimeEntry, SharesRepeatedValues) {
+    std::vector<TimeEntry *> list;
+    for (size_t i = 0; i < 10; i++) {
+        list.push_back(memoryBenchmarkTimeEntry(i));
+    }
 
-    res = Formatter::JoinTaskName(&t, 0, &c);
-    ASSERT_EQ("Task name. Customer name", res);
+    ASSERT_EQ("billable\tmeeting", list[2]->Tags());
+    ASSERT_EQ(size_t(2), list[2]->TagNames().size());
+    ASSERT_EQ("meeting", list[2]->TagNames()[1]);
+    ASSERT_EQ(&list[2]->CreatedWith(), &list[3]->CreatedWith());
+    ASSERT_EQ(&list[3]->Tags(), &list[8]->Tags());
 
-    res = Formatter::JoinTaskName(0, &p, &c);
-    ASSERT_EQ("Project name. Customer name", res);
+    for (size_t i = 0; i < list.size(); i++) {
+        delete list[i];
+    }
+}
 
-    res = Formatter::JoinTaskName(&t, &p, &c);
-    ASSERT_EQ("Task name. Project name. Customer name", res);
+#if defined(__linux__)
+TEST(TimeEntry, DISABLED_MemoryBenchmark) {
+    std::vector<TimeEntry *> list;
+    list.reserve(kMemoryBenchmarkTimeEntries);
+
+    Poco::UInt64 before = heapInUse();
+    for (size_t i = 0; i < kMemoryBenchmarkTimeEntries; i++) {
+        list.push_back(memoryBenchmarkTimeEntry(i));
+    }
+    Poco::UInt64 per_entry =
+        (heapInUse() - before) / kMemoryBenchmarkTimeEntries;
+    RecordProperty("bytes_per_entry", static_cast<int>(per_entry));
+
+    for (size_t i = 0; i < list.size(); i++) {
+        delete list[i];
+    }
+
+    // Separately allocated, with own copies of repeated values,
+    // a time entry took 579 bytes in this benchmark
+    ASSERT_LT(per_entry, Poco::UInt64(300));
 }
+#endif
+
+#define kPushBenchmarkTimeEntries 10000
+
+// Serializes batch updates of given number of dirty time entries
+// as a styled tree and with the compact writer, and compares them.
+void compareBatchUpdateJSON(const size_t count,
+                            Poco::Timestamp::TimeDiff *styled_micros,
+                            Poco::Timestamp::TimeDiff *compact_micros) {
+    std::vector<TimeEntry *> list;
+    for (size_t i = 0; i < count; i++) {
+        TimeEntry *te = new TimeEntry();
+        te->SetID(i + 1);
+        te->SetWID(123456789);
+        te->SetPID(i % 50 + 1);
+        std::stringstream description;
+        description << "Working on the feature number " << i % 1000;
+        te->SetDescription(description.str());
+        te->SetStart(1420113600 + i * 3600);
+        te->SetDurationInSeconds(1800);
+        te->SetStop(1420113600 + i * 3600 + 1800);
+        te->SetTags(i % 2 ? "billable\tmeeting" : "");
+        te->SetCreatedWith("TogglDesktop/7.3.346");
+        te->EnsureGUID();
+        te->SetUIModified();
+        list.push_back(te);
+    }
 
-TEST(JSON, EscapeJSONString) {
-    std::string text("https://github.com/bartschuller");
-    ASSERT_EQ(text, Formatter::EscapeJSONString(text));
-    ASSERT_EQ("\"", Formatter::EscapeJSONString("\""));
-    ASSERT_EQ(" ", Formatter::EscapeJSONString("\t"));
+    // As batch updates were serialized before
+    Poco::Stopwatch stopwatch;
+    stopwatch.start();
+    Json::Value tree;
+    for (size_t i = 0; i < list.size(); i++) {
+        Json::Value update;
+        ASSERT_EQ(noError, list[i]->BatchUpdateJSON(&update));
+        tree.append(update);
+    }
+    std::string styled = Json::StyledWriter().write(tree);
+    stopwatch.stop();
+    *styled_micros = stopwatch.elapsed();
+
+    stopwatch.restart();
+    std::string compact("");
+    JSONWriter writer(&compact);
+    writer.BeginArray();
+    for (size_t i = 0; i < list.size(); i++) {
+        ASSERT_EQ(noError, list[i]->WriteBatchUpdateJSON(&writer));
+    }
+    writer.EndArray();
+    stopwatch.stop();
+    *compact_micros = stopwatch.elapsed();
+
+    Json::Value root;
+    Json::Reader reader;
+    ASSERT_TRUE(reader.parse(compact, root));
+    ASSERT_EQ(tree.size(), root.size());
+    for (Json::ArrayIndex i = 0; i < root.size(); i++) {
+        ASSERT_EQ(Json::FastWriter().write(tree[i]),
+                  Json::FastWriter().write(root[i]));
+    }
+
+    ASSERT_LT(compact.size(), styled.size() * 2 / 3);
+
+    for (size_t i = 0; i < list.size(); i++) {
+        delete list[i];
+    }
 }
 
-TEST(JSON, UserID) {
-    Poco::UInt64 user_id(0);
-    ASSERT_EQ(noError,
-              User::UserID("{\"data\": {\"id\": 12345}}", &user_id));
-    ASSERT_EQ(Poco::UInt64(12345), user_id);
+TEST(TimeEntry, WritesCompactBatchUpdateJSON) {
+    Poco::Timestamp::TimeDiff styled_micros(0), compact_micros(0);
+    compareBatchUpdateJSON(100, &styled_micros, &compact_micros);
 }
 
-TEST(JSON, LoginToken) {
-    std::string token("");
-    ASSERT_EQ(noError,
-              User::LoginToken("{\"login_token\": \"foobar\"}", &token));
-    ASSERT_EQ("foobar", token);
+TEST(TimeEntry, DISABLED_BatchUpdateJSONBenchmark) {
+    Poco::Timestamp::TimeDiff styled_micros(0), compact_micros(0);
+    compareBatchUpdateJSON(kPushBenchmarkTimeEntries,
+                           &styled_micros, &compact_micros);
+    ASSERT_FALSE(HasFatalFailure());
+
+    RecordProperty("styled_us", static_cast<int>(styled_micros));
+    RecordProperty("compact_us", static_cast<int>(compact_micros));
+
+    ASSERT_LT(compact_micros, styled_micros);
 }
 
-TEST(JSON, ConvertTimelineToJSON) {
-    const std::string desktop_id("12345");
+namespace testing {
 
-    TimelineEvent event;
-    event.start_time = time(0) - 10;
-    event.end_time = time(0);
-    event.filename = "Is this the real life?";
-    event.title = "Is this just fantasy?";
-    event.idle = true;
-    {
-        std::vector<TimelineEvent> list;
-        list.push_back(event);
+// Replies with a JSON body, gzipped if the client accepts it.
+// Remembers the last request, with its body inflated.
+class TestRequestHandler : public Poco::Net::HTTPRequestHandler {
+ public:
+    static std::string LastContentEncoding;
+    static std::string LastBody;
+    static std::string LastURI;
 
-        std::string json = convertTimelineToJSON(list, desktop_id);
+    // Replies by request path, and since parameter if any,
+    // for example "/api/v8/me?since=0"
+    static std::map<std::string, std::string> Replies;
 
-        Json::Value root;
+    // Model names in each batch update request received
+    static std::vector<std::vector<std::string> > BatchUpdates;
+
+    // Models received in batch updates by GUID, as sent
+    static std::map<std::string, Json::Value> BatchUpdateModels;
+
+    // Accepts all updates of a batch, giving new models an ID.
+    // Like the real server, resolves GUID references only to
+    // models in the same batch.
+    static std::string BatchUpdateReply(const std::string &body) {
+        static Poco::UInt64 next_id(1000000);
+        std::map<std::string, Poco::UInt64> ids;
+
+        Json::Value updates;
         Json::Reader reader;
-        ASSERT_TRUE(reader.parse(json, root));
-        ASSERT_EQ(std::size_t(1), root.size());
+        if (!reader.parse(body, updates)) {
+            return "[]";
+        }
 
-        const Json::Value v = root[0];
-        ASSERT_EQ("timeline", v["created_with"].asString());
-        ASSERT_EQ(desktop_id, v["desktop_id"].asString());
-        ASSERT_EQ(event.start_time, v["start_time"].asInt());
-        ASSERT_EQ(event.end_time, v["end_time"].asInt());
+        Json::FastWriter writer;
+        Json::Value results(Json::arrayValue);
+        std::vector<std::string> model_names;
+        for (unsigned int i = 0; i < updates.size(); i++) {
+            const Json::Value &update = updates[i];
+            std::string model_name =
+                update["body"].getMemberNames().front();
+            model_names.push_back(model_name);
+
+            Json::Value data;
+            data["data"] = update["body"][model_name];
+            BatchUpdateModels[update["guid"].asString()] = data["data"];
+            if (!data["data"].isMember("id")) {
+                ids[update["guid"].asString()] = next_id;
+                data["data"]["id"] = Json::UInt64(next_id++);
+            }
+            // Projects can be referred to by GUID
+            if (data["data"]["pid"].isString()) {
+                data["data"]["pid"] =
+                    Json::UInt64(ids[data["data"]["pid"].asString()]);
+            }
+
+            Json::Value result;
+            result["guid"] = update["guid"];
+            result["method"] = update["method"];
+            result["status"] = 200;
+            result["content_type"] = kContentTypeApplicationJSON;
+            result["body"] = writer.write(data);
+            results.append(result);
+        }
+        BatchUpdates.push_back(model_names);
+        return writer.write(results);
+    }
+
+    static std::string ReplyKey(const std::string &uri) {
+        std::string key = uri.substr(0, uri.find('?'));
+        size_t since = uri.find("since=");
+        if (since != std::string::npos) {
+            key += "?" + uri.substr(since, uri.find('&', since) - since);
+        }
+        return key;
+    }
+
+    void handleRequest(
+        Poco::Net::HTTPServerRequest &request,
+        Poco::Net::HTTPServerResponse &response) {
+        LastContentEncoding = request.get("Content-Encoding", "");
+        std::stringstream body;
+        if ("gzip" == LastContentEncoding) {
+            Poco::InflatingInputStream inflater(
+                request.stream(),
+                Poco::InflatingStreamBuf::STREAM_GZIP);
+            Poco::StreamCopier::copyStream(inflater, body);
+        }
+        Poco::StreamCopier::copyStream(request.stream(), body);
+        LastBody = body.str();
+        LastURI = request.getURI();
+
+        std::string reply("{}");
+        std::map<std::string, std::string>::const_iterator it =
+            Replies.find(ReplyKey(LastURI));
+        if (it != Replies.end()) {
+            reply = it->second;
+        } else if ("/api/v8/batch_updates" == request.getURI()) {
+            reply = BatchUpdateReply(LastBody);
+        } else if ("/large" == request.getURI()) {
+            reply = "[";
+            for (int i = 0; i < 1000; i++) {
+                reply += "{\"id\":1},";
+            }
+            reply += "{}]";
+        }
+
+        response.setContentType(kContentTypeApplicationJSON);
+        if (request.get("Accept-Encoding", "").find("gzip")
+                != std::string::npos) {
+            std::ostringstream compressed;
+            Poco::DeflatingOutputStream deflater(
+                compressed,
+                Poco::DeflatingStreamBuf::STREAM_GZIP);
+            deflater << reply;
+            deflater.close();
+            reply = compressed.str();
+            response.set("Content-Encoding", "gzip");
+        }
+        response.sendBuffer(reply.data(), reply.size());
+    }
+};
+
+std::string TestRequestHandler::LastContentEncoding("");
+std::string TestRequestHandler::LastBody("");
+std::string TestRequestHandler::LastURI("");
+std::map<std::string, std::string> TestRequestHandler::Replies;
+std::vector<std::vector<std::string> > TestRequestHandler::BatchUpdates;
+std::map<std::string, Json::Value> TestRequestHandler::BatchUpdateModels;
+
+class TestRequestHandlerFactory
+    : public Poco::Net::HTTPRequestHandlerFactory {
+ public:
+    Poco::Net::HTTPRequestHandler *createRequestHandler(
+        const Poco::Net::HTTPServerRequest &request) {
+        return new TestRequestHandler();
+    }
+};
+
+// Local HTTPS server that counts the TLS handshakes it makes
+class HTTPSServer {
+ public:
+    HTTPSServer()
+        : context_(new Poco::Net::Context(
+            Poco::Net::Context::SERVER_USE,
+            "../testdata/localhost.pem",
+            "../testdata/localhost.pem",
+            "",
+            Poco::Net::Context::VERIFY_NONE))
+    , socket_(Poco::Net::SocketAddress("127.0.0.1", 0), 64, context_)
+    , server_(new TestRequestHandlerFactory(),
+              socket_,
+              new Poco::Net::HTTPServerParams()) {
+        context_->enableSessionCache(true, "toggl_test");
+        server_.start();
+    }
+    ~HTTPSServer() {
+        server_.stop();
+    }
+
+    std::string URL() const {
+        std::stringstream ss;
+        ss << "https://localhost:" << socket_.address().port();
+        return ss.str();
+    }
+    // Handshakes, full and resumed
+    long Handshakes() const {  // NOLINT
+        return SSL_CTX_sess_accept(context_->sslContext());
+    }
+    long ResumedHandshakes() const {  // NOLINT
+        return SSL_CTX_sess_hits(context_->sslContext());
+    }
+
+ private:
+    Poco::Net::Context::Ptr context_;
+    Poco::Net::SecureServerSocket socket_;
+    Poco::Net::HTTPServer server_;
+};
+
+}  // namespace testing
+
+TEST(HTTPSClient, ReusesConnections) {
+    HTTPSClientConfig config = HTTPSClient::Config;
+    HTTPSClient::Config.CACertPath = "cacert.pem";
+    HTTPSClient::Config.IgnoreCert = true;
+    HTTPSClient::Config.AutodetectProxy = false;
+    HTTPSClient::Config.UseProxy = false;
+
+    testing::HTTPSServer server;
+    HTTPSClient client;
+
+    // Consecutive requests share one connection
+    for (int i = 0; i < 5; i++) {
+        std::string response("");
+        ASSERT_EQ(noError,
+                  client.Get(server.URL(), "/get", "", "", &response));
+        ASSERT_EQ("{}", response);
+        std::string post_response("");
+        ASSERT_EQ(noError, client.Post(server.URL(), "/post", "{\"a\":1}",
+                                       "", "", &post_response));
+        ASSERT_EQ("{}", post_response);
+    }
+    ASSERT_EQ(1, server.Handshakes());
+    ASSERT_EQ(size_t(1), HTTPSClient::Connections.IdleConnections());
+
+    // A new connection resumes the TLS session
+    HTTPSClient::Connections.Clear();
+    {
+        std::string response("");
+        ASSERT_EQ(noError,
+                  client.Get(server.URL(), "/get", "", "", &response));
+    }
+    ASSERT_EQ(2, server.Handshakes());
+    ASSERT_EQ(1, server.ResumedHandshakes());
+
+    HTTPSClient::Connections.Clear();
+    HTTPSClient::Config = config;
+}
+
+TEST(HTTPSClient, CompressesLargeBodiesOnce) {
+    HTTPSClientConfig config = HTTPSClient::Config;
+    HTTPSClient::Config.CACertPath = "cacert.pem";
+    HTTPSClient::Config.IgnoreCert = true;
+    HTTPSClient::Config.AutodetectProxy = false;
+    HTTPSClient::Config.UseProxy = false;
+
+    testing::HTTPSServer server;
+    HTTPSClient client;
+    HTTPSClient::ResetTraffic();
+
+    // Small bodies are sent as they are
+    std::string response("");
+    ASSERT_EQ(noError, client.Post(server.URL(), "/post", "{\"a\":1}",
+                                   "", "", &response));
+    ASSERT_EQ("", testing::TestRequestHandler::LastContentEncoding);
+    ASSERT_EQ("{\"a\":1}", testing::TestRequestHandler::LastBody);
+
+    HTTPSTraffic traffic = HTTPSClient::Traffic();
+    ASSERT_EQ(Poco::UInt64(7), traffic.RequestBytes);
+    ASSERT_EQ(Poco::UInt64(7), traffic.RequestBytesOnWire);
+
+    // Large ones are gzipped
+    std::string payload("[");
+    for (int i = 0; i < 1000; i++) {
+        payload += "{\"description\":\"Time entry\"},";
     }
+    payload += "{}]";
+    ASSERT_EQ(noError, client.Post(server.URL(), "/post", payload,
+                                   "", "", &response));
+    ASSERT_EQ("gzip", testing::TestRequestHandler::LastContentEncoding);
+    ASSERT_EQ(payload, testing::TestRequestHandler::LastBody);
+
+    traffic = HTTPSClient::Traffic();
+    ASSERT_EQ(Poco::UInt64(7 + payload.size()), traffic.RequestBytes);
+    ASSERT_LT(traffic.RequestBytesOnWire, traffic.RequestBytes / 10);
+
+    // Responses arrive gzipped, as the client accepts it
+    HTTPSClient::ResetTraffic();
+    ASSERT_EQ(noError, client.Get(server.URL(), "/large", "", "", &response));
+    ASSERT_EQ(size_t(9004), response.size());
+
+    traffic = HTTPSClient::Traffic();
+    ASSERT_EQ(Poco::UInt64(response.size()), traffic.ResponseBytes);
+    ASSERT_LT(traffic.ResponseBytesOnWire, traffic.ResponseBytes / 10);
+
+    HTTPSClient::Connections.Clear();
+    HTTPSClient::Config = config;
+}
 
-    event.idle = false;
-    {
-        std::vector<TimelineEvent> list;
-        list.push_back(event);
+TEST(User, PullsOnlyChangesSinceLastPull) {
+    HTTPSClientConfig config = HTTPSClient::Config;
+    HTTPSClient::Config.CACertPath = "cacert.pem";
+    HTTPSClient::Config.IgnoreCert = true;
+    HTTPSClient::Config.AutodetectProxy = false;
+    HTTPSClient::Config.UseProxy = false;
 
-        std::string json = convertTimelineToJSON(list, desktop_id);
+    testing::HTTPSServer server;
+    urls::SetAPI(server.URL());
+    TogglClient client;
 
-        Json::Value root;
-        Json::Reader reader;
-        ASSERT_TRUE(reader.parse(json, root));
-        ASSERT_EQ(std::size_t(1), root.size());
+    std::map<std::string, std::string> &replies =
+        testing::TestRequestHandler::Replies;
+    replies.clear();
 
-        const Json::Value v = root[0];
-        ASSERT_EQ("timeline", v["created_with"].asString());
-        ASSERT_EQ(desktop_id, v["desktop_id"].asString());
-        ASSERT_EQ(event.start_time, v["start_time"].asInt());
-        ASSERT_EQ(event.end_time, v["end_time"].asInt());
-        ASSERT_EQ(event.filename, v["filename"].asString());
-        ASSERT_EQ(event.title, v["title"].asString());
-    }
+    // Full data, as of 1379068550
+    std::string all = loadTestData();
+    replies["/api/v8/me?since=0"] = all;
 
-    event.title = "Õhtu jõuab, päev veereb {\"\b\t";
-    {
-        std::vector<TimelineEvent> list;
-        list.push_back(event);
+    // One changed and one deleted time entry, as of 1379068650
+    Json::Value changes;
+    Json::Reader reader;
+    ASSERT_TRUE(reader.parse(all, changes));
+    changes["since"] = Json::UInt64(1379068650);
+    Json::Value data = changes["data"];
+    data.removeMember("workspaces");
+    data.removeMember("projects");
+    data.removeMember("clients");
+    data.removeMember("tasks");
+    data.removeMember("tags");
+    data["time_entries"] = Json::Value(Json::arrayValue);
+    Json::Value changed = changes["data"]["time_entries"][1];
+    changed["description"] = "Changed things";
+    data["time_entries"].append(changed);
+    Json::Value deleted = changes["data"]["time_entries"][2];
+    deleted["server_deleted_at"] = "2013-09-13T10:37:30+00:00";
+    data["time_entries"].append(deleted);
+    changes["data"] = data;
+    Json::FastWriter writer;
+    replies["/api/v8/me?since=1379068550"] = writer.write(changes);
+
+    // Server data older than what we have
+    changes["since"] = Json::UInt64(1379000000);
+    changes["data"]["time_entries"] = Json::Value(Json::arrayValue);
+    replies["/api/v8/me?since=1379068650"] = writer.write(changes);
 
-        std::string json = convertTimelineToJSON(list, desktop_id);
+    User user;
+    user.SetAPIToken("token");
 
-        Json::Value root;
-        Json::Reader reader;
-        ASSERT_TRUE(reader.parse(json, root));
-        ASSERT_EQ(std::size_t(1), root.size());
+    HTTPSClient::ResetTraffic();
+    ASSERT_EQ(noError, user.PullChanges(&client));
+    ASSERT_EQ(Poco::UInt64(1379068550), user.Since());
+    ASSERT_EQ(size_t(5), user.related.TimeEntries.size());
+    Poco::UInt64 all_bytes = HTTPSClient::Traffic().ResponseBytes;
 
-        const Json::Value v = root[0];
-        ASSERT_EQ(event.title, v["title"].asString());
-    }
-}
+    HTTPSClient::ResetTraffic();
+    ASSERT_EQ(noError, user.PullChanges(&client));
+    ASSERT_NE(std::string::npos,
+              testing::TestRequestHandler::LastURI.find("since=1379068550"));
+    ASSERT_EQ(Poco::UInt64(1379068650), user.Since());
+    ASSERT_LT(HTTPSClient::Traffic().ResponseBytes, all_bytes / 2);
 
-TEST(JSON, Tag) {
-    std::string json("{\"id\":36253522,\"wid\":123456788,\"name\":\"create new\",\"at\":\"2013-10-15T08:51:46+00:00\",\"guid\":\"041390ba-ed9c-b477-b949-1a4ebb60a9ce\"}");  // NOLINT
+    // Changes are applied, models not in the changes are kept
+    TimeEntry *te = user.related.TimeEntryByID(89818605);
+    ASSERT_TRUE(te);
+    ASSERT_EQ("Changed things", te->Description());
+    te = user.related.TimeEntryByID(89833438);
+    ASSERT_TRUE(!te || te->IsMarkedAsDeletedOnServer());
+    ASSERT_TRUE(user.related.TimeEntryByID(89837259));
+    ASSERT_FALSE(user.related.Projects.empty());
+    ASSERT_FALSE(user.related.Workspaces.empty());
+
+    // Going back in time means a full pull
+    ASSERT_EQ(noError, user.PullChanges(&client));
+    ASSERT_NE(std::string::npos,
+              testing::TestRequestHandler::LastURI.find("since=0"));
+    ASSERT_EQ(Poco::UInt64(1379068550), user.Since());
 
-    Tag t;
-    t.LoadFromJSON(jsonStringToValue(json));
-    ASSERT_EQ(Poco::UInt64(36253522), t.ID());
-    ASSERT_EQ(Poco::UInt64(123456788), t.WID());
-    ASSERT_EQ("create new", t.Name());
-    ASSERT_EQ("041390ba-ed9c-b477-b949-1a4ebb60a9ce", t.GUID());
+    replies.clear();
+    urls::SetAPI("");
+    HTTPSClient::Connections.Clear();
+    HTTPSClient::Config = config;
 }
 
-TEST(JSON, Workspace) {
-    std::string json("{\"id\":123456722,\"name\":\"A deleted workspace\",\"premium\":false,\"admin\":true,\"default_hourly_rate\":0,\"default_currency\":\"USD\",\"only_admins_may_create_projects\":false,\"only_admins_see_billable_rates\":false,\"rounding\":1,\"rounding_minutes\":0,\"at\":\"2013-07-02T13:45:36+00:00\",\"server_deleted_at\":\"2013-08-22T09:05:31+00:00\"}");  // NOLINT
+class TestBatchUpdateMonitor : public BatchUpdateMonitor {
+ public:
+    explicit TestBatchUpdateMonitor(User *user)
+        : Applied(0)
+    , user_(user) {}
+
+    error BatchUpdateApplied() {
+        Applied++;
+        Unpushed.push_back(0);
+        for (std::vector<TimeEntry *>::const_iterator it =
+            user_->related.TimeEntries.begin();
+                it != user_->related.TimeEntries.end(); it++) {
+            if ((*it)->NeedsPush()) {
+                Unpushed.back()++;
+            }
+        }
+        return noError;
+    }
 
-    Workspace w;
-    w.LoadFromJSON(jsonStringToValue(json));
-    ASSERT_EQ(Poco::UInt64(123456722), w.ID());
-    ASSERT_EQ("A deleted workspace", w.Name());
-    ASSERT_FALSE(w.Premium());
-    ASSERT_TRUE(w.Admin());
-    ASSERT_FALSE(w.OnlyAdminsMayCreateProjects());
-}
+    int Applied;
 
-TEST(JSON, Task) {
-    std::string json("{\"id\":1894712,\"name\":\"A deleted task\",\"wid\":123456789,\"pid\":2598305,\"active\":true,\"at\":\"2013-06-05T07:58:41+00:00\",\"estimated_seconds\":0,\"server_deleted_at\":\"2013-08-22T09:05:31+00:00\"}");  // NOLINT
+    // Time entries left to push after each batch
+    std::vector<size_t> Unpushed;
 
-    Task t;
-    t.LoadFromJSON(jsonStringToValue(json));
-    ASSERT_EQ(Poco::UInt64(1894712), t.ID());
-    ASSERT_EQ("A deleted task", t.Name());
-    ASSERT_EQ(Poco::UInt64(123456789), t.WID());
-    ASSERT_EQ(Poco::UInt64(2598305), t.PID());
-}
+ private:
+    User *user_;
+};
 
-TEST(JSON, Project) {
-    std::string json("{\"id\":2598323,\"guid\":\"2f0b8f11-f898-d992-3e1a-6bc261fc41ef\",\"wid\":123456789,\"name\":\"A deleted project\",\"billable\":true,\"is_private\":false,\"active\":false,\"template\":false,\"at\":\"2013-05-13T10:19:24+00:00\",\"color\":\"21\",\"auto_estimates\":true,\"server_deleted_at\":\"2013-08-22T09:05:31+00:00\"}");  // NOLINT
+TEST(User, PushesChangesInBatches) {
+    HTTPSClientConfig config = HTTPSClient::Config;
+    HTTPSClient::Config.CACertPath = "cacert.pem";
+    HTTPSClient::Config.IgnoreCert = true;
+    HTTPSClient::Config.AutodetectProxy = false;
+    HTTPSClient::Config.UseProxy = false;
 
-    Project p;
-    p.LoadFromJSON(jsonStringToValue(json));
-    ASSERT_EQ(Poco::UInt64(2598323), p.ID());
-    ASSERT_EQ("A deleted project", p.Name());
-    ASSERT_EQ(Poco::UInt64(123456789), p.WID());
-    ASSERT_EQ("2f0b8f11-f898-d992-3e1a-6bc261fc41ef", p.GUID());
+    testing::HTTPSServer server;
+    urls::SetAPI(server.URL());
+    TogglClient client;
+    testing::TestRequestHandler::BatchUpdates.clear();
 
-    Project p2;
-    p2.LoadFromJSON(p.SaveToJSON());
-    ASSERT_EQ(p.ID(), p2.ID());
-    ASSERT_EQ(p.Name(), p2.Name());
-    ASSERT_EQ(p.WID(), p2.WID());
-    ASSERT_EQ(p.GUID(), p2.GUID());
-    ASSERT_EQ(p.CID(), p2.CID());
-    ASSERT_EQ(p.Billable(), p2.Billable());
-    ASSERT_EQ(p.IsPrivate(), p2.IsPrivate());
-    ASSERT_EQ(p.UIModifiedAt(), p2.UIModifiedAt());
+    User user;
+    user.SetID(10471231);
+    user.SetAPIToken("token");
+    user.SetPushBatchSize(100);
+
+    Client *c = new Client();
+    c->SetGUID("client-guid");
+    c->SetWID(123456789);
+    c->SetName("Client");
+    user.related.Clients.push_back(c);
+
+    Project *p = new Project();
+    p->SetGUID("project-guid");
+    p->SetWID(123456789);
+    p->SetName("Project");
+    user.related.Projects.push_back(p);
+
+    for (int i = 0; i < 250; i++) {
+        std::stringstream guid;
+        guid << "time-entry-guid-" << i;
+        TimeEntry *te = new TimeEntry();
+        te->SetGUID(guid.str());
+        te->SetWID(123456789);
+        te->SetProjectGUID("project-guid");
+        te->SetDescription("Offline work");
+        te->SetStart(1417000000 + i * 3600);
+        te->SetStop(1417000000 + i * 3600 + 1800);
+        te->SetUIModified();
+        user.related.TimeEntries.push_back(te);
+    }
+
+    TestBatchUpdateMonitor monitor(&user);
+    bool had_something_to_push(false);
+    ASSERT_EQ(noError,
+              user.PushChanges(&client, &had_something_to_push, &monitor));
+    ASSERT_TRUE(had_something_to_push);
+
+    // Client and project go out first, in the first batch
+    const std::vector<std::vector<std::string> > &batches =
+        testing::TestRequestHandler::BatchUpdates;
+    ASSERT_EQ(size_t(3), batches.size());
+    ASSERT_EQ(size_t(100), batches[0].size());
+    ASSERT_EQ(size_t(100), batches[1].size());
+    ASSERT_EQ(size_t(52), batches[2].size());
+    ASSERT_EQ("client", batches[0][0]);
+    ASSERT_EQ("project", batches[0][1]);
+    ASSERT_EQ("time_entry", batches[0][2]);
+
+    // Progress is reported after each batch
+    ASSERT_EQ(3, monitor.Applied);
+    ASSERT_EQ(size_t(152), monitor.Unpushed[0]);
+    ASSERT_EQ(size_t(52), monitor.Unpushed[1]);
+    ASSERT_EQ(size_t(0), monitor.Unpushed[2]);
+
+    ASSERT_TRUE(c->ID());
+    ASSERT_TRUE(p->ID());
+    for (std::vector<TimeEntry *>::const_iterator it =
+        user.related.TimeEntries.begin();
+            it != user.related.TimeEntries.end(); it++) {
+        ASSERT_FALSE((*it)->NeedsPush());
+    }
+
+    // Nothing left to push
+    testing::TestRequestHandler::BatchUpdates.clear();
+    ASSERT_EQ(noError,
+              user.PushChanges(&client, &had_something_to_push, &monitor));
+    ASSERT_FALSE(had_something_to_push);
+    ASSERT_TRUE(testing::TestRequestHandler::BatchUpdates.empty());
+
+    urls::SetAPI("");
+    HTTPSClient::Connections.Clear();
+    HTTPSClient::Config = config;
 }
 
-TEST(JSON, Client) {
-    std::string json("{\"id\":878318,\"guid\":\"59b464cd-0f8e-e601-ff44-f135225a6738\",\"wid\":123456789,\"name\":\"Big Client\",\"at\":\"2013-03-27T13:17:18+00:00\"}");  // NOLINT
+TEST(User, PushesModelsAfterThoseTheyReferToAcrossBatches) {
+    HTTPSClientConfig config = HTTPSClient::Config;
+    HTTPSClient::Config.CACertPath = "cacert.pem";
+    HTTPSClient::Config.IgnoreCert = true;
+    HTTPSClient::Config.AutodetectProxy = false;
+    HTTPSClient::Config.UseProxy = false;
 
-    Client c;
-    c.LoadFromJSON(jsonStringToValue(json));
-    ASSERT_EQ(Poco::UInt64(878318), c.ID());
-    ASSERT_EQ("Big Client", c.Name());
-    ASSERT_EQ(Poco::UInt64(123456789), c.WID());
-    ASSERT_EQ("59b464cd-0f8e-e601-ff44-f135225a6738", c.GUID());
+    testing::HTTPSServer server;
+    urls::SetAPI(server.URL());
+    TogglClient client;
+    testing::TestRequestHandler::BatchUpdates.clear();
+    testing::TestRequestHandler::BatchUpdateModels.clear();
 
-    Client c2;
-    c2.LoadFromJSON(c.SaveToJSON());
-    ASSERT_EQ(c.ID(), c2.ID());
-    ASSERT_EQ(c.Name(), c2.Name());
-    ASSERT_EQ(c.WID(), c2.WID());
-    ASSERT_EQ(c.GUID(), c2.GUID());
+    User user;
+    user.SetID(10471231);
+    user.SetAPIToken("token");
+
+    // Client, project and time entry, each in a batch of its own
+    user.SetPushBatchSize(1);
+
+    Client *c = new Client();
+    c->SetGUID("chain-client-guid");
+    c->SetWID(123456789);
+    c->SetName("Client");
+    user.related.Clients.push_back(c);
+
+    Project *p = new Project();
+    p->SetGUID("chain-project-guid");
+    p->SetWID(123456789);
+    p->SetName("Project");
+    p->SetClientGUID(c->GUID());
+    user.related.Projects.push_back(p);
+
+    TimeEntry *te = new TimeEntry();
+    te->SetGUID("chain-time-entry-guid");
+    te->SetWID(123456789);
+    te->SetProjectGUID(p->GUID());
+    te->SetDescription("Offline work");
+    te->SetStart(1417000000);
+    te->SetStop(1417001800);
+    te->SetUIModified();
+    user.related.TimeEntries.push_back(te);
+
+    TestBatchUpdateMonitor monitor(&user);
+    bool had_something_to_push(false);
+    ASSERT_EQ(noError,
+              user.PushChanges(&client, &had_something_to_push, &monitor));
+    ASSERT_EQ(size_t(3), testing::TestRequestHandler::BatchUpdates.size());
+    ASSERT_EQ(3, monitor.Applied);
+
+    // Later batches refer to the models by the IDs they got
+    ASSERT_TRUE(c->ID());
+    ASSERT_TRUE(p->ID());
+    std::map<std::string, Json::Value> &received =
+        testing::TestRequestHandler::BatchUpdateModels;
+    ASSERT_EQ(c->ID(), received[p->GUID()]["cid"].asUInt64());
+    ASSERT_TRUE(received[te->GUID()]["pid"].isIntegral());
+    ASSERT_EQ(p->ID(), received[te->GUID()]["pid"].asUInt64());
+    ASSERT_EQ(c->ID(), p->CID());
+    ASSERT_EQ(p->ID(), te->PID());
+
+    urls::SetAPI("");
+    HTTPSClient::Connections.Clear();
+    HTTPSClient::Config = config;
 }
 
-TEST(JSON, TimeEntry) {
-    std::string json("{\"id\":89818612,\"guid\":\"07fba193-91c4-0ec8-2345-820df0548123\",\"wid\":123456789,\"pid\":2567324,\"billable\":true,\"start\":\"2013-09-05T06:33:50+00:00\",\"stop\":\"2013-09-05T08:19:46+00:00\",\"duration\":6356,\"description\":\"A deleted time entry\",\"tags\":[\"ahaa\"],\"duronly\":false,\"at\":\"2013-09-05T08:19:45+00:00\",\"server_deleted_at\":\"2013-08-22T09:05:31+00:00\"}");  // NOLINT
+namespace testing {
 
-    TimeEntry t;
-    t.LoadFromJSON(jsonStringToValue(json));
-    ASSERT_EQ(Poco::UInt64(89818612), t.ID());
-    ASSERT_EQ(Poco::UInt64(2567324), t.PID());
-    ASSERT_EQ(Poco::UInt64(123456789), t.WID());
-    ASSERT_EQ("07fba193-91c4-0ec8-2345-820df0548123", t.GUID());
-    ASSERT_TRUE(t.Billable());
-    ASSERT_EQ(Poco::UInt64(1378362830000 / 1000), t.Start());
-    ASSERT_EQ(Poco::UInt64(1378369186000 / 1000), t.Stop());
-    ASSERT_EQ(Poco::Int64(6356), t.DurationInSeconds());
-    ASSERT_EQ("A deleted time entry", t.Description());
-    ASSERT_EQ("ahaa", t.Tags());
-    ASSERT_FALSE(t.DurOnly());
+// Records the order tasks ran in, optionally
+// holding the scheduler up until released
+class TestTask : public Poco::Util::TimerTask {
+ public:
+    TestTask(
+        const std::string name,
+        std::vector<std::string> *ran,
+        Poco::Event *release = nullptr)
+        : name_(name)
+    , ran_(ran)
+    , release_(release) {}
+
+    void run() {
+        if (release_) {
+            release_->wait();
+        }
+        Poco::Mutex::ScopedLock lock(Mutex);
+        ran_->push_back(name_);
+    }
 
-    TimeEntry t2;
-    t2.LoadFromJSON(t.SaveToJSON());
-    ASSERT_EQ(t.ID(), t2.ID());
-    ASSERT_EQ(t.PID(), t2.PID());
-    ASSERT_EQ(t.WID(), t2.WID());
-    ASSERT_EQ(t.GUID(), t2.GUID());
-    ASSERT_EQ(t.Billable(), t2.Billable());
-    ASSERT_EQ(t.Start(), t2.Start());
-    ASSERT_EQ(t.Stop(), t2.Stop());
-    ASSERT_EQ(t.DurationInSeconds(), t2.DurationInSeconds());
-    ASSERT_EQ(t.Description(), t2.Description());
-    ASSERT_EQ(t.Tags(), t2.Tags());
-    ASSERT_EQ(t.DurOnly(), t2.DurOnly());
+    static Poco::Mutex Mutex;
+
+ private:
+    std::string name_;
+    std::vector<std::string> *ran_;
+    Poco::Event *release_;
+};
+
+Poco::Mutex TestTask::Mutex;
+
+size_t waitForTasks(std::vector<std::string> *ran, const size_t count) {
+    for (int i = 0; i < 200; i++) {
+        {
+            Poco::Mutex::ScopedLock lock(TestTask::Mutex);
+            if (ran->size() >= count) {
+                return ran->size();
+            }
+        }
+        Poco::Thread::sleep(10);
+    }
+    Poco::Mutex::ScopedLock lock(TestTask::Mutex);
+    return ran->size();
 }
 
-TEST(User, TimeOfDayFormat) {
-    User u;
-    u.SetTimeOfDayFormat("H:mm");
-    ASSERT_EQ("H:mm", u.TimeOfDayFormat());
-    ASSERT_EQ("H:mm", Formatter::TimeOfDayFormat);
+}  // namespace testing
 
-    u.SetTimeOfDayFormat("h:mm A");
-    ASSERT_EQ("h:mm A", u.TimeOfDayFormat());
-    ASSERT_EQ("h:mm A", Formatter::TimeOfDayFormat);
+TEST(TaskScheduler, CoalescesTasksByKey) {
+    TaskScheduler scheduler;
+    std::vector<std::string> ran;
+
+    // A burst of requests runs once, after the last of them
+    for (int i = 0; i < 100; i++) {
+        scheduler.Schedule("push",
+                           new testing::TestTask("push", &ran),
+                           Poco::Timestamp() + 50000);
+    }
+    ASSERT_EQ(size_t(1), scheduler.QueueDepth());
+    ASSERT_TRUE(scheduler.IsPending("push"));
+
+    ASSERT_EQ(size_t(1), testing::waitForTasks(&ran, 1));
+    Poco::Thread::sleep(100);
+    ASSERT_EQ(size_t(1), ran.size());
+    ASSERT_EQ(size_t(0), scheduler.QueueDepth());
+
+    TaskStats stats = scheduler.Stats("push");
+    ASSERT_EQ(Poco::UInt64(100), stats.Requests);
+    ASSERT_EQ(Poco::UInt64(1), stats.Runs);
+    ASSERT_LE(stats.TotalLatencyMicros, stats.MaxLatencyMicros);
+
+    // Cancelled tasks do not run
+    scheduler.Schedule("sync",
+                       new testing::TestTask("sync", &ran),
+                       Poco::Timestamp() + 50000);
+    scheduler.Cancel("sync");
+    ASSERT_FALSE(scheduler.IsPending("sync"));
+    Poco::Thread::sleep(100);
+    ASSERT_EQ(size_t(1), ran.size());
+    ASSERT_EQ(Poco::UInt64(0), scheduler.Stats("sync").Runs);
 }
 
-TEST(User, DurationFormat) {
-    User u;
-    u.SetDurationFormat("classic");
-    ASSERT_EQ("classic", u.DurationFormat());
-    ASSERT_EQ("classic", Formatter::DurationFormat);
+TEST(TaskScheduler, RunsTasksDueByPriority) {
+    TaskScheduler scheduler;
+    std::vector<std::string> ran;
+
+    // Hold the scheduler up while the other tasks become due
+    Poco::Event release;
+    scheduler.Schedule("hold",
+                       new testing::TestTask("hold", &ran, &release),
+                       Poco::Timestamp());
+    Poco::Thread::sleep(50);
+
+    Poco::Timestamp now;
+    scheduler.Schedule("off",
+                       new testing::TestTask("off", &ran),
+                       now);
+    scheduler.Schedule("on",
+                       new testing::TestTask("on", &ran),
+                       now);
+    scheduler.Schedule("analytics",
+                       new testing::TestTask("analytics", &ran),
+                       now - 1000, kTaskPriorityLow);
+    scheduler.Schedule("push",
+                       new testing::TestTask("push", &ran),
+                       now + 1000, kTaskPriorityHigh);
+    ASSERT_EQ(size_t(4), scheduler.QueueDepth());
+
+    Poco::Thread::sleep(10);
+    release.set();
+
+    ASSERT_EQ(size_t(5), testing::waitForTasks(&ran, 5));
+    ASSERT_EQ("hold", ran[0]);
+    ASSERT_EQ("push", ran[1]);
+    ASSERT_EQ("off", ran[2]);
+    ASSERT_EQ("on", ran[3]);
+    ASSERT_EQ("analytics", ran[4]);
+
+    // Nothing runs after shutdown
+    scheduler.Shutdown();
+    scheduler.Schedule("push",
+                       new testing::TestTask("push", &ran),
+                       Poco::Timestamp());
+    ASSERT_EQ(size_t(0), scheduler.QueueDepth());
+}
 
-    u.SetDurationFormat("decimal");
-    ASSERT_EQ("decimal", u.DurationFormat());
-    ASSERT_EQ("decimal", Formatter::DurationFormat);
+TEST(TaskScheduler, RunsTasksScheduledAfterCancellingAll) {
+    TaskScheduler scheduler;
+    std::vector<std::string> ran;
+
+    scheduler.Schedule("sync",
+                       new testing::TestTask("sync", &ran),
+                       Poco::Timestamp() + 50000);
+    scheduler.Schedule("remind",
+                       new testing::TestTask("remind", &ran),
+                       Poco::Timestamp() + 50000);
+    scheduler.CancelAll();
+    ASSERT_EQ(size_t(0), scheduler.QueueDepth());
+
+    // As after logout and login again
+    scheduler.Schedule("sync",
+                       new testing::TestTask("sync", &ran),
+                       Poco::Timestamp());
+    ASSERT_EQ(size_t(1), testing::waitForTasks(&ran, 1));
+    Poco::Thread::sleep(100);
+    ASSERT_EQ(size_t(1), ran.size());
+    ASSERT_EQ("sync", ran[0]);
 }
 
 TEST(BaseModel, LoadFromDataStringWithInvalidJSON) {
@@ -1801,6 +4559,319 @@ TEST(AutotrackerRule, Matches) {
     ASSERT_FALSE(a.Matches(ev));
 }
 
+namespace testing {
+
+class TestCommand : public Command {
+ public:
+    TestCommand(
+        const std::string name,
+        std::vector<std::string> *ran,
+        Poco::Event *proceed = nullptr)
+        : Command(name)
+    , ran_(ran)
+    , proceed_(proceed) {}
+
+    error Run() {
+        if (proceed_) {
+            proceed_->wait();
+        }
+        ran_->push_back(Name());
+        if ("fail" == Name()) {
+            return error("failed");
+        }
+        return noError;
+    }
+
+ private:
+    std::vector<std::string> *ran_;
+    Poco::Event *proceed_;
+};
+
+class TestCommandStateMonitor : public CommandStateMonitor {
+ public:
+    void DisplayCommandState(
+        const Poco::UInt64 command_id,
+        const std::string &name,
+        const Poco::Int64 state,
+        const error err) {
+        std::stringstream ss;
+        ss << name << " " << state;
+        Poco::Mutex::ScopedLock lock(mutex_);
+        States.push_back(ss.str());
+    }
+
+    std::vector<std::string> States;
+
+ private:
+    Poco::Mutex mutex_;
+};
+
+}  // namespace testing
+
+TEST(CommandQueue, RunsCommandsInOrderAndRefusesWhenFull) {
+    testing::TestCommandStateMonitor monitor;
+    std::vector<std::string> ran;
+    Poco::Event proceed;
+
+    {
+        CommandQueue queue(2);
+        queue.SetMonitor(&monitor);
+
+        // First command holds the queue thread until told to proceed
+        ASSERT_EQ(Poco::UInt64(1), queue.Enqueue(
+            new testing::TestCommand("first", &ran, &proceed)));
+        for (int i = 0; i < 100 && queue.Depth(); i++) {
+            Poco::Thread::sleep(10);
+        }
+        ASSERT_EQ(size_t(0), queue.Depth());
+
+        ASSERT_EQ(Poco::UInt64(2), queue.Enqueue(
+            new testing::TestCommand("fail", &ran)));
+        ASSERT_EQ(Poco::UInt64(3), queue.Enqueue(
+            new testing::TestCommand("third", &ran)));
+        ASSERT_EQ(size_t(2), queue.Depth());
+
+        // Queue is full
+        ASSERT_EQ(Poco::UInt64(0), queue.Enqueue(
+            new testing::TestCommand("refused", &ran)));
+
+        proceed.set();
+
+        // Queued commands run before shutdown returns
+        queue.Shutdown();
+
+        ASSERT_EQ(Poco::UInt64(0), queue.Enqueue(
+            new testing::TestCommand("after shutdown", &ran)));
+
+        CommandQueueStats stats = queue.Stats();
+        ASSERT_EQ(Poco::UInt64(3), stats.Queued);
+        ASSERT_EQ(Poco::UInt64(2), stats.Done);
+        ASSERT_EQ(Poco::UInt64(1), stats.Failed);
+        ASSERT_EQ(Poco::UInt64(2), stats.Rejected);
+        ASSERT_EQ(size_t(2), stats.MaxDepth);
+        ASSERT_LE(stats.MaxWaitMicros, stats.TotalWaitMicros);
+    }
+
+    ASSERT_EQ(size_t(3), ran.size());
+    ASSERT_EQ("first", ran[0]);
+    ASSERT_EQ("fail", ran[1]);
+    ASSERT_EQ("third", ran[2]);
+
+    ASSERT_EQ(size_t(8), monitor.States.size());
+    ASSERT_EQ("first 0", monitor.States[0]);
+    ASSERT_EQ("fail 0", monitor.States[1]);
+    ASSERT_EQ("third 0", monitor.States[2]);
+    ASSERT_EQ("refused 3", monitor.States[3]);
+    ASSERT_EQ("first 1", monitor.States[4]);
+    ASSERT_EQ("fail 2", monitor.States[5]);
+    ASSERT_EQ("third 1", monitor.States[6]);
+    ASSERT_EQ("after shutdown 3", monitor.States[7]);
+}
+
+TEST(Wakeup, SignalEndsWait) {
+    Wakeup wakeup;
+
+    // Not signalled
+    ASSERT_FALSE(wakeup.Wait(10));
+
+    // Signal before waiting is not lost
+    wakeup.Signal();
+    Poco::Stopwatch stopwatch;
+    stopwatch.start();
+    ASSERT_TRUE(wakeup.Wait(10000));
+    ASSERT_GT(1000, stopwatch.elapsed() / 1000);
+
+    // And is used up by the wait
+    ASSERT_FALSE(wakeup.Wait(10));
+
+    Poco::UInt64 count = Wakeup::Count();
+    wakeup.Wait(1);
+    ASSERT_LE(count + 1, Wakeup::Count());
+}
+
+TEST(Wakeup, WaitsForSocketOrSignal) {
+    Wakeup wakeup;
+
+    Poco::Net::DatagramSocket socket(
+        Poco::Net::SocketAddress("127.0.0.1", 0));
+    Poco::Net::DatagramSocket sender(Poco::Net::IPAddress::IPv4);
+
+    ASSERT_FALSE(wakeup.WaitReadable(socket, 10));
+
+    // Signal ends the wait, while socket has no data
+    Poco::Stopwatch stopwatch;
+    stopwatch.start();
+    wakeup.Signal();
+    ASSERT_FALSE(wakeup.WaitReadable(socket, 10000));
+    ASSERT_GT(1000, stopwatch.elapsed() / 1000);
+
+    sender.sendTo("x", 1, socket.address());
+    ASSERT_TRUE(wakeup.WaitReadable(socket, 10000));
+}
+
+
+namespace testing {
+
+class TestLockWriter : public Poco::Runnable {
+ public:
+    explicit TestLockWriter(ModelLock *lock)
+        : lock_(lock) {}
+
+    void run() {
+        ModelLock::ScopedWrite lock(lock_);
+        Locked.set();
+    }
+
+    Poco::Event Locked;
+
+ private:
+    ModelLock *lock_;
+};
+
+}  // namespace testing
+
+TEST(ModelLock, WriterWaitsForReadersAndLockIsReentrant) {
+    ModelLock lock;
+
+    // Thread holding the lock can lock it again, either way
+    {
+        ModelLock::ScopedWrite write(&lock);
+        ModelLock::ScopedRead read(&lock);
+        ModelLock::ScopedWrite again(&lock);
+    }
+    {
+        ModelLock::ScopedRead read(&lock);
+        ModelLock::ScopedRead again(&lock);
+        ModelLock::ScopedWrite upgrade(&lock);
+    }
+
+    // Scoped locks may be given no lock
+    {
+        ModelLock::ScopedRead read(nullptr);
+        ModelLock::ScopedWrite write(nullptr);
+    }
+
+    testing::TestLockWriter writer(&lock);
+    Poco::Thread thread;
+    {
+        ModelLock::ScopedRead read(&lock);
+        thread.start(writer);
+        ASSERT_FALSE(writer.Locked.tryWait(200));
+
+        // Reader may lock again while a writer is waiting
+        ModelLock::ScopedRead again(&lock);
+    }
+    ASSERT_TRUE(writer.Locked.tryWait(5000));
+    thread.join();
+
+    ModelLockStats stats = lock.Stats();
+    ASSERT_EQ(Poco::UInt64(5), stats.Reads);
+    ASSERT_EQ(Poco::UInt64(4), stats.Writes);
+    ASSERT_LE(Poco::UInt64(100000), stats.MaxWriteWaitMicros);
+    ASSERT_LE(stats.MaxWriteWaitMicros, stats.WriteWaitMicros);
+}
+
+// Date totals kept by snapshot, against a scan of all time entries
+void expectSnapshotDateTotals(const ViewSnapshot &snapshot) {
+    std::vector<TimeEntryViewDataPtr> list = snapshot.TimeEntries();
+    ASSERT_EQ(snapshot.TimeEntryCount(), list.size());
+    for (size_t i = 0; i < list.size(); i++) {
+        Poco::Int64 total(0);
+        for (size_t j = 0; j < list.size(); j++) {
+            if (list[j]->DateHeader() == list[i]->DateHeader()) {
+                total += TimeEntry::AbsDuration(list[j]->DurationInSeconds);
+            }
+        }
+        ASSERT_EQ(total, snapshot.DateTotal(*list[i]));
+    }
+}
+
+TEST(ViewSnapshot, SharesUnchangedDataBetweenVersions) {
+    User user;
+    ASSERT_EQ(noError,
+              user.LoadUserAndRelatedDataFromJSONString(loadTestData(), true));
+
+    ViewSnapshot empty;
+    ASSERT_FALSE(empty.LoggedIn());
+
+    // First snapshot of a user copies everything
+    ViewSnapshotChanges changes;
+    ViewSnapshotPtr first(ViewSnapshot::Next(empty, &user, changes));
+    ASSERT_TRUE(first->LoggedIn());
+    ASSERT_EQ(Poco::UInt64(1), first->Version());
+    ASSERT_FALSE(first->TimeEntries().empty());
+    ASSERT_FALSE(first->TimeEntryAutocomplete().empty());
+    for (size_t i = 1; i < first->TimeEntries().size(); i++) {
+        ASSERT_LE(first->TimeEntries()[i - 1]->Start,
+                  first->TimeEntries()[i]->Start);
+    }
+
+    TimeEntry *te = user.related.TimeEntryByID(89818605);
+    ASSERT_TRUE(te);
+    TimeEntry *other = user.related.TimeEntryByID(89837259);
+    ASSERT_TRUE(other);
+
+    // Only the changed time entry is copied again
+    std::string description = te->Description();
+    te->SetDescription("changed in models");
+    changes.TimeEntries.insert(te->GUID());
+    ViewSnapshotPtr second(ViewSnapshot::Next(*first, &user, changes));
+    ASSERT_EQ(Poco::UInt64(2), second->Version());
+    ASSERT_EQ(first->TimeEntries().size(), second->TimeEntries().size());
+    ASSERT_EQ("changed in models",
+              second->TimeEntryByGUID(te->GUID())->Description);
+    ASSERT_EQ(description, first->TimeEntryByGUID(te->GUID())->Description);
+    ASSERT_EQ(first->TimeEntryByGUID(other->GUID()),
+              second->TimeEntryByGUID(other->GUID()));
+    ASSERT_EQ(&first->TimeEntryAutocomplete(),
+              &second->TimeEntryAutocomplete());
+    expectSnapshotDateTotals(*first);
+    expectSnapshotDateTotals(*second);
+
+    // Started time entry moves to today, and is running
+    Poco::Int64 now = time(0);
+    other->SetStart(now - 60);
+    other->SetDurationInSeconds(-(now - 60));
+    changes.TimeEntries.clear();
+    changes.TimeEntries.insert(other->GUID());
+    ViewSnapshotPtr started(ViewSnapshot::Next(*second, &user, changes));
+    ASSERT_EQ(other->GUID(), started->RunningTimeEntry()->GUID);
+    ASSERT_FALSE(second->RunningTimeEntry());
+    ASSERT_EQ(started->TimeEntries().back()->GUID, other->GUID());
+    ASSERT_LE(60, started->DateTotal(*started->RunningTimeEntry()));
+    expectSnapshotDateTotals(*started);
+
+    other->SetDurationInSeconds(60);
+    ViewSnapshotPtr stopped(ViewSnapshot::Next(*started, &user, changes));
+    ASSERT_FALSE(stopped->RunningTimeEntry());
+    expectSnapshotDateTotals(*stopped);
+    changes.TimeEntries.clear();
+    changes.TimeEntries.insert(te->GUID());
+
+    // Deleted time entries drop out
+    te->SetDeletedAt(time(0));
+    ViewSnapshotPtr third(ViewSnapshot::Next(*stopped, &user, changes));
+    ASSERT_FALSE(third->TimeEntryByGUID(te->GUID()));
+    ASSERT_EQ(second->TimeEntries().size() - 1, third->TimeEntries().size());
+    ASSERT_TRUE(second->TimeEntryByGUID(te->GUID()));
+    expectSnapshotDateTotals(*third);
+
+    // Labels may change for all, and lists can be rebuilt
+    changes.SetAll();
+    ViewSnapshotPtr fourth(ViewSnapshot::Next(*third, &user, changes));
+    ASSERT_NE(third->TimeEntryByGUID(other->GUID()),
+              fourth->TimeEntryByGUID(other->GUID()));
+    ASSERT_NE(&third->TimeEntryAutocomplete(),
+              &fourth->TimeEntryAutocomplete());
+
+    // Logged out
+    ViewSnapshotPtr fifth(ViewSnapshot::Next(*fourth, nullptr, changes));
+    ASSERT_FALSE(fifth->LoggedIn());
+    ASSERT_TRUE(fifth->TimeEntries().empty());
+    ASSERT_FALSE(fifth->RunningTimeEntry());
+    ASSERT_FALSE(fourth->TimeEntries().empty());
+}
+
 }  // namespace toggl
 
 int main(int argc, char **argv) {
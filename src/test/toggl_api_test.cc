@@ -1,21 +1,31 @@
 // Copyright 2014 Toggl Desktop developers.
 
+#include <sstream>
 #include <vector>
 
 #include "gtest/gtest.h"
 
+#include "./../const.h"
+#include "./../context.h"
+#include "./../model_lock.h"
 #include "./../proxy.h"
 #include "./../settings.h"
 #include "./../time_entry.h"
 #include "./../toggl_api.h"
 #include "./../toggl_api_private.h"
+#include "./../wakeup.h"
 #include "./test_data.h"
 
+#include "Poco/Data/Session.h"
 #include "Poco/DateTime.h"
+#include "Poco/Event.h"
 #include "Poco/File.h"
 #include "Poco/FileStream.h"
 #include "Poco/LocalDateTime.h"
+#include "Poco/Mutex.h"
 #include "Poco/Path.h"
+#include "Poco/Stopwatch.h"
+#include "Poco/Thread.h"
 
 namespace toggl {
 
@@ -59,8 +69,11 @@ std::vector<std::string> projects;
 // on_client_select
 std::vector<std::string> clients;
 
-// on_time_entry_list
+// on_time_entry_list, and how many times it was called. Lists
+// may be rendered on another thread, so the mutex is held.
+Poco::Mutex time_entries_m;
 std::vector<TimeEntry> time_entries;
+int time_entry_list_renders(0);
 
 TimeEntry time_entry_by_guid(const std::string guid) {
     TimeEntry te;
@@ -87,6 +100,12 @@ int64_t unsynced_item_count;
 
 std::string update_url;
 
+// on_command_state, queued commands and the
+// commands that have run, in order of the calls
+Poco::Mutex command_states_m;
+std::vector<std::string> commands_queued;
+std::vector<std::string> commands_run;
+
 }  // namespace testresult
 
 void on_app(const bool_t open) {
@@ -135,6 +154,8 @@ void on_reminder(const char *title, const char *informative_text) {
 void on_time_entry_list(
     const bool_t open,
     TogglTimeEntryView *first) {
+    Poco::Mutex::ScopedLock lock(testing::testresult::time_entries_m);
+    testing::testresult::time_entry_list_renders++;
     testing::testresult::time_entries.clear();
     TogglTimeEntryView *it = first;
     while (it) {
@@ -259,11 +280,67 @@ void on_display_idle_notification(
     testing::testresult::idle_description = std::string(description);
 }
 
+void on_command_state(
+    const uint64_t command_id,
+    const char_t *name,
+    const int64_t state,
+    const char_t *errmsg) {
+    std::stringstream ss;
+    ss << command_id << " " << name << " " << state;
+    Poco::Mutex::ScopedLock lock(testresult::command_states_m);
+    if (kCommandStateQueued == state) {
+        testresult::commands_queued.push_back(ss.str());
+    } else {
+        testresult::commands_run.push_back(ss.str());
+    }
+}
+
+size_t commands_run_count() {
+    Poco::Mutex::ScopedLock lock(testresult::command_states_m);
+    return testresult::commands_run.size();
+}
+
+int time_entry_list_render_count() {
+    Poco::Mutex::ScopedLock lock(testresult::time_entries_m);
+    return testresult::time_entry_list_renders;
+}
+
+// Wait until time entry list has been rendered more than
+// the given number of times. Returns false on timeout.
+bool wait_for_time_entry_list_render(const int renders) {
+    for (int i = 0; i < 500; i++) {
+        if (time_entry_list_render_count() > renders) {
+            return true;
+        }
+        Poco::Thread::sleep(10);
+    }
+    return false;
+}
+
+// Holds the task scheduler up until released, as a slow sync does
+class HoldTask : public Poco::Util::TimerTask {
+ public:
+    HoldTask(Poco::Event *started, Poco::Event *release)
+        : started_(started)
+    , release_(release) {}
+
+    void run() {
+        started_->set();
+        release_->wait();
+    }
+
+ private:
+    Poco::Event *started_;
+    Poco::Event *release_;
+};
+
 class App {
  public:
-    App() {
+    // Keep the database to start over with the data of a
+    // previous app, as when app is restarted
+    explicit App(const bool keep_database = false) {
         Poco::File f(TESTDB);
-        if (f.exists()) {
+        if (!keep_database && f.exists()) {
             f.remove(false);
         }
 
@@ -273,6 +350,9 @@ class App {
 
         poco_assert(toggl_set_db_path(ctx_, TESTDB));
 
+        // Tests check UI right after the calls
+        ::app(ctx_)->SetDeferredRendering(false);
+
         Poco::Path path("src/ssl/cacert.pem");
         toggl_set_cacert_path(ctx_, path.toString().c_str());
 
@@ -312,6 +392,75 @@ class App {
     void *ctx_;
 };
 
+
+// Renders views and queries autocomplete, as UI does
+class ViewReader : public Poco::Runnable {
+ public:
+    ViewReader(void *ctx, const int iterations)
+        : ctx_(ctx)
+    , iterations_(iterations) {}
+
+    void run() {
+        for (int i = 0; i < iterations_; i++) {
+            toggl_view_time_entry_list(ctx_);
+            TogglAutocompleteView *first =
+                toggl_autocomplete_query(ctx_, 0, "a", 10);
+            toggl_autocomplete_view_clear(first);
+        }
+    }
+
+ private:
+    void *ctx_;
+    int iterations_;
+};
+
+// Applies time entries pushed from server, as websocket does
+class SyncWriter : public Poco::Runnable {
+ public:
+    SyncWriter(void *ctx, const int iterations)
+        : ctx_(ctx)
+    , iterations_(iterations) {}
+
+    void run() {
+        for (int i = 0; i < iterations_; i++) {
+            std::stringstream ss;
+            ss << "{\"model\":\"time_entry\",\"action\":\"update\","
+               << "\"data\":{\"id\":" << 900000 + i << ","
+               << "\"description\":\"synced " << i << "\","
+               << "\"start\":\"2015-06-01T10:00:00+00:00\","
+               << "\"duration\":60}}";
+            app(ctx_)->LoadUpdateFromJSONString(ss.str());
+        }
+    }
+
+ private:
+    void *ctx_;
+    int iterations_;
+};
+
+// Edits a time entry, as user does
+class EditWriter : public Poco::Runnable {
+ public:
+    EditWriter(void *ctx, const std::string guid, const int iterations)
+        : ctx_(ctx)
+    , guid_(guid)
+    , iterations_(iterations) {}
+
+    void run() {
+        for (int i = 0; i < iterations_; i++) {
+            std::stringstream ss;
+            ss << "edit " << i;
+            toggl_set_time_entry_description(
+                ctx_, guid_.c_str(), ss.str().c_str());
+        }
+    }
+
+ private:
+    void *ctx_;
+    std::string guid_;
+    int iterations_;
+};
+
 }  // namespace testing
 
 TEST(toggl_api, toggl_context_init) {
@@ -326,6 +475,35 @@ TEST(toggl_api, testing_sleep) {
     ASSERT_LT(elapsed_seconds, 2);
 }
 
+TEST(toggl_api, shutdown_does_not_wait_for_sleeping_activities) {
+    testing::App *app = new testing::App();
+    Poco::Thread::sleep(200);
+
+    Poco::Stopwatch stopwatch;
+    stopwatch.start();
+    delete app;
+    ASSERT_GT(1000, stopwatch.elapsed() / 1000);
+}
+
+TEST(toggl_api, DISABLED_background_activities_sleep_while_idle) {
+    testing::App *app = new testing::App();
+
+    // Let startup tasks finish
+    testing_sleep(2);
+
+    Poco::UInt64 count = Wakeup::Count();
+    testing_sleep(5);
+    Poco::UInt64 wakeups = Wakeup::Count() - count;
+    RecordProperty("idle_wakeups_per_minute", static_cast<int>(wakeups * 12));
+    ASSERT_GE(Poco::UInt64(3), wakeups);
+
+    // Shutdown does not wait for sleeping activities
+    Poco::Stopwatch stopwatch;
+    stopwatch.start();
+    delete app;
+    ASSERT_GT(1000, stopwatch.elapsed() / 1000);
+}
+
 TEST(toggl_api, toggl_run_script) {
     testing::App app;
     int64_t err(0);
@@ -985,6 +1163,71 @@ TEST(toggl_api, toggl_view_time_entry_list) {
     ASSERT_EQ(std::size_t(5), testing::testresult::time_entries.size());
 }
 
+static int timeEntryListPosition(const std::string guid) {
+    Poco::Mutex::ScopedLock lock(testing::testresult::time_entries_m);
+    for (std::size_t i = 0; i < testing::testresult::time_entries.size();
+            i++) {
+        if (testing::testresult::time_entries[i].GUID() == guid) {
+            return static_cast<int>(i);
+        }
+    }
+    return -1;
+}
+
+TEST(toggl_api, toggl_load_more_time_entries) {
+    const Poco::Int64 day = Poco::Timespan::DAYS / Poco::Timespan::SECONDS;
+    const Poco::Int64 now = time(0);
+
+    // Recent, within the next page, and beyond it
+    const std::string recent("07fba193-91c4-0ec8-2894-820df0548a8f");
+    const std::string older("6c97dc31-582e-7662-1d6f-5e9d623b1685");
+    const std::string oldest("6a958efd-0e9a-d777-7e19-001b2d7ced92");
+
+    {
+        testing::App app;
+        std::string json = loadTestData();
+        ASSERT_TRUE(testing_set_logged_in_user(app.ctx(), json.c_str()));
+        ASSERT_EQ(std::size_t(5), testing::testresult::time_entries.size());
+    }
+
+    {
+        Poco::Data::Session session("SQLite", TESTDB);
+        Poco::Int64 start = now - (kTimeEntryPageDays * 2) * day;
+        session << "UPDATE time_entries SET start = :start, "
+                "stop = :start + 60, duration = 60, ui_modified_at = 0",
+                Poco::Data::Keywords::use(start),
+                Poco::Data::Keywords::now;
+
+        const std::string guids[] = { recent, older, oldest };
+        const Poco::Int64 days[] = { 1,
+                                     kTimeEntryResidentDays + 2,
+                                     kTimeEntryResidentDays + 5
+                                   };
+        for (int i = 0; i < 3; i++) {
+            std::string guid(guids[i]);
+            start = now - days[i] * day;
+            session << "UPDATE time_entries SET start = :start, "
+                    "stop = :start + 60 WHERE guid = :guid",
+                    Poco::Data::Keywords::use(start),
+                    Poco::Data::Keywords::use(guid),
+                    Poco::Data::Keywords::now;
+        }
+    }
+
+    // Older time entries are not loaded on start
+    testing::App app(true);
+    toggl_view_time_entry_list(app.ctx());
+    ASSERT_EQ(0, timeEntryListPosition(recent));
+    ASSERT_EQ(-1, timeEntryListPosition(older));
+    ASSERT_EQ(-1, timeEntryListPosition(oldest));
+
+    ASSERT_TRUE(toggl_load_more_time_entries(app.ctx()));
+    ASSERT_EQ(std::size_t(3), testing::testresult::time_entries.size());
+    ASSERT_EQ(0, timeEntryListPosition(recent));
+    ASSERT_EQ(1, timeEntryListPosition(older));
+    ASSERT_EQ(2, timeEntryListPosition(oldest));
+}
+
 TEST(toggl_api, toggl_edit) {
     testing::App app;
     std::string json = loadTestData();
@@ -1137,6 +1380,293 @@ TEST(toggl_api, toggl_stop) {
     ASSERT_TRUE(testing::testresult::timer_state.GUID().empty());
 }
 
+TEST(toggl_api, toggl_start_async) {
+    testing::App app;
+    std::string json = loadTestData();
+    ASSERT_TRUE(testing_set_logged_in_user(app.ctx(), json.c_str()));
+
+    testing::testresult::commands_queued.clear();
+    testing::testresult::commands_run.clear();
+    toggl_on_command_state(app.ctx(), testing::on_command_state);
+    toggl_set_async_commands(app.ctx(), true);
+
+    // GUID is known before the time entry is created
+    char_t *guid = toggl_start(app.ctx(), "test", "", 0, 0, 0);
+    ASSERT_TRUE(guid);
+    std::string started_guid(guid);
+    free(guid);
+
+    ASSERT_TRUE(toggl_set_time_entry_description(
+        app.ctx(), started_guid.c_str(), "changed"));
+    ASSERT_TRUE(toggl_stop(app.ctx()));
+
+    for (int i = 0; i < 100 && testing::commands_run_count() < 3; i++) {
+        Poco::Thread::sleep(50);
+    }
+    ASSERT_EQ(0, toggl_command_queue_depth(app.ctx()));
+
+    // Each command is acknowledged when queued,
+    // and they are run in order
+    Poco::Mutex::ScopedLock lock(testing::testresult::command_states_m);
+    std::vector<std::string> &queued = testing::testresult::commands_queued;
+    ASSERT_EQ(size_t(3), queued.size());
+    ASSERT_EQ("1 start 0", queued[0]);
+    ASSERT_EQ("2 set_time_entry_description 0", queued[1]);
+    ASSERT_EQ("3 stop 0", queued[2]);
+
+    std::vector<std::string> &run = testing::testresult::commands_run;
+    ASSERT_EQ(size_t(3), run.size());
+    ASSERT_EQ("1 start 1", run[0]);
+    ASSERT_EQ("2 set_time_entry_description 1", run[1]);
+    ASSERT_EQ("3 stop 1", run[2]);
+}
+
+TEST(toggl_api, toggl_start_async_after_logging_in_again) {
+    testing::App app;
+    std::string json = loadTestData();
+    ASSERT_TRUE(testing_set_logged_in_user(app.ctx(), json.c_str()));
+
+    testing::testresult::commands_queued.clear();
+    testing::testresult::commands_run.clear();
+    toggl_on_command_state(app.ctx(), testing::on_command_state);
+    toggl_set_async_commands(app.ctx(), true);
+
+    char_t *guid = toggl_start(app.ctx(), "before logout", "", 0, 0, 0);
+    ASSERT_TRUE(guid);
+    free(guid);
+
+    // Logout runs the queued commands
+    ASSERT_TRUE(toggl_logout(app.ctx()));
+    ASSERT_EQ(size_t(1), testing::commands_run_count());
+    ASSERT_EQ(0, toggl_command_queue_depth(app.ctx()));
+
+    ASSERT_TRUE(testing_set_logged_in_user(app.ctx(), json.c_str()));
+
+    guid = toggl_start(app.ctx(), "after login", "", 0, 0, 0);
+    ASSERT_TRUE(guid);
+    std::string started_guid(guid);
+    free(guid);
+
+    for (int i = 0; i < 100 && testing::commands_run_count() < 2; i++) {
+        Poco::Thread::sleep(50);
+    }
+
+    Poco::Mutex::ScopedLock lock(testing::testresult::command_states_m);
+    std::vector<std::string> &run = testing::testresult::commands_run;
+    ASSERT_EQ(size_t(2), run.size());
+    ASSERT_EQ("1 start 1", run[0]);
+    ASSERT_EQ("2 start 1", run[1]);
+}
+
+namespace testing {
+
+// Renders views on two threads while changes are synced in
+// and made by user, then checks every change made it
+void runConcurrentViewsAndSync(App *app, const int iterations) {
+    std::string json = loadTestData();
+    ASSERT_TRUE(testing_set_logged_in_user(app->ctx(), json.c_str()));
+
+    ASSERT_FALSE(testresult::time_entries.empty());
+    std::string guid = testresult::time_entries[0].GUID();
+
+    ViewReader reader1(app->ctx(), iterations);
+    ViewReader reader2(app->ctx(), iterations);
+    SyncWriter sync(app->ctx(), iterations);
+    EditWriter edit(app->ctx(), guid, iterations);
+
+    Poco::Thread reader1_thread, reader2_thread, sync_thread, edit_thread;
+    reader1_thread.start(reader1);
+    reader2_thread.start(reader2);
+    sync_thread.start(sync);
+    edit_thread.start(edit);
+
+    reader1_thread.join();
+    reader2_thread.join();
+    sync_thread.join();
+    edit_thread.join();
+
+    // Renders read snapshots instead of locking the models,
+    // and every change published a new snapshot
+    ModelLockStats stats = ::app(app->ctx())->LockStats();
+    ASSERT_GT(Poco::UInt64(iterations), stats.Reads);
+    ASSERT_LE(Poco::UInt64(2 * iterations), stats.Writes);
+    ASSERT_LE(Poco::UInt64(2 * iterations),
+              ::app(app->ctx())->Snapshot()->Version());
+
+    // Every change made it, and the list shows them all
+    toggl_view_time_entry_list(app->ctx());
+    std::stringstream last_edit;
+    last_edit << "edit " << iterations - 1;
+    ASSERT_EQ(last_edit.str(),
+              testresult::time_entry_by_guid(guid).Description());
+    for (int i = 0; i < iterations; i++) {
+        std::stringstream description;
+        description << "synced " << i;
+        bool found(false);
+        for (size_t j = 0; j < testresult::time_entries.size(); j++) {
+            if (testresult::time_entries[j].Description()
+                    == description.str()) {
+                found = true;
+                break;
+            }
+        }
+        ASSERT_TRUE(found);
+    }
+}
+
+}  // namespace testing
+
+TEST(toggl_api, concurrent_views_and_sync) {
+    testing::App app;
+    testing::runConcurrentViewsAndSync(&app, 50);
+}
+
+TEST(toggl_api, DISABLED_concurrent_views_and_sync_stress) {
+    testing::App app;
+    Poco::Stopwatch stopwatch;
+    stopwatch.start();
+    testing::runConcurrentViewsAndSync(&app, 200);
+    stopwatch.stop();
+    ASSERT_FALSE(HasFatalFailure());
+
+    ModelLockStats stats = ::app(app.ctx())->LockStats();
+    RecordProperty("elapsed_ms", static_cast<int>(stopwatch.elapsed() / 1000));
+    RecordProperty("reads", static_cast<int>(stats.Reads));
+    RecordProperty("read_wait_us", static_cast<int>(stats.ReadWaitMicros));
+    RecordProperty("max_read_wait_us",
+                   static_cast<int>(stats.MaxReadWaitMicros));
+    RecordProperty("writes", static_cast<int>(stats.Writes));
+    RecordProperty("write_wait_us", static_cast<int>(stats.WriteWaitMicros));
+    RecordProperty("max_write_wait_us",
+                   static_cast<int>(stats.MaxWriteWaitMicros));
+}
+
+TEST(toggl_api, renders_burst_of_saves_once) {
+    testing::App app;
+    std::string json = loadTestData();
+    ASSERT_TRUE(testing_set_logged_in_user(app.ctx(), json.c_str()));
+
+    ASSERT_FALSE(testing::testresult::time_entries.empty());
+    std::string guid = testing::testresult::time_entries[0].GUID();
+
+    Context *ctx = ::app(app.ctx());
+    ctx->SetDeferredRendering(true);
+    ctx->SetRenderDelayMillis(500);
+
+    int renders(0);
+    {
+        Poco::Mutex::ScopedLock lock(testing::testresult::time_entries_m);
+        renders = testing::testresult::time_entry_list_renders;
+    }
+    TaskStats before = ctx->RenderStats();
+
+    const int kSaves = 10;
+    for (int i = 0; i < kSaves; i++) {
+        std::stringstream description;
+        description << "burst " << i;
+        ASSERT_TRUE(toggl_set_time_entry_description(
+            app.ctx(), guid.c_str(), description.str().c_str()));
+    }
+
+    // Nothing is rendered until the burst is over
+    {
+        Poco::Mutex::ScopedLock lock(testing::testresult::time_entries_m);
+        ASSERT_EQ(renders, testing::testresult::time_entry_list_renders);
+    }
+
+    Poco::Stopwatch stopwatch;
+    stopwatch.start();
+    while (stopwatch.elapsed() < 5 * kOneSecondInMicros) {
+        {
+            Poco::Mutex::ScopedLock lock(
+                testing::testresult::time_entries_m);
+            if (testing::testresult::time_entry_list_renders > renders) {
+                break;
+            }
+        }
+        Poco::Thread::sleep(10);
+    }
+    Poco::Thread::sleep(1000);
+
+    // All saves were rendered at once
+    TaskStats after = ctx->RenderStats();
+    ASSERT_EQ(before.Requests + kSaves, after.Requests);
+    ASSERT_EQ(before.Runs + 1, after.Runs);
+    {
+        Poco::Mutex::ScopedLock lock(testing::testresult::time_entries_m);
+        ASSERT_EQ(renders + 1, testing::testresult::time_entry_list_renders);
+        ASSERT_EQ("burst 9",
+                  testing::testresult::time_entry_by_guid(guid).Description());
+    }
+}
+
+TEST(toggl_api, renders_while_task_scheduler_is_busy) {
+    testing::App app;
+    std::string json = loadTestData();
+    ASSERT_TRUE(testing_set_logged_in_user(app.ctx(), json.c_str()));
+
+    Context *ctx = ::app(app.ctx());
+    ctx->SetDeferredRendering(true);
+
+    Poco::Event started;
+    Poco::Event release;
+    ctx->Scheduler()->Schedule("hold",
+                               new testing::HoldTask(&started, &release),
+                               Poco::Timestamp());
+    started.wait();
+
+    char_t *guid = toggl_start(app.ctx(), "rendered", "", 0, 0, 0);
+    bool stopped = toggl_stop(app.ctx());
+    bool rendered(false);
+    for (int i = 0; i < 500 && guid && !rendered; i++) {
+        {
+            Poco::Mutex::ScopedLock lock(
+                testing::testresult::time_entries_m);
+            rendered = "rendered" ==
+                       testing::testresult::time_entry_by_guid(
+                           guid).Description();
+        }
+        Poco::Thread::sleep(10);
+    }
+    release.set();
+
+    ASSERT_TRUE(guid);
+    free(guid);
+    ASSERT_TRUE(stopped);
+
+    // The new time entry shows up while a sync would still be running
+    ASSERT_TRUE(rendered);
+}
+
+TEST(toggl_api, renders_and_syncs_after_logging_in_again) {
+    testing::App app;
+    std::string json = loadTestData();
+    ASSERT_TRUE(testing_set_logged_in_user(app.ctx(), json.c_str()));
+    ASSERT_TRUE(toggl_logout(app.ctx()));
+    ASSERT_EQ(uint64_t(0), testing::testresult::user_id);
+
+    ASSERT_TRUE(testing_set_logged_in_user(app.ctx(), json.c_str()));
+    ASSERT_EQ(uint64_t(10471231), testing::testresult::user_id);
+
+    Context *ctx = ::app(app.ctx());
+    ctx->SetDeferredRendering(true);
+
+    Poco::UInt64 renders_before = ctx->RenderStats().Runs;
+    int renders = testing::time_entry_list_render_count();
+    char_t *guid = toggl_start(app.ctx(), "after login", "", 0, 0, 0);
+    ASSERT_TRUE(guid);
+    free(guid);
+    ASSERT_TRUE(testing::wait_for_time_entry_list_render(renders));
+    ASSERT_LT(renders_before, ctx->RenderStats().Runs);
+
+    Poco::UInt64 syncs_before = ctx->SyncStats().Runs;
+    toggl_sync(app.ctx());
+    for (int i = 0; i < 100 && ctx->SyncStats().Runs == syncs_before; i++) {
+        Poco::Thread::sleep(50);
+    }
+    ASSERT_LT(syncs_before, ctx->SyncStats().Runs);
+}
+
 TEST(toggl_api, toggl_start) {
     testing::App app;
     std::string json = loadTestData();
@@ -18,6 +18,8 @@
 
 #include "./formatter.h"
 #include "./https_client.h"
+#include "./json_writer.h"
+#include "./model_pool.h"
 
 #include "Poco/DateTime.h"
 #include "Poco/LocalDateTime.h"
@@ -27,6 +29,28 @@
 
 namespace toggl {
 
+// Never destroyed, as time entries may outlive other static objects
+static ModelPool &timeEntryPool() {
+    static ModelPool *pool =
+        new ModelPool(sizeof(TimeEntry), kTimeEntryPoolSlabSize);
+    return *pool;
+}
+
+void *TimeEntry::operator new(std::size_t size) {
+    if (size != sizeof(TimeEntry)) {
+        return ::operator new(size);
+    }
+    return timeEntryPool().Allocate();
+}
+
+void TimeEntry::operator delete(void *p, std::size_t size) {
+    if (size != sizeof(TimeEntry)) {
+        ::operator delete(p);
+        return;
+    }
+    timeEntryPool().Release(p);
+}
+
 bool TimeEntry::ResolveError(const error err) {
     if (durationTooLarge(err) && Stop() && Start()) {
         Poco::UInt64 seconds =
@@ -233,16 +257,8 @@ void TimeEntry::SetTID(const Poco::UInt64 value) {
 static const char kTagSeparator = '\t';
 
 void TimeEntry::SetTags(const std::string tags) {
-    if (Tags() != tags) {
-        TagNames.clear();
-        if (!tags.empty()) {
-            std::stringstream ss(tags);
-            while (ss.good()) {
-                std::string tag;
-                getline(ss, tag, kTagSeparator);
-                TagNames.push_back(tag);
-            }
-        }
+    if (tags_ != tags) {
+        tags_ = tags;
         SetDirty();
     }
 }
@@ -305,18 +321,17 @@ void TimeEntry::SetProjectGUID(const std::string value) {
     }
 }
 
-const std::string TimeEntry::Tags() const {
-    std::stringstream ss;
-    for (std::vector<std::string>::const_iterator it =
-        TagNames.begin();
-            it != TagNames.end();
-            it++) {
-        if (it != TagNames.begin()) {
-            ss << kTagSeparator;
+std::vector<std::string> TimeEntry::TagNames() const {
+    std::vector<std::string> result;
+    if (!tags_.empty()) {
+        std::stringstream ss(tags_);
+        while (ss.good()) {
+            std::string tag;
+            getline(ss, tag, kTagSeparator);
+            result.push_back(tag);
         }
-        ss << *it;
     }
-    return ss.str();
+    return result;
 }
 
 std::string TimeEntry::DateHeaderString() const {
@@ -340,7 +355,7 @@ bool TimeEntry::IsToday() const {
            today.day() == datetime.day();
 }
 
-void TimeEntry::LoadFromJSON(Json::Value data) {
+void TimeEntry::LoadFromJSON(const Json::Value &data) {
     Json::Value modified = data["ui_modified_at"];
     Poco::UInt64 ui_modified_at(0);
     if (modified.isString()) {
@@ -432,8 +447,9 @@ Json::Value TimeEntry::SaveToJSON() const {
     n["created_with"] = Formatter::EscapeJSONString(CreatedWith());
 
     Json::Value tag_nodes;
-    for (std::vector<std::string>::const_iterator it = TagNames.begin();
-            it != TagNames.end();
+    std::vector<std::string> tag_names = TagNames();
+    for (std::vector<std::string>::const_iterator it = tag_names.begin();
+            it != tag_names.end();
             it++) {
         std::string tag_name = Formatter::EscapeJSONString(*it);
         tag_nodes.append(Json::Value(tag_name));
@@ -443,6 +459,65 @@ Json::Value TimeEntry::SaveToJSON() const {
     return n;
 }
 
+void TimeEntry::WriteJSON(JSONWriter *writer) const {
+    poco_check_ptr(writer);
+
+    writer->BeginObject();
+    if (ID()) {
+        writer->Key("id");
+        writer->UInt(ID());
+    }
+    writer->Key("description");
+    writer->String(Formatter::EscapeJSONString(Description()));
+    if (WID()) {
+        writer->Key("wid");
+        writer->UInt(WID());
+    }
+    writer->Key("guid");
+    writer->String(GUID());
+    writer->Key("pid");
+    if (!PID() && !ProjectGUID().empty()) {
+        writer->String(ProjectGUID());
+    } else {
+        writer->UInt(PID());
+    }
+    writer->Key("tid");
+    writer->UInt(TID());
+    writer->Key("start");
+    writer->String(StartString());
+    if (Stop()) {
+        writer->Key("stop");
+        writer->String(StopString());
+    }
+    writer->Key("duration");
+    writer->Int(DurationInSeconds());
+    writer->Key("billable");
+    writer->Bool(Billable());
+    writer->Key("duronly");
+    writer->Bool(DurOnly());
+    writer->Key("ui_modified_at");
+    writer->UInt(UIModifiedAt());
+    writer->Key("created_with");
+    writer->String(Formatter::EscapeJSONString(CreatedWith()));
+
+    // Same as SaveToJSON, which sends null if there are no tags
+    writer->Key("tags");
+    if (Tags().empty()) {
+        writer->Null();
+    } else {
+        writer->BeginArray();
+        std::vector<std::string> tag_names = TagNames();
+        for (std::vector<std::string>::const_iterator it = tag_names.begin();
+                it != tag_names.end();
+                it++) {
+            writer->String(Formatter::EscapeJSONString(*it));
+        }
+        writer->EndArray();
+    }
+
+    writer->EndObject();
+}
+
 Poco::UInt64 TimeEntry::AbsDuration(const Poco::Int64 value) {
     Poco::Int64 duration = value;
 
@@ -462,14 +537,20 @@ Poco::UInt64 TimeEntry::AbsDuration(const Poco::Int64 value) {
 }
 
 void TimeEntry::loadTagsFromJSON(Json::Value list) {
-    TagNames.clear();
-
+    std::stringstream ss;
+    bool first(true);
     for (unsigned int i = 0; i < list.size(); i++) {
         std::string tag = list[i].asString();
-        if (!tag.empty()) {
-            TagNames.push_back(tag);
+        if (tag.empty()) {
+            continue;
+        }
+        if (!first) {
+            ss << kTagSeparator;
         }
+        ss << tag;
+        first = false;
     }
+    tags_ = ss.str();
 }
 
 }   // namespace toggl
@@ -3,11 +3,13 @@
 #ifndef SRC_TIME_ENTRY_H_
 #define SRC_TIME_ENTRY_H_
 
+#include <cstddef>
 #include <string>
 #include <vector>
 
 #include "./base_model.h"
 #include "./const.h"
+#include "./string_pool.h"
 #include "./types.h"
 
 #include "Poco/Types.h"
@@ -22,19 +24,27 @@ class TimeEntry : public BaseModel {
     , pid_(0)
     , tid_(0)
     , billable_(false)
+    , duronly_(false)
     , start_(0)
     , stop_(0)
     , duration_in_seconds_(0)
     , description_("")
-    , duronly_(false)
     , created_with_("")
-    , project_guid_("") {}
+    , project_guid_("")
+    , tags_("") {}
 
     virtual ~TimeEntry() {}
 
-    std::vector<std::string> TagNames;
+    // Time entries are allocated from a ModelPool
+    static void *operator new(std::size_t size);
+    static void operator delete(void *p, std::size_t size);
 
-    const std::string Tags() const;
+    std::vector<std::string> TagNames() const;
+
+    // Tag names, separated by tabs
+    const std::string &Tags() const {
+        return tags_;
+    }
     void SetTags(const std::string tags);
 
     const Poco::UInt64 &WID() const {
@@ -113,8 +123,9 @@ class TimeEntry : public BaseModel {
         return "/api/v8/time_entries";
     }
 
-    void LoadFromJSON(Json::Value value);
+    void LoadFromJSON(const Json::Value &value);
     Json::Value SaveToJSON() const;
+    void WriteJSON(JSONWriter *writer) const;
 
     // User-triggered changes to timer:
     void SetDurationUserInput(const std::string);
@@ -136,13 +147,16 @@ class TimeEntry : public BaseModel {
     Poco::UInt64 pid_;
     Poco::UInt64 tid_;
     bool billable_;
+    bool duronly_;
     Poco::UInt64 start_;
     Poco::UInt64 stop_;
     Poco::Int64 duration_in_seconds_;
-    std::string description_;
-    bool duronly_;
-    std::string created_with_;
-    std::string project_guid_;
+
+    // Values repeated across time entries are interned
+    InternedString description_;
+    InternedString created_with_;
+    InternedString project_guid_;
+    InternedString tags_;
 
     bool setDurationStringHHMMSS(const std::string value);
     bool setDurationStringHHMM(const std::string value);
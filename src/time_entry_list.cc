@@ -0,0 +1,328 @@
+// Copyright 2015 Toggl Desktop developers.
+
+#include "../src/time_entry_list.h"
+
+#include <algorithm>
+#include <utility>
+
+#include "./formatter.h"
+#include "./time_entry.h"
+
+namespace toggl {
+
+bool TimeEntryList::isListed(TimeEntry * const te) {
+    return te && !te->GUID().empty() && !te->DeletedAt();
+}
+
+// Newest first. Ties are broken by GUID, in the reverse order
+// of CompareTimeEntriesByStart, which the full render uses.
+bool TimeEntryList::rowBefore(const Row &a, const Row &b) {
+    if (a.Start != b.Start) {
+        return a.Start > b.Start;
+    }
+    return a.GUID > b.GUID;
+}
+
+void TimeEntryList::Clear() {
+    entries_.clear();
+    rows_.clear();
+    day_totals_.clear();
+    running_.clear();
+    initialized_ = false;
+}
+
+bool TimeEntryList::entryOf(TimeEntry * const te, Entry *entry) {
+    if (!isListed(te)) {
+        return false;
+    }
+    entry->Start = te->Start();
+    entry->Duration = te->DurationInSeconds();
+    entry->Day = ViewSnapshot::DayOf(te->Start());
+    return true;
+}
+
+// Snapshots have only listed time entries
+bool TimeEntryList::entryOf(
+    const TimeEntryViewData * const te,
+    Entry *entry) {
+    if (!te) {
+        return false;
+    }
+    entry->Start = te->Start;
+    entry->Duration = te->DurationInSeconds;
+    entry->Day = ViewSnapshot::DayOf(te->Start);
+    return true;
+}
+
+void TimeEntryList::Reset(const std::vector<TimeEntry *> &list) {
+    std::vector<std::pair<guid, Entry> > entries;
+    for (std::vector<TimeEntry *>::const_iterator it = list.begin();
+            it != list.end(); it++) {
+        Entry entry;
+        if (entryOf(*it, &entry)) {
+            entries.push_back(std::make_pair((*it)->GUID(), entry));
+        }
+    }
+    reset(entries);
+}
+
+void TimeEntryList::Reset(const std::vector<TimeEntryViewDataPtr> &list) {
+    std::vector<std::pair<guid, Entry> > entries;
+    for (std::vector<TimeEntryViewDataPtr>::const_iterator it = list.begin();
+            it != list.end(); it++) {
+        Entry entry;
+        if (entryOf(it->get(), &entry)) {
+            entries.push_back(std::make_pair((*it)->GUID, entry));
+        }
+    }
+    reset(entries);
+}
+
+void TimeEntryList::reset(
+    const std::vector<std::pair<guid, Entry> > &entries) {
+    Clear();
+
+    for (std::vector<std::pair<guid, Entry> >::const_iterator it =
+        entries.begin(); it != entries.end(); it++) {
+        const Entry &entry = it->second;
+        addEntry(it->first, entry);
+
+        if (entry.Duration >= 0) {
+            Row row;
+            row.GUID = it->first;
+            row.Start = entry.Start;
+            row.Day = entry.Day;
+            rows_.push_back(row);
+        }
+    }
+
+    std::sort(rows_.begin(), rows_.end(), rowBefore);
+
+    for (size_t i = 0; i < rows_.size(); i++) {
+        Row &row = rows_[i];
+        row.IsHeader = !i || rows_[i - 1].Day != row.Day;
+        row.DateDuration = Formatter::FormatDurationForDateHeader(
+            DateTotal(row.Day));
+    }
+
+    initialized_ = true;
+}
+
+void TimeEntryList::GUIDs(std::vector<guid> *result) const {
+    poco_check_ptr(result);
+
+    for (std::vector<Row>::const_iterator it = rows_.begin();
+            it != rows_.end(); it++) {
+        result->push_back(it->GUID);
+    }
+}
+
+bool TimeEntryList::IsHeader(const size_t position) const {
+    return rows_.at(position).IsHeader;
+}
+
+std::string TimeEntryList::DateDuration(const size_t position) const {
+    return rows_.at(position).DateDuration;
+}
+
+void TimeEntryList::Update(
+    const guid GUID,
+    TimeEntry * const te,
+    std::vector<TimeEntryListChange> *changes) {
+    Entry entry;
+    update(GUID, entryOf(te, &entry) ? &entry : nullptr, changes);
+}
+
+void TimeEntryList::Update(
+    const guid GUID,
+    const ViewSnapshot &snapshot,
+    std::vector<TimeEntryListChange> *changes) {
+    Entry entry;
+    bool listed = entryOf(snapshot.TimeEntryByGUID(GUID), &entry);
+    update(GUID, listed ? &entry : nullptr, changes);
+}
+
+void TimeEntryList::update(
+    const guid GUID,
+    const Entry * const listed,
+    std::vector<TimeEntryListChange> *changes) {
+
+    poco_check_ptr(changes);
+
+    if (GUID.empty()) {
+        return;
+    }
+
+    // Days whose rows may need a new header or date duration
+    std::vector<Entry> days;
+
+    Poco::Int64 old_position(-1);
+    std::map<guid, Entry>::const_iterator it = entries_.find(GUID);
+    if (it != entries_.end()) {
+        days.push_back(it->second);
+        old_position = removeEntry(GUID);
+    }
+
+    Poco::Int64 new_position(-1);
+    if (listed) {
+        days.push_back(*listed);
+        addEntry(GUID, *listed);
+        if (listed->Duration >= 0) {
+            new_position = insertRow(GUID, *listed);
+        }
+    }
+
+    std::vector<TimeEntryListChange> day_changes;
+    for (std::vector<Entry>::const_iterator day = days.begin();
+            day != days.end(); day++) {
+        refreshDay(*day, GUID, &day_changes);
+    }
+
+    if (old_position >= 0 && old_position != new_position) {
+        changes->push_back(TimeEntryListChange(
+            kTimeEntryListDelete, GUID, old_position, false, ""));
+    }
+    if (new_position >= 0) {
+        const Row &row = rows_[new_position];
+        changes->push_back(TimeEntryListChange(
+            old_position == new_position
+            ? kTimeEntryListUpdate : kTimeEntryListInsert,
+            GUID, new_position, row.IsHeader, row.DateDuration));
+    }
+    changes->insert(changes->end(), day_changes.begin(), day_changes.end());
+}
+
+void TimeEntryList::Tick(std::vector<TimeEntryListChange> *changes) {
+    poco_check_ptr(changes);
+
+    for (std::set<guid>::const_iterator it = running_.begin();
+            it != running_.end(); it++) {
+        std::map<guid, Entry>::const_iterator entry = entries_.find(*it);
+        if (entry != entries_.end()) {
+            refreshDay(entry->second, "", changes);
+        }
+    }
+}
+
+void TimeEntryList::addEntry(const guid GUID, const Entry &entry) {
+    entries_[GUID] = entry;
+    if (entry.Duration < 0) {
+        running_.insert(GUID);
+    } else {
+        day_totals_[entry.Day] += entry.Duration;
+    }
+}
+
+Poco::Int64 TimeEntryList::insertRow(const guid GUID, const Entry &entry) {
+    Row row;
+    row.GUID = GUID;
+    row.Start = entry.Start;
+    row.Day = entry.Day;
+    std::vector<Row>::iterator pos =
+        std::lower_bound(rows_.begin(), rows_.end(), row, rowBefore);
+    pos = rows_.insert(pos, row);
+    return pos - rows_.begin();
+}
+
+// Forget the time entry and return its former
+// list position, or -1 if it was not displayed.
+Poco::Int64 TimeEntryList::removeEntry(const guid GUID) {
+    std::map<guid, Entry>::iterator it = entries_.find(GUID);
+    if (it == entries_.end()) {
+        return -1;
+    }
+    Entry entry = it->second;
+    entries_.erase(it);
+
+    if (entry.Duration < 0) {
+        running_.erase(GUID);
+        return -1;
+    }
+
+    day_totals_[entry.Day] -= entry.Duration;
+    if (!day_totals_[entry.Day]) {
+        day_totals_.erase(entry.Day);
+    }
+
+    Row row;
+    row.GUID = GUID;
+    row.Start = entry.Start;
+    std::vector<Row>::iterator pos =
+        std::lower_bound(rows_.begin(), rows_.end(), row, rowBefore);
+    if (pos == rows_.end() || pos->GUID != GUID) {
+        return -1;
+    }
+    Poco::Int64 position = pos - rows_.begin();
+    rows_.erase(pos);
+    return position;
+}
+
+Poco::Int64 TimeEntryList::DateTotal(const int day) const {
+    Poco::Int64 total(0);
+    std::map<int, Poco::Int64>::const_iterator it = day_totals_.find(day);
+    if (it != day_totals_.end()) {
+        total = it->second;
+    }
+    for (std::set<guid>::const_iterator running = running_.begin();
+            running != running_.end(); running++) {
+        std::map<guid, Entry>::const_iterator entry = entries_.find(*running);
+        if (entry != entries_.end() && entry->second.Day == day) {
+            total += TimeEntry::AbsDuration(entry->second.Duration);
+        }
+    }
+    return total;
+}
+
+// Recalculate header flags and date durations for the rows of the
+// day the given entry belongs to. Rows of a day are contiguous,
+// since the day is derived from the start time.
+void TimeEntryList::refreshDay(
+    const Entry &day,
+    const guid changed_guid,
+    std::vector<TimeEntryListChange> *changes) {
+
+    Row key;
+    key.Start = day.Start;
+    std::vector<Row>::iterator pos =
+        std::lower_bound(rows_.begin(), rows_.end(), key, rowBefore);
+    size_t first = pos - rows_.begin();
+    while (first > 0 && rows_[first - 1].Day == day.Day) {
+        first--;
+    }
+
+    std::string date_duration =
+        Formatter::FormatDurationForDateHeader(DateTotal(day.Day));
+
+    for (size_t i = first;
+            i < rows_.size() && rows_[i].Day == day.Day;
+            i++) {
+        Row &row = rows_[i];
+        bool is_header = (i == first);
+        if (row.IsHeader == is_header && row.DateDuration == date_duration) {
+            continue;
+        }
+        row.IsHeader = is_header;
+        row.DateDuration = date_duration;
+        if (row.GUID != changed_guid) {
+            changes->push_back(TimeEntryListChange(
+                kTimeEntryListUpdate, row.GUID, i, is_header, date_duration));
+        }
+    }
+
+    // The row following the day may have lost or gained its header flag
+    // too, if it was right after a row that moved away.
+    size_t next = first;
+    while (next < rows_.size() && rows_[next].Day == day.Day) {
+        next++;
+    }
+    if (next < rows_.size() && !rows_[next].IsHeader) {
+        Row &row = rows_[next];
+        row.IsHeader = true;
+        if (row.GUID != changed_guid) {
+            changes->push_back(TimeEntryListChange(
+                kTimeEntryListUpdate, row.GUID, next, true, row.DateDuration));
+        }
+    }
+}
+
+}   // namespace toggl
@@ -0,0 +1,182 @@
+// Copyright 2015 Toggl Desktop developers.
+
+#ifndef SRC_TIME_ENTRY_LIST_H_
+#define SRC_TIME_ENTRY_LIST_H_
+
+#include <map>
+#include <set>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "./types.h"
+#include "./view_snapshot.h"
+
+#include "Poco/Types.h"
+
+namespace toggl {
+
+#define kTimeEntryListInsert 0
+#define kTimeEntryListUpdate 1
+#define kTimeEntryListDelete 2
+
+class TimeEntry;
+
+class TimeEntryListChange {
+ public:
+    TimeEntryListChange(
+        const Poco::Int64 change_type,
+        const guid GUID,
+        const Poco::Int64 position,
+        const bool is_header,
+        const std::string date_duration)
+        : change_type_(change_type)
+    , GUID_(GUID)
+    , position_(position)
+    , is_header_(is_header)
+    , date_duration_(date_duration) {}
+
+    const Poco::Int64 &ChangeType() const {
+        return change_type_;
+    }
+    const guid &GUID() const {
+        return GUID_;
+    }
+    // Position in the list, newest time entry first.
+    // Changes must be applied in the order they were made.
+    const Poco::Int64 &Position() const {
+        return position_;
+    }
+    const bool &IsHeader() const {
+        return is_header_;
+    }
+    const std::string &DateDuration() const {
+        return date_duration_;
+    }
+    bool IsDeletion() const {
+        return kTimeEntryListDelete == change_type_;
+    }
+
+ private:
+    Poco::Int64 change_type_;
+    guid GUID_;
+    Poco::Int64 position_;
+    bool is_header_;
+    std::string date_duration_;
+};
+
+// Sorted, day-bucketed model of the time entry list as it was
+// last sent to UI, newest time entry first. Time entry model
+// changes are turned into insert/update/delete deltas against it,
+// so UI can patch its list instead of rebuilding it.
+class TimeEntryList {
+ public:
+    TimeEntryList()
+        : initialized_(false) {}
+
+    // Start over from a full render. The list contains all visible
+    // time entries, running ones included, in any order.
+    void Reset(const std::vector<TimeEntry *> &list);
+    void Reset(const std::vector<TimeEntryViewDataPtr> &list);
+    void Clear();
+
+    bool Initialized() const {
+        return initialized_;
+    }
+
+    // Time entries in list order, as used for the full render
+    void GUIDs(std::vector<guid> *result) const;
+
+    size_t Size() const {
+        return rows_.size();
+    }
+    bool IsHeader(const size_t position) const;
+    std::string DateDuration(const size_t position) const;
+
+    // Apply a time entry change and collect the resulting list deltas.
+    // Pass a null te when the time entry no longer exists.
+    void Update(
+        const guid GUID,
+        TimeEntry * const te,
+        std::vector<TimeEntryListChange> *changes);
+    void Update(
+        const guid GUID,
+        const ViewSnapshot &snapshot,
+        std::vector<TimeEntryListChange> *changes);
+
+    // Refresh date durations of the days that have a running time
+    // entry and collect updates for the rows whose duration changed.
+    void Tick(std::vector<TimeEntryListChange> *changes);
+
+    // Total duration of a date, as given by ViewSnapshot::DayOf,
+    // running time entries included
+    Poco::Int64 DateTotal(const int day) const;
+
+ private:
+    class Entry {
+     public:
+        Entry()
+            : Start(0)
+        , Duration(0)
+        , Day(0) {}
+
+        Poco::UInt64 Start;
+        Poco::Int64 Duration;
+        int Day;
+    };
+
+    class Row {
+     public:
+        Row()
+            : GUID("")
+        , Start(0)
+        , Day(0)
+        , IsHeader(false)
+        , DateDuration("") {}
+
+        guid GUID;
+        Poco::UInt64 Start;
+        int Day;
+        bool IsHeader;
+        std::string DateDuration;
+    };
+
+    static bool isListed(TimeEntry * const te);
+    static bool rowBefore(const Row &a, const Row &b);
+
+    // Fill in the entry of a listed time entry
+    static bool entryOf(TimeEntry * const te, Entry *entry);
+    static bool entryOf(const TimeEntryViewData * const te, Entry *entry);
+
+    void reset(const std::vector<std::pair<guid, Entry> > &entries);
+    void update(
+        const guid GUID,
+        const Entry * const listed,
+        std::vector<TimeEntryListChange> *changes);
+
+    void addEntry(const guid GUID, const Entry &entry);
+    Poco::Int64 insertRow(const guid GUID, const Entry &entry);
+    Poco::Int64 removeEntry(const guid GUID);
+
+    void refreshDay(
+        const Entry &day,
+        const guid changed_guid,
+        std::vector<TimeEntryListChange> *changes);
+
+    bool initialized_;
+
+    // All tracked time entries by GUID, running ones included
+    std::map<guid, Entry> entries_;
+
+    // Stopped time entries, as displayed in the list
+    std::vector<Row> rows_;
+
+    // Total duration of stopped time entries per date
+    std::map<int, Poco::Int64> day_totals_;
+
+    std::set<guid> running_;
+};
+
+}  // namespace toggl
+
+#endif  // SRC_TIME_ENTRY_LIST_H_
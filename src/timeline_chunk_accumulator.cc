@@ -0,0 +1,90 @@
+// Copyright 2015 Toggl Desktop developers.
+
+#include "../src/timeline_chunk_accumulator.h"
+
+#include "./const.h"
+
+namespace toggl {
+
+bool TimelineChunkAccumulator::Key::operator<(const Key &other) const {
+    if (ChunkStart != other.ChunkStart) {
+        return ChunkStart < other.ChunkStart;
+    }
+    if (Filename != other.Filename) {
+        return Filename < other.Filename;
+    }
+    if (Title != other.Title) {
+        return Title < other.Title;
+    }
+    return Idle < other.Idle;
+}
+
+void TimelineChunkAccumulator::Add(const TimelineEvent &event) {
+    Poco::Mutex::ScopedLock lock(mutex_);
+
+    time_t chunk_start =
+        (event.start_time / kTimelineChunkSeconds) * kTimelineChunkSeconds;
+
+    time_t duration = event.end_time - event.start_time;
+    if (duration < 0) {
+        duration = 0;
+    }
+
+    Key key(event, chunk_start);
+    std::map<Key, TimelineEvent>::iterator it = chunks_.find(key);
+    if (it == chunks_.end()) {
+        TimelineEvent chunk;
+        chunk.user_id = event.user_id;
+        chunk.start_time = event.start_time;
+        chunk.end_time = chunk.start_time + duration;
+        chunk.filename = event.filename;
+        chunk.title = event.title;
+        chunk.idle = event.idle;
+        chunks_[key] = chunk;
+        return;
+    }
+
+    TimelineEvent &chunk = it->second;
+    if (event.start_time < chunk.start_time) {
+        chunk.end_time -= chunk.start_time - event.start_time;
+        chunk.start_time = event.start_time;
+    }
+    chunk.end_time += duration;
+}
+
+void TimelineChunkAccumulator::TakeCompleted(
+    const time_t earliest_start,
+    std::vector<TimelineEvent> *result) {
+
+    poco_check_ptr(result);
+
+    Poco::Mutex::ScopedLock lock(mutex_);
+
+    std::map<Key, TimelineEvent>::iterator it = chunks_.begin();
+    while (it != chunks_.end()
+            && it->first.ChunkStart + kTimelineChunkSeconds <= earliest_start) {
+        TimelineEvent chunk = it->second;
+        chunk.chunked = true;
+        result->push_back(chunk);
+        chunks_.erase(it++);
+    }
+}
+
+void TimelineChunkAccumulator::TakeAll(std::vector<TimelineEvent> *result) {
+    poco_check_ptr(result);
+
+    Poco::Mutex::ScopedLock lock(mutex_);
+
+    for (std::map<Key, TimelineEvent>::const_iterator it = chunks_.begin();
+            it != chunks_.end(); it++) {
+        result->push_back(it->second);
+    }
+    chunks_.clear();
+}
+
+size_t TimelineChunkAccumulator::Size() const {
+    Poco::Mutex::ScopedLock lock(mutex_);
+    return chunks_.size();
+}
+
+}   // namespace toggl
@@ -0,0 +1,66 @@
+// Copyright 2015 Toggl Desktop developers.
+
+#ifndef SRC_TIMELINE_CHUNK_ACCUMULATOR_H_
+#define SRC_TIMELINE_CHUNK_ACCUMULATOR_H_
+
+#include <map>
+#include <string>
+#include <vector>
+
+#include "./timeline_event.h"
+
+#include "Poco/Mutex.h"
+
+namespace toggl {
+
+// Merges timeline events in memory into chunks of
+// kTimelineChunkSeconds, by app, window title and idle state,
+// the same way as the database compresses raw events. A chunk
+// starts with its first event and lasts as long as its events
+// together. Only completed chunks need to be saved.
+class TimelineChunkAccumulator {
+ public:
+    TimelineChunkAccumulator() {}
+
+    void Add(const TimelineEvent &event);
+
+    // Remove the chunks that no event starting at or after
+    // given time can belong to, and append them to result
+    // as chunked events.
+    void TakeCompleted(
+        const time_t earliest_start,
+        std::vector<TimelineEvent> *result);
+
+    // Remove all chunks, also incomplete ones, and append
+    // them to result as raw events. The database merges
+    // them with any later events of the same chunk.
+    void TakeAll(std::vector<TimelineEvent> *result);
+
+    size_t Size() const;
+
+ private:
+    class Key {
+     public:
+        Key(const TimelineEvent &event, const time_t chunk_start)
+            : ChunkStart(chunk_start)
+        , Filename(event.filename)
+        , Title(event.title)
+        , Idle(event.idle) {}
+
+        bool operator<(const Key &other) const;
+
+        time_t ChunkStart;
+        std::string Filename;
+        std::string Title;
+        bool Idle;
+    };
+
+    mutable Poco::Mutex mutex_;
+
+    // Chunks ordered by start of chunk
+    std::map<Key, TimelineEvent> chunks_;
+};
+
+}  // namespace toggl
+
+#endif  // SRC_TIMELINE_CHUNK_ACCUMULATOR_H_
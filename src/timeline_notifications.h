@@ -66,7 +66,8 @@ class TimelineDatasource {
     virtual error StartAutotrackerEvent(const TimelineEvent event) = 0;
 
     // A timeline event is detected, window has changes
-    // or there's an idle event.
+    // or there's an idle event. Completed chunks of
+    // events come already merged, as chunked events.
     virtual error StartTimelineEvent(TimelineEvent *event) = 0;
 
     // Find timeline events for upload,
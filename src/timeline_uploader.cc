@@ -7,14 +7,12 @@
 
 #include "./formatter.h"
 #include "./https_client.h"
+#include "./json_writer.h"
 #include "./urls.h"
 
 #include "Poco/Foundation.h"
-#include "Poco/Thread.h"
 #include "Poco/Util/Application.h"
 
-#include <json/json.h>  // NOLINT
-
 namespace toggl {
 
 Poco::Logger &TimelineUploader::logger() const {
@@ -22,13 +20,7 @@ Poco::Logger &TimelineUploader::logger() const {
 }
 
 void TimelineUploader::sleep() {
-    // Sleep in increments for faster shutdown.
-    for (unsigned int i = 0; i < current_upload_interval_seconds_*4; i++) {
-        if (uploading_.isStopped()) {
-            return;
-        }
-        Poco::Thread::sleep(250);
-    }
+    wakeup_.Wait(current_upload_interval_seconds_ * 1000);
 }
 
 void TimelineUploader::upload_loop_activity() {
@@ -111,24 +103,32 @@ std::string convertTimelineToJSON(
     const std::vector<TimelineEvent> &timeline_events,
     const std::string &desktop_id) {
 
-    Json::Value root;
+    std::string result("");
+    JSONWriter writer(&result);
 
+    writer.BeginArray();
     for (std::vector<TimelineEvent>::const_iterator i = timeline_events.begin();
             i != timeline_events.end();
             ++i) {
         const TimelineEvent &event = *i;
-        Json::Value n;
-        n["filename"] = event.filename;
-        n["title"] = event.title;
-        n["start_time"] = Json::Int64(event.start_time);
-        n["end_time"] = Json::Int64(event.end_time);
-        n["desktop_id"] = desktop_id;
-        n["created_with"] = "timeline";
-        root.append(n);
+        writer.BeginObject();
+        writer.Key("filename");
+        writer.String(event.filename);
+        writer.Key("title");
+        writer.String(event.title);
+        writer.Key("start_time");
+        writer.Int(event.start_time);
+        writer.Key("end_time");
+        writer.Int(event.end_time);
+        writer.Key("desktop_id");
+        writer.String(desktop_id);
+        writer.Key("created_with");
+        writer.String("timeline");
+        writer.EndObject();
     }
+    writer.EndArray();
 
-    Json::StyledWriter writer;
-    return writer.write(root);
+    return result;
 }
 
 void TimelineUploader::backoff() {
@@ -165,6 +165,7 @@ error TimelineUploader::Shutdown() {
     try {
         if (uploading_.isRunning()) {
             uploading_.stop();
+            wakeup_.Signal();
             uploading_.wait();
         }
     } catch(const Poco::Exception& exc) {
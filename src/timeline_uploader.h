@@ -10,6 +10,7 @@
 #include "./timeline_event.h"
 #include "./timeline_notifications.h"
 #include "./types.h"
+#include "./wakeup.h"
 
 #include "Poco/Activity.h"
 
@@ -60,6 +61,9 @@ class TimelineUploader {
 
     TimelineDatasource *timeline_datasource_;
 
+    // Ends the wait between uploads on shutdown
+    Wakeup wakeup_;
+
     // An Activity is a possibly long running void/no arguments
     // member function running in its own thread.
     Poco::Activity<TimelineUploader> uploading_;
@@ -12,7 +12,9 @@
 #include "./client.h"
 #include "./const.h"
 #include "./context.h"
+#include "./context_commands.h"
 #include "./custom_error_handler.h"
+#include "./database.h"
 #include "./feedback.h"
 #include "./formatter.h"
 #include "./https_client.h"
@@ -30,6 +32,11 @@
 #include "Poco/Logger.h"
 #include "Poco/UnicodeConverter.h"
 
+// Queue a command in async mode. True if it was queued.
+static bool_t enqueue(void *context, toggl::Command *command) {
+    return app(context)->Commands()->Enqueue(command) != 0;
+}
+
 void *toggl_context_init(
     const char_t *app_name,
     const char_t *app_version) {
@@ -465,6 +472,15 @@ char_t *toggl_start(
         p_guid = to_string(project_guid);
     }
 
+    if (app(context)->AsyncCommands()) {
+        std::string guid = toggl::Database::GenerateGUID();
+        if (!enqueue(context, new toggl::StartCommand(
+            app(context), desc, dur, task_id, project_id, p_guid, guid))) {
+            return nullptr;
+        }
+        return copy_string(guid);
+    }
+
     toggl::TimeEntry *te = app(context)->Start(desc, dur,
                            task_id,
                            project_id, p_guid);
@@ -484,6 +500,11 @@ bool_t toggl_continue(
     ss << "toggl_continue guid=" << guid;
     logger().debug(ss.str());
 
+    if (app(context)->AsyncCommands()) {
+        return enqueue(context, new toggl::ContinueCommand(
+            app(context), to_string(guid)));
+    }
+
     return toggl::noError == app(context)->Continue(to_string(guid));
 }
 
@@ -491,6 +512,11 @@ void toggl_view_time_entry_list(void *context) {
     app(context)->DisplayTimeEntryList(true);
 }
 
+bool_t toggl_load_more_time_entries(void *context) {
+    logger().debug("toggl_load_more_time_entries");
+    return toggl::noError == app(context)->LoadMoreTimeEntries();
+}
+
 void toggl_edit(
     void *context,
     const char_t *guid,
@@ -520,6 +546,10 @@ bool_t toggl_continue_latest(
 
     logger().debug("toggl_continue_latest");
 
+    if (app(context)->AsyncCommands()) {
+        return enqueue(context, new toggl::ContinueCommand(app(context), ""));
+    }
+
     return toggl::noError == app(context)->ContinueLatest();
 }
 
@@ -533,6 +563,11 @@ bool_t toggl_delete_time_entry(
     ss << "toggl_delete_time_entry guid=" << guid;
     logger().debug(ss.str());
 
+    if (app(context)->AsyncCommands()) {
+        return enqueue(context, new toggl::DeleteTimeEntryCommand(
+            app(context), to_string(guid)));
+    }
+
     return toggl::noError == app(context)->
            DeleteTimeEntryByGUID(to_string(guid));
 }
@@ -550,6 +585,13 @@ bool_t toggl_set_time_entry_duration(
         << ", value=" << value;
     logger().debug(ss.str());
 
+    if (app(context)->AsyncCommands()) {
+        return enqueue(context, new toggl::SetTimeEntryValueCommand(
+            "set_time_entry_duration", app(context),
+            &toggl::Context::SetTimeEntryDuration,
+            to_string(guid), to_string(value)));
+    }
+
     return toggl::noError == app(context)->SetTimeEntryDuration(
         to_string(guid),
         to_string(value));
@@ -567,6 +609,11 @@ bool_t toggl_set_time_entry_project(
     if (project_guid) {
         pguid = to_string(project_guid);
     }
+    if (app(context)->AsyncCommands()) {
+        return enqueue(context, new toggl::SetTimeEntryProjectCommand(
+            app(context), to_string(guid), task_id, project_id, pguid));
+    }
+
     return toggl::noError == app(context)->SetTimeEntryProject(to_string(guid),
             task_id,
             project_id,
@@ -585,6 +632,11 @@ bool_t toggl_set_time_entry_date(
         << ", unix_timestamp=" << unix_timestamp;
     logger().debug(ss.str());
 
+    if (app(context)->AsyncCommands()) {
+        return enqueue(context, new toggl::SetTimeEntryDateCommand(
+            app(context), to_string(guid), unix_timestamp));
+    }
+
     return toggl::noError == app(context)->
            SetTimeEntryDate(to_string(guid), unix_timestamp);
 }
@@ -601,6 +653,13 @@ bool_t toggl_set_time_entry_start(
         << ", value=" << value;
     logger().debug(ss.str());
 
+    if (app(context)->AsyncCommands()) {
+        return enqueue(context, new toggl::SetTimeEntryValueCommand(
+            "set_time_entry_start", app(context),
+            &toggl::Context::SetTimeEntryStart,
+            to_string(guid), to_string(value)));
+    }
+
     return toggl::noError == app(context)->
            SetTimeEntryStart(to_string(guid), to_string(value));
 }
@@ -617,6 +676,13 @@ bool_t toggl_set_time_entry_end(
         << ", value=" << value;
     logger().debug(ss.str());
 
+    if (app(context)->AsyncCommands()) {
+        return enqueue(context, new toggl::SetTimeEntryValueCommand(
+            "set_time_entry_end", app(context),
+            &toggl::Context::SetTimeEntryStop,
+            to_string(guid), to_string(value)));
+    }
+
     return toggl::noError == app(context)->
            SetTimeEntryStop(to_string(guid), to_string(value));
 }
@@ -634,6 +700,13 @@ bool_t toggl_set_time_entry_tags(
         << ", value=" << value;
     logger().debug(ss.str());
 
+    if (app(context)->AsyncCommands()) {
+        return enqueue(context, new toggl::SetTimeEntryValueCommand(
+            "set_time_entry_tags", app(context),
+            &toggl::Context::SetTimeEntryTags,
+            to_string(guid), to_string(value)));
+    }
+
     return toggl::noError == app(context)->SetTimeEntryTags(to_string(guid),
             to_string(value));
 }
@@ -650,6 +723,11 @@ bool_t toggl_set_time_entry_billable(
         << ", value=" << value;
     logger().debug(ss.str());
 
+    if (app(context)->AsyncCommands()) {
+        return enqueue(context, new toggl::SetTimeEntryBillableCommand(
+            app(context), to_string(guid), value));
+    }
+
     return toggl::noError == app(context)->
            SetTimeEntryBillable(to_string(guid), value);
 }
@@ -666,6 +744,13 @@ bool_t toggl_set_time_entry_description(
         << ", value=" << value;
     logger().debug(ss.str());
 
+    if (app(context)->AsyncCommands()) {
+        return enqueue(context, new toggl::SetTimeEntryValueCommand(
+            "set_time_entry_description", app(context),
+            &toggl::Context::SetTimeEntryDescription,
+            to_string(guid), to_string(value)));
+    }
+
     return toggl::noError == app(context)->
            SetTimeEntryDescription(to_string(guid), to_string(value));
 }
@@ -674,6 +759,10 @@ bool_t toggl_stop(
     void *context) {
     logger().debug("toggl_stop");
 
+    if (app(context)->AsyncCommands()) {
+        return enqueue(context, new toggl::StopCommand(app(context)));
+    }
+
     return toggl::noError == app(context)->Stop();
 }
 
@@ -785,6 +874,27 @@ char_t *toggl_get_user_email(
     return copy_string(email);
 }
 
+TogglAutocompleteView *toggl_autocomplete_query(
+    void *context,
+    const uint64_t kind,
+    const char_t *text,
+    const uint64_t limit) {
+
+    std::vector<toggl::AutocompleteItem> items;
+    toggl::error err =
+        app(context)->AutocompleteQuery(kind, to_string(text), limit, &items);
+    if (err != toggl::noError) {
+        logger().error(err);
+        return nullptr;
+    }
+    return autocomplete_list_init(&items);
+}
+
+void toggl_autocomplete_view_clear(
+    TogglAutocompleteView *first) {
+    autocomplete_item_clear(first);
+}
+
 int64_t toggl_parse_duration_string_into_seconds(
     const char_t *duration_string) {
     if (!duration_string) {
@@ -869,6 +979,23 @@ void toggl_on_promotion(
     app(context)->UI()->OnDisplayPromotion(cb);
 }
 
+void toggl_on_command_state(
+    void *context,
+    TogglDisplayCommandState cb) {
+    app(context)->UI()->OnDisplayCommandState(cb);
+}
+
+void toggl_set_async_commands(
+    void *context,
+    const bool_t async) {
+    app(context)->SetAsyncCommands(async);
+}
+
+int64_t toggl_command_queue_depth(
+    void *context) {
+    return app(context)->Commands()->Depth();
+}
+
 void toggl_set_sleep(void *context) {
     app(context)->SetSleep();
 }
@@ -919,6 +1046,12 @@ void toggl_on_time_entry_list(
     app(context)->UI()->OnDisplayTimeEntryList(cb);
 }
 
+void toggl_on_time_entry_list_changes(
+    void *context,
+    TogglDisplayTimeEntryListChanges cb) {
+    app(context)->UI()->OnDisplayTimeEntryListChanges(cb);
+}
+
 void toggl_on_mini_timer_autocomplete(
     void *context,
     TogglDisplayAutocomplete cb) {
@@ -70,6 +70,19 @@ extern "C" {
         void *Next;
     } TogglTimeEntryView;
 
+    typedef struct {
+        // 0 - insert, 1 - update, 2 - delete
+        int64_t ChangeType;
+        // Position in the displayed list, newest time entry first.
+        // Changes must be applied in the order they are listed.
+        int64_t Position;
+        char_t *GUID;
+        // Time entry as it should be displayed; null on delete
+        TogglTimeEntryView *Item;
+        // Next in list
+        void *Next;
+    } TogglTimeEntryListChangeView;
+
     typedef struct {
         // This is what is displayed to user, includes project and task.
         char_t *Text;
@@ -185,6 +198,9 @@ extern "C" {
         const bool_t open,
         TogglTimeEntryView *first);
 
+    typedef void (*TogglDisplayTimeEntryListChanges)(
+        TogglTimeEntryListChangeView *first);
+
     typedef void (*TogglDisplayAutocomplete)(
         TogglAutocompleteView *first);
 
@@ -218,6 +234,14 @@ extern "C" {
         const uint64_t title_count,
         char_t *title_list[]);
 
+    // State is 0 when queued, 1 when done, 2 when failed
+    // and 3 when refused because too many commands are queued
+    typedef void (*TogglDisplayCommandState)(
+        const uint64_t command_id,
+        const char_t *name,
+        const int64_t state,
+        const char_t *errmsg);
+
     // Initialize/destroy an instance of the app
 
     TOGGL_EXPORT void *toggl_context_init(
@@ -327,6 +351,12 @@ extern "C" {
         void *context,
         TogglDisplayTimeEntryList);
 
+    // Optional. If set, time entry list updates that follow a full
+    // render are sent as incremental changes instead of a new list.
+    TOGGL_EXPORT void toggl_on_time_entry_list_changes(
+        void *context,
+        TogglDisplayTimeEntryListChanges);
+
     TOGGL_EXPORT void toggl_on_mini_timer_autocomplete(
         void *context,
         TogglDisplayAutocomplete);
@@ -375,6 +405,24 @@ extern "C" {
         void *context,
         TogglDisplayPromotion);
 
+    // Optional. Tells when commands are queued and run in async mode.
+    // The queued state is sent before the command call returns.
+    TOGGL_EXPORT void toggl_on_command_state(
+        void *context,
+        TogglDisplayCommandState);
+
+    // Async mode. Starting, stopping, continuing, deleting and
+    // editing time entries is queued and done in order on a thread
+    // of the library, so the calling thread does not wait for it.
+    // The calls return true if the command was queued.
+    TOGGL_EXPORT void toggl_set_async_commands(
+        void *context,
+        const bool_t async);
+
+    // Number of commands waiting to run in async mode
+    TOGGL_EXPORT int64_t toggl_command_queue_depth(
+        void *context);
+
     // After UI callbacks are configured, start pumping UI events
 
     TOGGL_EXPORT bool_t toggl_ui_start(
@@ -414,6 +462,11 @@ extern "C" {
     TOGGL_EXPORT void toggl_view_time_entry_list(
         void *context);
 
+    // Only recent time entries are loaded at start,
+    // this adds older ones to time entry list.
+    TOGGL_EXPORT bool_t toggl_load_more_time_entries(
+        void *context);
+
     TOGGL_EXPORT void toggl_edit(
         void *context,
         const char_t *guid,
@@ -635,6 +688,19 @@ extern "C" {
     TOGGL_EXPORT char_t *toggl_get_user_email(
         void *context);
 
+    // Search an autocomplete list, as last displayed in UI.
+    // Kind: 0 - time entry, 1 - mini timer, 2 - project.
+    // Returns up to limit items (all if zero), best matches first.
+    // You must free the result with toggl_autocomplete_view_clear.
+    TOGGL_EXPORT TogglAutocompleteView *toggl_autocomplete_query(
+        void *context,
+        const uint64_t kind,
+        const char_t *text,
+        const uint64_t limit);
+
+    TOGGL_EXPORT void toggl_autocomplete_view_clear(
+        TogglAutocompleteView *first);
+
     TOGGL_EXPORT void toggl_sync(
         void *context);
 
@@ -150,6 +150,12 @@ static int l_toggl_continue(lua_State *L) {
     return 1;
 }
 
+static int l_toggl_load_more_time_entries(lua_State *L) {
+    bool_t res = toggl_load_more_time_entries(toggl_app_instance_);
+    lua_pushboolean(L, res);
+    return 1;
+}
+
 static int l_toggl_continue_latest(lua_State *L) {
     bool_t res = toggl_continue_latest(toggl_app_instance_);
     lua_pushboolean(L, res);
@@ -404,6 +410,35 @@ static int l_toggl_get_user_email(lua_State *L) {
     return 1;
 }
 
+static int l_toggl_set_async_commands(lua_State *L) {
+    toggl_set_async_commands(toggl_app_instance_,
+                             lua_toboolean(L, -1));
+    return 0;
+}
+
+static int l_toggl_command_queue_depth(lua_State *L) {
+    lua_pushinteger(L, toggl_command_queue_depth(toggl_app_instance_));
+    return 1;
+}
+
+// Returns a table with the text of each matching item
+static int l_toggl_autocomplete_query(lua_State *L) {
+    TogglAutocompleteView *first = toggl_autocomplete_query(
+        toggl_app_instance_,
+        lua_tointeger(L, 1),
+        checkstring(L, 2),
+        lua_tointeger(L, 3));
+    lua_newtable(L);
+    int i = 1;
+    for (TogglAutocompleteView *it = first; it;
+            it = static_cast<TogglAutocompleteView *>(it->Next)) {
+        pushstring(L, it->Text);
+        lua_rawseti(L, -2, i++);
+    }
+    toggl_autocomplete_view_clear(first);
+    return 1;
+}
+
 static int l_toggl_sync(lua_State *L) {
     toggl_sync(toggl_app_instance_);
     return 0;
@@ -499,6 +534,7 @@ static const struct luaL_Reg toggl_f[] = {
     {"edit_preferences", l_toggl_edit_preferences},
     {"continue", l_toggl_continue},
     {"continue_latest", l_toggl_continue_latest},
+    {"load_more_time_entries", l_toggl_load_more_time_entries},
     {"delete_time_entry", l_toggl_delete_time_entry},
     {"set_time_entry_duration", l_toggl_set_time_entry_duration},
     {"set_time_entry_project", l_toggl_set_time_entry_project},
@@ -531,6 +567,9 @@ static const struct luaL_Reg toggl_f[] = {
     {"update_channel", l_toggl_get_update_channel},
     {"user_fullname", l_toggl_get_user_fullname},
     {"user_email", l_toggl_get_user_email},
+    {"set_async_commands", l_toggl_set_async_commands},
+    {"command_queue_depth", l_toggl_command_queue_depth},
+    {"autocomplete_query", l_toggl_autocomplete_query},
     {"sync", l_toggl_sync},
     {"timeline_toggle_recording", l_toggl_timeline_toggle_recording},
     {"timeline_is_recording_enabled", l_toggl_timeline_is_recording_enabled},
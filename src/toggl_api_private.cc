@@ -222,71 +222,63 @@ int compare_string(const char_t *s1, const char_t *s2) {
 }
 
 TogglTimeEntryView *time_entry_view_item_init(
-    toggl::TimeEntry *te,
-    const std::string workspace_name,
-    const std::string project_and_task_label,
-    const std::string task_label,
-    const std::string project_label,
-    const std::string client_label,
-    const std::string color,
-    const std::string date_duration,
+    const toggl::TimeEntryViewData &te,
+    const std::string &date_duration,
     const bool time_in_timer_format) {
 
-    poco_check_ptr(te);
-
     TogglTimeEntryView *view_item = new TogglTimeEntryView();
     poco_check_ptr(view_item);
 
-    view_item->DurationInSeconds = static_cast<int>(te->DurationInSeconds());
-    view_item->Description = copy_string(te->Description());
-    view_item->GUID = copy_string(te->GUID());
-    view_item->WID = static_cast<unsigned int>(te->WID());
-    view_item->TID = static_cast<unsigned int>(te->TID());
-    view_item->PID = static_cast<unsigned int>(te->PID());
+    view_item->DurationInSeconds = static_cast<int>(te.DurationInSeconds);
+    view_item->Description = copy_string(te.Description);
+    view_item->GUID = copy_string(te.GUID);
+    view_item->WID = static_cast<unsigned int>(te.WID);
+    view_item->TID = static_cast<unsigned int>(te.TID);
+    view_item->PID = static_cast<unsigned int>(te.PID);
     if (time_in_timer_format) {
         view_item->Duration =
-            toggl_format_tracking_time_duration(te->DurationInSeconds());
+            toggl_format_tracking_time_duration(te.DurationInSeconds);
     } else {
         view_item->Duration = copy_string(toggl::Formatter::FormatDuration(
-            te->DurationInSeconds(), toggl::Formatter::DurationFormat));
+            te.DurationInSeconds, toggl::Formatter::DurationFormat));
     }
-    view_item->Started = static_cast<unsigned int>(te->Start());
-    view_item->Ended = static_cast<unsigned int>(te->Stop());
+    view_item->Started = static_cast<unsigned int>(te.Start);
+    view_item->Ended = static_cast<unsigned int>(te.Stop);
 
-    view_item->WorkspaceName = copy_string(workspace_name);
-    view_item->ProjectAndTaskLabel = copy_string(project_and_task_label);
-    view_item->TaskLabel = copy_string(task_label);
-    view_item->ProjectLabel = copy_string(project_label);
-    view_item->ClientLabel = copy_string(client_label);
-    view_item->Color = copy_string(color);
+    view_item->WorkspaceName = copy_string(te.WorkspaceName);
+    view_item->ProjectAndTaskLabel = copy_string(te.ProjectAndTaskLabel);
+    view_item->TaskLabel = copy_string(te.TaskLabel);
+    view_item->ProjectLabel = copy_string(te.ProjectLabel);
+    view_item->ClientLabel = copy_string(te.ClientLabel);
+    view_item->Color = copy_string(te.Color);
 
     std::string start_time_string =
-        toggl::Formatter::FormatTimeForTimeEntryEditor(te->Start());
+        toggl::Formatter::FormatTimeForTimeEntryEditor(te.Start);
     std::string end_time_string =
-        toggl::Formatter::FormatTimeForTimeEntryEditor(te->Stop());
+        toggl::Formatter::FormatTimeForTimeEntryEditor(te.Stop);
 
     view_item->StartTimeString = copy_string(start_time_string);
     view_item->EndTimeString = copy_string(end_time_string);
 
     view_item->DateDuration = copy_string(date_duration);
 
-    view_item->Billable = te->Billable();
-    if (te->Tags().empty()) {
+    view_item->Billable = te.Billable;
+    if (te.Tags.empty()) {
         view_item->Tags = nullptr;
     } else {
-        view_item->Tags = copy_string(te->Tags().c_str());
+        view_item->Tags = copy_string(te.Tags.c_str());
     }
-    view_item->UpdatedAt = static_cast<unsigned int>(te->UpdatedAt());
-    view_item->DateHeader = copy_string(te->DateHeaderString());
-    view_item->DurOnly = te->DurOnly();
+    view_item->UpdatedAt = static_cast<unsigned int>(te.UpdatedAt);
+    view_item->DateHeader = copy_string(te.DateHeader());
+    view_item->DurOnly = te.DurOnly;
     view_item->IsHeader = false;
 
     view_item->CanAddProjects = false;
     view_item->CanSeeBillable = false;
     view_item->DefaultWID = 0;
 
-    if (te->ValidationError() != toggl::noError) {
-        view_item->Error = copy_string(te->ValidationError());
+    if (te.ValidationError != toggl::noError) {
+        view_item->Error = copy_string(te.ValidationError);
     } else {
         view_item->Error = nullptr;
     }
@@ -358,6 +350,40 @@ void time_entry_view_item_clear(
     delete item;
 }
 
+TogglTimeEntryListChangeView *time_entry_list_change_view_item_init(
+    const toggl::TimeEntryListChange change,
+    TogglTimeEntryView *item) {
+    TogglTimeEntryListChangeView *view = new TogglTimeEntryListChangeView();
+    view->ChangeType = change.ChangeType();
+    view->Position = change.Position();
+    view->GUID = copy_string(change.GUID());
+    view->Item = item;
+    view->Next = nullptr;
+    return view;
+}
+
+void time_entry_list_change_view_item_clear(
+    TogglTimeEntryListChangeView *view) {
+    if (!view) {
+        return;
+    }
+
+    free(view->GUID);
+    view->GUID = nullptr;
+
+    time_entry_view_item_clear(view->Item);
+    view->Item = nullptr;
+
+    if (view->Next) {
+        TogglTimeEntryListChangeView *next =
+            reinterpret_cast<TogglTimeEntryListChangeView *>(view->Next);
+        time_entry_list_change_view_item_clear(next);
+        view->Next = nullptr;
+    }
+
+    delete view;
+}
+
 TogglSettingsView *settings_view_item_init(
     const bool_t record_timeline,
     const toggl::Settings settings,
@@ -10,7 +10,9 @@
 #include "./autotracker.h"
 #include "./proxy.h"
 #include "./settings.h"
+#include "./time_entry_list.h"
 #include "./toggl_api.h"
+#include "./view_snapshot.h"
 
 namespace Poco {
 class Logger;
@@ -52,18 +54,19 @@ void view_item_clear(TogglGenericView *item);
 void autocomplete_item_clear(TogglAutocompleteView *item);
 
 TogglTimeEntryView *time_entry_view_item_init(
-    toggl::TimeEntry *te,
-    const std::string workspace_name,
-    const std::string project_and_task_label,
-    const std::string task_label,
-    const std::string project_label,
-    const std::string client_label,
-    const std::string color,
-    const std::string date_duration,
+    const toggl::TimeEntryViewData &te,
+    const std::string &date_duration,
     const bool time_in_timer_format);
 
 void time_entry_view_item_clear(TogglTimeEntryView *item);
 
+TogglTimeEntryListChangeView *time_entry_list_change_view_item_init(
+    const toggl::TimeEntryListChange change,
+    TogglTimeEntryView *item);
+
+void time_entry_list_change_view_item_clear(
+    TogglTimeEntryListChangeView *view);
+
 TogglSettingsView *settings_view_item_init(
     const bool_t record_timeline,
     const toggl::Settings settings,
@@ -25,6 +25,7 @@ CONFIG(debug, debug|release) {
 
 SOURCES += main.cpp\
     timeentryview.cpp \
+    timeentrylistchangeview.cpp \
     autocompleteview.cpp \
     genericview.cpp \
     settingsview.cpp \
@@ -52,6 +53,7 @@ SOURCES += main.cpp\
 
 HEADERS  += \
     timeentryview.h \
+    timeentrylistchangeview.h \
     autocompleteview.h \
     genericview.h \
     settingsview.h \
@@ -16,6 +16,7 @@
 #include "./bugsnag.h"
 #include "./genericview.h"
 #include "./mainwindowcontroller.h"
+#include "./timeentrylistchangeview.h"
 #include "./toggl.h"
 
 class TogglApplication : public QtSingleApplication {
@@ -44,6 +45,7 @@ int main(int argc, char *argv[]) try {
     qRegisterMetaType<int64_t>("int64_t");
     qRegisterMetaType<bool_t>("bool_t");
     qRegisterMetaType<QVector<TimeEntryView*> >("QVector<TimeEntryView*>");
+    qRegisterMetaType<QVector<TimeEntryListChangeView*> >("QVector<TimeEntryListChangeView*>");  // NOLINT
     qRegisterMetaType<QVector<AutocompleteView*> >("QVector<AutocompleteView*");
     qRegisterMetaType<QVector<GenericView*> >("QVector<GenericView*");
 
@@ -0,0 +1,28 @@
+// Copyright 2015 Toggl Desktop developers.
+
+#include "./timeentrylistchangeview.h"
+
+TimeEntryListChangeView::TimeEntryListChangeView(QObject *parent)
+    : QObject(parent)
+, ChangeType(0)
+, Position(0)
+, Item(0) {
+}
+
+QVector<TimeEntryListChangeView *> TimeEntryListChangeView::importAll(
+    TogglTimeEntryListChangeView *first) {
+    QVector<TimeEntryListChangeView *> result;
+    TogglTimeEntryListChangeView *it = first;
+    while (it) {
+        TimeEntryListChangeView *view = new TimeEntryListChangeView();
+        view->ChangeType = it->ChangeType;
+        view->Position = it->Position;
+        view->GUID = QString(it->GUID);
+        if (it->Item) {
+            view->Item = TimeEntryView::importOne(it->Item);
+        }
+        result.push_back(view);
+        it = static_cast<TogglTimeEntryListChangeView *>(it->Next);
+    }
+    return result;
+}
@@ -0,0 +1,31 @@
+// Copyright 2015 Toggl Desktop developers.
+
+#ifndef SRC_UI_LINUX_TOGGLDESKTOP_TIMEENTRYLISTCHANGEVIEW_H_
+#define SRC_UI_LINUX_TOGGLDESKTOP_TIMEENTRYLISTCHANGEVIEW_H_
+
+#include <QObject>
+#include <QVector>
+
+#include <stdint.h>
+
+#include "./toggl_api.h"
+#include "./timeentryview.h"
+
+class TimeEntryListChangeView : public QObject {
+    Q_OBJECT
+
+ public:
+    explicit TimeEntryListChangeView(QObject *parent = 0);
+
+    static QVector<TimeEntryListChangeView *> importAll(
+        TogglTimeEntryListChangeView *first);
+
+    // 0 - insert, 1 - update, 2 - delete
+    int64_t ChangeType;
+    int64_t Position;
+    QString GUID;
+    // Null on delete
+    TimeEntryView *Item;
+};
+
+#endif  // SRC_UI_LINUX_TOGGLDESKTOP_TIMEENTRYLISTCHANGEVIEW_H_
@@ -19,6 +19,9 @@ ui(new Ui::TimeEntryListWidget) {
     connect(TogglApi::instance, SIGNAL(displayTimeEntryList(bool,QVector<TimeEntryView*>)),  // NOLINT
             this, SLOT(displayTimeEntryList(bool,QVector<TimeEntryView*>)));  // NOLINT
 
+    connect(TogglApi::instance, SIGNAL(displayTimeEntryListChanges(QVector<TimeEntryListChangeView*>)),  // NOLINT
+            this, SLOT(displayTimeEntryListChanges(QVector<TimeEntryListChangeView*>)));  // NOLINT
+
     connect(TogglApi::instance, SIGNAL(displayTimeEntryEditor(bool,TimeEntryView*,QString)),  // NOLINT
             this, SLOT(displayTimeEntryEditor(bool,TimeEntryView*,QString)));  // NOLINT
 
@@ -85,6 +88,49 @@ void TimeEntryListWidget::displayTimeEntryList(
     setSizePolicy(QSizePolicy::Expanding, QSizePolicy::Expanding);
 }
 
+void TimeEntryListWidget::displayTimeEntryListChanges(
+    QVector<TimeEntryListChangeView *> list) {
+
+    render_m_.lock();
+
+    for (int i = 0; i < list.size(); i++) {
+        TimeEntryListChangeView *change = list.at(i);
+        int row = static_cast<int>(change->Position);
+
+        if (2 == change->ChangeType) {
+            ui->list->model()->removeRow(row);
+            continue;
+        }
+
+        QListWidgetItem *item = 0;
+        TimeEntryCellWidget *cell = 0;
+
+        if (0 == change->ChangeType) {
+            item = new QListWidgetItem();
+            cell = new TimeEntryCellWidget();
+
+            ui->list->insertItem(row, item);
+            ui->list->setItemWidget(item, cell);
+        } else {
+            item = ui->list->item(row);
+            if (!item) {
+                continue;
+            }
+            cell = static_cast<TimeEntryCellWidget *>(
+                ui->list->itemWidget(item));
+        }
+
+        item->setSizeHint(cell->getSizeHint(change->Item->IsHeader));
+
+        cell->display(change->Item);
+    }
+
+    ui->list->setVisible(ui->list->count() > 0);
+    ui->blankView->setVisible(ui->list->count() == 0);
+
+    render_m_.unlock();
+}
+
 void TimeEntryListWidget::displayTimeEntryEditor(
     const bool open,
     TimeEntryView *view,
@@ -9,6 +9,7 @@
 
 #include <stdint.h>
 
+#include "./timeentrylistchangeview.h"
 #include "./timeentryview.h"
 
 namespace Ui {
@@ -31,6 +32,9 @@ class TimeEntryListWidget : public QWidget {
         const bool open,
         QVector<TimeEntryView *> list);
 
+    void displayTimeEntryListChanges(
+        QVector<TimeEntryListChangeView *> list);
+
     void displayTimeEntryEditor(
         const bool open,
         TimeEntryView *view,
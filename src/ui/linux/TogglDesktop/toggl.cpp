@@ -16,6 +16,7 @@
 #include "./../../../toggl_api.h"
 
 #include "./timeentryview.h"
+#include "./timeentrylistchangeview.h"
 #include "./genericview.h"
 #include "./autocompleteview.h"
 #include "./settingsview.h"
@@ -74,6 +75,24 @@ void on_display_time_entry_list(
         TimeEntryView::importAll(first));
 }
 
+void on_display_time_entry_list_changes(
+    TogglTimeEntryListChangeView *first) {
+    TogglApi::instance->displayTimeEntryListChanges(
+        TimeEntryListChangeView::importAll(first));
+}
+
+void on_display_command_state(
+    const uint64_t command_id,
+    const char *name,
+    const int64_t state,
+    const char *errmsg) {
+    TogglApi::instance->displayCommandState(
+        command_id,
+        QString(name),
+        state,
+        QString(errmsg));
+}
+
 void on_display_time_entry_autocomplete(
     TogglAutocompleteView *first) {
     TogglApi::instance->displayTimeEntryAutocomplete(
@@ -205,6 +224,7 @@ TogglApi::TogglApi(
     toggl_on_login(ctx, on_display_login);
     toggl_on_reminder(ctx, on_display_reminder);
     toggl_on_time_entry_list(ctx, on_display_time_entry_list);
+    toggl_on_time_entry_list_changes(ctx, on_display_time_entry_list_changes);
     toggl_on_time_entry_autocomplete(ctx, on_display_time_entry_autocomplete);
     toggl_on_mini_timer_autocomplete(ctx, on_display_mini_timer_autocomplete);
     toggl_on_project_autocomplete(ctx, on_display_project_autocomplete);
@@ -215,6 +235,7 @@ TogglApi::TogglApi(
     toggl_on_settings(ctx, on_display_settings);
     toggl_on_timer_state(ctx, on_display_timer_state);
     toggl_on_idle_notification(ctx, on_display_idle_notification);
+    toggl_on_command_state(ctx, on_display_command_state);
 
     char *env = toggl_environment(ctx);
     if (env) {
@@ -456,6 +477,29 @@ bool TogglApi::continueLatestTimeEntry() {
     return toggl_continue_latest(ctx);
 }
 
+bool TogglApi::loadMoreTimeEntries() {
+    return toggl_load_more_time_entries(ctx);
+}
+
+void TogglApi::setAsyncCommands(const bool async) {
+    toggl_set_async_commands(ctx, async);
+}
+
+int64_t TogglApi::commandQueueDepth() {
+    return toggl_command_queue_depth(ctx);
+}
+
+QVector<AutocompleteView *> TogglApi::autocompleteQuery(
+    const uint64_t kind,
+    const QString text,
+    const uint64_t limit) {
+    TogglAutocompleteView *first = toggl_autocomplete_query(
+        ctx, kind, text.toStdString().c_str(), limit);
+    QVector<AutocompleteView *> result = AutocompleteView::importAll(first);
+    toggl_autocomplete_view_clear(first);
+    return result;
+}
+
 void TogglApi::sync() {
     toggl_sync(ctx);
 }
@@ -14,6 +14,7 @@
 class AutocompleteView;
 class GenericView;
 class SettingsView;
+class TimeEntryListChangeView;
 class TimeEntryView;
 
 class TogglApi : public QObject {
@@ -65,6 +66,18 @@ class TogglApi : public QObject {
 
     bool continueLatestTimeEntry();
 
+    bool loadMoreTimeEntries();
+
+    // Kind: 0 - time entry, 1 - mini timer, 2 - project
+    void setAsyncCommands(const bool async);
+
+    int64_t commandQueueDepth();
+
+    QVector<AutocompleteView *> autocompleteQuery(
+        const uint64_t kind,
+        const QString text,
+        const uint64_t limit);
+
     void openInBrowser();
 
     void sync();
@@ -198,6 +211,9 @@ class TogglApi : public QObject {
         const bool open,
         QVector<TimeEntryView *> list);
 
+    void displayTimeEntryListChanges(
+        QVector<TimeEntryListChangeView *> list);
+
     void displayTimeEntryEditor(
         const bool open,
         TimeEntryView *view,
@@ -237,6 +253,14 @@ class TogglApi : public QObject {
     void displayWorkspaceSelect(
         QVector<GenericView *> list);
 
+    // State is 0 when queued, 1 when done, 2 when failed
+    // and 3 when refused
+    void displayCommandState(
+        const uint64_t command_id,
+        const QString name,
+        const int64_t state,
+        const QString errmsg);
+
  private:
     void *ctx;
 
@@ -268,6 +292,13 @@ void on_display_reminder(
 void on_display_time_entry_list(
     const bool_t open,
     TogglTimeEntryView *first);
+void on_display_time_entry_list_changes(
+    TogglTimeEntryListChangeView *first);
+void on_display_command_state(
+    const uint64_t command_id,
+    const char *name,
+    const int64_t state,
+    const char *errmsg);
 void on_display_time_entry_autocomplete(
     TogglAutocompleteView *first);
 void on_display_mini_timer_autocomplete(
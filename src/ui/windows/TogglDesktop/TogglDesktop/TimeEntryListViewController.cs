@@ -21,6 +21,7 @@ public partial class TimeEntryListViewController : UserControl
         Dock = DockStyle.Fill;
 
         Toggl.OnTimeEntryList += OnTimeEntryList;
+        Toggl.OnTimeEntryListChanges += OnTimeEntryListChanges;
         Toggl.OnLogin += OnLogin;
 
         timerEditViewController.DescriptionTextBox.MouseWheel += TimeEntryListViewController_MouseWheel;
@@ -103,6 +104,58 @@ public partial class TimeEntryListViewController : UserControl
 
     }
 
+    void OnTimeEntryListChanges(List<Toggl.TimeEntryListChange> list)
+    {
+        if (InvokeRequired)
+        {
+            Invoke((MethodInvoker)delegate {
+                OnTimeEntryListChanges(list);
+            });
+            return;
+        }
+
+        lock (rendering)
+        {
+            applyTimeEntryListChanges(list);
+        }
+    }
+
+    private void applyTimeEntryListChanges(
+        List<Toggl.TimeEntryListChange> list)
+    {
+        foreach (Toggl.TimeEntryListChange change in list)
+        {
+            int position = (int)change.Position;
+
+            if (change.ChangeType == Toggl.TimeEntryListDelete)
+            {
+                entries.Children.RemoveAt(position);
+                this.cellsByGUID.Remove(change.GUID);
+                continue;
+            }
+
+            WPF.TimeEntryCell cell = null;
+            if (change.ChangeType == Toggl.TimeEntryListInsert)
+            {
+                cell = new WPF.TimeEntryCell();
+                entries.Children.Insert(position, cell);
+            }
+            else
+            {
+                cell = (TogglDesktop.WPF.TimeEntryCell)entries.Children[position];
+            }
+            cell.Display(change.Item);
+            this.cellsByGUID[change.GUID] = cell;
+        }
+
+        emptyLabel.Visible = (entries.Children.Count == 0);
+
+        entries.Dispatcher.Invoke(() => { }, DispatcherPriority.Render);
+        entriesHost.Invalidate();
+
+        entries.RefreshHighLight();
+    }
+
     void OnLogin(bool open, UInt64 user_id)
     {
         if (InvokeRequired)
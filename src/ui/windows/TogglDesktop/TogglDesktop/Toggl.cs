@@ -83,6 +83,32 @@ public static class Toggl
         public IntPtr Next;
     }
 
+    public const Int64 TimeEntryListInsert = 0;
+    public const Int64 TimeEntryListUpdate = 1;
+    public const Int64 TimeEntryListDelete = 2;
+
+    [StructLayout(LayoutKind.Sequential, CharSet = CharSet.Unicode)]
+    private struct TogglTimeEntryListChange
+    {
+        public Int64 ChangeType;
+        public Int64 Position;
+        [MarshalAs(UnmanagedType.LPWStr)]
+        public string GUID;
+        public IntPtr Item;
+        public IntPtr Next;
+    }
+
+    public struct TimeEntryListChange
+    {
+        // TimeEntryListInsert, TimeEntryListUpdate or TimeEntryListDelete
+        public Int64 ChangeType;
+        // Position in the displayed list, newest time entry first
+        public Int64 Position;
+        public string GUID;
+        // Not set on delete
+        public TimeEntry Item;
+    }
+
     [StructLayout(LayoutKind.Sequential, CharSet = CharSet.Unicode)]
     public struct AutocompleteItem
     {
@@ -272,6 +298,29 @@ public static class Toggl
         bool open,
         List<TimeEntry> list);
 
+    [UnmanagedFunctionPointer(convention)]
+    private delegate void TogglDisplayTimeEntryListChanges(
+        IntPtr first);
+
+    public delegate void DisplayTimeEntryListChanges(
+        List<TimeEntryListChange> list);
+
+    [UnmanagedFunctionPointer(convention)]
+    private delegate void TogglDisplayCommandState(
+        UInt64 command_id,
+        [MarshalAs(UnmanagedType.LPWStr)]
+        string name,
+        Int64 state,
+        [MarshalAs(UnmanagedType.LPWStr)]
+        string errmsg);
+
+    // State is one of the CommandState* constants
+    public delegate void DisplayCommandState(
+        UInt64 command_id,
+        string name,
+        Int64 state,
+        string errmsg);
+
     [UnmanagedFunctionPointer(convention)]
     private delegate void TogglDisplayAutocomplete(
         IntPtr first);
@@ -449,6 +498,16 @@ public static class Toggl
         IntPtr context,
         TogglDisplayTimeEntryList cb);
 
+    [DllImport(dll, CharSet = charset, CallingConvention = convention)]
+    private static extern void toggl_on_time_entry_list_changes(
+        IntPtr context,
+        TogglDisplayTimeEntryListChanges cb);
+
+    [DllImport(dll, CharSet = charset, CallingConvention = convention)]
+    private static extern void toggl_on_command_state(
+        IntPtr context,
+        TogglDisplayCommandState cb);
+
     [DllImport(dll, CharSet = charset, CallingConvention = convention)]
     private static extern void toggl_on_time_entry_autocomplete(
         IntPtr context,
@@ -648,6 +707,16 @@ public static class Toggl
         return toggl_continue_latest(ctx);
     }
 
+    [DllImport(dll, CharSet = charset, CallingConvention = convention)]
+    [return: MarshalAs(UnmanagedType.I1)]
+    private static extern bool toggl_load_more_time_entries(
+        IntPtr context);
+
+    public static bool LoadMoreTimeEntries()
+    {
+        return toggl_load_more_time_entries(ctx);
+    }
+
     [DllImport(dll, CharSet = charset, CallingConvention = convention)]
     [return: MarshalAs(UnmanagedType.I1)]
     private static extern bool toggl_delete_time_entry(
@@ -1087,6 +1156,58 @@ public static class Toggl
         return toggl_get_user_email(ctx);
     }
 
+    public const Int64 CommandStateQueued = 0;
+    public const Int64 CommandStateDone = 1;
+    public const Int64 CommandStateFailed = 2;
+    public const Int64 CommandStateRefused = 3;
+
+    [DllImport(dll, CharSet = charset, CallingConvention = convention)]
+    private static extern void toggl_set_async_commands(
+        IntPtr context,
+        [MarshalAs(UnmanagedType.I1)]
+        bool async);
+
+    public static void SetAsyncCommands(bool async)
+    {
+        toggl_set_async_commands(ctx, async);
+    }
+
+    [DllImport(dll, CharSet = charset, CallingConvention = convention)]
+    private static extern Int64 toggl_command_queue_depth(
+        IntPtr context);
+
+    public static Int64 CommandQueueDepth()
+    {
+        return toggl_command_queue_depth(ctx);
+    }
+
+    public const UInt64 AutocompleteTimeEntry = 0;
+    public const UInt64 AutocompleteMinitimer = 1;
+    public const UInt64 AutocompleteProject = 2;
+
+    [DllImport(dll, CharSet = charset, CallingConvention = convention)]
+    private static extern IntPtr toggl_autocomplete_query(
+        IntPtr context,
+        UInt64 kind,
+        [MarshalAs(UnmanagedType.LPWStr)]
+        string text,
+        UInt64 limit);
+
+    [DllImport(dll, CharSet = charset, CallingConvention = convention)]
+    private static extern void toggl_autocomplete_view_clear(
+        IntPtr first);
+
+    public static List<AutocompleteItem> AutocompleteQuery(
+        UInt64 kind,
+        string text,
+        UInt64 limit)
+    {
+        IntPtr first = toggl_autocomplete_query(ctx, kind, text, limit);
+        List<AutocompleteItem> list = ConvertToAutocompleteList(first);
+        toggl_autocomplete_view_clear(first);
+        return list;
+    }
+
     [DllImport(dll, CharSet = charset, CallingConvention = convention)]
     private static extern void toggl_sync(
         IntPtr context);
@@ -1181,6 +1302,8 @@ public static class Toggl
     public static event DisplayLogin OnLogin = delegate { };
     public static event DisplayReminder OnReminder = delegate { };
     public static event DisplayTimeEntryList OnTimeEntryList = delegate { };
+    public static event DisplayTimeEntryListChanges OnTimeEntryListChanges = delegate { };
+    public static event DisplayCommandState OnCommandState = delegate { };
     public static event DisplayAutocomplete OnTimeEntryAutocomplete = delegate { };
     public static event DisplayAutocomplete OnMinitimerAutocomplete = delegate { };
     public static event DisplayAutocomplete OnProjectAutocomplete = delegate { };
@@ -1254,6 +1377,20 @@ public static class Toggl
             OnTimeEntryList(open, ConvertToTimeEntryList(first));
         });
 
+        toggl_on_time_entry_list_changes(ctx, delegate(IntPtr first)
+        {
+            OnTimeEntryListChanges(ConvertToTimeEntryListChanges(first));
+        });
+
+        toggl_on_command_state(ctx, delegate(
+            UInt64 command_id,
+            string name,
+            Int64 state,
+            string errmsg)
+        {
+            OnCommandState(command_id, name, state, errmsg);
+        });
+
         toggl_on_time_entry_autocomplete(ctx, delegate(IntPtr first)
         {
             OnTimeEntryAutocomplete(ConvertToAutocompleteList(first));
@@ -1502,6 +1639,30 @@ public static class Toggl
         return list;
     }
 
+    private static List<TimeEntryListChange> ConvertToTimeEntryListChanges(
+        IntPtr first)
+    {
+        List<TimeEntryListChange> list = new List<TimeEntryListChange>();
+        IntPtr it = first;
+        while (it != IntPtr.Zero)
+        {
+            TogglTimeEntryListChange n = (TogglTimeEntryListChange)
+                                         Marshal.PtrToStructure(it, typeof(TogglTimeEntryListChange));
+            TimeEntryListChange change = new TimeEntryListChange();
+            change.ChangeType = n.ChangeType;
+            change.Position = n.Position;
+            change.GUID = n.GUID;
+            if (n.Item != IntPtr.Zero)
+            {
+                change.Item = (TimeEntry)Marshal.PtrToStructure(
+                    n.Item, typeof(TimeEntry));
+            }
+            list.Add(change);
+            it = n.Next;
+        }
+        return list;
+    }
+
     private static List<TimeEntry> ConvertToTimeEntryList(IntPtr first)
     {
         List<TimeEntry> list = new List<TimeEntry>();
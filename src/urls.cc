@@ -8,7 +8,12 @@ namespace urls {
 
 bool use_staging_as_backend = false;
 
+std::string api("");
+
 std::string API() {
+    if (!api.empty()) {
+        return api;
+    }
     if (use_staging_as_backend) {
         return "https://next.toggl.com";
     }
@@ -33,6 +38,10 @@ void SetUseStagingAsBackend(const bool value) {
     use_staging_as_backend = value;
 }
 
+void SetAPI(const std::string value) {
+    api = value;
+}
+
 }  // namespace urls
 
 }  // namespace toggl
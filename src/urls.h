@@ -17,6 +17,10 @@ std::string WebSocket();
 
 void SetUseStagingAsBackend(const bool value);
 
+// Send API requests to another backend, such as a local
+// test server. Empty value restores the default.
+void SetAPI(const std::string value);
+
 }  // namespace urls
 
 }  // namespace toggl
@@ -4,12 +4,15 @@
 
 #include <time.h>
 
+#include <set>
 #include <sstream>
 
 #include "./client.h"
 #include "./const.h"
 #include "./formatter.h"
 #include "./https_client.h"
+#include "./json_stream_reader.h"
+#include "./json_writer.h"
 #include "./project.h"
 #include "./tag.h"
 #include "./task.h"
@@ -28,7 +31,9 @@
 #include "Poco/Random.h"
 #include "Poco/RandomStream.h"
 #include "Poco/SHA1Engine.h"
+#include "Poco/Runnable.h"
 #include "Poco/Stopwatch.h"
+#include "Poco/Thread.h"
 #include "Poco/UTF8String.h"
 
 namespace toggl {
@@ -53,7 +58,7 @@ Project *User::CreateProject(
     p->SetActive(true);
     p->SetPrivate(is_private);
 
-    related.Projects.push_back(p);
+    related.Add(p);
 
     return p;
 }
@@ -64,7 +69,7 @@ Client *User::CreateClient(
     Client *c = new Client();
     c->SetWID(workspace_id);
     c->SetName(client_name);
-    related.Clients.push_back(c);
+    related.Add(c);
     return c;
 }
 
@@ -75,7 +80,8 @@ TimeEntry *User::Start(
     const std::string duration,
     const Poco::UInt64 task_id,
     const Poco::UInt64 project_id,
-    const std::string project_guid) {
+    const std::string project_guid,
+    const std::string guid) {
     Stop();
 
     time_t now = time(0);
@@ -84,6 +90,9 @@ TimeEntry *User::Start(
     ss << "User::Start now=" << now;
 
     TimeEntry *te = new TimeEntry();
+    if (!guid.empty()) {
+        te->SetGUID(guid);
+    }
     te->SetCreatedWith(HTTPSClient::Config.UserAgent());
     te->SetDescription(description);
     te->SetUID(ID());
@@ -127,7 +136,7 @@ TimeEntry *User::Start(
     te->SetDurOnly(!StoreStartAndStopTime());
     te->SetUIModified();
 
-    related.TimeEntries.push_back(te);
+    related.Add(te);
 
     return te;
 }
@@ -190,7 +199,7 @@ toggl::error User::Continue(
     result->SetDurationInSeconds(-time(0));
     result->SetCreatedWith(HTTPSClient::Config.UserAgent());
 
-    related.TimeEntries.push_back(result);
+    related.Add(result);
 
     return toggl::noError;
 }
@@ -351,7 +360,7 @@ TimeEntry *User::DiscardTimeAt(
         split->SetStart(at);
         split->SetDurationInSeconds(-at);
         split->SetUIModified();
-        related.TimeEntries.push_back(split);
+        related.Add(split);
         return split;
     }
 
@@ -372,13 +381,13 @@ TimeEntry *User::RunningTimeEntry() const {
 
 template<typename T>
 void User::CollectPushableModels(
-    const std::vector<T *> list,
+    const ModelList<T> &list,
     std::vector<T *> *result,
     std::map<std::string, BaseModel *> *models) const {
 
     poco_check_ptr(result);
 
-    for (typename std::vector<T *>::const_iterator it =
+    for (typename ModelList<T>::const_iterator it =
         list.begin();
             it != list.end();
             it++) {
@@ -395,8 +404,59 @@ void User::CollectPushableModels(
     }
 }
 
+// Loads the /me response into the user while it is received
+class UserDataReader : public HTTPSResponseReader {
+ public:
+    UserDataReader(
+        User *user,
+        const bool including_related_data)
+        : user_(user)
+    , including_related_data_(including_related_data) {}
+
+    error ReadResponse(std::istream *body) {
+        return user_->LoadUserAndRelatedDataFromJSONStream(
+            body, including_related_data_);
+    }
+
+ private:
+    User *user_;
+    bool including_related_data_;
+};
+
 error User::PullAllUserData(
     TogglClient *toggl_client) {
+    return pullUserData(toggl_client, 0);
+}
+
+error User::PullChanges(
+    TogglClient *toggl_client) {
+
+    Poco::UInt64 since = Since();
+    if (!since) {
+        return PullAllUserData(toggl_client);
+    }
+
+    error err = pullUserData(toggl_client, since);
+    if (err != noError) {
+        return err;
+    }
+
+    // Server data is older than ours, so changes we have not
+    // seen may be missing, deletions included
+    if (Since() < since) {
+        std::stringstream ss;
+        ss << "Server returned data as of " << Since()
+           << ", older than " << since << ", pulling all user data";
+        logger().warning(ss.str());
+        return PullAllUserData(toggl_client);
+    }
+
+    return noError;
+}
+
+error User::pullUserData(
+    TogglClient *toggl_client,
+    const Poco::UInt64 since) {
 
     if (APIToken().empty()) {
         return error("cannot pull user data without API token");
@@ -406,22 +466,23 @@ error User::PullAllUserData(
         Poco::Stopwatch stopwatch;
         stopwatch.start();
 
-        std::string user_data_json("");
+        // Only all data tells which models were deleted on server,
+        // changes carry their own tombstones
+        UserDataReader reader(this, !since);
         error err = Me(
             toggl_client,
             APIToken(),
             "api_token",
-            &user_data_json,
-            Since());
+            &reader,
+            since);
         if (err != noError) {
             return err;
         }
 
-        LoadUserAndRelatedDataFromJSONString(user_data_json, !Since());
-
         stopwatch.stop();
         std::stringstream ss;
-        ss << "User with related data JSON fetched and parsed in "
+        ss << "User with related data JSON since " << since
+           << " fetched and parsed in "
            << stopwatch.elapsed() / 1000 << " ms";
         logger().debug(ss.str());
     } catch(const Poco::Exception& exc) {
@@ -434,9 +495,59 @@ error User::PullAllUserData(
     return noError;
 }
 
+// Posts one batch on a thread of its own, so that
+// the next batch can be serialized while this one is in flight
+class BatchUpdatePost : public Poco::Runnable {
+ public:
+    BatchUpdatePost(
+        TogglClient *toggl_client,
+        const std::string api_token,
+        const std::string &json)
+        : toggl_client_(toggl_client)
+    , api_token_(api_token)
+    , json_(json)
+    , response_body_("")
+    , err_(noError) {
+        poco_check_ptr(toggl_client_);
+    }
+
+    void run() {
+        try {
+            err_ = toggl_client_->Post(urls::API(),
+                                       "/api/v8/batch_updates",
+                                       json_,
+                                       api_token_,
+                                       "api_token",
+                                       &response_body_);
+        } catch(const Poco::Exception& exc) {
+            err_ = exc.displayText();
+        } catch(const std::exception& ex) {
+            err_ = ex.what();
+        } catch(const std::string& ex) {
+            err_ = ex;
+        }
+    }
+
+    const std::string &ResponseBody() const {
+        return response_body_;
+    }
+
+    const error &Error() const {
+        return err_;
+    }
+
+ private:
+    TogglClient *toggl_client_;
+    std::string api_token_;
+    const std::string &json_;
+    std::string response_body_;
+    error err_;
+};
+
 error User::PushChanges(
     TogglClient *toggl_client,
-    bool *had_something_to_push) {
+    bool *had_something_to_push,
+    BatchUpdateMonitor *monitor) {
 
     if (APIToken().empty()) {
         return error("cannot push changes without API token");
@@ -455,43 +566,101 @@ error User::PushChanges(
         std::vector<Project *> projects;
         std::vector<Client *> clients;
 
-        CollectPushableModels(related.TimeEntries, &time_entries, &models);
-        CollectPushableModels(related.Projects, &projects, &models);
-        CollectPushableModels(related.Clients, &clients, &models);
+        std::vector<BaseModel *> pushable;
+        size_t next(0);
+        std::string json("");
+        std::string next_json("");
+        error err = noError;
+        {
+            ModelLock::ScopedWrite lock(model_lock_);
+
+            CollectPushableModels(related.TimeEntries, &time_entries, &models);
+            CollectPushableModels(related.Projects, &projects, &models);
+            CollectPushableModels(related.Clients, &clients, &models);
+
+            if (time_entries.empty() && projects.empty() && clients.empty()) {
+                *had_something_to_push = false;
+                return noError;
+            }
 
-        if (time_entries.empty() && projects.empty() && clients.empty()) {
-            *had_something_to_push = false;
-            return noError;
+            // Clients first, because projects depend on clients, then
+            // projects, because time entries depend on projects. Batches
+            // are cut in this order, so nothing goes out before the
+            // models it depends on.
+            pushable.insert(pushable.end(), clients.begin(), clients.end());
+            pushable.insert(pushable.end(), projects.begin(), projects.end());
+            pushable.insert(pushable.end(),
+                            time_entries.begin(), time_entries.end());
+
+            resolvePushReferences(pushable, next);
+            err = updateJSON(pushable, &next, &json);
+            if (err != noError) {
+                return err;
+            }
         }
 
-        std::string json("");
-        error err = updateJSON(&clients, &projects, &time_entries, &json);
-        if (err != noError) {
-            return err;
-        }
+        std::vector<error> errors;
+        Poco::UInt64 batches(0);
+
+        while (!json.empty()) {
+            logger().debug(json);
+
+            BatchUpdatePost post(toggl_client, APIToken(), json);
+            Poco::Thread thread;
+            thread.start(post);
+
+            // Serialize the next batch meanwhile, unless it
+            // depends on models pushed in this one
+            bool serialized(false);
+            if (next < pushable.size()) {
+                ModelLock::ScopedWrite lock(model_lock_);
+                if (resolvePushReferences(pushable, next)) {
+                    err = updateJSON(pushable, &next, &next_json);
+                    serialized = true;
+                }
+            }
 
-        logger().debug(json);
+            thread.join();
 
-        std::string response_body("");
-        err = toggl_client->Post(urls::API(),
-                                 "/api/v8/batch_updates",
-                                 json,
-                                 APIToken(),
-                                 "api_token",
-                                 &response_body);
-        if (err != noError) {
-            return err;
-        }
+            if (post.Error() != noError) {
+                return post.Error();
+            }
+            if (err != noError) {
+                return err;
+            }
 
-        std::vector<BatchUpdateResult> results;
-        err = BatchUpdateResult::ParseResponseArray(response_body, &results);
-        if (err != noError) {
-            return err;
-        }
+            std::vector<BatchUpdateResult> results;
+            err = BatchUpdateResult::ParseResponseArray(
+                post.ResponseBody(), &results);
+            if (err != noError) {
+                return err;
+            }
 
-        std::vector<error> errors;
+            {
+                ModelLock::ScopedWrite lock(model_lock_);
+                BatchUpdateResult::ProcessResponseArray(
+                    &results, &models, &errors);
+
+                if (!serialized) {
+                    resolvePushReferences(pushable, next);
+                    err = updateJSON(pushable, &next, &next_json);
+                    if (err != noError) {
+                        return err;
+                    }
+                }
+            }
+
+            batches++;
 
-        BatchUpdateResult::ProcessResponseArray(&results, &models, &errors);
+            if (monitor) {
+                err = monitor->BatchUpdateApplied();
+                if (err != noError) {
+                    return err;
+                }
+            }
+
+            json.swap(next_json);
+        }
 
         if (!errors.empty()) {
             return Formatter::CollectErrors(&errors);
@@ -499,7 +668,8 @@ error User::PushChanges(
 
         stopwatch.stop();
         std::stringstream ss;
-        ss << "Changes data JSON pushed and responses parsed in "
+        ss << "Changes data JSON pushed in " << batches
+           << " batches and responses parsed in "
            << stopwatch.elapsed() / 1000 << " ms";
         logger().debug(ss.str());
     } catch(const Poco::Exception& exc) {
@@ -542,14 +712,8 @@ error User::Me(
         poco_check_ptr(user_data_json);
         poco_check_ptr(toggl_client);
 
-        std::stringstream relative_url;
-        relative_url << "/api/v8/me"
-                     << "?app_name=" << TogglClient::Config.AppName
-                     << "&with_related_data=true"
-                     << "&since=" << since;
-
         return toggl_client->Get(urls::API(),
-                                 relative_url.str(),
+                                 meRelativeURL(since),
                                  email,
                                  password,
                                  user_data_json);
@@ -562,6 +726,48 @@ error User::Me(
     }
 }
 
+error User::Me(
+    TogglClient *toggl_client,
+    const std::string email,
+    const std::string password,
+    HTTPSResponseReader *user_data_reader,
+    const Poco::UInt64 since) {
+
+    if (email.empty()) {
+        return "Empty email or API token";
+    }
+
+    if (password.empty()) {
+        return "Empty password";
+    }
+
+    try {
+        poco_check_ptr(user_data_reader);
+        poco_check_ptr(toggl_client);
+
+        return toggl_client->Get(urls::API(),
+                                 meRelativeURL(since),
+                                 email,
+                                 password,
+                                 user_data_reader);
+    } catch(const Poco::Exception& exc) {
+        return exc.displayText();
+    } catch(const std::exception& ex) {
+        return ex.what();
+    } catch(const std::string& ex) {
+        return ex;
+    }
+}
+
+std::string User::meRelativeURL(const Poco::UInt64 since) {
+    std::stringstream relative_url;
+    relative_url << "/api/v8/me"
+                 << "?app_name=" << TogglClient::Config.AppName
+                 << "&with_related_data=true"
+                 << "&since=" << since;
+    return relative_url.str();
+}
+
 error User::Signup(
     TogglClient *toggl_client,
     const std::string email,
@@ -589,7 +795,7 @@ error User::Signup(
 
         return toggl_client->Post(urls::API(),
                                   "/api/v8/signups",
-                                  Json::StyledWriter().write(root),
+                                  Json::FastWriter().write(root),
                                   "",
                                   "",
                                   user_data_json);
@@ -611,7 +817,8 @@ void User::DeleteRelatedModelsWithWorkspace(const Poco::UInt64 wid) {
 }
 
 void User::RemoveClientFromRelatedModels(const Poco::UInt64 cid) {
-    for (std::vector<Project *>::iterator it = related.Projects.begin();
+    for (std::vector<Project *>::const_iterator it =
+        related.Projects.begin();
             it != related.Projects.end(); it++) {
         Project *model = *it;
         if (model->CID() == cid) {
@@ -626,7 +833,8 @@ void User::RemoveProjectFromRelatedModels(const Poco::UInt64 pid) {
 }
 
 void User::RemoveTaskFromRelatedModels(const Poco::UInt64 tid) {
-    for (std::vector<TimeEntry *>::iterator it = related.TimeEntries.begin();
+    for (std::vector<TimeEntry *>::const_iterator it =
+        related.TimeEntries.begin();
             it != related.TimeEntries.end(); it++) {
         TimeEntry *model = *it;
         if (model->TID() == tid) {
@@ -636,7 +844,7 @@ void User::RemoveTaskFromRelatedModels(const Poco::UInt64 tid) {
 }
 
 void User::loadUserTagFromJSON(
-    Json::Value data,
+    const Json::Value &data,
     std::set<Poco::UInt64> *alive) {
 
     // alive can be 0, dont assert/check it
@@ -662,7 +870,7 @@ void User::loadUserTagFromJSON(
 
     if (!model) {
         model = new Tag();
-        related.Tags.push_back(model);
+        related.Add(model);
     }
     if (alive) {
         alive->insert(id);
@@ -672,7 +880,7 @@ void User::loadUserTagFromJSON(
 }
 
 void User::loadUserTaskFromJSON(
-    Json::Value data,
+    const Json::Value &data,
     std::set<Poco::UInt64> *alive) {
 
     // alive can be 0, dont assert/check it
@@ -696,7 +904,7 @@ void User::loadUserTaskFromJSON(
 
     if (!model) {
         model = new Task();
-        related.Tasks.push_back(model);
+        related.Add(model);
     }
 
     if (alive) {
@@ -725,9 +933,9 @@ error User::LoadUserUpdateFromJSONString(
 }
 
 void User::loadUserUpdateFromJSON(
-    Json::Value node) {
+    const Json::Value &node) {
 
-    Json::Value data = node["data"];
+    const Json::Value &data = node["data"];
     std::string model = node["model"].asString();
     std::string action = node["action"].asString();
 
@@ -757,7 +965,7 @@ void User::loadUserUpdateFromJSON(
 }
 
 void User::loadUserWorkspaceFromJSON(
-    Json::Value data,
+    const Json::Value &data,
     std::set<Poco::UInt64> *alive) {
 
     // alive can be 0, dont assert/check it
@@ -780,7 +988,7 @@ void User::loadUserWorkspaceFromJSON(
 
     if (!model) {
         model = new Workspace();
-        related.Workspaces.push_back(model);
+        related.Add(model);
     }
     if (alive) {
         alive->insert(id);
@@ -793,32 +1001,135 @@ error User::LoadUserAndRelatedDataFromJSONString(
     const std::string &json,
     const bool &including_related_data) {
 
-    if (json.empty()) {
-        Poco::Logger &logger = Poco::Logger::get("json");
+    std::istringstream in(json);
+    return LoadUserAndRelatedDataFromJSONStream(&in, including_related_data);
+}
+
+error User::LoadUserAndRelatedDataFromJSONStream(
+    std::istream *in,
+    const bool &including_related_data) {
+
+    poco_check_ptr(in);
+
+    Poco::Logger &logger = Poco::Logger::get("json");
+
+    if (std::char_traits<char>::eof() == in->peek()) {
         logger.warning("cannot load empty JSON");
         return noError;
     }
 
-    Json::Value root;
-    Json::Reader reader;
-    if (!reader.parse(json, root)) {
-        return error("Failed to LoadUserAndRelatedDataFromJSONString");
-    }
+    try {
+        JSONStreamReader reader(in);
+
+        // Since is applied only after the whole document is read,
+        // so data lost to a broken response is pulled again.
+        Json::Value since;
+
+        reader.BeginObject();
+        std::string key("");
+        while (reader.NextMember(&key)) {
+            if ("since" == key) {
+                reader.ReadValue(&since);
+            } else if ("data" == key && reader.AtObject()) {
+                loadUserAndRelatedDataFromJSONStream(
+                    &reader, including_related_data);
+            } else {
+                reader.SkipValue();
+            }
+        }
+        reader.End();
 
-    SetSince(root["since"].asUInt64());
+        ModelLock::ScopedWrite lock(model_lock_);
+        SetSince(since.asUInt64());
+    } catch(const Poco::Exception& exc) {
+        return error("Failed to LoadUserAndRelatedDataFromJSON: "
+                     + exc.displayText());
+    } catch(const std::exception& ex) {
+        return ex.what();
+    } catch(const std::string& ex) {
+        return ex;
+    }
 
-    Poco::Logger &logger = Poco::Logger::get("json");
     std::stringstream s;
     s << "User data as of: " << Since();
     logger.debug(s.str());
 
-    loadUserAndRelatedDataFromJSON(root["data"], including_related_data);
-
     return noError;
 }
 
+typedef void (User::*loadRelatedModelFromJSON)(
+    const Json::Value &data,
+    std::set<Poco::UInt64> *alive);
+
+// Reads user data, loading related models one by one as they are read.
+// User fields are applied after the related models, as they can come
+// in any order. Related models get their UID when they are saved.
+void User::loadUserAndRelatedDataFromJSONStream(
+    JSONStreamReader *reader,
+    const bool &including_related_data) {
+
+    poco_check_ptr(reader);
+
+    std::map<std::string, loadRelatedModelFromJSON> loaders;
+    loaders["projects"] = &User::loadUserProjectFromJSON;
+    loaders["tags"] = &User::loadUserTagFromJSON;
+    loaders["tasks"] = &User::loadUserTaskFromJSON;
+    loaders["time_entries"] = &User::loadUserTimeEntryFromJSON;
+    loaders["workspaces"] = &User::loadUserWorkspaceFromJSON;
+    loaders["clients"] = &User::loadUserClientFromJSON;
+
+    // IDs of related models present in the data, by list name
+    std::map<std::string, std::set<Poco::UInt64> > alive;
+
+    Json::Value data(Json::objectValue);
+
+    reader->BeginObject();
+    std::string key("");
+    while (reader->NextMember(&key)) {
+        std::map<std::string, loadRelatedModelFromJSON>::const_iterator
+        loader = loaders.find(key);
+        if (loader == loaders.end() || !reader->AtArray()) {
+            reader->ReadValue(&data[key]);
+            if ("id" == key) {
+                ModelLock::ScopedWrite lock(model_lock_);
+                SetID(data[key].asUInt64());
+            }
+            continue;
+        }
+
+        // Without all data, alive models are not known
+        std::set<Poco::UInt64> *ids = nullptr;
+        if (including_related_data) {
+            ids = &alive[key];
+        }
+        Json::Value item;
+        reader->BeginArray();
+        while (reader->NextElement()) {
+            reader->ReadValue(&item);
+
+            // Views may render between items, while
+            // the next one is read from the network
+            ModelLock::ScopedWrite lock(model_lock_);
+            (this->*loader->second)(item, ids);
+        }
+    }
+
+    ModelLock::ScopedWrite lock(model_lock_);
+
+    loadUserAndRelatedDataFromJSON(data, false);
+
+    if (including_related_data) {
+        deleteZombies(related.Projects, alive["projects"]);
+        deleteZombies(related.Tags, alive["tags"]);
+        deleteZombies(related.Tasks, alive["tasks"]);
+        deleteZombies(related.TimeEntries, alive["time_entries"]);
+        deleteZombies(related.Workspaces, alive["workspaces"]);
+        deleteZombies(related.Clients, alive["clients"]);
+    }
+}
+
 void User::loadUserAndRelatedDataFromJSON(
-    Json::Value data,
+    const Json::Value &data,
     const bool &including_related_data) {
 
     if (!data["id"].asUInt64()) {
@@ -840,7 +1151,7 @@ void User::loadUserAndRelatedDataFromJSON(
         std::set<Poco::UInt64> alive;
 
         if (data.isMember("projects")) {
-            Json::Value list = data["projects"];
+            const Json::Value &list = data["projects"];
 
             for (unsigned int i = 0; i < list.size(); i++) {
                 loadUserProjectFromJSON(list[i], &alive);
@@ -856,7 +1167,7 @@ void User::loadUserAndRelatedDataFromJSON(
         std::set<Poco::UInt64> alive;
 
         if (data.isMember("tags")) {
-            Json::Value list = data["tags"];
+            const Json::Value &list = data["tags"];
 
             for (unsigned int i = 0; i < list.size(); i++) {
                 loadUserTagFromJSON(list[i], &alive);
@@ -872,7 +1183,7 @@ void User::loadUserAndRelatedDataFromJSON(
         std::set<Poco::UInt64> alive;
 
         if (data.isMember("tasks")) {
-            Json::Value list = data["tasks"];
+            const Json::Value &list = data["tasks"];
 
             for (unsigned int i = 0; i < list.size(); i++) {
                 loadUserTaskFromJSON(list[i], &alive);
@@ -888,7 +1199,7 @@ void User::loadUserAndRelatedDataFromJSON(
         std::set<Poco::UInt64> alive;
 
         if (data.isMember("time_entries")) {
-            Json::Value list = data["time_entries"];
+            const Json::Value &list = data["time_entries"];
 
             for (unsigned int i = 0; i < list.size(); i++) {
                 loadUserTimeEntryFromJSON(list[i], &alive);
@@ -904,7 +1215,7 @@ void User::loadUserAndRelatedDataFromJSON(
         std::set<Poco::UInt64> alive;
 
         if (data.isMember("workspaces")) {
-            Json::Value list = data["workspaces"];
+            const Json::Value &list = data["workspaces"];
 
             for (unsigned int i = 0; i < list.size(); i++) {
                 loadUserWorkspaceFromJSON(list[i], &alive);
@@ -920,7 +1231,7 @@ void User::loadUserAndRelatedDataFromJSON(
         std::set<Poco::UInt64> alive;
 
         if (data.isMember("clients")) {
-            Json::Value list = data["clients"];
+            const Json::Value &list = data["clients"];
 
             for (unsigned int i = 0; i < list.size(); i++) {
                 loadUserClientFromJSON(list[i], &alive);
@@ -934,7 +1245,7 @@ void User::loadUserAndRelatedDataFromJSON(
 }
 
 void User::loadUserClientFromJSON(
-    Json::Value data,
+    const Json::Value &data,
     std::set<Poco::UInt64> *alive) {
 
     // alive can be 0, dont assert/check it
@@ -959,7 +1270,7 @@ void User::loadUserClientFromJSON(
 
     if (!model) {
         model = new Client();
-        related.Clients.push_back(model);
+        related.Add(model);
     }
     if (alive) {
         alive->insert(id);
@@ -969,7 +1280,7 @@ void User::loadUserClientFromJSON(
 }
 
 void User::loadUserProjectFromJSON(
-    Json::Value data,
+    const Json::Value &data,
     std::set<Poco::UInt64> *alive) {
 
     // alive can be 0, dont assert/check it
@@ -995,7 +1306,7 @@ void User::loadUserProjectFromJSON(
 
     if (!model) {
         model = new Project();
-        related.Projects.push_back(model);
+        related.Add(model);
     }
     if (alive) {
         alive->insert(id);
@@ -1005,7 +1316,7 @@ void User::loadUserProjectFromJSON(
 }
 
 void User::loadUserTimeEntryFromJSON(
-    Json::Value data,
+    const Json::Value &data,
     std::set<Poco::UInt64> *alive) {
 
     // alive can be 0, dont assert/check it
@@ -1023,6 +1334,14 @@ void User::loadUserTimeEntryFromJSON(
     }
 
     if (!data["server_deleted_at"].asString().empty()) {
+        if (!model && related.ResidentTimeEntriesSince) {
+            // Time entry may be in database only,
+            // let it be deleted from there
+            model = new TimeEntry();
+            model->SetID(id);
+            model->SetGUID(data["guid"].asString());
+            related.Add(model);
+        }
         if (model) {
             model->MarkAsDeletedOnServer();
         }
@@ -1031,7 +1350,7 @@ void User::loadUserTimeEntryFromJSON(
 
     if (!model) {
         model = new TimeEntry();
-        related.TimeEntries.push_back(model);
+        related.Add(model);
     }
     if (alive) {
         alive->insert(id);
@@ -1070,57 +1389,82 @@ error User::LoginToken(
 }
 
 error User::updateJSON(
-    std::vector<Client *> * const clients,
-    std::vector<Project *> * const projects,
-    std::vector<TimeEntry *> * const time_entries,
+    const std::vector<BaseModel *> &models,
+    size_t *next,
     std::string *result) const {
 
-    poco_check_ptr(clients);
-    poco_check_ptr(projects);
-    poco_check_ptr(time_entries);
+    poco_check_ptr(next);
+    poco_check_ptr(result);
 
-    Json::Value c;
+    size_t end = batchEnd(*next, models.size());
 
-    // First, clients, because projects depend on clients
-    for (std::vector<Client *>::const_iterator it =
-        clients->begin();
-            it != clients->end(); it++) {
-        Json::Value update;
-        error err = (*it)->BatchUpdateJSON(&update);
-        if (err != noError) {
-            return err;
-        }
-        c.append(update);
+    // Buffer keeps its capacity from earlier batches
+    result->clear();
+    if (*next >= end) {
+        return noError;
     }
 
-    // First, projects, because time entries depend on projects
-    for (std::vector<Project *>::const_iterator it =
-        projects->begin();
-            it != projects->end(); it++) {
-        Json::Value update;
-        error err = (*it)->BatchUpdateJSON(&update);
+    JSONWriter writer(result);
+    writer.BeginArray();
+    for (size_t i = *next; i < end; i++) {
+        error err = models[i]->WriteBatchUpdateJSON(&writer);
         if (err != noError) {
             return err;
         }
-        c.append(update);
     }
+    writer.EndArray();
+    *next = end;
 
-    // Time entries go last
-    for (std::vector<TimeEntry *>::const_iterator it =
-        time_entries->begin();
-            it != time_entries->end(); it++) {
-        Json::Value update;
-        error err = (*it)->BatchUpdateJSON(&update);
-        if (err != noError) {
-            return err;
-        }
-        c.append(update);
+    return noError;
+}
+
+size_t User::batchEnd(const size_t from, const size_t count) const {
+    if (push_batch_size_ && from + push_batch_size_ < count) {
+        return from + push_batch_size_;
     }
+    return count;
+}
 
-    Json::StyledWriter writer;
-    *result = writer.write(c);
+bool User::resolvePushReferences(
+    const std::vector<BaseModel *> &models,
+    const size_t from) {
 
-    return noError;
+    size_t end = batchEnd(from, models.size());
+
+    std::set<guid> batch;
+    for (size_t i = from; i < end; i++) {
+        batch.insert(models[i]->GUID());
+    }
+
+    bool resolved(true);
+    for (size_t i = from; i < end; i++) {
+        BaseModel *model = models[i];
+        BaseModel *referred = nullptr;
+        if (kModelTimeEntry == model->ModelName()) {
+            TimeEntry *te = static_cast<TimeEntry *>(model);
+            if (te->PID() || te->ProjectGUID().empty()) {
+                continue;
+            }
+            referred = related.ProjectByGUID(te->ProjectGUID());
+            if (referred && referred->ID()) {
+                te->SetPID(referred->ID());
+            }
+        } else if (kModelProject == model->ModelName()) {
+            Project *p = static_cast<Project *>(model);
+            if (p->CID() || p->ClientGUID().empty()) {
+                continue;
+            }
+            referred = related.ClientByGUID(p->ClientGUID());
+            if (referred && referred->ID()) {
+                p->SetCID(referred->ID());
+            }
+        }
+        if (referred && !referred->ID()
+                && batch.find(referred->GUID()) == batch.end()) {
+            resolved = false;
+        }
+    }
+    return resolved;
 }
 
 std::string User::generateKey(const std::string password) {
@@ -1243,7 +1587,7 @@ error User::EnableOfflineLogin(
 
 template<class T>
 void deleteZombies(
-    const std::vector<T> &list,
+    const ModelList<T> &list,
     const std::set<Poco::UInt64> &alive) {
     for (size_t i = 0; i < list.size(); ++i) {
         BaseModel *model = list[i];
@@ -1261,8 +1605,8 @@ void deleteZombies(
 
 template <typename T>
 void deleteRelatedModelsWithWorkspace(const Poco::UInt64 wid,
-                                      std::vector<T *> *list) {
-    typedef typename std::vector<T *>::iterator iterator;
+                                      ModelList<T> *list) {
+    typedef typename ModelList<T>::const_iterator iterator;
     for (iterator it = list->begin(); it != list->end(); it++) {
         T *model = *it;
         if (model->WID() == wid) {
@@ -1273,8 +1617,8 @@ void deleteRelatedModelsWithWorkspace(const Poco::UInt64 wid,
 
 template <typename T>
 void removeProjectFromRelatedModels(const Poco::UInt64 pid,
-                                    std::vector<T *> *list) {
-    typedef typename std::vector<T *>::iterator iterator;
+                                    ModelList<T> *list) {
+    typedef typename ModelList<T>::const_iterator iterator;
     for (iterator it = list->begin(); it != list->end(); it++) {
         T *model = *it;
         if (model->PID() == pid) {
@@ -3,6 +3,7 @@
 #ifndef SRC_USER_H_
 #define SRC_USER_H_
 
+#include <istream>
 #include <map>
 #include <set>
 #include <string>
@@ -12,6 +13,8 @@
 
 #include "./base_model.h"
 #include "./batch_update_result.h"
+#include "./const.h"
+#include "./model_lock.h"
 #include "./related_data.h"
 #include "./types.h"
 
@@ -19,6 +22,8 @@
 
 namespace toggl {
 
+class HTTPSResponseReader;
+class JSONStreamReader;
 class TogglClient;
 
 class User : public BaseModel {
@@ -33,18 +38,46 @@ class User : public BaseModel {
     store_start_and_stop_time_(true),
     timeofday_format_(""),
     duration_format_(""),
-    offline_data_("") {}
+    offline_data_(""),
+    push_batch_size_(kBatchUpdateMaxSize),
+    model_lock_(nullptr) {}
 
     ~User();
 
     error EnableOfflineLogin(
         const std::string password);
 
+    // Pull all user data, and mark models that
+    // are not in it as deleted on server
     error PullAllUserData(TogglClient *https_client);
+
+    // Pull only what changed since the last pull. Falls back to
+    // pulling all data if there is no earlier pull, or if the
+    // server has older data than the last pull gave.
     error PullChanges(TogglClient *https_client);
+
+    // Push changed models in batches of at most PushBatchSize()
+    // models: clients first, then projects, then time entries.
+    // Monitor, if given, is told when each batch has been applied.
     error PushChanges(
         TogglClient *https_client,
-        bool *had_something_to_push);
+        bool *had_something_to_push,
+        BatchUpdateMonitor *monitor = nullptr);
+
+    // Zero pushes all changes in one batch
+    const Poco::UInt64 &PushBatchSize() const {
+        return push_batch_size_;
+    }
+    void SetPushBatchSize(const Poco::UInt64 value) {
+        push_batch_size_ = value;
+    }
+
+    // Lock that guards this user and its related data, if shared
+    // between threads. Pulls and pushes hold it only while they
+    // read or change models, not while waiting for the network.
+    void SetModelLock(ModelLock *value) {
+        model_lock_ = value;
+    }
 
     std::string String() const;
 
@@ -55,7 +88,7 @@ class User : public BaseModel {
 
     template<typename T>
     void CollectPushableModels(
-        const std::vector<T *> list,
+        const ModelList<T> &list,
         std::vector<T *> *result,
         std::map<std::string, BaseModel *> *models = nullptr) const;
 
@@ -64,12 +97,14 @@ class User : public BaseModel {
         return RunningTimeEntry() != nullptr;
     }
 
+    // New time entry gets the given GUID, if any
     TimeEntry *Start(
         const std::string description,
         const std::string duration,
         const Poco::UInt64 task_id,
         const Poco::UInt64 project_id,
-        const std::string project_guid);
+        const std::string project_guid,
+        const std::string guid = "");
 
     toggl::error Continue(
         const std::string GUID);
@@ -168,6 +203,12 @@ class User : public BaseModel {
         const std::string &json,
         const bool &including_related_data);
 
+    // Same as above, but models are loaded one at a time while
+    // the JSON is read, so the whole document is never in memory.
+    error LoadUserAndRelatedDataFromJSONStream(
+        std::istream *in,
+        const bool &including_related_data);
+
     error SetAPITokenFromOfflineData(const std::string password);
 
     static error UserID(
@@ -196,44 +237,74 @@ class User : public BaseModel {
         std::string *user_data,
         const Poco::UInt64 since);
 
+    static error Me(
+        TogglClient *https_client,
+        const std::string email,
+        const std::string password,
+        HTTPSResponseReader *user_data_reader,
+        const Poco::UInt64 since);
+
  private:
+    // Serialize the next batch of models, starting from *next,
+    // and move *next past it. Result is empty if none are left.
     error updateJSON(
-        std::vector<Client *> * const,
-        std::vector<Project *> * const,
-        std::vector<TimeEntry *> * const,
+        const std::vector<BaseModel *> &models,
+        size_t *next,
         std::string *result) const;
 
+    // End of the batch starting from models[from]
+    size_t batchEnd(const size_t from, const size_t count) const;
+
+    // Refer to pushed clients and projects by the IDs they got from
+    // server, in the batch starting from models[from]. The server
+    // resolves GUID references only within a batch, so returns false
+    // if a model refers to one that is yet to get its ID from an
+    // earlier batch.
+    bool resolvePushReferences(
+        const std::vector<BaseModel *> &models,
+        const size_t from);
+
+    error pullUserData(
+        TogglClient *https_client,
+        const Poco::UInt64 since);
+
     void loadUserTagFromJSON(
-        Json::Value data,
+        const Json::Value &data,
         std::set<Poco::UInt64> *alive = nullptr);
 
     void loadUserAndRelatedDataFromJSON(
-        Json::Value node,
+        const Json::Value &node,
+        const bool &including_related_data);
+
+    void loadUserAndRelatedDataFromJSONStream(
+        JSONStreamReader *reader,
         const bool &including_related_data);
 
     void loadUserUpdateFromJSON(
-        Json::Value list);
+        const Json::Value &node);
 
     void loadUserProjectFromJSON(
-        Json::Value data,
+        const Json::Value &data,
         std::set<Poco::UInt64> *alive = nullptr);
 
     void loadUserWorkspaceFromJSON(
-        Json::Value data,
+        const Json::Value &data,
         std::set<Poco::UInt64> *alive = nullptr);
 
     void loadUserClientFromJSON(
-        Json::Value data,
+        const Json::Value &data,
         std::set<Poco::UInt64> *alive = nullptr);
 
     void loadUserTaskFromJSON(
-        Json::Value data,
+        const Json::Value &data,
         std::set<Poco::UInt64> *alive = nullptr);
 
     void loadUserTimeEntryFromJSON(
-        Json::Value data,
+        const Json::Value &data,
         std::set<Poco::UInt64> *alive = nullptr);
 
+    static std::string meRelativeURL(const Poco::UInt64 since);
+
     std::string dirtyObjectsJSON(std::vector<TimeEntry *> * const) const;
 
     void processResponseArray(
@@ -268,20 +339,22 @@ class User : public BaseModel {
     std::string timeofday_format_;
     std::string duration_format_;
     std::string offline_data_;
+    Poco::UInt64 push_batch_size_;
+    ModelLock *model_lock_;
 };
 
 template<class T>
 void deleteZombies(
-    const std::vector<T> &list,
+    const ModelList<T> &list,
     const std::set<Poco::UInt64> &alive);
 
 template <typename T>
 void deleteRelatedModelsWithWorkspace(const Poco::UInt64 wid,
-                                      std::vector<T *> *list);
+                                      ModelList<T> *list);
 
 template <typename T>
 void removeProjectFromRelatedModels(const Poco::UInt64 pid,
-                                    std::vector<T *> *list);
+                                    ModelList<T> *list);
 
 }  // namespace toggl
 
@@ -0,0 +1,256 @@
+// Copyright 2015 Toggl Desktop developers.
+
+#include "../src/view_snapshot.h"
+
+#include <algorithm>
+#include <functional>
+
+#include "./const.h"
+#include "./formatter.h"
+#include "./related_data.h"
+#include "./time_entry.h"
+#include "./user.h"
+
+#include "Poco/LocalDateTime.h"
+#include "Poco/Timestamp.h"
+
+namespace toggl {
+
+TimeEntryViewData::TimeEntryViewData(
+    TimeEntry * const te,
+    const RelatedData &related)
+    : GUID(te->GUID())
+, Description(te->Description())
+, WID(te->WID())
+, TID(te->TID())
+, PID(te->PID())
+, DurationInSeconds(te->DurationInSeconds())
+, Start(te->Start())
+, Stop(te->Stop())
+, Billable(te->Billable())
+, Tags(te->Tags())
+, UpdatedAt(te->UpdatedAt())
+, DurOnly(te->DurOnly())
+, ValidationError(te->ValidationError()) {
+    related.ProjectLabelAndColorCode(te,
+                                     &WorkspaceName,
+                                     &ProjectAndTaskLabel,
+                                     &TaskLabel,
+                                     &ProjectLabel,
+                                     &ClientLabel,
+                                     &Color);
+}
+
+std::string TimeEntryViewData::DateHeader() const {
+    return Formatter::FormatDateHeader(Start);
+}
+
+ViewSnapshot::ViewSnapshot()
+    : version_(0)
+, logged_in_(false)
+, time_entry_count_(0)
+, time_entry_autocomplete_(new std::vector<AutocompleteItem>())
+, minitimer_autocomplete_(new std::vector<AutocompleteItem>())
+, project_autocomplete_(new std::vector<AutocompleteItem>()) {
+    for (size_t i = 0; i < kViewSnapshotGUIDBuckets; i++) {
+        by_guid_.push_back(new GUIDBucket());
+    }
+}
+
+// Same order as CompareTimeEntriesByStart
+bool ViewSnapshot::compareByStart(
+    const TimeEntryViewDataPtr &a,
+    const TimeEntryViewDataPtr &b) {
+    if (a->Start != b->Start) {
+        return a->Start < b->Start;
+    }
+    return a->GUID < b->GUID;
+}
+
+// Same dates as Formatter::FormatDateHeader
+int ViewSnapshot::DayOf(const Poco::UInt64 start) {
+    Poco::LocalDateTime datetime(Poco::Timestamp::fromEpochTime(start));
+    return datetime.year() * 10000 + datetime.month() * 100 + datetime.day();
+}
+
+size_t ViewSnapshot::bucketOf(const guid &GUID) const {
+    return std::hash<std::string>()(GUID) % by_guid_.size();
+}
+
+ViewSnapshot::GUIDBucket *ViewSnapshot::bucketForWrite(const guid &GUID) {
+    GUIDBucketPtr &bucket = by_guid_[bucketOf(GUID)];
+    if (bucket.referenceCount() > 1) {
+        bucket = new GUIDBucket(*bucket);
+    }
+    return bucket.get();
+}
+
+ViewSnapshot::Day *ViewSnapshot::dayForWrite(const int day) {
+    DayPtr &result = days_[day];
+    if (result.isNull()) {
+        result = new Day();
+    } else if (result.referenceCount() > 1) {
+        result = new Day(*result);
+    }
+    return result.get();
+}
+
+void ViewSnapshot::add(const TimeEntryViewDataPtr &te) {
+    (*bucketForWrite(te->GUID))[te->GUID] = te;
+    time_entry_count_++;
+
+    Day *day = dayForWrite(DayOf(te->Start));
+    day->TimeEntries.insert(
+        std::lower_bound(day->TimeEntries.begin(), day->TimeEntries.end(),
+                         te, compareByStart), te);
+    if (te->DurationInSeconds < 0) {
+        day->Running.push_back(te);
+        running_ = te;
+    } else {
+        day->StoppedTotal += te->DurationInSeconds;
+    }
+}
+
+void ViewSnapshot::remove(const TimeEntryViewData &te) {
+    // The time entry may be freed once it is out of the buckets
+    TimeEntryViewDataPtr keep = by_guid_[bucketOf(te.GUID)]->at(te.GUID);
+
+    bucketForWrite(te.GUID)->erase(te.GUID);
+    time_entry_count_--;
+
+    int key = DayOf(te.Start);
+    Day *day = dayForWrite(key);
+    std::vector<TimeEntryViewDataPtr>::iterator it =
+        std::lower_bound(day->TimeEntries.begin(), day->TimeEntries.end(),
+                         keep, compareByStart);
+    poco_assert(it != day->TimeEntries.end() && it->get() == &te);
+    day->TimeEntries.erase(it);
+    if (te.DurationInSeconds < 0) {
+        for (it = day->Running.begin(); it != day->Running.end(); it++) {
+            if (it->get() == &te) {
+                day->Running.erase(it);
+                break;
+            }
+        }
+    } else {
+        day->StoppedTotal -= te.DurationInSeconds;
+    }
+    if (day->TimeEntries.empty()) {
+        days_.erase(key);
+    }
+
+    if (running_.get() == &te) {
+        running_ = nullptr;
+    }
+}
+
+static bool isVisible(TimeEntry * const te) {
+    return te && !te->GUID().empty() && !te->DeletedAt();
+}
+
+ViewSnapshot *ViewSnapshot::Next(
+    const ViewSnapshot &previous,
+    User *user,
+    const ViewSnapshotChanges &changes) {
+
+    ViewSnapshot *result = new ViewSnapshot();
+    result->version_ = previous.version_ + 1;
+
+    if (!user) {
+        return result;
+    }
+
+    result->logged_in_ = true;
+
+    RelatedData &related = user->related;
+
+    if (changes.AllTimeEntries || !previous.logged_in_) {
+        for (std::vector<TimeEntry *>::const_iterator it =
+            related.TimeEntries.begin();
+                it != related.TimeEntries.end(); it++) {
+            TimeEntry *te = *it;
+            if (isVisible(te)) {
+                result->add(new TimeEntryViewData(te, related));
+            }
+        }
+    } else {
+        // Share everything, then copy the buckets of changed time entries
+        result->by_guid_ = previous.by_guid_;
+        result->days_ = previous.days_;
+        result->time_entry_count_ = previous.time_entry_count_;
+        result->running_ = previous.running_;
+        for (std::set<guid>::const_iterator it = changes.TimeEntries.begin();
+                it != changes.TimeEntries.end(); it++) {
+            const TimeEntryViewData *old = result->TimeEntryByGUID(*it);
+            if (old) {
+                result->remove(*old);
+            }
+            TimeEntry *te = related.TimeEntryByGUID(*it);
+            if (isVisible(te)) {
+                result->add(new TimeEntryViewData(te, related));
+            }
+        }
+    }
+
+    // Autocomplete lists are shared with the previous
+    // version, unless they have to be built again
+    if (changes.TimeEntryAutocomplete || !previous.logged_in_) {
+        result->time_entry_autocomplete_ = new std::vector<AutocompleteItem>(
+            related.TimeEntryAutocompleteItems());
+    } else {
+        result->time_entry_autocomplete_ = previous.time_entry_autocomplete_;
+    }
+    if (changes.MinitimerAutocomplete || !previous.logged_in_) {
+        result->minitimer_autocomplete_ = new std::vector<AutocompleteItem>(
+            related.MinitimerAutocompleteItems());
+    } else {
+        result->minitimer_autocomplete_ = previous.minitimer_autocomplete_;
+    }
+    if (changes.ProjectAutocomplete || !previous.logged_in_) {
+        result->project_autocomplete_ = new std::vector<AutocompleteItem>(
+            related.ProjectAutocompleteItems());
+    } else {
+        result->project_autocomplete_ = previous.project_autocomplete_;
+    }
+
+    return result;
+}
+
+const TimeEntryViewData *ViewSnapshot::TimeEntryByGUID(
+    const guid &GUID) const {
+    const GUIDBucket &bucket = *by_guid_[bucketOf(GUID)];
+    GUIDBucket::const_iterator it = bucket.find(GUID);
+    if (it == bucket.end()) {
+        return nullptr;
+    }
+    return it->second.get();
+}
+
+std::vector<TimeEntryViewDataPtr> ViewSnapshot::TimeEntries() const {
+    std::vector<TimeEntryViewDataPtr> result;
+    result.reserve(time_entry_count_);
+    for (std::map<int, DayPtr>::const_iterator it = days_.begin();
+            it != days_.end(); it++) {
+        result.insert(result.end(),
+                      it->second->TimeEntries.begin(),
+                      it->second->TimeEntries.end());
+    }
+    return result;
+}
+
+Poco::Int64 ViewSnapshot::DateTotal(const TimeEntryViewData &te) const {
+    std::map<int, DayPtr>::const_iterator it = days_.find(DayOf(te.Start));
+    if (it == days_.end()) {
+        return 0;
+    }
+    const Day &day = *it->second;
+    Poco::Int64 result = day.StoppedTotal;
+    for (std::vector<TimeEntryViewDataPtr>::const_iterator running =
+        day.Running.begin();
+            running != day.Running.end(); running++) {
+        result += TimeEntry::AbsDuration((*running)->DurationInSeconds);
+    }
+    return result;
+}
+
+}   // namespace toggl
@@ -0,0 +1,215 @@
+// Copyright 2015 Toggl Desktop developers.
+
+#ifndef SRC_VIEW_SNAPSHOT_H_
+#define SRC_VIEW_SNAPSHOT_H_
+
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+
+#include "./autocomplete_item.h"
+#include "./types.h"
+
+#include "Poco/SharedPtr.h"
+#include "Poco/Types.h"
+
+namespace toggl {
+
+class RelatedData;
+class TimeEntry;
+class User;
+
+// A time entry as displayed in UI, copied out of the models
+class TimeEntryViewData {
+ public:
+    TimeEntryViewData()
+        : GUID("")
+    , Description("")
+    , WID(0)
+    , TID(0)
+    , PID(0)
+    , DurationInSeconds(0)
+    , Start(0)
+    , Stop(0)
+    , Billable(false)
+    , Tags("")
+    , UpdatedAt(0)
+    , DurOnly(false)
+    , ValidationError(noError)
+    , WorkspaceName("")
+    , ProjectAndTaskLabel("")
+    , TaskLabel("")
+    , ProjectLabel("")
+    , ClientLabel("")
+    , Color("") {}
+
+    TimeEntryViewData(TimeEntry * const te, const RelatedData &related);
+
+    // Date headers are relative to today,
+    // so they are not kept in the snapshot
+    std::string DateHeader() const;
+
+    guid GUID;
+    std::string Description;
+    Poco::UInt64 WID;
+    Poco::UInt64 TID;
+    Poco::UInt64 PID;
+    Poco::Int64 DurationInSeconds;
+    Poco::UInt64 Start;
+    Poco::UInt64 Stop;
+    bool Billable;
+    std::string Tags;
+    Poco::UInt64 UpdatedAt;
+    bool DurOnly;
+    error ValidationError;
+
+    std::string WorkspaceName;
+    std::string ProjectAndTaskLabel;
+    std::string TaskLabel;
+    std::string ProjectLabel;
+    std::string ClientLabel;
+    std::string Color;
+};
+
+// Shared between snapshots and never changed once built
+typedef Poco::SharedPtr<TimeEntryViewData> TimeEntryViewDataPtr;
+typedef Poco::SharedPtr<std::vector<AutocompleteItem> > AutocompleteListPtr;
+
+// What changed since the last snapshot
+class ViewSnapshotChanges {
+ public:
+    ViewSnapshotChanges()
+        : AllTimeEntries(false)
+    , TimeEntryAutocomplete(false)
+    , MinitimerAutocomplete(false)
+    , ProjectAutocomplete(false) {}
+
+    void SetAll() {
+        AllTimeEntries = true;
+        TimeEntryAutocomplete = true;
+        MinitimerAutocomplete = true;
+        ProjectAutocomplete = true;
+    }
+
+    // Copy all time entries again, for example when
+    // a project they are labelled with has changed
+    bool AllTimeEntries;
+
+    // Time entries to copy again, by GUID
+    std::set<guid> TimeEntries;
+
+    bool TimeEntryAutocomplete;
+    bool MinitimerAutocomplete;
+    bool ProjectAutocomplete;
+};
+
+// The user data as displayed in UI, as of one version of it.
+// A snapshot never changes once built, so any number of threads
+// may render from it at once, without locking the models. After
+// each change a new snapshot is built. Time entries are kept in
+// copy-on-write buckets, by GUID and by day, and the new snapshot
+// copies only the buckets the change touched; the rest, and all
+// unchanged time entries, are shared with the snapshot before it.
+class ViewSnapshot {
+ public:
+    // Empty snapshot, as when no user is logged in
+    ViewSnapshot();
+
+    // Build the next version. User must not change while it is
+    // copied; without a user, the snapshot is empty.
+    static ViewSnapshot *Next(
+        const ViewSnapshot &previous,
+        User *user,
+        const ViewSnapshotChanges &changes);
+
+    const Poco::UInt64 &Version() const {
+        return version_;
+    }
+    const bool &LoggedIn() const {
+        return logged_in_;
+    }
+
+    // Visible time entries, running ones included, oldest first.
+    // The list is put together on each call, for full renders.
+    std::vector<TimeEntryViewDataPtr> TimeEntries() const;
+    const size_t &TimeEntryCount() const {
+        return time_entry_count_;
+    }
+
+    const TimeEntryViewData *TimeEntryByGUID(const guid &GUID) const;
+    const TimeEntryViewData *RunningTimeEntry() const {
+        return running_.get();
+    }
+
+    // Total duration of the date of a time entry,
+    // running time entries included
+    Poco::Int64 DateTotal(const TimeEntryViewData &te) const;
+
+    // Local calendar date of a start time, as YYYYMMDD. Unlike
+    // date headers, it does not change when the day is over.
+    static int DayOf(const Poco::UInt64 start);
+
+    const std::vector<AutocompleteItem> &TimeEntryAutocomplete() const {
+        return *time_entry_autocomplete_;
+    }
+    const std::vector<AutocompleteItem> &MinitimerAutocomplete() const {
+        return *minitimer_autocomplete_;
+    }
+    const std::vector<AutocompleteItem> &ProjectAutocomplete() const {
+        return *project_autocomplete_;
+    }
+
+ private:
+    ViewSnapshot(const ViewSnapshot &);
+    ViewSnapshot &operator=(const ViewSnapshot &);
+
+    // Time entries started on one local date, oldest first
+    class Day {
+     public:
+        Day()
+            : StoppedTotal(0) {}
+
+        std::vector<TimeEntryViewDataPtr> TimeEntries;
+
+        // Durations of running time entries grow,
+        // so only stopped ones are totalled here
+        Poco::Int64 StoppedTotal;
+        std::vector<TimeEntryViewDataPtr> Running;
+    };
+
+    typedef Poco::SharedPtr<Day> DayPtr;
+    typedef std::map<guid, TimeEntryViewDataPtr> GUIDBucket;
+    typedef Poco::SharedPtr<GUIDBucket> GUIDBucketPtr;
+
+    static bool compareByStart(
+        const TimeEntryViewDataPtr &a,
+        const TimeEntryViewDataPtr &b);
+
+    size_t bucketOf(const guid &GUID) const;
+
+    // Buckets that are still shared are copied before writing
+    GUIDBucket *bucketForWrite(const guid &GUID);
+    Day *dayForWrite(const int day);
+
+    void add(const TimeEntryViewDataPtr &te);
+    void remove(const TimeEntryViewData &te);
+
+    Poco::UInt64 version_;
+    bool logged_in_;
+
+    std::vector<GUIDBucketPtr> by_guid_;
+    std::map<int, DayPtr> days_;
+    size_t time_entry_count_;
+    TimeEntryViewDataPtr running_;
+
+    AutocompleteListPtr time_entry_autocomplete_;
+    AutocompleteListPtr minitimer_autocomplete_;
+    AutocompleteListPtr project_autocomplete_;
+};
+
+typedef Poco::SharedPtr<ViewSnapshot> ViewSnapshotPtr;
+
+}  // namespace toggl
+
+#endif  // SRC_VIEW_SNAPSHOT_H_
@@ -0,0 +1,155 @@
+// Copyright 2015 Toggl Desktop developers.
+
+#include "../src/wakeup.h"
+
+#include "Poco/Exception.h"
+#include "Poco/Logger.h"
+#include "Poco/Net/DatagramSocket.h"
+#include "Poco/Net/Socket.h"
+#include "Poco/Net/SocketAddress.h"
+#include "Poco/Timespan.h"
+
+namespace toggl {
+
+// If no loopback socket can be opened, waiting on a socket
+// is done in slices of this length to notice signals
+#define kWakeupFallbackMillis 1000
+
+Poco::AtomicCounter Wakeup::count_;
+
+Wakeup::Wakeup()
+    : event_(false)
+, signalled_(false)
+, receiver_(nullptr)
+, sender_(nullptr) {}
+
+Wakeup::~Wakeup() {
+    delete receiver_;
+    receiver_ = nullptr;
+    delete sender_;
+    sender_ = nullptr;
+}
+
+Poco::Logger &Wakeup::logger() const {
+    return Poco::Logger::get("Wakeup");
+}
+
+Poco::UInt64 Wakeup::Count() {
+    return count_.value();
+}
+
+bool Wakeup::Wait(const long timeout_millis) {  // NOLINT
+    event_.tryWait(timeout_millis);
+    ++count_;
+
+    // Signal may have arrived just after the timeout
+    Poco::Mutex::ScopedLock lock(mutex_);
+    bool signalled = signalled_;
+    signalled_ = false;
+    event_.reset();
+    drainReceiver();
+    return signalled;
+}
+
+bool Wakeup::WaitReadable(
+    const Poco::Net::Socket &socket,
+    const long timeout_millis) {  // NOLINT
+
+    long wait_millis = timeout_millis;  // NOLINT
+    Poco::Net::Socket::SocketList read_list;
+    read_list.push_back(socket);
+    {
+        Poco::Mutex::ScopedLock lock(mutex_);
+        if (signalled_) {
+            signalled_ = false;
+            event_.reset();
+            drainReceiver();
+            return false;
+        }
+        if (openReceiver()) {
+            read_list.push_back(*receiver_);
+        } else if (wait_millis > kWakeupFallbackMillis) {
+            wait_millis = kWakeupFallbackMillis;
+        }
+    }
+
+    Poco::Net::Socket::SocketList write_list;
+    Poco::Net::Socket::SocketList except_list;
+    try {
+        Poco::Net::Socket::select(
+            read_list, write_list, except_list,
+            Poco::Timespan(wait_millis * Poco::Timespan::MILLISECONDS));
+    } catch(const Poco::Exception& exc) {
+        logger().error(exc.displayText());
+        read_list.clear();
+    }
+    ++count_;
+
+    bool readable(false);
+    for (Poco::Net::Socket::SocketList::const_iterator it =
+        read_list.begin(); it != read_list.end(); it++) {
+        if (*it == socket) {
+            readable = true;
+        }
+    }
+
+    Poco::Mutex::ScopedLock lock(mutex_);
+    if (signalled_) {
+        signalled_ = false;
+        event_.reset();
+        drainReceiver();
+    }
+    return readable;
+}
+
+void Wakeup::Signal() {
+    Poco::Mutex::ScopedLock lock(mutex_);
+    signalled_ = true;
+    event_.set();
+    if (!receiver_) {
+        return;
+    }
+    try {
+        const char c(0);
+        sender_->sendTo(&c, 1, receiver_->address());
+    } catch(const Poco::Exception& exc) {
+        logger().error(exc.displayText());
+    }
+}
+
+bool Wakeup::openReceiver() {
+    if (receiver_) {
+        return true;
+    }
+    try {
+        Poco::Net::SocketAddress loopback("127.0.0.1", 0);
+        receiver_ = new Poco::Net::DatagramSocket(loopback);
+        receiver_->setBlocking(false);
+        sender_ = new Poco::Net::DatagramSocket(
+            Poco::Net::IPAddress::IPv4);
+        return true;
+    } catch(const Poco::Exception& exc) {
+        logger().error(exc.displayText());
+    }
+    delete receiver_;
+    receiver_ = nullptr;
+    delete sender_;
+    sender_ = nullptr;
+    return false;
+}
+
+void Wakeup::drainReceiver() {
+    if (!receiver_) {
+        return;
+    }
+    try {
+        char buf[64];
+        while (receiver_->available() > 0) {
+            receiver_->receiveBytes(buf, sizeof(buf));
+        }
+    } catch(const Poco::Exception& exc) {
+        logger().error(exc.displayText());
+    }
+}
+
+}   // namespace toggl
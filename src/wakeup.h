@@ -0,0 +1,67 @@
+// Copyright 2015 Toggl Desktop developers.
+
+#ifndef SRC_WAKEUP_H_
+#define SRC_WAKEUP_H_
+
+#include "Poco/AtomicCounter.h"
+#include "Poco/Event.h"
+#include "Poco/Mutex.h"
+#include "Poco/Types.h"
+
+namespace Poco {
+class Logger;
+
+namespace Net {
+class DatagramSocket;
+class Socket;
+}
+}
+
+namespace toggl {
+
+// Lets a background activity block until it has something to do,
+// instead of sleeping in short increments to notice shutdown.
+// Signal() ends the current or the next wait, so a signal is
+// never lost even if it arrives before the activity starts waiting.
+class Wakeup {
+ public:
+    Wakeup();
+    ~Wakeup();
+
+    // Block until signalled or until the timeout passes.
+    // Returns true if signalled.
+    bool Wait(const long timeout_millis);  // NOLINT
+
+    // Block until the socket has data to read, or until signalled
+    // or the timeout passes. Returns true if the socket is readable.
+    bool WaitReadable(
+        const Poco::Net::Socket &socket,
+        const long timeout_millis);  // NOLINT
+
+    void Signal();
+
+    // Number of times any waiting activity has woken up,
+    // for measuring how often the app wakes up while idle
+    static Poco::UInt64 Count();
+
+ private:
+    // Loopback socket that Signal() writes to, so that
+    // waiting on a socket can be interrupted as well
+    bool openReceiver();
+    void drainReceiver();
+
+    Poco::Logger &logger() const;
+
+    Poco::Mutex mutex_;
+    Poco::Event event_;
+    bool signalled_;
+
+    Poco::Net::DatagramSocket *receiver_;
+    Poco::Net::DatagramSocket *sender_;
+
+    static Poco::AtomicCounter count_;
+};
+
+}  // namespace toggl
+
+#endif  // SRC_WAKEUP_H_
@@ -70,6 +70,7 @@ void WebSocketClient::Shutdown() {
         return;
     }
     activity_.stop();  // request stop
+    wakeup_.Signal();
     activity_.wait();  // wait until activity actually stops
 
     deleteSession();
@@ -154,7 +155,7 @@ void WebSocketClient::authenticate() {
     c["type"] = "authenticate";
     c["api_token"] = api_token_;
 
-    Json::StyledWriter writer;
+    Json::FastWriter writer;
     std::string payload = writer.write(c);
 
     ws_->sendFrame(payload.data(),
@@ -184,6 +185,12 @@ std::string WebSocketClient::parseWebSocketMessageType(
 
 const int kWebsocketBufSize = 1024 * 10;
 
+// Wait after a failed connection, before trying again
+const long kWebsocketRetryMillis = 10000;  // NOLINT
+
+// Shortest wait between checks of connection state
+const long kWebsocketMinWaitMillis = 1000;  // NOLINT
+
 error WebSocketClient::receiveWebSocketMessage(std::string *message) {
     int flags = Poco::Net::WebSocket::FRAME_BINARY;
     std::string json("");
@@ -208,8 +215,7 @@ const std::string kPong("{\"type\": \"pong\"}");
 
 error WebSocketClient::poll() {
     try {
-        Poco::Timespan span(250 * Poco::Timespan::MILLISECONDS);
-        if (!ws_->poll(span, Poco::Net::Socket::SELECT_READ)) {
+        if (!ws_->poll(Poco::Timespan(0), Poco::Net::Socket::SELECT_READ)) {
             return noError;
         }
 
@@ -263,11 +269,9 @@ void WebSocketClient::runActivity() {
                 logger().debug("encountered an error and will delete session");
                 deleteSession();
                 logger().debug("will sleep for 10 sec");
-                for (int i = 0; i < 20; i++) {
-                    if (activity_.isStopped()) {
-                        return;
-                    }
-                    Poco::Thread::sleep(500);
+                wakeup_.Wait(kWebsocketRetryMillis);
+                if (activity_.isStopped()) {
+                    return;
                 }
                 logger().debug("sleep done");
             }
@@ -279,21 +283,33 @@ void WebSocketClient::runActivity() {
             error err = createSession();
             if (err != noError) {
                 logger().error(err);
-                for (int i = 0; i < 20; i++) {
-                    if (activity_.isStopped()) {
-                        return;
-                    }
-                    Poco::Thread::sleep(500);
+                wakeup_.Wait(kWebsocketRetryMillis);
+                if (activity_.isStopped()) {
+                    return;
                 }
             }
         }
 
-        Poco::Thread::sleep(1000);
+        waitForMessage(restart_interval);
     }
 
     logger().debug("activity finished");
 }
 
+void WebSocketClient::waitForMessage(const int restart_interval) {
+    std::time_t restart_at = last_connection_at_ + restart_interval + 1;
+    long wait_millis = (restart_at - time(0)) * 1000;  // NOLINT
+    if (wait_millis < kWebsocketMinWaitMillis) {
+        wait_millis = kWebsocketMinWaitMillis;
+    }
+
+    if (!ws_) {
+        wakeup_.Wait(wait_millis);
+        return;
+    }
+    wakeup_.WaitReadable(*ws_, wait_millis);
+}
+
 void WebSocketClient::deleteSession() {
     logger().debug("deleteSession");
 
@@ -10,6 +10,7 @@
 #include "Poco/Activity.h"
 
 #include "./types.h"
+#include "./wakeup.h"
 
 namespace Poco {
 class Logger;
@@ -68,9 +69,13 @@ class WebSocketClient {
 
     int nextWebsocketRestartInterval();
 
+    // Wait for data from server, or shutdown, until restart is due
+    void waitForMessage(const int restart_interval);
+
     Poco::Logger &logger() const;
 
     Poco::Activity<WebSocketClient> activity_;
+    Wakeup wakeup_;
     Poco::Net::HTTPSClientSession *session_;
     Poco::Net::HTTPRequest *req_;
     Poco::Net::HTTPResponse *res_;
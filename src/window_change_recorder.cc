@@ -8,7 +8,6 @@
 #include "./const.h"
 
 #include "Poco/Logger.h"
-#include "Poco/Thread.h"
 
 namespace toggl {
 
@@ -79,11 +78,7 @@ void WindowChangeRecorder::inspectFocusedWindow() {
             event.filename = last_filename_;
             event.title = last_title_;
             event.idle = false;
-
-            error err = timeline_datasource_->StartTimelineEvent(&event);
-            if (err != noError) {
-                logger().error(err);
-            }
+            chunks_.Add(event);
         }
     }
 
@@ -91,23 +86,50 @@ void WindowChangeRecorder::inspectFocusedWindow() {
     last_filename_ = filename;
     last_idle_ = idle;
     last_event_started_at_ = now;
+
+    // Events recorded from now on start after this one,
+    // so chunks before its chunk are complete.
+    std::vector<TimelineEvent> completed;
+    chunks_.TakeCompleted(last_event_started_at_, &completed);
+    saveTimeline(&completed);
 }
 
-void WindowChangeRecorder::recordLoop() {
-    while (!recording_.isStopped()) {
-        inspectFocusedWindow();
+void WindowChangeRecorder::saveTimeline(std::vector<TimelineEvent> *events) {
+    for (std::vector<TimelineEvent>::iterator it = events->begin();
+            it != events->end(); it++) {
+        error err = timeline_datasource_->StartTimelineEvent(&(*it));
+        if (err != noError) {
+            logger().error(err);
+        }
+    }
+}
 
-        if (recording_.isStopped()) {
-            break;
+int WindowChangeRecorder::waitMillis() const {
+    // Autotracker must hear of a window once it
+    // has been focused for long enough
+    if (last_event_started_at_ > 0 && !last_idle_
+            && last_autotracker_title_ != last_title_) {
+        time_t due = last_event_started_at_ + kAutotrackerThresholdSeconds;
+        time_t now = time(0);
+        if (due <= now) {
+            return kWindowChangeMinWaitMillis;
+        }
+        if (due - now < kWindowChangeMaxWaitMillis / 1000) {
+            return static_cast<int>(due - now) * 1000;
         }
+    }
+    return kWindowChangeMaxWaitMillis;
+}
 
-        Poco::Thread::sleep(250);
+void WindowChangeRecorder::recordLoop() {
+    while (!recording_.isStopped()) {
+        inspectFocusedWindow();
 
         if (recording_.isStopped()) {
             break;
         }
 
-        Poco::Thread::sleep(250);
+        waitForFocusedWindowChange(waitMillis());
     }
 }
 
@@ -115,8 +137,14 @@ error WindowChangeRecorder::Shutdown() {
     try {
         if (recording_.isRunning()) {
             recording_.stop();
+            interruptFocusedWindowWait();
             recording_.wait(5);
         }
+
+        // Incomplete chunks are saved as raw events
+        std::vector<TimelineEvent> events;
+        chunks_.TakeAll(&events);
+        saveTimeline(&events);
     } catch(const Poco::Exception& exc) {
         return exc.displayText();
     } catch(const std::exception& ex) {
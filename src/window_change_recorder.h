@@ -4,7 +4,9 @@
 #define SRC_WINDOW_CHANGE_RECORDER_H_
 
 #include <string>
+#include <vector>
 
+#include "./timeline_chunk_accumulator.h"
 #include "./timeline_notifications.h"
 #include "./types.h"
 
@@ -41,12 +43,18 @@ class WindowChangeRecorder {
  private:
     void inspectFocusedWindow();
 
+    // How long to wait for a window change before inspecting anyway
+    int waitMillis() const;
+
     bool hasWindowChanged(
         const std::string &title,
         const std::string &filename) const;
 
     bool hasIdlenessChanged(const bool &idle) const;
 
+    // Save the given chunks or events to timeline
+    void saveTimeline(std::vector<TimelineEvent> *events);
+
     Poco::Logger &logger();
 
     // Last window focus event data
@@ -57,6 +65,9 @@ class WindowChangeRecorder {
 
     TimelineDatasource *timeline_datasource_;
 
+    // Recorded events not yet saved to timeline
+    TimelineChunkAccumulator chunks_;
+
     Poco::Activity<WindowChangeRecorder> recording_;
 
     std::string last_autotracker_title_;
@@ -43,7 +43,7 @@ void Workspace::SetAdmin(const bool value) {
     }
 }
 
-void Workspace::LoadFromJSON(Json::Value n) {
+void Workspace::LoadFromJSON(const Json::Value &n) {
     SetID(n["id"].asUInt64());
     SetName(n["name"].asString());
     SetPremium(n["premium"].asBool());
@@ -9,6 +9,7 @@
 
 #include "./base_model.h"
 #include "./const.h"
+#include "./string_pool.h"
 
 namespace toggl {
 
@@ -51,10 +52,10 @@ class Workspace : public BaseModel {
         return "/api/v8/workspaces";
     }
 
-    void LoadFromJSON(Json::Value value);
+    void LoadFromJSON(const Json::Value &value);
 
  private:
-    std::string name_;
+    InternedString name_;
     bool premium_;
     bool only_admins_may_create_projects_;
     bool admin_;